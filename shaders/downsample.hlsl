@@ -1,8 +1,49 @@
-// Downsample from 128 bpp to 32 bpp.
+// Downsample from 128 bpp (or 64 bpp fixed point) to 32 bpp.
 
-Texture2D<float4> source_texture : register(t0);
 RWTexture2D<unorm float4> dest_texture : register(u0);
 
+#if MOSAMPLE_FIXED
+
+cbuffer mosample_buffer_1 : register(b1)
+{
+    uint4 mosample_to_fixed[64];
+    uint4 mosample_fixed_thresholds[64]; // Lowest fixed point value that becomes every 8 bit value.
+};
+
+Texture2D<uint4> source_texture : register(t0);
+
+// Largest 8 bit value whose threshold is not above the fixed point value.
+uint from_fixed(uint v)
+{
+    uint idx = 0;
+
+    [unroll]
+    for (uint step = 128; step > 0; step >>= 1)
+    {
+        uint next = idx + step;
+
+        if (v >= mosample_fixed_thresholds[next >> 2][next & 3])
+        {
+            idx = next;
+        }
+    }
+
+    return idx;
+}
+
+// This must be synchronized with the compute shader Dispatch call in CPU code!
+[numthreads(8, 8, 1)]
+void main(uint3 dtid : SV_DispatchThreadID)
+{
+    uint2 pos = dtid.xy;
+    uint4 source_pix = source_texture.Load(dtid);
+    dest_texture[pos] = float4(from_fixed(source_pix.r), from_fixed(source_pix.g), from_fixed(source_pix.b), 255.0f) / 255.0f;
+}
+
+#else
+
+Texture2D<float4> source_texture : register(t0);
+
 float4 from_linear(float4 v)
 {
     return pow(max(v, 0.0f), 1.0f / 2.2f);
@@ -16,3 +57,5 @@ void main(uint3 dtid : SV_DispatchThreadID)
     float4 source_pix = from_linear(source_texture.Load(dtid)); // Must go back from linear space used in mosample.
     dest_texture[pos] = source_pix;
 }
+
+#endif
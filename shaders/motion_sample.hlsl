@@ -1,9 +1,46 @@
 cbuffer mosample_buffer_0 : register(b0)
 {
     float mosample_weight;
+    float mosample_weight_start; // Sum of the weights before this frame in the movie frame.
+    float mosample_weight_end; // Sum of the weights including this frame.
 };
 
 Texture2D<unorm float4> source_texture : register(t0);
+
+#if MOSAMPLE_FIXED
+
+// Fixed point format, with 65535 as a linear value of 1. Same as svr_mosample.cpp, which also has the tables.
+// Alpha is not used.
+
+cbuffer mosample_buffer_1 : register(b1)
+{
+    uint4 mosample_to_fixed[64]; // Fixed point value of every 8 bit value.
+    uint4 mosample_fixed_thresholds[64];
+};
+
+RWTexture2D<uint4> dest_texture : register(u0);
+
+uint to_fixed(uint v)
+{
+    return mosample_to_fixed[v >> 2][v & 3];
+}
+
+// This must be synchronized with the compute shader Dispatch call in CPU code!
+[numthreads(8, 8, 1)]
+void main(uint3 dtid : SV_DispatchThreadID)
+{
+    uint3 source_pix = (uint3)(source_texture.Load(dtid).rgb * 255.0f + 0.5f);
+    float3 fixed_pix = float3(to_fixed(source_pix.r), to_fixed(source_pix.g), to_fixed(source_pix.b));
+
+    // Rounding the sums of the weights instead of the weight makes the rounding cancel out over the movie frame.
+    uint3 add = (uint3)(floor(fixed_pix * mosample_weight_end + 0.5f) - floor(fixed_pix * mosample_weight_start + 0.5f));
+
+    uint3 new_pix = min(dest_texture[dtid.xy].rgb + add, 65535u);
+    dest_texture[dtid.xy] = uint4(new_pix, 0);
+}
+
+#else
+
 RWTexture2D<float4> dest_texture : register(u0);
 
 float4 to_linear(float4 v)
@@ -20,3 +57,5 @@ void main(uint3 dtid : SV_DispatchThreadID)
     float4 new_pix = dest_texture[dtid.xy] + source_pix * mosample_weight;
     dest_texture[dtid.xy] = new_pix;
 }
+
+#endif
@@ -1,12 +1,15 @@
 #pragma once
 #include "svr_common.h"
+#include "svr_atom.h"
 
 // Shared stuff between 32-bit svr_game and 64-bit svr_encoder.
 
 // All Windows handles only use 32 bits of data, so we can safely refer to them in here as u32 with _h in the name.
 // https://learn.microsoft.com/en-us/windows/win32/winprog64/interprocess-communication
 
-const s32 ENCODER_MAX_SAMPLES = 4096; // How many samples can be stored at most in the buffer placed at audio_buffer_offset.
+const s32 ENCODER_AUDIO_RING_SAMPLES = 65536; // How many samples fit in the audio ring placed at audio_buffer_offset. Must be a power of 2.
+const s32 ENCODER_MAX_SAMPLES = 4096; // How many samples svr_game lets wait in the audio ring before it wakes svr_encoder up. This is also the most samples svr_encoder converts at once.
+const s32 ENCODER_NUM_VIDEO_TEXTURES = 4; // How many video frames svr_game can have written that svr_encoder has not taken yet.
 
 // Identifiers used by the DXGI lock for synchronizing with the shared texture.
 // You need to specify which device to give access to, so that's what these are.
@@ -20,10 +23,20 @@ enum /* EncoderSharedEvent */
     ENCODER_EVENT_NONE,
     ENCODER_EVENT_START, // Movie parameters will be setup. This event can fail.
     ENCODER_EVENT_STOP, // Rendering will stop. This event cannot fail.
-    ENCODER_EVENT_NEW_VIDEO, // Texture at game_texture_h will have new data. This event can fail.
-    ENCODER_EVENT_NEW_AUDIO, // New samples will be placed at audio_buffer_offset. This event can fail.
 };
 
+// Video frames are not events, because svr_game should not have to wait for svr_encoder to take every frame.
+// Video frame N is written to the texture at game_texture_hs[N % ENCODER_NUM_VIDEO_TEXTURES], then svr_game releases its keyed mutex to
+// ENCODER_PROC_ID, increments video_write_idx and sets encoder_wake_event_h. svr_encoder takes all frames up to video_write_idx every time it wakes up,
+// and gives each texture back by releasing it to ENCODER_GAME_ID. svr_game only has to wait when it wants to write to a texture that has not been given back.
+// svr_encoder takes the video frames before it handles an event, so video frames sent before ENCODER_EVENT_STOP are always included.
+
+// Audio samples are not events either. They are written to a ring of ENCODER_AUDIO_RING_SAMPLES at audio_buffer_offset, with only svr_game writing
+// and only svr_encoder reading. Sample N is at index N % ENCODER_AUDIO_RING_SAMPLES. svr_game copies the samples in and then increments audio_write_idx,
+// and svr_encoder converts the samples from there and then increments audio_read_idx, so the space can be written again.
+// The indexes only ever increase and are allowed to overflow, the number of waiting samples is always audio_write_idx - audio_read_idx as u32.
+// svr_encoder takes all waiting samples every time it wakes up, the same as the video frames. svr_game only has to wait if the ring is full.
+
 struct EncoderSharedMovieParams
 {
     char dest_file[256];
@@ -45,6 +58,11 @@ struct EncoderSharedMovieParams
     s32 x264_crf;
     bool x264_intra;
     bool use_audio;
+    s32 max_queued_mb; // Memory limit of uncompressed video frames waiting to be encoded. 0 for no limit.
+    bool cpu_conversion; // Convert to the video pixel format on the CPU instead of the GPU.
+    s32 chunk_threads; // Encode the video in chunks on this many codec contexts at once. 0 or 1 encodes the whole video on one codec context.
+    s32 chunk_frames; // Length of every chunk, which starts with a keyframe and does not reference the other chunks.
+    bool write_trace; // Write the trace of the encoder threads to data/ENCODER_TRACE.json when the movie ends.
 };
 
 // Memory that is shared between the processes.
@@ -52,21 +70,28 @@ struct EncoderSharedMem
 {
     EncoderSharedMovieParams movie_params; // Movie parameters and profile stuff set by svr_game on ENCODER_EVENT_START.
 
-    // Shared handle to the latest game texture in the B8G8R8A8 format. Updated on ENCODER_EVENT_NEW_VIDEO.
-    u32 game_texture_h;
+    // Shared handles to the textures with the video frames in the B8G8R8A8 format. Set on ENCODER_EVENT_START.
+    u32 game_texture_hs[ENCODER_NUM_VIDEO_TEXTURES];
+
+    SvrAtom32 video_write_idx; // How many video frames svr_game has sent. Reset on ENCODER_EVENT_START.
 
     // Pointer types have different sizes in 32-bit and 64-bit so we have to store the offsets from the base
-    // of the shared memory instead. The audio samples here are updated on ENCODER_EVENT_NEW_AUDIO.
+    // of the shared memory instead. This is the audio ring, in the format given by the audio parameters in movie_params.
     s32 audio_buffer_offset;
 
-    s32 waiting_audio_samples; // Set by svr_game to how many audio samples are waiting at audio_buffer_offset. Updated on ENCODER_EVENT_NEW_AUDIO.
+    SvrAtom32 audio_write_idx; // How many audio samples svr_game has written to the audio ring. Reset on ENCODER_EVENT_START.
+    SvrAtom32 audio_read_idx; // How many audio samples svr_encoder has taken from the audio ring. Reset on ENCODER_EVENT_START.
 
     u32 game_wake_event_h; // Event set by svr_encoder to wake svr_game up.
     u32 encoder_wake_event_h; // Event set by svr_game to wake svr_encoder up.
     u32 game_pid; // Game process id. Used by svr_encoder to know if the game exits so we don't get stuck.
 
-    EncoderSharedEvent event_type; // Set by svr_game to let svr_encoder know what to do when woken up. Updated on all events.
+    // EncoderSharedEvent set by svr_game to let svr_encoder know what to do when woken up. Updated on all events.
+    // Set back to ENCODER_EVENT_NONE by svr_encoder when the event has been handled, since it can also be woken up for video frames.
+    SvrAtom32 event_type;
 
-    s32 error; // Set to 1 by svr_encoder on any error. A message will be written to error_message.
+    // Set to 1 by svr_encoder on any error. A message will be written to error_message before this is set.
+    // This stays set until svr_game clears it on ENCODER_EVENT_START, since errors can come from video frames that svr_game did not wait for.
+    SvrAtom32 error;
     char error_message[512]; // Any encoding error will be written here by svr_encoder when error is set to 1.
 };
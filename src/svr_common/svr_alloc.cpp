@@ -1,6 +1,8 @@
 #include "svr_alloc.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 void* svr_alloc(s32 size)
 {
@@ -31,7 +33,18 @@ char* svr_dup_str(const char* source)
 
 void* svr_align_alloc(s32 size, s32 align)
 {
+#ifdef _WIN32
     return _aligned_malloc(size, align);
+#else
+    void* ret = NULL;
+
+    if (posix_memalign(&ret, svr_max(align, (s32)sizeof(void*)), size) != 0)
+    {
+        return NULL;
+    }
+
+    return ret;
+#endif
 }
 
 void svr_free(void* addr)
@@ -39,7 +52,11 @@ void svr_free(void* addr)
     free(addr);
 }
 
-void svr_align_free(void* addr, s32 align)
+void svr_align_free(void* addr, s32 /* align */)
 {
+#ifdef _WIN32
     _aligned_free(addr);
+#else
+    free(addr);
+#endif
 }
@@ -13,6 +13,3 @@ void svr_align_free(void* addr, s32 align);
 // Easier to type when you need to allocate structures.
 #define SVR_ZALLOC(T) (T*)svr_zalloc(sizeof(T))
 #define SVR_ZALLOC_NUM(T, NUM) (T*)svr_zalloc(sizeof(T) * NUM)
-
-#define SVR_ALLOCA(T) (T*)_alloca(sizeof(T))
-#define SVR_ALLOCA_NUM(T, NUM) (T*)_alloca(sizeof(T) * NUM)
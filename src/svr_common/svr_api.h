@@ -10,6 +10,7 @@
 // 3) Call svr_start when movie production should start.
 // 4a) Call svr_frame for all frames where movie production is active.
 // 4b) Optionally call svr_give_velocity before svr_frame.
+// 4c) Optionally call svr_get_next_frame_steps after svr_start and after svr_frame, and set the game frame time to what it returns.
 // 5) Call svr_stop when movie production should stop.
 
 // Programming errors are printed to the debugger output (prefixed with "SVR (<function name>):").
@@ -29,7 +30,7 @@ extern "C"
 
 // To be increased when something in the interface changes. Internal DLL changes (svr_dll_version) does not have to up this.
 // The API must not be used if the DLL API version does not match the client header API version.
-const int SVR_API_VERSION = 1;
+const int SVR_API_VERSION = 2;
 
 struct IUnknown;
 struct IDirect3DSurface9;
@@ -120,6 +121,13 @@ SVR_API bool svr_start(const char* movie_name, const char* movie_profile, SvrSta
 // Set the host_framerate console variable to the value this returns.
 SVR_API int svr_get_game_rate();
 
+// Returns how many frames of svr_get_game_rate the next game frame should advance the game time by.
+// With motion blur, the game frames that would have no weight in the movie are skipped over this way instead of being rendered.
+// Calling this function after svr_start tells SVR that the game follows what it returns, otherwise every game frame is used as before.
+// If called, it must be called again after every svr_frame, and the next game frame must be advanced by the new value.
+// Set the host_framerate console variable to the number of steps divided by svr_get_game_rate (the frame time in seconds) when the value changes.
+SVR_API int svr_get_next_frame_steps();
+
 // To be called when movie recording should stop. Can be in response to a console command or UI element or some automatic event.
 // Calling this function will stop movie production and calling svr_frame will not do anything.
 // The console variables mentioned in svr_start can be reset back to their previous value after this. Also the host_framerate console variable must be set back to 0.
@@ -1,4 +1,8 @@
 #include "svr_atom.h"
+#include "svr_platform.h"
+#include <immintrin.h>
+
+#ifdef _WIN32
 #include <Windows.h>
 #include <intrin0.h>
 
@@ -100,36 +104,187 @@ s64 svr_atom_sub(SvrAtom64* atom, s64 num)
     return svr_atom_add(atom, 0 - num);
 }
 
+void svr_atom_full_barrier()
+{
+    MemoryBarrier();
+}
+
+#else
+// Same orders as above with the GCC builtins.
+
+void svr_atom_store(SvrAtom32* atom, s32 value)
+{
+    __atomic_store_n(&atom->v, value, __ATOMIC_RELEASE);
+}
+
+s32 svr_atom_load(SvrAtom32* atom)
+{
+    return __atomic_load_n(&atom->v, __ATOMIC_ACQUIRE);
+}
+
+void svr_atom_and(SvrAtom32* atom, s32 value)
+{
+    __atomic_fetch_and(&atom->v, value, __ATOMIC_SEQ_CST);
+}
+
+void svr_atom_or(SvrAtom32* atom, s32 value)
+{
+    __atomic_fetch_or(&atom->v, value, __ATOMIC_SEQ_CST);
+}
+
+bool svr_atom_cmpxchg(SvrAtom32* atom, s32* expr, s32 value)
+{
+    // Writes the current value to expr on failure.
+    return __atomic_compare_exchange_n(&atom->v, expr, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+s32 svr_atom_add(SvrAtom32* atom, s32 num)
+{
+    return __atomic_fetch_add(&atom->v, num, __ATOMIC_SEQ_CST);
+}
+
+s32 svr_atom_sub(SvrAtom32* atom, s32 num)
+{
+    return svr_atom_add(atom, 0 - num);
+}
+
+void svr_atom_store(SvrAtom64* atom, s64 value)
+{
+    __atomic_store_n(&atom->v, value, __ATOMIC_RELEASE);
+}
+
+s64 svr_atom_load(SvrAtom64* atom)
+{
+    return __atomic_load_n(&atom->v, __ATOMIC_ACQUIRE);
+}
+
+void svr_atom_and(SvrAtom64* atom, s64 value)
+{
+    __atomic_fetch_and(&atom->v, value, __ATOMIC_SEQ_CST);
+}
+
+void svr_atom_or(SvrAtom64* atom, s64 value)
+{
+    __atomic_fetch_or(&atom->v, value, __ATOMIC_SEQ_CST);
+}
+
+bool svr_atom_cmpxchg(SvrAtom64* atom, s64* expr, s64 value)
+{
+    // Writes the current value to expr on failure.
+    return __atomic_compare_exchange_n(&atom->v, expr, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+s64 svr_atom_add(SvrAtom64* atom, s64 num)
+{
+    return __atomic_fetch_add(&atom->v, num, __ATOMIC_SEQ_CST);
+}
+
+s64 svr_atom_sub(SvrAtom64* atom, s64 num)
+{
+    return svr_atom_add(atom, 0 - num);
+}
+
+void svr_atom_full_barrier()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
+
+void svr_cpu_pause()
+{
+    _mm_pause();
+}
+
 void svr_notify_atom_changed(SvrAtom32* atom)
 {
     // This creates a full memory barrier. Wake all waiting threads.
-    WakeByAddressAll(&atom->v);
+    svr_futex_wake_all(&atom->v);
 }
 
 void svr_notify_atom_changed(SvrAtom64* atom)
 {
     // This creates a full memory barrier. Wake all waiting threads.
-    WakeByAddressAll(&atom->v);
+    svr_futex_wake_all(&atom->v);
 }
 
 void svr_wait_until_atom_is(SvrAtom32* atom, s32 target_value)
 {
+    for (s32 i = 0; i < SVR_ATOM_SPIN_COUNT; i++)
+    {
+        if (svr_atom_load(atom) == target_value)
+        {
+            return;
+        }
+
+        svr_cpu_pause();
+    }
+
     s32 captured_value = svr_atom_load(atom);
 
     while (captured_value != target_value)
     {
-        WaitOnAddress(&atom->v, &captured_value, sizeof(target_value), INFINITE); // Awake when value differs.
+        svr_futex_wait(&atom->v, &captured_value, sizeof(target_value)); // Awake when value differs.
         captured_value = svr_atom_load(atom);
     }
 }
 
 void svr_wait_until_atom_is(SvrAtom64* atom, s64 target_value)
 {
+    for (s32 i = 0; i < SVR_ATOM_SPIN_COUNT; i++)
+    {
+        if (svr_atom_load(atom) == target_value)
+        {
+            return;
+        }
+
+        svr_cpu_pause();
+    }
+
     s64 captured_value = svr_atom_load(atom);
 
     while (captured_value != target_value)
     {
-        WaitOnAddress(&atom->v, &captured_value, sizeof(target_value), INFINITE); // Awake when value differs.
+        svr_futex_wait(&atom->v, &captured_value, sizeof(target_value)); // Awake when value differs.
         captured_value = svr_atom_load(atom);
     }
 }
+
+s32 svr_signal_get(SvrSignal* signal)
+{
+    return svr_atom_load(&signal->count);
+}
+
+void svr_signal_wake(SvrSignal* signal)
+{
+    // The add is a full barrier, so either we see that the other thread is parked, or it sees the new count before it sleeps.
+    svr_atom_add(&signal->count, 1);
+
+    if (svr_atom_load(&signal->parked))
+    {
+        svr_notify_atom_changed(&signal->count);
+    }
+}
+
+void svr_signal_wait(SvrSignal* signal, s32 seen_count)
+{
+    for (s32 i = 0; i < SVR_ATOM_SPIN_COUNT; i++)
+    {
+        if (svr_atom_load(&signal->count) != seen_count)
+        {
+            return;
+        }
+
+        svr_cpu_pause();
+    }
+
+    svr_atom_store(&signal->parked, 1);
+    svr_atom_full_barrier();
+
+    if (svr_atom_load(&signal->count) == seen_count)
+    {
+        svr_futex_wait(&signal->count.v, &seen_count, sizeof(seen_count)); // Awake when count differs.
+    }
+
+    svr_atom_store(&signal->parked, 0);
+}
@@ -1,7 +1,7 @@
 #pragma once
 #include "svr_common.h"
 
-// Atomic operations for x86.
+// Atomic operations for x86 and x64.
 
 struct SvrAtom32
 {
@@ -32,7 +32,18 @@ bool svr_atom_cmpxchg(SvrAtom64* atom, s64* expr, s64 value);
 s64 svr_atom_add(SvrAtom64* atom, s64 num);
 s64 svr_atom_sub(SvrAtom64* atom, s64 num);
 
+// Orders all loads and stores, including stores before later loads which the acquire and release orders above do not.
+void svr_atom_full_barrier();
+
 // Functions to wait on atoms. Makes it super easy to synchronize between threads.
+// These use WaitOnAddress on Windows and futex on Linux.
+// When threads hand work to each other, the value often changes right after the wait starts. So all waits first spin for SVR_ATOM_SPIN_COUNT
+// iterations before going to sleep in the kernel. That is a few microseconds on most CPUs.
+
+const s32 SVR_ATOM_SPIN_COUNT = 512;
+
+// Tell the CPU that we are spinning.
+void svr_cpu_pause();
 
 // Call this to wake waiting threads if anyone is waiting on this atom.
 void svr_notify_atom_changed(SvrAtom32* atom);
@@ -41,3 +52,19 @@ void svr_notify_atom_changed(SvrAtom64* atom);
 // Wait on atom. Writer must use notify function above to wake waiting threads.
 void svr_wait_until_atom_is(SvrAtom32* atom, s32 target_value);
 void svr_wait_until_atom_is(SvrAtom64* atom, s64 target_value);
+
+// Wakeup for a single thread that waits for work from other threads, used instead of an auto reset event.
+// Every svr_signal_wake increments the count. The waiting thread reads the count with svr_signal_get before it checks for work,
+// and only sleeps in svr_signal_wait if the count is still the same, so wakes are never missed.
+// The kernel is only entered when the waiting thread actually sleeps, not when it is busy or spinning.
+struct SvrSignal
+{
+    SvrAtom32 count;
+    SvrAtom32 parked; // Set while the waiting thread sleeps.
+};
+
+s32 svr_signal_get(SvrSignal* signal);
+void svr_signal_wake(SvrSignal* signal);
+
+// Returns when the count is no longer seen_count. Can return spuriously, so the caller must check its own state again.
+void svr_signal_wait(SvrSignal* signal, s32 seen_count);
@@ -0,0 +1,76 @@
+#include "svr_audio.h"
+#include "svr_platform.h"
+#include <immintrin.h>
+
+using SvrAudioPackFn = void(*)(const s32* src, s16* dest, s32 num_values);
+
+SvrAudioKernel audio_best_kernel = -1;
+
+void audio_pack_scalar(const s32* src, s16* dest, s32 num_values)
+{
+    for (s32 i = 0; i < num_values; i++)
+    {
+        s32 v = src[i];
+        svr_clamp(&v, (s32)INT16_MIN, (s32)INT16_MAX);
+        dest[i] = (s16)v;
+    }
+}
+
+// The pack instructions saturate to the 16-bit range.
+
+void audio_pack_sse2(const s32* src, s16* dest, s32 num_values)
+{
+    s32 i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_packs_epi32(a, b));
+    }
+
+    audio_pack_scalar(src + i, dest + i, num_values - i);
+}
+
+SVR_TARGET_AVX2 void audio_pack_avx2(const s32* src, s16* dest, s32 num_values)
+{
+    s32 i = 0;
+
+    for (; i + 16 <= num_values; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+
+        // Packing is done within each 128-bit half, so the middle 64-bit parts are swapped to get the values back in order.
+        __m256i packed = _mm256_packs_epi32(a, b);
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm256_storeu_si256((__m256i*)(dest + i), packed);
+    }
+
+    audio_pack_sse2(src + i, dest + i, num_values - i);
+}
+
+// Indexed by SvrAudioKernel.
+const SvrAudioPackFn AUDIO_PACK_FNS[] =
+{
+    audio_pack_scalar,
+    audio_pack_sse2,
+    audio_pack_avx2,
+};
+
+void svr_audio_pack_s32_to_s16(const s32* src, s16* dest, s32 num_values)
+{
+    // Pick the best version that the processor and the system supports.
+    if (audio_best_kernel == -1)
+    {
+        audio_best_kernel = svr_cpu_has_avx2() ? SVR_AUDIO_KERNEL_AVX2 : SVR_AUDIO_KERNEL_SSE2;
+    }
+
+    AUDIO_PACK_FNS[audio_best_kernel](src, dest, num_values);
+}
+
+void svr_audio_pack_s32_to_s16_with_kernel(const s32* src, s16* dest, s32 num_values, SvrAudioKernel kernel)
+{
+    AUDIO_PACK_FNS[kernel](src, dest, num_values);
+}
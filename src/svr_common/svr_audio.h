@@ -0,0 +1,21 @@
+#pragma once
+#include "svr_common.h"
+
+// Audio sample conversion.
+
+// Convert 32-bit samples to 16-bit. Values outside of the 16-bit range are clamped to it instead of wrapping around.
+// The source and destination must not overlap. Channels are not touched, so interleaved samples stay interleaved.
+void svr_audio_pack_s32_to_s16(const s32* src, s16* dest, s32 num_values);
+
+// Versions of svr_audio_pack_s32_to_s16, which picks the best one that the processor supports.
+using SvrAudioKernel = s32;
+
+enum /* SvrAudioKernel */
+{
+    SVR_AUDIO_KERNEL_SCALAR,
+    SVR_AUDIO_KERNEL_SSE2,
+    SVR_AUDIO_KERNEL_AVX2, // Only if svr_cpu_has_avx2.
+};
+
+// Same as svr_audio_pack_s32_to_s16 with a specific version, for comparing them with each other.
+void svr_audio_pack_s32_to_s16_with_kernel(const s32* src, s16* dest, s32 num_values, SvrAudioKernel kernel);
@@ -0,0 +1,52 @@
+#pragma once
+#include "svr_common.h"
+#include "svr_api.h"
+
+// Capture files contain everything that was given to svr_api during a movie, so the same movie can be produced again without the game.
+// They are written by svr_game when capture_output is set in the profile, and can be replayed with "svr_launcher replay".
+// This is useful for benchmarking and comparing the processing and encoding, since the input will be identical every time.
+
+// The file starts with a SvrCaptureHeader, followed by chunks in the same order as the calls were made.
+// Every chunk header and chunk data start on a SVR_CAPTURE_ALIGN boundary, so the file can be mapped and the data used directly.
+
+const u32 SVR_CAPTURE_MAGIC = 0x50414353; // SCAP.
+const s32 SVR_CAPTURE_VERSION = 1;
+const s32 SVR_CAPTURE_ALIGN = 64;
+
+using SvrCaptureChunkType = s32;
+
+enum /* SvrCaptureChunkType */
+{
+    SVR_CAPTURE_CHUNK_VIDEO, // Rows of the game texture (svr_frame).
+    SVR_CAPTURE_CHUNK_AUDIO, // Array of SvrWaveSample (svr_give_audio).
+    SVR_CAPTURE_CHUNK_VELO, // 3 floats (svr_give_velocity).
+    SVR_CAPTURE_CHUNK_FRAME_STEPS, // s32 of the first svr_get_next_frame_steps, after which game frames were skipped.
+};
+
+struct SvrCaptureHeader
+{
+    u32 magic;
+    s32 version;
+
+    s32 video_width;
+    s32 video_height;
+    u32 video_format; // DXGI_FORMAT of the game texture.
+    s32 video_pitch; // Size of a row in video chunks. Rows are tightly packed.
+
+    SvrAudioParams audio_params;
+
+    s32 game_rate; // What svr_get_game_rate returned. Replaying with a profile with another rate will not produce the same movie.
+
+    SVR_STRUCT_PADDING(24);
+};
+
+struct SvrCaptureChunk
+{
+    SvrCaptureChunkType type;
+    s32 size; // Size of the data that follows, not including the padding to the next chunk.
+
+    SVR_STRUCT_PADDING(56);
+};
+
+static_assert(sizeof(SvrCaptureHeader) == SVR_CAPTURE_ALIGN, "Capture header must be aligned");
+static_assert(sizeof(SvrCaptureChunk) == SVR_CAPTURE_ALIGN, "Capture chunk header must be aligned");
@@ -1,10 +1,17 @@
 #include "svr_common.h"
 #include "svr_alloc.h"
+#include "svr_platform.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
-#include <Windows.h>
 #include <assert.h>
+
+#ifndef _WIN32
+#include <strings.h>
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
 #include <mfapi.h>
 #include <strsafe.h>
 
@@ -24,6 +31,7 @@ void svr_maybe_close_handle(void** h)
         *h = NULL;
     }
 }
+#endif
 
 void svr_maybe_free(void** addr)
 {
@@ -36,13 +44,27 @@ void svr_maybe_free(void** addr)
 
 s32 svr_copy_string(const char* source, char* dest, s32 dest_chars)
 {
-    s32 len = svr_min(dest_chars - 1, (s32)strlen(source));
+    return svr_copy_string_part(source, (s32)strlen(source), dest, dest_chars);
+}
+
+s32 svr_copy_string_part(const char* source, s32 source_chars, char* dest, s32 dest_chars)
+{
+    s32 len = svr_min(dest_chars - 1, source_chars);
     memcpy(dest, source, len);
     dest[len] = 0;
 
     return len;
 }
 
+s32 svr_compare_no_case(const char* a, const char* b)
+{
+#ifdef _WIN32
+    return _stricmp(a, b);
+#else
+    return strcasecmp(a, b);
+#endif
+}
+
 thread_local char svr_va_buf[4096];
 
 const char* svr_va(const char* format, ...)
@@ -86,6 +108,7 @@ bool svr_ends_with(const char* str, const char* suffix)
     return !strcmp(str, suffix);
 }
 
+#ifdef _WIN32
 s32 svr_to_utf16(const char* value, s32 value_length, wchar* buf, s32 buf_chars)
 {
     s32 length = MultiByteToWideChar(CP_UTF8, 0, value, value_length, buf, buf_chars);
@@ -97,6 +120,7 @@ s32 svr_to_utf16(const char* value, s32 value_length, wchar* buf, s32 buf_chars)
 
     return length;
 }
+#endif
 
 template <class T>
 bool svr_are_values_sorted_priv(T* values, s32 num)
@@ -166,18 +190,15 @@ void svr_check_all_mask(bool* mask, s32 num, bool* all_false, bool* all_true)
 
 char* svr_read_file_as_string(const char* path, SvrReadFileFlags flags)
 {
-    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    SvrFileView view;
 
-    if (h == INVALID_HANDLE_VALUE)
+    if (!svr_file_view_open(&view, path))
     {
         return NULL;
     }
 
     char* ret = NULL;
 
-    LARGE_INTEGER large;
-    GetFileSizeEx(h, &large);
-
     s32 ceiling = 1; // Extra for terminator.
 
     if (flags & SVR_READ_FILE_FLAGS_NEW_LINE)
@@ -185,14 +206,16 @@ char* svr_read_file_as_string(const char* path, SvrReadFileFlags flags)
         ceiling++;
     }
 
-    if (large.HighPart == 0 && large.LowPart < (INT32_MAX - ceiling))
+    if (view.size < (INT32_MAX - ceiling))
     {
-        ret = (char*)svr_alloc(large.LowPart + ceiling);
+        ret = (char*)svr_alloc((s32)view.size + ceiling);
 
-        DWORD num_read = 0;
-        ReadFile(h, ret, large.LowPart, &num_read, NULL);
+        if (view.data)
+        {
+            memcpy(ret, view.data, view.size);
+        }
 
-        DWORD extra_pos = num_read;
+        s32 extra_pos = (s32)view.size;
 
         if (flags & SVR_READ_FILE_FLAGS_NEW_LINE)
         {
@@ -203,7 +226,7 @@ char* svr_read_file_as_string(const char* path, SvrReadFileFlags flags)
         ret[extra_pos] = 0;
     }
 
-    CloseHandle(h);
+    svr_file_view_close(&view);
 
     return ret;
 }
@@ -355,7 +378,7 @@ const char* svr_extract_string(const char* text, char* dest, s32 dest_size)
     ptr = svr_advance_quote(ptr); // Maybe go inside quote.
     const char* next_ptr = svr_advance_string(quoted, ptr); // Read content.
     s32 dist = next_ptr - ptr; // Content length.
-    StringCchCopyNA(dest, dest_size, ptr, dist);
+    svr_copy_string_part(ptr, dist, dest, dest_size);
     next_ptr = svr_advance_quote(next_ptr); // Maybe go outside quote.
 
     return next_ptr;
@@ -401,7 +424,11 @@ SvrSplitTime svr_split_time(s64 us)
 
 s64 svr_rescale(s64 a, s64 b, s64 c)
 {
+#ifdef _WIN32
     return MFllMulDiv(a, b, c, c / 2);
+#else
+    return (s64)(((__int128)a * b + (c / 2)) / c);
+#endif
 }
 
 bool svr_check_all_true(bool* opts, s32 num)
@@ -444,10 +471,7 @@ s32 svr_count_num_true(bool* opts, s32 num)
 
 bool svr_does_file_exist(const char* path)
 {
-    WIN32_FILE_ATTRIBUTE_DATA attr;
-    auto res = GetFileAttributesExA(path, GetFileExInfoStandard, &attr);
-
-    return res != 0;
+    return svr_file_exists(path);
 }
 
 void svr_trim_right(char* buf, s32 length)
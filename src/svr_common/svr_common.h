@@ -2,6 +2,9 @@
 #include <stdint.h>
 #include <malloc.h>
 #include <stdio.h>
+#ifndef _WIN32
+#include <alloca.h>
+#endif
 #include "stb_sprintf.h"
 
 using s8 = int8_t;
@@ -31,8 +34,14 @@ using wchar = wchar_t;
 #define SVR_STR_CAT(X) SVR_STR_CAT1(X)
 #define SVR_FILE_LOCATION __FILE__ ":" SVR_STR_CAT(__LINE__)
 
-#define SVR_ALLOCA(T) (T*)_alloca(sizeof(T))
-#define SVR_ALLOCA_NUM(T, NUM) (T*)_alloca(sizeof(T) * NUM)
+#ifdef _WIN32
+#define SVR_ALLOCA_SIZE(SIZE) _alloca(SIZE)
+#else
+#define SVR_ALLOCA_SIZE(SIZE) alloca(SIZE)
+#endif
+
+#define SVR_ALLOCA(T) (T*)SVR_ALLOCA_SIZE(sizeof(T))
+#define SVR_ALLOCA_NUM(T, NUM) (T*)SVR_ALLOCA_SIZE(sizeof(T) * NUM)
 
 // Format to buffer with size restriction.
 #define SVR_SNPRINTF(BUF, FORMAT, ...) stbsp_snprintf((BUF), SVR_ARRAY_SIZE((BUF)), FORMAT, __VA_ARGS__)
@@ -42,7 +51,7 @@ using wchar = wchar_t;
 
 #define SVR_BIT(N) (1 << (N))
 
-#ifdef _WIN64
+#if defined(_WIN64) || defined(__x86_64__)
 #define SVR_IS_X64() true
 #define SVR_IS_X86() false
 #else
@@ -50,7 +59,17 @@ using wchar = wchar_t;
 #define SVR_IS_X86() true
 #endif
 
-#ifdef _WIN64
+// For functions that use AVX2 or AVX-512 intrinsics and are only called when svr_cpu_has_avx2 or svr_cpu_has_avx512 is true.
+// MSVC allows any intrinsics without this.
+#ifdef _WIN32
+#define SVR_TARGET_AVX2
+#define SVR_TARGET_AVX512
+#else
+#define SVR_TARGET_AVX2 __attribute__((target("avx2")))
+#define SVR_TARGET_AVX512 __attribute__((target("avx2,avx512f")))
+#endif
+
+#if defined(_WIN64) || defined(__x86_64__)
 #define SVR_ARCH_STRING "x64"
 #else
 #define SVR_ARCH_STRING "x86"
@@ -97,7 +116,7 @@ inline void svr_clamp(T* v, T min, T max)
 }
 
 // Release a COM based object.
-void svr_release(struct IUnknown* p);
+void svr_release(struct IUnknown* p); // Only on Windows.
 
 // Maybe release a COM based object.
 template <class T>
@@ -112,7 +131,7 @@ inline void svr_maybe_release(T** ptr)
 }
 
 // Maybe release a HANDLE based object.
-void svr_maybe_close_handle(void** h);
+void svr_maybe_close_handle(void** h); // Only on Windows.
 
 void svr_maybe_free(void** addr);
 
@@ -129,6 +148,8 @@ inline s64 svr_align64(s64 value, s64 alignment)
 }
 
 s32 svr_copy_string(const char* source, char* dest, s32 dest_chars);
+s32 svr_copy_string_part(const char* source, s32 source_chars, char* dest, s32 dest_chars); // Source does not have to be terminated.
+s32 svr_compare_no_case(const char* a, const char* b); // Like strcmp but ignores case.
 
 // Temporary buffer formatting.
 const char* svr_va(const char* format, ...);
@@ -136,7 +157,7 @@ const char* svr_va(const char* format, ...);
 bool svr_starts_with(const char* str, const char* prefix);
 bool svr_ends_with(const char* str, const char* suffix);
 
-s32 svr_to_utf16(const char* value, s32 value_length, wchar* buf, s32 buf_chars);
+s32 svr_to_utf16(const char* value, s32 value_length, wchar* buf, s32 buf_chars); // Only on Windows.
 
 bool svr_is_sorted(s32* idxs, s32 num);
 bool svr_are_idxs_unique(s32* idxs, s32 num);
@@ -0,0 +1,102 @@
+#include "svr_glyph_atlas.h"
+#include "svr_alloc.h"
+#include <math.h>
+#include <string.h>
+
+void svr_glyph_atlas_init(SvrGlyphAtlas* atlas, s32 num_glyphs, s32 cell_width, s32 cell_height, s32 origin_x, s32 origin_y)
+{
+    atlas->num_glyphs = num_glyphs;
+    atlas->cell_width = cell_width;
+    atlas->cell_height = cell_height;
+    atlas->origin_x = origin_x;
+    atlas->origin_y = origin_y;
+    atlas->pitch = num_glyphs * cell_width * 4;
+    atlas->pixels = (u8*)svr_zalloc(atlas->pitch * cell_height);
+}
+
+void svr_glyph_atlas_free(SvrGlyphAtlas* atlas)
+{
+    if (atlas->pixels)
+    {
+        svr_free(atlas->pixels);
+    }
+
+    *atlas = {};
+}
+
+u8* svr_glyph_atlas_get_cell(SvrGlyphAtlas* atlas, s32 glyph)
+{
+    return atlas->pixels + glyph * atlas->cell_width * 4;
+}
+
+s32 svr_glyph_atlas_get_pen_x(float advance, s32 index)
+{
+    return (s32)floorf(index * advance + 0.5f);
+}
+
+SvrVec2I svr_glyph_atlas_get_line_size(SvrGlyphAtlas* atlas, s32 num_glyphs, float advance)
+{
+    if (num_glyphs == 0)
+    {
+        return SvrVec2I { 0, 0 };
+    }
+
+    return SvrVec2I { svr_glyph_atlas_get_pen_x(advance, num_glyphs - 1) + atlas->cell_width, atlas->cell_height };
+}
+
+void svr_glyph_atlas_draw_line(SvrGlyphAtlas* atlas, const s32* glyphs, s32 num_glyphs, float advance, s32 x, s32 y,
+                               u8* dest, s32 dest_pitch, s32 dest_width, s32 dest_height)
+{
+    s32 top = y - atlas->origin_y;
+    s32 start_y = svr_max(top, 0);
+    s32 end_y = svr_min(top + atlas->cell_height, dest_height);
+
+    for (s32 i = 0; i < num_glyphs; i++)
+    {
+        s32 left = x + svr_glyph_atlas_get_pen_x(advance, i) - atlas->origin_x;
+        s32 start_x = svr_max(left, 0);
+        s32 end_x = svr_min(left + atlas->cell_width, dest_width);
+
+        if (start_x >= end_x)
+        {
+            continue;
+        }
+
+        u8* cell = svr_glyph_atlas_get_cell(atlas, glyphs[i]);
+
+        for (s32 j = start_y; j < end_y; j++)
+        {
+            const u8* source_row = cell + (j - top) * atlas->pitch + (start_x - left) * 4;
+            u8* dest_row = dest + j * dest_pitch + start_x * 4;
+            svr_glyph_atlas_blend_row(dest_row, source_row, end_x - start_x);
+        }
+    }
+}
+
+void svr_glyph_atlas_blend_row(u8* dest, const u8* source, s32 num_pixels)
+{
+    for (s32 i = 0; i < num_pixels; i++)
+    {
+        const u8* s = source + i * 4;
+        u8* d = dest + i * 4;
+        s32 a = s[3];
+
+        // Most of a cell is either empty or inside the glyph.
+        if (a == 0)
+        {
+            continue;
+        }
+
+        if (a == 255)
+        {
+            memcpy(d, s, 4);
+            continue;
+        }
+
+        for (s32 c = 0; c < 4; c++)
+        {
+            s32 v = s[c] + (d[c] * (255 - a) + 127) / 255;
+            d[c] = (u8)svr_min(v, 255);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "svr_common.h"
+
+// Glyphs that are drawn once and then put together into lines of text on the CPU.
+// Every glyph has a cell of the same size in one image, with the glyph origin (on the baseline) at the same place in every cell.
+// Pixels are premultiplied BGRA, so the alpha is the coverage of the glyph and the color is already applied.
+// Glyphs are put over what is already in the destination in the order they are in the line, which is the same as drawing them one by one.
+
+struct SvrGlyphAtlas
+{
+    u8* pixels; // Cells next to each other in one row.
+    s32 pitch;
+    s32 num_glyphs;
+    s32 cell_width;
+    s32 cell_height;
+    s32 origin_x; // Position of the glyph origin inside every cell.
+    s32 origin_y;
+};
+
+// The cells start out transparent.
+void svr_glyph_atlas_init(SvrGlyphAtlas* atlas, s32 num_glyphs, s32 cell_width, s32 cell_height, s32 origin_x, s32 origin_y);
+void svr_glyph_atlas_free(SvrGlyphAtlas* atlas);
+
+// Top left pixel of the cell of a glyph. Rows are atlas->pitch apart.
+u8* svr_glyph_atlas_get_cell(SvrGlyphAtlas* atlas, s32 glyph);
+
+// Origins of the glyphs in a line are advance apart, rounded to whole pixels.
+s32 svr_glyph_atlas_get_pen_x(float advance, s32 index);
+
+// Size of the smallest image that holds a whole line, when the origin of the first glyph is put at the cell origin.
+SvrVec2I svr_glyph_atlas_get_line_size(SvrGlyphAtlas* atlas, s32 num_glyphs, float advance);
+
+// Draw a line of glyphs over a BGRA image. The origin of the first glyph is at x and y, and the parts outside the image are skipped.
+void svr_glyph_atlas_draw_line(SvrGlyphAtlas* atlas, const s32* glyphs, s32 num_glyphs, float advance, s32 x, s32 y,
+                               u8* dest, s32 dest_pitch, s32 dest_width, s32 dest_height);
+
+// Premultiplied over of a row of pixels, the same as the blending that Direct2D does.
+void svr_glyph_atlas_blend_row(u8* dest, const u8* source, s32 num_pixels);
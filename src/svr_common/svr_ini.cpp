@@ -1,6 +1,5 @@
 #include "svr_ini.h"
 #include "svr_alloc.h"
-#include <strsafe.h>
 
 using SvrIniLineType = s32;
 
@@ -122,7 +121,7 @@ SvrIniKeyValue* svr_ini_section_find_kv(SvrIniSection* priv, const char* key)
     {
         SvrIniKeyValue* kv = priv->kvs[i];
 
-        if (!strcmpi(kv->key, key))
+        if (!svr_compare_no_case(kv->key, key))
         {
             return kv;
         }
@@ -153,7 +152,7 @@ SvrIniKeyValue* svr_ini_parse_expression(const char* expr)
         return NULL; // There is only an equal sign and nothing else.
     }
 
-    StringCchCopyNA(key_name, SVR_ARRAY_SIZE(key_name), ptr, dist);
+    svr_copy_string_part(ptr, dist, key_name, SVR_ARRAY_SIZE(key_name));
 
     ptr = next_ptr;
 
@@ -211,7 +210,7 @@ const char* svr_ini_find_command_value(SvrDynArray<SvrIniKeyValue*>* kvs, const
     {
         SvrIniKeyValue* kv = kvs->at(i);
 
-        if (!strcmpi(kv->key, key))
+        if (!svr_compare_no_case(kv->key, key))
         {
             return kv->value;
         }
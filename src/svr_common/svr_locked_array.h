@@ -1,7 +1,7 @@
 #pragma once
 #include "svr_common.h"
 #include "svr_array.h"
-#include <Windows.h>
+#include "svr_platform.h"
 
 // Lock based dynamic array.
 // Safe for several threads to push and pull.
@@ -10,7 +10,7 @@ template <class T>
 struct SvrLockedArray
 {
     SvrDynArray<T> items;
-    SRWLOCK lock;
+    SvrMutex lock;
 
     inline void init(s32 init_capacity)
     {
@@ -25,9 +25,9 @@ struct SvrLockedArray
     // Pushes to the back.
     inline void push(T* item)
     {
-        AcquireSRWLockExclusive(&lock);
+        svr_mutex_lock(&lock);
         items.push(*item);
-        ReleaseSRWLockExclusive(&lock);
+        svr_mutex_unlock(&lock);
     }
 
     // Pops from the back.
@@ -35,7 +35,7 @@ struct SvrLockedArray
     {
         bool ret = false;
 
-        AcquireSRWLockExclusive(&lock);
+        svr_mutex_lock(&lock);
 
         if (items.size == 0)
         {
@@ -49,7 +49,7 @@ struct SvrLockedArray
         ret = true;
 
     rexit:
-        ReleaseSRWLockExclusive(&lock);
+        svr_mutex_unlock(&lock);
         return ret;
     }
 };
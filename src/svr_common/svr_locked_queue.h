@@ -1,7 +1,7 @@
 #pragma once
 #include "svr_common.h"
 #include "svr_queue.h"
-#include <Windows.h>
+#include "svr_platform.h"
 
 // Lock based queue.
 // Safe for several threads to push and pull.
@@ -9,12 +9,13 @@
 // This also has no chance of achieving the potential circular queue overflow problem which is difficult to handle without a huge mess.
 // Even if you manage to handle the overflow problem, you now have a bottleneck problem instead where the writer is clearly faster than the reader.
 // The things we store in these are not extremely large, so we just keep on growing since the order is very important.
+// For hops that only have one writer and one reader, SvrSpscQueue in svr_spsc_queue.h avoids the lock and the event for every item.
 
 template <class T>
 struct SvrLockedQueue
 {
     SvrDynQueue<T> items;
-    SRWLOCK lock;
+    SvrMutex lock;
 
     inline void init(s32 init_capacity)
     {
@@ -29,9 +30,9 @@ struct SvrLockedQueue
     // Pushes to the back.
     inline void push(T* item)
     {
-        AcquireSRWLockExclusive(&lock);
+        svr_mutex_lock(&lock);
         items.push(item);
-        ReleaseSRWLockExclusive(&lock);
+        svr_mutex_unlock(&lock);
     }
 
     // Pops from the front.
@@ -39,7 +40,7 @@ struct SvrLockedQueue
     {
         bool ret = false;
 
-        AcquireSRWLockExclusive(&lock);
+        svr_mutex_lock(&lock);
 
         if (items.size() == 0)
         {
@@ -52,7 +53,7 @@ struct SvrLockedQueue
         ret = true;
 
     rexit:
-        ReleaseSRWLockExclusive(&lock);
+        svr_mutex_unlock(&lock);
         return ret;
     }
 };
@@ -0,0 +1,613 @@
+#include "svr_mosample.h"
+#include "svr_alloc.h"
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+// The shaders use pow with 2.2 and 1 / 2.2. Since the source and result are 8 bits, both directions can be done with tables instead.
+// Going to linear space is a lookup of the 256 source values.
+// Going back is finding the largest 8 bit value whose rounding threshold is not above the linear value, which is the same as
+// rounding pow(v, 1 / 2.2) to 8 bits except for values that are right at a threshold.
+// To find it, the exponent and the top 7 bits of the mantissa of the linear value are used as an index into a table of buckets.
+// The thresholds are further apart than the buckets are wide, so there is at most one threshold in a bucket and one compare is enough.
+// All kernels use the same tables and the same order of float operations, so they give the exact same output.
+
+// In the fixed point format, every 8 bit value is given its linear value rounded to 16 bits, but always at least one step above the value before.
+// Rounding every frame that is added would make the error grow with the number of frames. Instead, a frame adds the difference between
+// the rounded fixed point value times the weight sums before and after it. For a pixel that does not change, the sum is then the
+// rounded value times 1, which is the fixed point value of the source. The thresholds for going back are put between these values,
+// so every 8 bit value comes back as itself.
+
+#ifdef _WIN32
+#pragma float_control(precise, on, push)
+#endif
+
+// Rows in every band of work.
+const s32 MOSAMPLE_BAND_ROWS = 16;
+
+// Linear values are clamped to this range before they are put in a bucket. The lowest threshold is about 2^-20.
+const float MOSAMPLE_MIN_LINEAR = 1.0f / (1 << 21);
+const float MOSAMPLE_MAX_LINEAR = 0.99999994f; // Largest float below 1.
+
+// Bucket is the float bits shifted down by 16, minus the bits of the lowest value.
+const s32 MOSAMPLE_BUCKET_BIAS = (127 - 21) << 7;
+const s32 MOSAMPLE_NUM_BUCKETS = 21 << 7;
+
+float mosample_to_linear_table[256];
+
+// Linear value where the 8 bit result goes from i - 1 to i. The first value is 0, and the last value is above all linear values.
+float mosample_thresholds[257];
+
+// Largest 8 bit value whose threshold is not above the start of the bucket.
+s32 mosample_buckets[MOSAMPLE_NUM_BUCKETS];
+
+u16 mosample_to_fixed_table[256];
+
+// Lowest fixed point value that becomes the 8 bit value i. The first value is 0.
+u16 mosample_fixed_thresholds[256];
+
+// 8 bit value of every fixed point value. Padded so that a 32-bit gather can be done at the last value.
+u8 mosample_from_fixed_table[65536 + 3];
+
+void mosample_init_tables()
+{
+    for (s32 i = 0; i < 256; i++)
+    {
+        mosample_to_linear_table[i] = (float)pow(i / 255.0, 2.2);
+        mosample_thresholds[i] = i == 0 ? 0.0f : (float)pow((i - 0.5) / 255.0, 2.2);
+    }
+
+    mosample_to_fixed_table[0] = 0;
+    mosample_fixed_thresholds[0] = 0;
+
+    for (s32 i = 1; i < 256; i++)
+    {
+        s32 fixed = (s32)(pow(i / 255.0, 2.2) * 65535.0 + 0.5);
+        fixed = svr_max(fixed, mosample_to_fixed_table[i - 1] + 1); // The darkest values are too close together otherwise.
+
+        s32 threshold = (s32)ceil(pow((i - 0.5) / 255.0, 2.2) * 65535.0);
+        svr_clamp(&threshold, mosample_to_fixed_table[i - 1] + 1, fixed);
+
+        mosample_to_fixed_table[i] = (u16)fixed;
+        mosample_fixed_thresholds[i] = (u16)threshold;
+    }
+
+    s32 fixed_value = 0;
+
+    for (s32 i = 0; i < 65536; i++)
+    {
+        while (fixed_value < 255 && i >= mosample_fixed_thresholds[fixed_value + 1])
+        {
+            fixed_value++;
+        }
+
+        mosample_from_fixed_table[i] = (u8)fixed_value;
+    }
+
+    mosample_thresholds[256] = 2.0f;
+
+    s32 value = 0;
+
+    for (s32 i = 0; i < MOSAMPLE_NUM_BUCKETS; i++)
+    {
+        u32 bits = (u32)(i + MOSAMPLE_BUCKET_BIAS) << 16;
+
+        float start;
+        memcpy(&start, &bits, sizeof(float));
+
+        while (mosample_thresholds[value + 1] <= start)
+        {
+            value++;
+        }
+
+        mosample_buckets[i] = value;
+    }
+}
+
+float svr_mosample_to_linear(u8 v)
+{
+    return mosample_to_linear_table[v];
+}
+
+// Negative values and NaN become 0, and values above 1 become 255, same as storing to a unorm texture.
+u8 svr_mosample_from_linear(float v)
+{
+    // Written so that NaN becomes the low value, same as _mm256_max_ps.
+    v = v > MOSAMPLE_MIN_LINEAR ? v : MOSAMPLE_MIN_LINEAR;
+    v = v < MOSAMPLE_MAX_LINEAR ? v : MOSAMPLE_MAX_LINEAR;
+
+    u32 bits;
+    memcpy(&bits, &v, sizeof(float));
+
+    s32 value = mosample_buckets[(s32)(bits >> 16) - MOSAMPLE_BUCKET_BIAS];
+    value += v >= mosample_thresholds[value + 1];
+
+    return (u8)value;
+}
+
+u16 svr_mosample_to_fixed(u8 v)
+{
+    return mosample_to_fixed_table[v];
+}
+
+u8 svr_mosample_from_fixed(u16 v)
+{
+    return mosample_from_fixed_table[v];
+}
+
+void svr_mosample_get_fixed_tables(u32* to_fixed, u32* fixed_thresholds)
+{
+    mosample_init_tables();
+
+    for (s32 i = 0; i < 256; i++)
+    {
+        to_fixed[i] = mosample_to_fixed_table[i];
+        fixed_thresholds[i] = mosample_fixed_thresholds[i];
+    }
+}
+
+// What every 8 bit value adds in the fixed point format. Same math as the fixed point motion sample shader.
+void mosample_make_fixed_adds(s32* adds, float weight_start, float weight_end)
+{
+    for (s32 i = 0; i < 256; i++)
+    {
+        float fixed = mosample_to_fixed_table[i];
+        adds[i] = (s32)(floorf(fixed * weight_end + 0.5f) - floorf(fixed * weight_start + 0.5f));
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Scalar.
+
+void mosample_add_row_scalar(const u8* source, float* dest, s32 num_values, float weight)
+{
+    for (s32 i = 0; i < num_values; i++)
+    {
+        dest[i] = dest[i] + mosample_to_linear_table[source[i]] * weight;
+    }
+}
+
+void mosample_resolve_row_scalar(const float* source, u8* dest, s32 num_values)
+{
+    for (s32 i = 0; i < num_values; i++)
+    {
+        dest[i] = svr_mosample_from_linear(source[i]);
+    }
+}
+
+void mosample_add_fixed_row_scalar(const u8* source, u16* dest, s32 num_values, const s32* adds)
+{
+    for (s32 i = 0; i < num_values; i++)
+    {
+        dest[i] = (u16)svr_min(dest[i] + adds[source[i]], 65535);
+    }
+}
+
+void mosample_resolve_fixed_row_scalar(const u16* source, u8* dest, s32 num_values)
+{
+    for (s32 i = 0; i < num_values; i += 4)
+    {
+        dest[i + 0] = mosample_from_fixed_table[source[i + 0]];
+        dest[i + 1] = mosample_from_fixed_table[source[i + 1]];
+        dest[i + 2] = mosample_from_fixed_table[source[i + 2]];
+        dest[i + 3] = 255;
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2.
+
+SVR_TARGET_AVX2 void mosample_add_row_avx2(const u8* source, float* dest, s32 num_values, float weight)
+{
+    __m256 w = _mm256_set1_ps(weight);
+
+    s32 i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        __m256i idxs = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(source + i)));
+        __m256 lin = _mm256_i32gather_ps(mosample_to_linear_table, idxs, 4);
+
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(dest + i), _mm256_mul_ps(lin, w));
+        _mm256_storeu_ps(dest + i, sum);
+    }
+
+    mosample_add_row_scalar(source + i, dest + i, num_values - i, weight);
+}
+
+// Same as svr_mosample_from_linear for 8 values at once.
+SVR_TARGET_AVX2 __m256i mosample_from_linear_avx2(__m256 v)
+{
+    v = _mm256_max_ps(v, _mm256_set1_ps(MOSAMPLE_MIN_LINEAR)); // Gives the second operand for NaN.
+    v = _mm256_min_ps(v, _mm256_set1_ps(MOSAMPLE_MAX_LINEAR));
+
+    __m256i bucket = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(v), 16), _mm256_set1_epi32(MOSAMPLE_BUCKET_BIAS));
+    __m256i value = _mm256_i32gather_epi32(mosample_buckets, bucket, 4);
+
+    __m256 threshold = _mm256_i32gather_ps(mosample_thresholds + 1, value, 4);
+    __m256 ge = _mm256_cmp_ps(v, threshold, _CMP_GE_OQ);
+
+    return _mm256_sub_epi32(value, _mm256_castps_si256(ge)); // Compare gives -1 for true.
+}
+
+SVR_TARGET_AVX2 void mosample_resolve_row_avx2(const float* source, u8* dest, s32 num_values)
+{
+    s32 i = 0;
+
+    for (; i + 32 <= num_values; i += 32)
+    {
+        __m256i a = mosample_from_linear_avx2(_mm256_loadu_ps(source + i + 0));
+        __m256i b = mosample_from_linear_avx2(_mm256_loadu_ps(source + i + 8));
+        __m256i c = mosample_from_linear_avx2(_mm256_loadu_ps(source + i + 16));
+        __m256i d = mosample_from_linear_avx2(_mm256_loadu_ps(source + i + 24));
+
+        // The packs work within each 128-bit lane, so the result has to be put back in order.
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+        _mm256_storeu_si256((__m256i*)(dest + i), packed);
+    }
+
+    mosample_resolve_row_scalar(source + i, dest + i, num_values - i);
+}
+
+SVR_TARGET_AVX2 void mosample_add_fixed_row_avx2(const u8* source, u16* dest, s32 num_values, const s32* adds)
+{
+    s32 i = 0;
+
+    for (; i + 16 <= num_values; i += 16)
+    {
+        __m256i a = _mm256_i32gather_epi32(adds, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(source + i + 0))), 4);
+        __m256i b = _mm256_i32gather_epi32(adds, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(source + i + 8))), 4);
+
+        // The pack works within each 128-bit lane, so the result has to be put back in order.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+
+        __m256i sum = _mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(dest + i)), packed);
+        _mm256_storeu_si256((__m256i*)(dest + i), sum);
+    }
+
+    mosample_add_fixed_row_scalar(source + i, dest + i, num_values - i, adds);
+}
+
+SVR_TARGET_AVX2 __m256i mosample_from_fixed_avx2(const u16* source)
+{
+    __m256i idxs = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)source));
+    __m256i values = _mm256_i32gather_epi32((const int*)mosample_from_fixed_table, idxs, 1);
+
+    return _mm256_and_si256(values, _mm256_set1_epi32(0xff));
+}
+
+SVR_TARGET_AVX2 void mosample_resolve_fixed_row_avx2(const u16* source, u8* dest, s32 num_values)
+{
+    s32 i = 0;
+
+    for (; i + 32 <= num_values; i += 32)
+    {
+        __m256i a = mosample_from_fixed_avx2(source + i + 0);
+        __m256i b = mosample_from_fixed_avx2(source + i + 8);
+        __m256i c = mosample_from_fixed_avx2(source + i + 16);
+        __m256i d = mosample_from_fixed_avx2(source + i + 24);
+
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+        packed = _mm256_or_si256(packed, _mm256_set1_epi32(0xff000000)); // Opaque alpha.
+
+        _mm256_storeu_si256((__m256i*)(dest + i), packed);
+    }
+
+    mosample_resolve_fixed_row_scalar(source + i, dest + i, num_values - i);
+}
+
+#ifdef _WIN32
+#pragma float_control(pop)
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void mosample_do_fixed_row(SvrMosample* mosample, s32 y, u8* pixel_row)
+{
+    s32 num_values = mosample->width * 4;
+    u16* accum_row = mosample->fixed_accum + ((s64)y * num_values);
+
+    switch (mosample->job_type)
+    {
+        case SVR_MOSAMPLE_JOB_CLEAR:
+        {
+            memset(accum_row, 0, sizeof(u16) * num_values);
+            break;
+        }
+
+        case SVR_MOSAMPLE_JOB_ADD:
+        {
+            if (mosample->use_avx2)
+            {
+                mosample_add_fixed_row_avx2(pixel_row, accum_row, num_values, mosample->job_fixed_adds);
+            }
+
+            else
+            {
+                mosample_add_fixed_row_scalar(pixel_row, accum_row, num_values, mosample->job_fixed_adds);
+            }
+
+            break;
+        }
+
+        case SVR_MOSAMPLE_JOB_RESOLVE:
+        case SVR_MOSAMPLE_JOB_RESOLVE_ROWS:
+        {
+            if (mosample->use_avx2)
+            {
+                mosample_resolve_fixed_row_avx2(accum_row, pixel_row, num_values);
+            }
+
+            else
+            {
+                mosample_resolve_fixed_row_scalar(accum_row, pixel_row, num_values);
+            }
+
+            break;
+        }
+    }
+}
+
+void mosample_do_float_row(SvrMosample* mosample, s32 y, u8* pixel_row)
+{
+    s32 num_values = mosample->width * 4;
+    float* accum_row = mosample->accum + ((s64)y * num_values);
+
+    switch (mosample->job_type)
+    {
+        case SVR_MOSAMPLE_JOB_CLEAR:
+        {
+            // The work texture is cleared to black with an alpha of 1.
+            for (s32 i = 0; i < num_values; i += 4)
+            {
+                accum_row[i + 0] = 0.0f;
+                accum_row[i + 1] = 0.0f;
+                accum_row[i + 2] = 0.0f;
+                accum_row[i + 3] = 1.0f;
+            }
+
+            break;
+        }
+
+        case SVR_MOSAMPLE_JOB_ADD:
+        {
+            if (mosample->use_avx2)
+            {
+                mosample_add_row_avx2(pixel_row, accum_row, num_values, mosample->job_weight);
+            }
+
+            else
+            {
+                mosample_add_row_scalar(pixel_row, accum_row, num_values, mosample->job_weight);
+            }
+
+            break;
+        }
+
+        case SVR_MOSAMPLE_JOB_RESOLVE:
+        case SVR_MOSAMPLE_JOB_RESOLVE_ROWS:
+        {
+            if (mosample->use_avx2)
+            {
+                mosample_resolve_row_avx2(accum_row, pixel_row, num_values);
+            }
+
+            else
+            {
+                mosample_resolve_row_scalar(accum_row, pixel_row, num_values);
+            }
+
+            break;
+        }
+    }
+}
+
+void mosample_do_band(SvrMosample* mosample, s32 band_idx)
+{
+    s32 start_row = band_idx * MOSAMPLE_BAND_ROWS;
+    s32 end_row = svr_min(start_row + MOSAMPLE_BAND_ROWS, mosample->height);
+
+    // Rows that are given to the row function only need to exist for one row at a time.
+    u8* scratch_row = NULL;
+
+    if (mosample->job_type == SVR_MOSAMPLE_JOB_RESOLVE_ROWS)
+    {
+        scratch_row = SVR_ALLOCA_NUM(u8, mosample->width * 4);
+    }
+
+    for (s32 y = start_row; y < end_row; y++)
+    {
+        u8* pixel_row = scratch_row ? scratch_row : mosample->job_pixels + ((s64)y * mosample->job_pitch);
+
+        if (mosample->format == SVR_MOSAMPLE_FORMAT_FIXED)
+        {
+            mosample_do_fixed_row(mosample, y, pixel_row);
+        }
+
+        else
+        {
+            mosample_do_float_row(mosample, y, pixel_row);
+        }
+
+        if (scratch_row)
+        {
+            mosample->job_row_fn(mosample->job_row_param, y, scratch_row);
+        }
+    }
+}
+
+void mosample_do_bands(SvrMosample* mosample)
+{
+    while (true)
+    {
+        s32 band_idx = svr_atom_add(&mosample->next_band, 1);
+
+        if (band_idx >= mosample->num_bands)
+        {
+            break;
+        }
+
+        mosample_do_band(mosample, band_idx);
+    }
+}
+
+void mosample_worker_proc(void* param)
+{
+    SvrMosampleWorker* worker = (SvrMosampleWorker*)param;
+    SvrMosample* mosample = worker->mosample;
+
+    svr_thread_set_name("MOSAMPLE THREAD");
+
+    while (true)
+    {
+        // Must be read before the job, so a job that is started after we have looked is not missed.
+        s32 seen_count = svr_signal_get(&worker->signal);
+
+        if (svr_atom_load(&mosample->quit))
+        {
+            break;
+        }
+
+        s32 job_id = svr_atom_load(&mosample->job_id);
+
+        if (job_id != worker->seen_job_id)
+        {
+            worker->seen_job_id = job_id;
+
+            mosample_do_bands(mosample);
+
+            svr_atom_sub(&mosample->num_working, 1);
+            svr_notify_atom_changed(&mosample->num_working);
+            continue;
+        }
+
+        svr_signal_wait(&worker->signal, seen_count);
+    }
+}
+
+// Do the job that has been set up with all threads, and wait for it to be done.
+void mosample_run_job(SvrMosample* mosample)
+{
+    svr_atom_store(&mosample->next_band, 0);
+    svr_atom_store(&mosample->num_working, mosample->num_workers);
+    svr_atom_add(&mosample->job_id, 1);
+
+    for (s32 i = 0; i < mosample->num_workers; i++)
+    {
+        svr_signal_wake(&mosample->workers[i].signal);
+    }
+
+    mosample_do_bands(mosample);
+
+    svr_wait_until_atom_is(&mosample->num_working, 0);
+}
+
+void svr_mosample_init(SvrMosample* mosample, s32 width, s32 height, SvrMosampleFormat format, s32 num_threads)
+{
+    *mosample = {};
+
+    mosample_init_tables();
+
+    mosample->width = width;
+    mosample->height = height;
+    mosample->format = format;
+
+    if (format == SVR_MOSAMPLE_FORMAT_FIXED)
+    {
+        mosample->fixed_accum = (u16*)svr_alloc((s32)sizeof(u16) * 4 * width * height);
+    }
+
+    else
+    {
+        mosample->accum = (float*)svr_alloc((s32)sizeof(float) * 4 * width * height);
+    }
+
+    mosample->use_avx2 = svr_cpu_has_avx2();
+    mosample->num_bands = (height + MOSAMPLE_BAND_ROWS - 1) / MOSAMPLE_BAND_ROWS;
+
+    // No point in more threads than bands.
+    svr_clamp(&num_threads, 1, svr_max(mosample->num_bands, 1));
+
+    mosample->num_workers = num_threads - 1;
+    mosample->workers = SVR_ZALLOC_NUM(SvrMosampleWorker, svr_max(mosample->num_workers, 1));
+
+    for (s32 i = 0; i < mosample->num_workers; i++)
+    {
+        SvrMosampleWorker* worker = &mosample->workers[i];
+        worker->mosample = mosample;
+
+        svr_thread_start(&worker->thread, mosample_worker_proc, worker);
+    }
+
+    svr_mosample_clear(mosample);
+}
+
+void svr_mosample_free(SvrMosample* mosample)
+{
+    svr_atom_store(&mosample->quit, 1);
+
+    for (s32 i = 0; i < mosample->num_workers; i++)
+    {
+        SvrMosampleWorker* worker = &mosample->workers[i];
+
+        svr_signal_wake(&worker->signal);
+
+        if (worker->thread.h)
+        {
+            svr_thread_wait(&worker->thread);
+            svr_thread_close(&worker->thread);
+        }
+    }
+
+    svr_maybe_free((void**)&mosample->workers);
+    svr_maybe_free((void**)&mosample->accum);
+    svr_maybe_free((void**)&mosample->fixed_accum);
+}
+
+void svr_mosample_clear(SvrMosample* mosample)
+{
+    mosample->job_type = SVR_MOSAMPLE_JOB_CLEAR;
+    mosample->job_pixels = NULL;
+    mosample->job_pitch = 0;
+
+    mosample_run_job(mosample);
+}
+
+void svr_mosample_add(SvrMosample* mosample, const u8* source, s32 source_pitch, float weight_start, float weight_end)
+{
+    mosample->job_type = SVR_MOSAMPLE_JOB_ADD;
+    mosample->job_pixels = (u8*)source;
+    mosample->job_pitch = source_pitch;
+    mosample->job_weight = weight_end - weight_start;
+
+    if (mosample->format == SVR_MOSAMPLE_FORMAT_FIXED)
+    {
+        mosample_make_fixed_adds(mosample->job_fixed_adds, weight_start, weight_end);
+    }
+
+    mosample_run_job(mosample);
+}
+
+void svr_mosample_resolve(SvrMosample* mosample, u8* dest, s32 dest_pitch)
+{
+    mosample->job_type = SVR_MOSAMPLE_JOB_RESOLVE;
+    mosample->job_pixels = dest;
+    mosample->job_pitch = dest_pitch;
+
+    mosample_run_job(mosample);
+}
+
+void svr_mosample_resolve_rows(SvrMosample* mosample, SvrMosampleRowFn row_fn, void* param)
+{
+    mosample->job_type = SVR_MOSAMPLE_JOB_RESOLVE_ROWS;
+    mosample->job_pixels = NULL;
+    mosample->job_pitch = 0;
+    mosample->job_row_fn = row_fn;
+    mosample->job_row_param = param;
+
+    mosample_run_job(mosample);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "svr_common.h"
+#include "svr_atom.h"
+#include "svr_platform.h"
+
+// Motion blur on the CPU, with the same math as motion_sample.hlsl and downsample.hlsl.
+// Frames are added together in linear space into a buffer of floats, and the sum is brought back to gamma space as 8 bits.
+// Pixels are 4 channels of 8 bits. Every channel is treated the same, so the channel order does not matter.
+// The work is split into bands of rows that are done by all threads, including the calling thread.
+
+// There are two formats for the sum. The float format is the same as the R32G32B32A32_FLOAT work texture.
+// The fixed point format uses 16 bits per channel (half the memory traffic) and is the same as the R16G16B16A16_UINT work texture.
+// In the fixed point format, 65535 is a linear value of 1. The fourth channel is alpha and is not summed, it is always opaque in the result.
+// Frames that do not change come back exactly as they were. Otherwise the result can be off by one step of 1 / 65535 for every frame that is added.
+
+struct SvrMosample;
+
+// Called for every row of the result with svr_mosample_resolve_rows. The row is only valid during the call.
+// This is called from all threads at the same time, for different rows.
+using SvrMosampleRowFn = void(*)(void* param, s32 y, u8* row);
+
+struct SvrMosampleWorker
+{
+    SvrThread thread;
+    SvrSignal signal; // Woken when there is a new job.
+    s32 seen_job_id;
+    SvrMosample* mosample;
+};
+
+using SvrMosampleFormat = s32;
+
+enum /* SvrMosampleFormat */
+{
+    SVR_MOSAMPLE_FORMAT_FLOAT,
+    SVR_MOSAMPLE_FORMAT_FIXED,
+};
+
+using SvrMosampleJobType = s32;
+
+enum /* SvrMosampleJobType */
+{
+    SVR_MOSAMPLE_JOB_CLEAR,
+    SVR_MOSAMPLE_JOB_ADD,
+    SVR_MOSAMPLE_JOB_RESOLVE,
+    SVR_MOSAMPLE_JOB_RESOLVE_ROWS,
+};
+
+struct SvrMosample
+{
+    s32 width;
+    s32 height;
+    SvrMosampleFormat format;
+
+    // Only one of these is used depending on the format. Both have 4 channels per pixel in linear space, and rows are tightly packed.
+    float* accum;
+    u16* fixed_accum;
+
+    bool use_avx2;
+
+    // Current job, only written by the calling thread when the workers are idle.
+    SvrMosampleJobType job_type;
+    u8* job_pixels; // Source for add, destination for resolve.
+    s32 job_pitch;
+    float job_weight;
+    s32 job_fixed_adds[256]; // What to add in the fixed point format for every 8 bit value.
+    SvrMosampleRowFn job_row_fn;
+    void* job_row_param;
+
+    s32 num_bands;
+    SvrAtom32 next_band;
+    SvrAtom32 job_id; // Increased for every job.
+    SvrAtom32 num_working; // Workers that have not finished the current job.
+    SvrAtom32 quit;
+
+    SvrMosampleWorker* workers;
+    s32 num_workers; // Threads other than the calling thread.
+};
+
+// Number of threads includes the calling thread. The buffer starts out cleared.
+void svr_mosample_init(SvrMosample* mosample, s32 width, s32 height, SvrMosampleFormat format, s32 num_threads);
+void svr_mosample_free(SvrMosample* mosample);
+
+// Start over for a new movie frame. Same as the black clear of the work texture.
+void svr_mosample_clear(SvrMosample* mosample);
+
+// Add a frame. The weights are the sum of the weights of the frames before this one in the movie frame, and the sum including this one
+// (weight_start and weight_end of SvrSubframe). The fixed point format rounds the sums instead of the weight, so that the rounding cancels out.
+void svr_mosample_add(SvrMosample* mosample, const u8* source, s32 source_pitch, float weight_start, float weight_end);
+
+// Write the sum as 8 bit pixels.
+void svr_mosample_resolve(SvrMosample* mosample, u8* dest, s32 dest_pitch);
+
+// Same as svr_mosample_resolve, but every row is given to a function instead of being written to an image.
+// This is for doing more work on the row while it is still in the cache, instead of going through the whole image again.
+// Only the encoder benchmark uses this, to measure converting the rows to video planes in the same pass.
+void svr_mosample_resolve_rows(SvrMosample* mosample, SvrMosampleRowFn row_fn, void* param);
+
+// Same as the shaders for a single value, for comparing with.
+float svr_mosample_to_linear(u8 v);
+u8 svr_mosample_from_linear(float v);
+
+// Same as above for the fixed point format.
+u16 svr_mosample_to_fixed(u8 v);
+u8 svr_mosample_from_fixed(u16 v);
+
+// Tables for the fixed point shaders. Both have 256 values.
+// The first is the fixed point value of every 8 bit value, and the second is the lowest fixed point value that becomes every 8 bit value.
+void svr_mosample_get_fixed_tables(u32* to_fixed, u32* fixed_thresholds);
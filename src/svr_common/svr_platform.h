@@ -0,0 +1,136 @@
+#pragma once
+#include "svr_common.h"
+
+// Thin layer over the operating system for the things that svr_common and the encoder core need.
+// The backends are in svr_platform_win.cpp and svr_platform_linux.cpp.
+// Stuff that only ever runs on Windows (D3D11, the game, process handles) keeps using the Windows API directly.
+
+// -----------------------------------------------
+// Mutex:
+
+// Zero initialized is an unlocked mutex, so this can be placed in structures without any init.
+// Not recursive.
+struct SvrMutex
+{
+#ifdef _WIN32
+    void* srw; // SRWLOCK.
+#else
+    s32 state; // 0 for unlocked, 1 for locked, 2 for locked with waiters.
+#endif
+};
+
+void svr_mutex_lock(SvrMutex* mutex);
+void svr_mutex_unlock(SvrMutex* mutex);
+
+// -----------------------------------------------
+// Event:
+
+// Auto reset event, only one waiting thread is woken up for every set.
+// Only for threads in the same process.
+struct SvrEvent
+{
+#ifdef _WIN32
+    void* h; // HANDLE.
+#else
+    s32 state; // 1 when set.
+#endif
+};
+
+void svr_event_init(SvrEvent* ev);
+void svr_event_free(SvrEvent* ev);
+void svr_event_set(SvrEvent* ev);
+void svr_event_reset(SvrEvent* ev);
+void svr_event_wait(SvrEvent* ev);
+
+// -----------------------------------------------
+// Futex:
+
+// Sleep while the 4 or 8 bytes at addr are equal to the value at compare. Can return spuriously, so the caller must check again.
+// Only 32-bit values are supported by the Linux kernel, so 64-bit values are checked at an interval there instead.
+void svr_futex_wait(void* addr, void* compare, s32 size);
+
+// Wake all threads waiting on addr. This is also a full memory barrier.
+void svr_futex_wake_all(void* addr);
+
+// -----------------------------------------------
+// Thread:
+
+using SvrThreadProc = void(*)(void* param);
+
+struct SvrThread
+{
+    void* h; // NULL when no thread has been started.
+    bool waited;
+};
+
+bool svr_thread_start(SvrThread* thread, SvrThreadProc proc, void* param);
+
+// Wait for the thread to exit. The thread must still be closed after.
+void svr_thread_wait(SvrThread* thread);
+
+// Release the thread. If the thread has not been waited for, it will continue on its own and clean up when it exits.
+void svr_thread_close(SvrThread* thread);
+
+// Name the calling thread for debuggers. This may be shortened on some platforms.
+void svr_thread_set_name(const char* name);
+
+u32 svr_get_thread_id();
+u32 svr_get_process_id();
+
+// Number of logical processors that the process can run on.
+s32 svr_get_num_processors();
+
+// If the processor has AVX2 and the system saves the 256-bit registers between thread switches.
+bool svr_cpu_has_avx2();
+
+// If the processor has AVX-512F and the system saves the 512-bit registers between thread switches.
+bool svr_cpu_has_avx512();
+
+// How much memory of the process is in physical memory right now.
+s64 svr_get_working_set_size();
+
+// -----------------------------------------------
+// Clock:
+
+// High resolution monotonic clock.
+s64 svr_get_clock_ticks();
+s64 svr_get_clock_freq(); // Ticks per second.
+
+// -----------------------------------------------
+// File:
+
+using SvrFileMode = s32;
+
+enum /* SvrFileMode */
+{
+    SVR_FILE_MODE_READ, // File must exist.
+    SVR_FILE_MODE_WRITE, // File is created or truncated.
+    SVR_FILE_MODE_APPEND, // File must exist, writes are added to the end.
+};
+
+// Files can be read by other processes while they are open.
+struct SvrFile
+{
+    void* h; // NULL when not open.
+};
+
+bool svr_file_open(SvrFile* file, const char* path, SvrFileMode mode);
+void svr_file_close(SvrFile* file);
+bool svr_file_write(SvrFile* file, const void* data, s32 size);
+s32 svr_file_read(SvrFile* file, void* dest, s32 size); // Returns how many bytes were read, or -1 on error.
+s64 svr_file_get_size(SvrFile* file); // Returns -1 on error.
+bool svr_file_exists(const char* path);
+bool svr_file_delete(const char* path);
+
+// -----------------------------------------------
+// Memory mapped file:
+
+// Read only view of a whole file.
+struct SvrFileView
+{
+    void* data; // NULL for empty files.
+    s64 size;
+};
+
+bool svr_file_view_open(SvrFileView* view, const char* path);
+void svr_file_view_close(SvrFileView* view);
@@ -0,0 +1,446 @@
+#ifdef __linux__
+#include "svr_platform.h"
+#include "svr_alloc.h"
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+const s32 PLATFORM_FUTEX64_WAIT_NS = 1000000; // How often 64-bit futex waits check the value again.
+
+long platform_futex(s32* addr, s32 op, s32 value, const timespec* timeout)
+{
+    return syscall(SYS_futex, addr, op, value, timeout, NULL, 0);
+}
+
+// Mutex from "Futexes Are Tricky" by Ulrich Drepper.
+// Only goes to the kernel when there is contention.
+
+void svr_mutex_lock(SvrMutex* mutex)
+{
+    s32 state = 0;
+
+    if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    if (state != 2)
+    {
+        state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+
+    while (state != 0)
+    {
+        platform_futex(&mutex->state, FUTEX_WAIT_PRIVATE, 2, NULL);
+        state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void svr_mutex_unlock(SvrMutex* mutex)
+{
+    if (__atomic_exchange_n(&mutex->state, 0, __ATOMIC_RELEASE) == 2)
+    {
+        platform_futex(&mutex->state, FUTEX_WAKE_PRIVATE, 1, NULL);
+    }
+}
+
+void svr_event_init(SvrEvent* ev)
+{
+    __atomic_store_n(&ev->state, 0, __ATOMIC_RELEASE);
+}
+
+void svr_event_free(SvrEvent* /* ev */)
+{
+}
+
+void svr_event_set(SvrEvent* ev)
+{
+    __atomic_store_n(&ev->state, 1, __ATOMIC_SEQ_CST);
+    platform_futex(&ev->state, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+void svr_event_reset(SvrEvent* ev)
+{
+    __atomic_store_n(&ev->state, 0, __ATOMIC_RELEASE);
+}
+
+void svr_event_wait(SvrEvent* ev)
+{
+    while (true)
+    {
+        // Reset it again when taking it, as only one waiter should get through.
+        if (__atomic_exchange_n(&ev->state, 0, __ATOMIC_ACQUIRE) == 1)
+        {
+            break;
+        }
+
+        platform_futex(&ev->state, FUTEX_WAIT_PRIVATE, 0, NULL);
+    }
+}
+
+void svr_futex_wait(void* addr, void* compare, s32 size)
+{
+    if (size == 4)
+    {
+        platform_futex((s32*)addr, FUTEX_WAIT_PRIVATE, *(s32*)compare, NULL);
+        return;
+    }
+
+    assert(size == 8);
+
+    // Can only wait on the low half. A change in the high half only would not be seen, so don't wait forever.
+    timespec timeout = {};
+    timeout.tv_nsec = PLATFORM_FUTEX64_WAIT_NS;
+
+    if (__atomic_load_n((s64*)addr, __ATOMIC_ACQUIRE) == *(s64*)compare)
+    {
+        platform_futex((s32*)addr, FUTEX_WAIT_PRIVATE, *(s32*)compare, &timeout);
+    }
+}
+
+void svr_futex_wake_all(void* addr)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    platform_futex((s32*)addr, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL);
+}
+
+struct PlatformThreadStart
+{
+    SvrThreadProc proc;
+    void* param;
+};
+
+void* platform_thread_proc(void* param)
+{
+    PlatformThreadStart start = *(PlatformThreadStart*)param;
+    svr_free(param);
+
+    start.proc(start.param);
+
+    return NULL; // Not used.
+}
+
+// The pthread_t is stored in the handle directly.
+static_assert(sizeof(pthread_t) <= sizeof(void*), "pthread_t must fit in SvrThread");
+
+bool svr_thread_start(SvrThread* thread, SvrThreadProc proc, void* param)
+{
+    PlatformThreadStart* start = SVR_ZALLOC(PlatformThreadStart);
+    start->proc = proc;
+    start->param = param;
+
+    pthread_t pt;
+
+    thread->h = NULL;
+    thread->waited = false;
+
+    if (pthread_create(&pt, NULL, platform_thread_proc, start) != 0)
+    {
+        svr_free(start);
+        return false;
+    }
+
+    thread->h = (void*)pt;
+    return true;
+}
+
+void svr_thread_wait(SvrThread* thread)
+{
+    assert(thread->h);
+
+    if (!thread->waited)
+    {
+        pthread_join((pthread_t)thread->h, NULL);
+        thread->waited = true;
+    }
+}
+
+void svr_thread_close(SvrThread* thread)
+{
+    if (thread->h && !thread->waited)
+    {
+        pthread_detach((pthread_t)thread->h);
+    }
+
+    thread->h = NULL;
+    thread->waited = false;
+}
+
+void svr_thread_set_name(const char* name)
+{
+    // Names can only be 15 characters here.
+    char buf[16];
+    SVR_COPY_STRING(name, buf);
+
+    pthread_setname_np(pthread_self(), buf);
+}
+
+u32 svr_get_thread_id()
+{
+    return (u32)syscall(SYS_gettid);
+}
+
+u32 svr_get_process_id()
+{
+    return (u32)getpid();
+}
+
+s32 svr_get_num_processors()
+{
+    return svr_max((s32)sysconf(_SC_NPROCESSORS_ONLN), 1);
+}
+
+bool svr_cpu_has_avx2()
+{
+    // Also checks that the system saves the registers.
+    return __builtin_cpu_supports("avx2");
+}
+
+bool svr_cpu_has_avx512()
+{
+    // Also checks that the system saves the registers.
+    return __builtin_cpu_supports("avx512f");
+}
+
+s64 svr_get_working_set_size()
+{
+    // The second value is the number of resident pages.
+    char buf[128];
+    s32 fd = open("/proc/self/statm", O_RDONLY);
+
+    if (fd == -1)
+    {
+        return 0;
+    }
+
+    ssize_t size = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+
+    if (size <= 0)
+    {
+        return 0;
+    }
+
+    buf[size] = 0;
+
+    long long total_pages = 0;
+    long long resident_pages = 0;
+
+    if (sscanf(buf, "%lld %lld", &total_pages, &resident_pages) != 2)
+    {
+        return 0;
+    }
+
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+s64 svr_get_clock_ticks()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+s64 svr_get_clock_freq()
+{
+    return 1000000000LL;
+}
+
+// The descriptor is stored as fd + 1 so that NULL can mean not open, as 0 is a valid descriptor.
+
+s32 platform_get_fd(SvrFile* file)
+{
+    return (s32)(intptr_t)file->h - 1;
+}
+
+bool svr_file_open(SvrFile* file, const char* path, SvrFileMode mode)
+{
+    s32 flags = 0;
+
+    switch (mode)
+    {
+        case SVR_FILE_MODE_READ:
+        {
+            flags = O_RDONLY;
+            break;
+        }
+
+        case SVR_FILE_MODE_WRITE:
+        {
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+        }
+
+        case SVR_FILE_MODE_APPEND:
+        {
+            flags = O_WRONLY | O_APPEND;
+            break;
+        }
+    }
+
+    s32 fd = open(path, flags | O_CLOEXEC, 0644);
+
+    if (fd == -1)
+    {
+        file->h = NULL;
+        return false;
+    }
+
+    file->h = (void*)(intptr_t)(fd + 1);
+    return true;
+}
+
+void svr_file_close(SvrFile* file)
+{
+    if (file->h)
+    {
+        close(platform_get_fd(file));
+        file->h = NULL;
+    }
+}
+
+bool svr_file_write(SvrFile* file, const void* data, s32 size)
+{
+    const u8* ptr = (const u8*)data;
+
+    while (size > 0)
+    {
+        ssize_t written = write(platform_get_fd(file), ptr, size);
+
+        if (written == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        ptr += written;
+        size -= (s32)written;
+    }
+
+    return true;
+}
+
+s32 svr_file_read(SvrFile* file, void* dest, s32 size)
+{
+    u8* ptr = (u8*)dest;
+    s32 total = 0;
+
+    while (total < size)
+    {
+        ssize_t num_read = read(platform_get_fd(file), ptr + total, size - total);
+
+        if (num_read == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+
+        // End of file.
+        if (num_read == 0)
+        {
+            break;
+        }
+
+        total += (s32)num_read;
+    }
+
+    return total;
+}
+
+s64 svr_file_get_size(SvrFile* file)
+{
+    struct stat st;
+
+    if (fstat(platform_get_fd(file), &st) == -1)
+    {
+        return -1;
+    }
+
+    return st.st_size;
+}
+
+bool svr_file_exists(const char* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+bool svr_file_delete(const char* path)
+{
+    return unlink(path) == 0;
+}
+
+bool svr_file_view_open(SvrFileView* view, const char* path)
+{
+    bool ret = false;
+    SvrFile file = {};
+
+    view->data = NULL;
+    view->size = 0;
+
+    if (!svr_file_open(&file, path, SVR_FILE_MODE_READ))
+    {
+        goto rfail;
+    }
+
+    view->size = svr_file_get_size(&file);
+
+    if (view->size < 0)
+    {
+        goto rfail;
+    }
+
+    // Empty files cannot be mapped.
+    if (view->size == 0)
+    {
+        ret = true;
+        goto rexit;
+    }
+
+    // The mapping keeps the file open.
+    view->data = mmap(NULL, view->size, PROT_READ, MAP_PRIVATE, platform_get_fd(&file), 0);
+
+    if (view->data == MAP_FAILED)
+    {
+        view->data = NULL;
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    view->size = 0;
+
+rexit:
+    svr_file_close(&file);
+    return ret;
+}
+
+void svr_file_view_close(SvrFileView* view)
+{
+    if (view->data)
+    {
+        munmap(view->data, view->size);
+        view->data = NULL;
+    }
+
+    view->size = 0;
+}
+#endif
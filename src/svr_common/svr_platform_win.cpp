@@ -0,0 +1,351 @@
+#ifdef _WIN32
+#include "svr_platform.h"
+#include "svr_alloc.h"
+#include <Windows.h>
+#include <Psapi.h>
+#include <intrin.h>
+#include <assert.h>
+#include <string.h>
+
+static_assert(sizeof(SRWLOCK) == sizeof(void*), "SvrMutex must fit a SRWLOCK");
+
+void svr_mutex_lock(SvrMutex* mutex)
+{
+    AcquireSRWLockExclusive((SRWLOCK*)&mutex->srw);
+}
+
+void svr_mutex_unlock(SvrMutex* mutex)
+{
+    ReleaseSRWLockExclusive((SRWLOCK*)&mutex->srw);
+}
+
+void svr_event_init(SvrEvent* ev)
+{
+    ev->h = CreateEventA(NULL, FALSE, FALSE, NULL);
+}
+
+void svr_event_free(SvrEvent* ev)
+{
+    svr_maybe_close_handle(&ev->h);
+}
+
+void svr_event_set(SvrEvent* ev)
+{
+    SetEvent(ev->h);
+}
+
+void svr_event_reset(SvrEvent* ev)
+{
+    ResetEvent(ev->h);
+}
+
+void svr_event_wait(SvrEvent* ev)
+{
+    WaitForSingleObject(ev->h, INFINITE);
+}
+
+void svr_futex_wait(void* addr, void* compare, s32 size)
+{
+    WaitOnAddress(addr, compare, size, INFINITE);
+}
+
+void svr_futex_wake_all(void* addr)
+{
+    WakeByAddressAll(addr);
+}
+
+struct PlatformThreadStart
+{
+    SvrThreadProc proc;
+    void* param;
+};
+
+DWORD CALLBACK platform_thread_proc(LPVOID param)
+{
+    PlatformThreadStart start = *(PlatformThreadStart*)param;
+    svr_free(param);
+
+    start.proc(start.param);
+
+    return 0; // Not used.
+}
+
+bool svr_thread_start(SvrThread* thread, SvrThreadProc proc, void* param)
+{
+    PlatformThreadStart* start = SVR_ZALLOC(PlatformThreadStart);
+    start->proc = proc;
+    start->param = param;
+
+    thread->waited = false;
+    thread->h = CreateThread(NULL, 0, platform_thread_proc, start, 0, NULL);
+
+    if (thread->h == NULL)
+    {
+        svr_free(start);
+        return false;
+    }
+
+    return true;
+}
+
+void svr_thread_wait(SvrThread* thread)
+{
+    assert(thread->h);
+
+    WaitForSingleObject(thread->h, INFINITE);
+    thread->waited = true;
+}
+
+void svr_thread_close(SvrThread* thread)
+{
+    svr_maybe_close_handle(&thread->h);
+    thread->waited = false;
+}
+
+void svr_thread_set_name(const char* name)
+{
+    wchar buf[128];
+    svr_to_utf16(name, (s32)strlen(name) + 1, buf, SVR_ARRAY_SIZE(buf));
+
+    SetThreadDescription(GetCurrentThread(), buf);
+}
+
+u32 svr_get_thread_id()
+{
+    return GetCurrentThreadId();
+}
+
+u32 svr_get_process_id()
+{
+    return GetCurrentProcessId();
+}
+
+s32 svr_get_num_processors()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (s32)info.dwNumberOfProcessors;
+}
+
+bool svr_cpu_has_avx2()
+{
+    s32 info[4];
+
+    __cpuid(info, 0);
+    s32 max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool has_osxsave = info[2] & (1 << 27);
+
+    s32 leaf7_ebx = 0;
+
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        leaf7_ebx = info[1];
+    }
+
+    u64 xcr0 = has_osxsave ? _xgetbv(0) : 0;
+
+    return (xcr0 & 0x06) == 0x06 && (leaf7_ebx & (1 << 5));
+}
+
+bool svr_cpu_has_avx512()
+{
+    s32 info[4];
+
+    __cpuid(info, 0);
+    s32 max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool has_osxsave = info[2] & (1 << 27);
+
+    s32 leaf7_ebx = 0;
+
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        leaf7_ebx = info[1];
+    }
+
+    u64 xcr0 = has_osxsave ? _xgetbv(0) : 0;
+
+    return (xcr0 & 0xe6) == 0xe6 && (leaf7_ebx & (1 << 16));
+}
+
+s64 svr_get_working_set_size()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(PROCESS_MEMORY_COUNTERS)))
+    {
+        return 0;
+    }
+
+    return (s64)counters.WorkingSetSize;
+}
+
+s64 svr_get_clock_ticks()
+{
+    LARGE_INTEGER ret;
+    QueryPerformanceCounter(&ret);
+    return ret.QuadPart;
+}
+
+s64 svr_get_clock_freq()
+{
+    LARGE_INTEGER ret;
+    QueryPerformanceFrequency(&ret);
+    return ret.QuadPart;
+}
+
+bool svr_file_open(SvrFile* file, const char* path, SvrFileMode mode)
+{
+    DWORD access = GENERIC_WRITE;
+    DWORD open_flags = OPEN_EXISTING;
+
+    switch (mode)
+    {
+        case SVR_FILE_MODE_READ:
+        {
+            access = GENERIC_READ;
+            break;
+        }
+
+        case SVR_FILE_MODE_WRITE:
+        {
+            open_flags = CREATE_ALWAYS;
+            break;
+        }
+    }
+
+    HANDLE h = CreateFileA(path, access, FILE_SHARE_READ, NULL, open_flags, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        file->h = NULL;
+        return false;
+    }
+
+    if (mode == SVR_FILE_MODE_APPEND)
+    {
+        LARGE_INTEGER dist_to_move = {};
+        SetFilePointerEx(h, dist_to_move, NULL, FILE_END);
+    }
+
+    file->h = h;
+    return true;
+}
+
+void svr_file_close(SvrFile* file)
+{
+    svr_maybe_close_handle(&file->h);
+}
+
+bool svr_file_write(SvrFile* file, const void* data, s32 size)
+{
+    DWORD written = 0;
+    return WriteFile(file->h, data, size, &written, NULL) && written == (DWORD)size;
+}
+
+s32 svr_file_read(SvrFile* file, void* dest, s32 size)
+{
+    DWORD num_read = 0;
+
+    if (!ReadFile(file->h, dest, size, &num_read, NULL))
+    {
+        return -1;
+    }
+
+    return (s32)num_read;
+}
+
+s64 svr_file_get_size(SvrFile* file)
+{
+    LARGE_INTEGER large;
+
+    if (!GetFileSizeEx(file->h, &large))
+    {
+        return -1;
+    }
+
+    return large.QuadPart;
+}
+
+bool svr_file_exists(const char* path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    return GetFileAttributesExA(path, GetFileExInfoStandard, &attr) != 0;
+}
+
+bool svr_file_delete(const char* path)
+{
+    return DeleteFileA(path) != 0;
+}
+
+bool svr_file_view_open(SvrFileView* view, const char* path)
+{
+    bool ret = false;
+    SvrFile file = {};
+    HANDLE mapping_h = NULL;
+
+    view->data = NULL;
+    view->size = 0;
+
+    if (!svr_file_open(&file, path, SVR_FILE_MODE_READ))
+    {
+        goto rfail;
+    }
+
+    view->size = svr_file_get_size(&file);
+
+    if (view->size < 0)
+    {
+        goto rfail;
+    }
+
+    // Mappings cannot be created for empty files.
+    if (view->size == 0)
+    {
+        ret = true;
+        goto rexit;
+    }
+
+    mapping_h = CreateFileMappingA(file.h, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (mapping_h == NULL)
+    {
+        goto rfail;
+    }
+
+    // The view keeps the mapping and the file open.
+    view->data = MapViewOfFile(mapping_h, FILE_MAP_READ, 0, 0, 0);
+
+    if (view->data == NULL)
+    {
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    view->size = 0;
+
+rexit:
+    svr_maybe_close_handle(&mapping_h);
+    svr_file_close(&file);
+    return ret;
+}
+
+void svr_file_view_close(SvrFileView* view)
+{
+    if (view->data)
+    {
+        UnmapViewOfFile(view->data);
+        view->data = NULL;
+    }
+
+    view->size = 0;
+}
+#endif
@@ -0,0 +1,605 @@
+#include "svr_scan.h"
+#include "svr_alloc.h"
+#include "svr_atom.h"
+#include "svr_platform.h"
+#include <immintrin.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+// Bytes that are the most common in x86 and x64 code, most common first.
+// Used to pick which bytes of a pattern to search for first, because the rarer the byte, the fewer places have to be checked fully.
+const u8 SCAN_COMMON_BYTES[] =
+{
+    0x00, 0xFF, 0x8B, 0x48, 0x89, 0xCC, 0x0F, 0xE8, 0x24, 0x4C, 0x83, 0x44, 0x01, 0x85, 0xC0, 0x8D,
+    0x45, 0x04, 0x08, 0x74, 0x75, 0x10, 0x20, 0x40, 0xC3, 0x33, 0x90, 0x0D, 0x05, 0x3B, 0x84, 0xEB,
+};
+
+// Size of the parts that the regions are split into for svr_scan_find_many.
+const s32 SCAN_BLOCK_SIZE = 1024 * 1024;
+
+// Higher is rarer.
+s32 scan_get_byte_rarity(u8 byte)
+{
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(SCAN_COMMON_BYTES); i++)
+    {
+        if (SCAN_COMMON_BYTES[i] == byte)
+        {
+            return i;
+        }
+    }
+
+    return 256;
+}
+
+// Pick the two rarest known bytes of the pattern to search for.
+// The same byte is used twice if there is only one known byte.
+void scan_find_anchors(SvrScanPattern* pattern)
+{
+    s32 best_idx = -1;
+    s32 best_rarity = -1;
+    s32 second_idx = -1;
+    s32 second_rarity = -1;
+
+    for (s32 i = 0; i < pattern->used; i++)
+    {
+        if (pattern->bytes[i] < 0)
+        {
+            continue;
+        }
+
+        s32 rarity = scan_get_byte_rarity((u8)pattern->bytes[i]);
+
+        if (rarity > best_rarity)
+        {
+            second_idx = best_idx;
+            second_rarity = best_rarity;
+            best_idx = i;
+            best_rarity = rarity;
+        }
+
+        else if (rarity > second_rarity)
+        {
+            second_idx = i;
+            second_rarity = rarity;
+        }
+    }
+
+    if (second_idx == -1)
+    {
+        second_idx = best_idx;
+    }
+
+    pattern->anchor_idxs[0] = best_idx;
+    pattern->anchor_idxs[1] = second_idx;
+}
+
+bool scan_is_hex_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F');
+}
+
+void svr_scan_parse_pattern(const char* input, SvrScanPattern* out)
+{
+    const char* ptr = input;
+
+    out->used = 0;
+
+    for (; *ptr != 0; ptr++)
+    {
+        assert(out->used < SVR_SCAN_MAX_BYTES);
+
+        if (scan_is_hex_char(*ptr))
+        {
+            assert(scan_is_hex_char(*(ptr + 1))); // Next must be the next 4 bits.
+
+            out->bytes[out->used] = (s16)strtol(ptr, NULL, 16);
+            out->used++;
+            ptr++;
+        }
+
+        else if (*ptr == '?')
+        {
+            assert(*(ptr + 1) == '?'); // Next must be question mark.
+
+            out->bytes[out->used] = -1;
+            out->used++;
+            ptr++;
+        }
+    }
+
+    assert(out->used > 0); // Must have written something.
+
+    scan_find_anchors(out);
+}
+
+bool scan_compare_data(u8* data, SvrScanPattern* pattern)
+{
+    s16* bytes = pattern->bytes;
+
+    for (s32 i = 0; i < pattern->used; i++)
+    {
+        s16 byte = bytes[i];
+
+        if (byte > -1 && data[i] != byte)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline s32 scan_get_first_bit(u32 mask)
+{
+#ifdef _WIN32
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return (s32)bit;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// -----------------------------------------------
+// Single pattern:
+
+u8* scan_find_scalar(u8* start, s32 search_length, SvrScanPattern* pattern)
+{
+    for (s32 i = 0; i <= search_length - pattern->used; i++)
+    {
+        u8* addr = start + i;
+
+        if (scan_compare_data(addr, pattern))
+        {
+            return addr;
+        }
+    }
+
+    return NULL;
+}
+
+// Check all candidates in a block that had both anchor bytes in the right place.
+u8* scan_check_candidates(u8* block, u32 mask, SvrScanPattern* pattern)
+{
+    while (mask)
+    {
+        u8* addr = block + scan_get_first_bit(mask);
+
+        if (scan_compare_data(addr, pattern))
+        {
+            return addr;
+        }
+
+        mask &= mask - 1;
+    }
+
+    return NULL;
+}
+
+// The kernels compare the anchor bytes for a whole block of start positions at a time, and only verify the full pattern where both anchors match.
+// Positions at the end that don't fill a whole block are checked by the scalar version.
+
+u8* scan_find_sse2(u8* start, s32 search_length, SvrScanPattern* pattern)
+{
+    s32 last_pos = search_length - pattern->used; // Last position where the whole pattern fits.
+    s32 anchor_0 = pattern->anchor_idxs[0];
+    s32 anchor_1 = pattern->anchor_idxs[1];
+
+    __m128i value_0 = _mm_set1_epi8((char)pattern->bytes[anchor_0]);
+    __m128i value_1 = _mm_set1_epi8((char)pattern->bytes[anchor_1]);
+
+    s32 i = 0;
+
+    for (; i + 15 <= last_pos; i += 16)
+    {
+        __m128i cmp_0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(start + i + anchor_0)), value_0);
+        __m128i cmp_1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(start + i + anchor_1)), value_1);
+
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(cmp_0, cmp_1));
+
+        if (mask)
+        {
+            u8* addr = scan_check_candidates(start + i, mask, pattern);
+
+            if (addr)
+            {
+                return addr;
+            }
+        }
+    }
+
+    return scan_find_scalar(start + i, search_length - i, pattern);
+}
+
+SVR_TARGET_AVX2 u8* scan_find_avx2(u8* start, s32 search_length, SvrScanPattern* pattern)
+{
+    s32 last_pos = search_length - pattern->used; // Last position where the whole pattern fits.
+    s32 anchor_0 = pattern->anchor_idxs[0];
+    s32 anchor_1 = pattern->anchor_idxs[1];
+
+    __m256i value_0 = _mm256_set1_epi8((char)pattern->bytes[anchor_0]);
+    __m256i value_1 = _mm256_set1_epi8((char)pattern->bytes[anchor_1]);
+
+    s32 i = 0;
+
+    for (; i + 31 <= last_pos; i += 32)
+    {
+        __m256i cmp_0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(start + i + anchor_0)), value_0);
+        __m256i cmp_1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(start + i + anchor_1)), value_1);
+
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(cmp_0, cmp_1));
+
+        if (mask)
+        {
+            u8* addr = scan_check_candidates(start + i, mask, pattern);
+
+            if (addr)
+            {
+                return addr;
+            }
+        }
+    }
+
+    // Can still do a block of 16.
+    return scan_find_sse2(start + i, search_length - i, pattern);
+}
+
+using ScanFindFn = u8*(*)(u8* start, s32 search_length, SvrScanPattern* pattern);
+
+// Indexed by SvrScanKernel.
+const ScanFindFn SCAN_FIND_FNS[] =
+{
+    scan_find_scalar,
+    scan_find_sse2,
+    scan_find_avx2,
+};
+
+SvrScanKernel scan_best_kernel = -1;
+
+u8* svr_scan_find(u8* start, s32 search_length, SvrScanPattern* pattern)
+{
+    // Pick the best version that the processor and the system supports.
+    if (scan_best_kernel == -1)
+    {
+        scan_best_kernel = svr_cpu_has_avx2() ? SVR_SCAN_KERNEL_AVX2 : SVR_SCAN_KERNEL_SSE2;
+    }
+
+    return svr_scan_find_with_kernel(start, search_length, pattern, scan_best_kernel);
+}
+
+u8* svr_scan_find_with_kernel(u8* start, s32 search_length, SvrScanPattern* pattern, SvrScanKernel kernel)
+{
+    if (search_length < pattern->used)
+    {
+        return NULL;
+    }
+
+    // Only unknown bytes, so it matches right away.
+    if (pattern->anchor_idxs[0] == -1)
+    {
+        return start;
+    }
+
+    return SCAN_FIND_FNS[kernel](start, search_length, pattern);
+}
+
+// -----------------------------------------------
+// Many patterns:
+
+// The first anchor byte of every pattern is put in a set. The regions are swept for bytes in the set, and the patterns that have that byte as anchor
+// are checked at that position. Every match is found by the block that its first anchor byte is in, so the blocks can be searched in any order.
+// The set is tested 32 bytes at a time by looking up the low 4 bits of every byte in a table of which high 4 bits are in the set (the "truffle" method).
+
+struct ScanRegionState
+{
+    SvrScanRegion* region;
+
+    // Bitmask of the first anchor bytes. For the bytes with the low 4 bits as index, bit N means that the high 4 bits as N (or N + 8) is in the set.
+    u8 set_low[16];
+    u8 set_high[16];
+    bool set_table[256];
+
+    // Indexes of the patterns for every first anchor byte.
+    s32 bucket_starts[257];
+    s32* bucket_patterns;
+
+    SvrAtom32* best_offsets; // Lowest match offset of every pattern so far.
+};
+
+struct ScanBlock
+{
+    ScanRegionState* state;
+    s32 start;
+    s32 end;
+};
+
+struct ScanManyState
+{
+    ScanBlock* blocks;
+    s32 num_blocks;
+    SvrAtom32 next_block;
+    bool use_avx2;
+};
+
+void scan_init_region_state(ScanRegionState* state, SvrScanRegion* region)
+{
+    memset(state, 0, sizeof(ScanRegionState));
+    state->region = region;
+
+    state->bucket_patterns = SVR_ZALLOC_NUM(s32, svr_max(region->num_patterns, 1));
+    state->best_offsets = SVR_ZALLOC_NUM(SvrAtom32, svr_max(region->num_patterns, 1));
+
+    s32 bucket_counts[256] = {};
+
+    for (s32 i = 0; i < region->num_patterns; i++)
+    {
+        SvrScanPattern* pattern = &region->patterns[i];
+
+        svr_atom_store(&state->best_offsets[i], INT32_MAX);
+
+        if (pattern->anchor_idxs[0] == -1)
+        {
+            continue;
+        }
+
+        u8 byte = (u8)pattern->bytes[pattern->anchor_idxs[0]];
+
+        bucket_counts[byte]++;
+
+        state->set_table[byte] = true;
+
+        if (byte < 0x80)
+        {
+            state->set_low[byte & 0x0F] |= 1 << (byte >> 4);
+        }
+
+        else
+        {
+            state->set_high[byte & 0x0F] |= 1 << ((byte >> 4) - 8);
+        }
+    }
+
+    // Patterns are stored sorted by their anchor byte.
+
+    s32 pos = 0;
+
+    for (s32 i = 0; i < 256; i++)
+    {
+        state->bucket_starts[i] = pos;
+        pos += bucket_counts[i];
+    }
+
+    state->bucket_starts[256] = pos;
+
+    s32 bucket_fill[256] = {};
+
+    for (s32 i = 0; i < region->num_patterns; i++)
+    {
+        SvrScanPattern* pattern = &region->patterns[i];
+
+        if (pattern->anchor_idxs[0] == -1)
+        {
+            continue;
+        }
+
+        u8 byte = (u8)pattern->bytes[pattern->anchor_idxs[0]];
+
+        state->bucket_patterns[state->bucket_starts[byte] + bucket_fill[byte]] = i;
+        bucket_fill[byte]++;
+    }
+}
+
+void scan_free_region_state(ScanRegionState* state)
+{
+    svr_free(state->bucket_patterns);
+    svr_free(state->best_offsets);
+}
+
+// Lower the best offset of a pattern if this match is earlier.
+void scan_set_best_offset(SvrAtom32* best, s32 offset)
+{
+    s32 cur = svr_atom_load(best);
+
+    while (offset < cur)
+    {
+        if (svr_atom_cmpxchg(best, &cur, offset))
+        {
+            break;
+        }
+    }
+}
+
+// Check all patterns that have this byte as anchor.
+void scan_check_position(ScanRegionState* state, s32 pos)
+{
+    SvrScanRegion* region = state->region;
+    u8 byte = region->data[pos];
+
+    for (s32 i = state->bucket_starts[byte]; i < state->bucket_starts[byte + 1]; i++)
+    {
+        s32 pattern_idx = state->bucket_patterns[i];
+        SvrScanPattern* pattern = &region->patterns[pattern_idx];
+
+        s32 start = pos - pattern->anchor_idxs[0];
+
+        if (start < 0 || start > region->size - pattern->used)
+        {
+            continue;
+        }
+
+        // Already found at an earlier place.
+        if (start >= svr_atom_load(&state->best_offsets[pattern_idx]))
+        {
+            continue;
+        }
+
+        if (region->data[start + pattern->anchor_idxs[1]] != (u8)pattern->bytes[pattern->anchor_idxs[1]])
+        {
+            continue;
+        }
+
+        if (scan_compare_data(region->data + start, pattern))
+        {
+            scan_set_best_offset(&state->best_offsets[pattern_idx], start);
+        }
+    }
+}
+
+void scan_sweep_scalar(ScanRegionState* state, s32 start, s32 end)
+{
+    u8* data = state->region->data;
+
+    for (s32 i = start; i < end; i++)
+    {
+        if (state->set_table[data[i]])
+        {
+            scan_check_position(state, i);
+        }
+    }
+}
+
+SVR_TARGET_AVX2 void scan_sweep_avx2(ScanRegionState* state, s32 start, s32 end)
+{
+    u8* data = state->region->data;
+
+    __m256i set_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)state->set_low));
+    __m256i set_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)state->set_high));
+    __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128,
+                                    1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    __m256i high_bit = _mm256_set1_epi8((char)0x80);
+    __m256i low_3_bits = _mm256_set1_epi8(0x07);
+    __m256i zero = _mm256_setzero_si256();
+
+    s32 i = start;
+
+    for (; i + 32 <= end; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((__m256i*)(data + i));
+
+        // The shuffle gives 0 for bytes with the high bit set, so each table only gives bits for its half.
+        __m256i found_low = _mm256_shuffle_epi8(set_low, v);
+        __m256i found_high = _mm256_shuffle_epi8(set_high, _mm256_xor_si256(v, high_bit));
+        __m256i found = _mm256_or_si256(found_low, found_high);
+
+        __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_3_bits));
+
+        u32 mask = ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(found, bit), zero));
+
+        while (mask)
+        {
+            scan_check_position(state, i + scan_get_first_bit(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    scan_sweep_scalar(state, i, end);
+}
+
+void scan_many_thread_proc(void* param)
+{
+    ScanManyState* many = (ScanManyState*)param;
+
+    while (true)
+    {
+        s32 block_idx = svr_atom_add(&many->next_block, 1);
+
+        if (block_idx >= many->num_blocks)
+        {
+            break;
+        }
+
+        ScanBlock* block = &many->blocks[block_idx];
+
+        if (many->use_avx2)
+        {
+            scan_sweep_avx2(block->state, block->start, block->end);
+        }
+
+        else
+        {
+            scan_sweep_scalar(block->state, block->start, block->end);
+        }
+    }
+}
+
+void svr_scan_find_many(SvrScanRegion* regions, s32 num_regions, s32 num_threads)
+{
+    ScanManyState many = {};
+    many.use_avx2 = svr_cpu_has_avx2();
+
+    ScanRegionState* states = SVR_ZALLOC_NUM(ScanRegionState, svr_max(num_regions, 1));
+
+    for (s32 i = 0; i < num_regions; i++)
+    {
+        scan_init_region_state(&states[i], &regions[i]);
+        many.num_blocks += (regions[i].size + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+    }
+
+    many.blocks = SVR_ZALLOC_NUM(ScanBlock, svr_max(many.num_blocks, 1));
+
+    s32 block_idx = 0;
+
+    for (s32 i = 0; i < num_regions; i++)
+    {
+        for (s32 start = 0; start < regions[i].size; start += SCAN_BLOCK_SIZE)
+        {
+            ScanBlock* block = &many.blocks[block_idx];
+            block->state = &states[i];
+            block->start = start;
+            block->end = svr_min(start + SCAN_BLOCK_SIZE, regions[i].size);
+            block_idx++;
+        }
+    }
+
+    // No point in more threads than blocks.
+    svr_clamp(&num_threads, 1, svr_max(many.num_blocks, 1));
+
+    SvrThread* threads = SVR_ZALLOC_NUM(SvrThread, num_threads);
+
+    for (s32 i = 1; i < num_threads; i++)
+    {
+        svr_thread_start(&threads[i], scan_many_thread_proc, &many);
+    }
+
+    scan_many_thread_proc(&many);
+
+    for (s32 i = 1; i < num_threads; i++)
+    {
+        if (threads[i].h)
+        {
+            svr_thread_wait(&threads[i]);
+            svr_thread_close(&threads[i]);
+        }
+    }
+
+    for (s32 i = 0; i < num_regions; i++)
+    {
+        SvrScanRegion* region = &regions[i];
+
+        for (s32 j = 0; j < region->num_patterns; j++)
+        {
+            SvrScanPattern* pattern = &region->patterns[j];
+
+            s32 offset = svr_atom_load(&states[i].best_offsets[j]);
+
+            // Only unknown bytes, so it matches right away (same as svr_scan_find).
+            if (pattern->anchor_idxs[0] == -1)
+            {
+                offset = region->size >= pattern->used ? 0 : INT32_MAX;
+            }
+
+            region->results[j] = offset == INT32_MAX ? -1 : offset;
+        }
+
+        scan_free_region_state(&states[i]);
+    }
+
+    svr_free(threads);
+    svr_free(many.blocks);
+    svr_free(states);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "svr_common.h"
+
+// Searching memory for byte patterns with unknown bytes, such as "8B 0D ?? ?? ?? ?? 85 C9".
+// Used by svr_standalone to find functions and variables in the game libraries.
+
+// How many bytes there can be in a pattern.
+const s32 SVR_SCAN_MAX_BYTES = 256;
+
+struct SvrScanPattern
+{
+    // A value of -1 means unknown byte.
+    s16 bytes[SVR_SCAN_MAX_BYTES];
+    s32 used;
+
+    // Indexes of the rarest known bytes that are searched for first, or -1 if there are no known bytes.
+    s32 anchor_idxs[2];
+};
+
+// Pattern strings are hex bytes in upper case, with "??" for unknown bytes.
+void svr_scan_parse_pattern(const char* input, SvrScanPattern* out);
+
+// Returns the first address where the pattern matches, or NULL if it does not match anywhere.
+u8* svr_scan_find(u8* start, s32 search_length, SvrScanPattern* pattern);
+
+// Versions of svr_scan_find, which picks the best one that the processor supports.
+using SvrScanKernel = s32;
+
+enum /* SvrScanKernel */
+{
+    SVR_SCAN_KERNEL_SCALAR,
+    SVR_SCAN_KERNEL_SSE2,
+    SVR_SCAN_KERNEL_AVX2, // Only if svr_cpu_has_avx2.
+};
+
+// Same as svr_scan_find with a specific version, for comparing them with each other.
+u8* svr_scan_find_with_kernel(u8* start, s32 search_length, SvrScanPattern* pattern, SvrScanKernel kernel);
+
+// Memory to find many patterns in at once, see svr_scan_find_many.
+struct SvrScanRegion
+{
+    u8* data;
+    s32 size;
+    SvrScanPattern* patterns;
+    s32 num_patterns;
+    s32* results; // Offset from data of the first match of every pattern, or -1 if it does not match. Written by svr_scan_find_many.
+};
+
+// Find all patterns of all regions with one pass over each region, instead of one pass for each pattern.
+// The regions are split into blocks that are searched in num_threads threads, including the calling thread.
+// The results are the same as svr_scan_find for every pattern.
+void svr_scan_find_many(SvrScanRegion* regions, s32 num_regions, s32 num_threads);
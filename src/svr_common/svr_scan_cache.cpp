@@ -0,0 +1,388 @@
+#include "svr_scan_cache.h"
+#include "svr_scan.h"
+#include "svr_alloc.h"
+#include "svr_platform.h"
+#include <stdio.h>
+#include <string.h>
+
+// Increase when the format changes or when the scan results can change for the same module, so old files are thrown away.
+const s32 SCAN_CACHE_VERSION = 1;
+
+const u64 SCAN_CACHE_PRIME_1 = 0x9E3779B185EBCA87ULL;
+const u64 SCAN_CACHE_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+const u64 SCAN_CACHE_PRIME_3 = 0x165667B19E3779F9ULL;
+const u64 SCAN_CACHE_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+const u64 SCAN_CACHE_PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+// Longest line in the file, enough for a pattern of SVR_SCAN_MAX_BYTES.
+const s32 SCAN_CACHE_MAX_LINE = 2048;
+
+// Longest module name, must match the width in the line format of svr_scan_cache_parse.
+const s32 SCAN_CACHE_MAX_MODULE = 260;
+
+inline u64 scan_cache_rotl(u64 v, s32 bits)
+{
+    return (v << bits) | (v >> (64 - bits));
+}
+
+inline u64 scan_cache_read64(const u8* ptr)
+{
+    u64 ret;
+    memcpy(&ret, ptr, sizeof(u64));
+    return ret;
+}
+
+inline u32 scan_cache_read32(const u8* ptr)
+{
+    u32 ret;
+    memcpy(&ret, ptr, sizeof(u32));
+    return ret;
+}
+
+inline u64 scan_cache_round(u64 acc, u64 input)
+{
+    acc += input * SCAN_CACHE_PRIME_2;
+    acc = scan_cache_rotl(acc, 31);
+    acc *= SCAN_CACHE_PRIME_1;
+    return acc;
+}
+
+inline u64 scan_cache_merge_round(u64 acc, u64 val)
+{
+    acc ^= scan_cache_round(0, val);
+    acc = acc * SCAN_CACHE_PRIME_1 + SCAN_CACHE_PRIME_4;
+    return acc;
+}
+
+u64 svr_scan_cache_hash(const void* data, s64 size)
+{
+    const u8* ptr = (const u8*)data;
+    const u8* end = ptr + size;
+
+    u64 h;
+
+    if (size >= 32)
+    {
+        // Four independent lanes so the multiplies can overlap.
+        u64 v1 = SCAN_CACHE_PRIME_1 + SCAN_CACHE_PRIME_2;
+        u64 v2 = SCAN_CACHE_PRIME_2;
+        u64 v3 = 0;
+        u64 v4 = 0 - SCAN_CACHE_PRIME_1;
+
+        const u8* limit = end - 32;
+
+        do
+        {
+            v1 = scan_cache_round(v1, scan_cache_read64(ptr + 0));
+            v2 = scan_cache_round(v2, scan_cache_read64(ptr + 8));
+            v3 = scan_cache_round(v3, scan_cache_read64(ptr + 16));
+            v4 = scan_cache_round(v4, scan_cache_read64(ptr + 24));
+            ptr += 32;
+        }
+        while (ptr <= limit);
+
+        h = scan_cache_rotl(v1, 1) + scan_cache_rotl(v2, 7) + scan_cache_rotl(v3, 12) + scan_cache_rotl(v4, 18);
+        h = scan_cache_merge_round(h, v1);
+        h = scan_cache_merge_round(h, v2);
+        h = scan_cache_merge_round(h, v3);
+        h = scan_cache_merge_round(h, v4);
+    }
+
+    else
+    {
+        h = SCAN_CACHE_PRIME_5;
+    }
+
+    h += (u64)size;
+
+    while (ptr + 8 <= end)
+    {
+        h ^= scan_cache_round(0, scan_cache_read64(ptr));
+        h = scan_cache_rotl(h, 27) * SCAN_CACHE_PRIME_1 + SCAN_CACHE_PRIME_4;
+        ptr += 8;
+    }
+
+    if (ptr + 4 <= end)
+    {
+        h ^= (u64)scan_cache_read32(ptr) * SCAN_CACHE_PRIME_1;
+        h = scan_cache_rotl(h, 23) * SCAN_CACHE_PRIME_2 + SCAN_CACHE_PRIME_3;
+        ptr += 4;
+    }
+
+    while (ptr < end)
+    {
+        h ^= (*ptr) * SCAN_CACHE_PRIME_5;
+        h = scan_cache_rotl(h, 11) * SCAN_CACHE_PRIME_1;
+        ptr++;
+    }
+
+    h ^= h >> 33;
+    h *= SCAN_CACHE_PRIME_2;
+    h ^= h >> 29;
+    h *= SCAN_CACHE_PRIME_3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+s32 scan_cache_find_index(SvrScanCache* cache, const char* module, const char* pattern)
+{
+    for (s32 i = 0; i < cache->entries.size; i++)
+    {
+        SvrScanCacheEntry* e = &cache->entries[i];
+
+        if (!svr_compare_no_case(e->module, module) && !strcmp(e->pattern, pattern))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void scan_cache_free_entry(SvrScanCacheEntry* e)
+{
+    svr_maybe_free((void**)&e->module);
+    svr_maybe_free((void**)&e->pattern);
+}
+
+inline bool scan_cache_is_hex_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F');
+}
+
+// Check that a pattern from the file can be given to svr_scan_parse_pattern, which does not accept anything else.
+bool scan_cache_is_pattern_valid(const char* pattern)
+{
+    const char* ptr = pattern;
+    s32 num_bytes = 0;
+
+    while (true)
+    {
+        bool is_hex = scan_cache_is_hex_char(ptr[0]) && scan_cache_is_hex_char(ptr[1]);
+        bool is_unknown = ptr[0] == '?' && ptr[1] == '?';
+
+        if (!is_hex && !is_unknown)
+        {
+            return false;
+        }
+
+        num_bytes++;
+        ptr += 2;
+
+        if (num_bytes > SVR_SCAN_MAX_BYTES)
+        {
+            return false;
+        }
+
+        if (*ptr == 0)
+        {
+            break;
+        }
+
+        if (*ptr != ' ')
+        {
+            return false;
+        }
+
+        ptr++;
+    }
+
+    return true;
+}
+
+bool svr_scan_cache_parse(SvrScanCache* cache, const char* text)
+{
+    char line[SCAN_CACHE_MAX_LINE];
+
+    const char* ptr = text;
+    ptr = svr_read_line(ptr, line, SVR_ARRAY_SIZE(line));
+
+    s32 version = 0;
+
+    if (sscanf(line, "SVR_SCAN_CACHE %d", &version) != 1 || version != SCAN_CACHE_VERSION)
+    {
+        return false;
+    }
+
+    while (*ptr != 0)
+    {
+        ptr = svr_read_line(ptr, line, SVR_ARRAY_SIZE(line));
+
+        if (line[0] == 0)
+        {
+            continue;
+        }
+
+        svr_trim_right(line, strlen(line));
+
+        char module[SCAN_CACHE_MAX_MODULE];
+        unsigned long long module_hash = 0;
+        s32 rva = 0;
+        s32 pattern_pos = 0;
+
+        if (sscanf(line, "%259s %16llx %d %n", module, &module_hash, &rva, &pattern_pos) != 3 || pattern_pos == 0)
+        {
+            goto rfail;
+        }
+
+        const char* pattern = line + pattern_pos;
+
+        if (rva < -1 || !scan_cache_is_pattern_valid(pattern))
+        {
+            goto rfail;
+        }
+
+        SvrScanCacheEntry* e = cache->entries.emplace();
+        e->module = svr_dup_str(module);
+        e->module_hash = module_hash;
+        e->pattern = svr_dup_str(pattern);
+        e->rva = rva;
+    }
+
+    cache->changed = false;
+    return true;
+
+rfail:
+    svr_scan_cache_free(cache);
+    return false;
+}
+
+void svr_scan_cache_load(SvrScanCache* cache, const char* path)
+{
+    char* text = svr_read_file_as_string(path, SVR_READ_FILE_FLAGS_NEW_LINE);
+
+    if (text == NULL)
+    {
+        return;
+    }
+
+    svr_scan_cache_parse(cache, text);
+
+    svr_free(text);
+}
+
+bool svr_scan_cache_save(SvrScanCache* cache, const char* path)
+{
+    SvrFile file;
+    char line[SCAN_CACHE_MAX_LINE];
+    s32 length;
+
+    if (!svr_file_open(&file, path, SVR_FILE_MODE_WRITE))
+    {
+        return false;
+    }
+
+    length = SVR_SNPRINTF(line, "SVR_SCAN_CACHE %d\n", SCAN_CACHE_VERSION);
+
+    if (!svr_file_write(&file, line, length))
+    {
+        goto rfail;
+    }
+
+    for (s32 i = 0; i < cache->entries.size; i++)
+    {
+        SvrScanCacheEntry* e = &cache->entries[i];
+
+        length = SVR_SNPRINTF(line, "%s %016llx %d %s\n", e->module, (unsigned long long)e->module_hash, e->rva, e->pattern);
+
+        if (!svr_file_write(&file, line, length))
+        {
+            goto rfail;
+        }
+    }
+
+    svr_file_close(&file);
+
+    cache->changed = false;
+    return true;
+
+rfail:
+    svr_file_close(&file);
+    return false;
+}
+
+void svr_scan_cache_free(SvrScanCache* cache)
+{
+    for (s32 i = 0; i < cache->entries.size; i++)
+    {
+        scan_cache_free_entry(&cache->entries[i]);
+    }
+
+    cache->entries.free();
+}
+
+void svr_scan_cache_set_module(SvrScanCache* cache, const char* module, u64 module_hash)
+{
+    for (s32 i = cache->entries.size - 1; i >= 0; i--)
+    {
+        SvrScanCacheEntry* e = &cache->entries[i];
+
+        if (!svr_compare_no_case(e->module, module) && e->module_hash != module_hash)
+        {
+            scan_cache_free_entry(e);
+            cache->entries.remove_index_keep_order(i);
+            cache->changed = true;
+        }
+    }
+}
+
+bool svr_scan_cache_find(SvrScanCache* cache, const char* module, u64 module_hash, const char* pattern, s32* rva)
+{
+    s32 idx = scan_cache_find_index(cache, module, pattern);
+
+    if (idx == -1)
+    {
+        return false;
+    }
+
+    SvrScanCacheEntry* e = &cache->entries[idx];
+
+    if (e->module_hash != module_hash)
+    {
+        return false;
+    }
+
+    *rva = e->rva;
+    return true;
+}
+
+void svr_scan_cache_add(SvrScanCache* cache, const char* module, u64 module_hash, const char* pattern, s32 rva)
+{
+    s32 idx = scan_cache_find_index(cache, module, pattern);
+
+    SvrScanCacheEntry* e;
+
+    if (idx != -1)
+    {
+        e = &cache->entries[idx];
+        svr_free(e->module);
+    }
+
+    else
+    {
+        e = cache->entries.emplace();
+        e->pattern = svr_dup_str(pattern);
+    }
+
+    e->module = svr_dup_str(module);
+    e->module_hash = module_hash;
+    e->rva = rva;
+
+    cache->changed = true;
+}
+
+void svr_scan_cache_remove(SvrScanCache* cache, const char* module, const char* pattern)
+{
+    s32 idx = scan_cache_find_index(cache, module, pattern);
+
+    if (idx == -1)
+    {
+        return;
+    }
+
+    scan_cache_free_entry(&cache->entries[idx]);
+    cache->entries.remove_index_keep_order(idx);
+
+    cache->changed = true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "svr_common.h"
+#include "svr_array.h"
+
+// Cache of pattern scan results (see svr_scan.h), so that modules that have not changed do not have to be scanned again.
+// Results are stored as offsets from the module base, together with a hash of the module contents.
+// When a module is seen with another hash, all its results are removed.
+
+// The file is text with a header line followed by one line per result:
+// SVR_SCAN_CACHE 1
+// <module> <hash in 16 hex digits> <offset or -1 if not found> <pattern>
+
+struct SvrScanCacheEntry
+{
+    char* module;
+    u64 module_hash;
+    char* pattern;
+    s32 rva; // -1 if the pattern was not found.
+};
+
+struct SvrScanCache
+{
+    SvrDynArray<SvrScanCacheEntry> entries;
+    bool changed; // Set when the entries are changed and the cache should be saved.
+};
+
+// Fast non cryptographic hash of memory (XXH64 with seed 0).
+u64 svr_scan_cache_hash(const void* data, s64 size);
+
+// Read the entries from text in the format above. Fails and leaves the cache empty if the text is not in the right format.
+bool svr_scan_cache_parse(SvrScanCache* cache, const char* text);
+
+// A missing or broken file is not an error, the cache just starts out empty.
+void svr_scan_cache_load(SvrScanCache* cache, const char* path);
+bool svr_scan_cache_save(SvrScanCache* cache, const char* path);
+
+void svr_scan_cache_free(SvrScanCache* cache);
+
+// Remove the results of a module if they are for other contents. Call before looking up the results of a module.
+void svr_scan_cache_set_module(SvrScanCache* cache, const char* module, u64 module_hash);
+
+// Returns true if there is a result for the pattern, which is written to rva.
+bool svr_scan_cache_find(SvrScanCache* cache, const char* module, u64 module_hash, const char* pattern, s32* rva);
+
+// Add or replace the result of a pattern.
+void svr_scan_cache_add(SvrScanCache* cache, const char* module, u64 module_hash, const char* pattern, s32 rva);
+
+// Remove the result of a pattern, for when it turns out to be wrong.
+void svr_scan_cache_remove(SvrScanCache* cache, const char* module, const char* pattern);
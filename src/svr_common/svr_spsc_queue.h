@@ -0,0 +1,170 @@
+#pragma once
+#include "svr_common.h"
+#include "svr_alloc.h"
+#include "svr_atom.h"
+#include <assert.h>
+
+// Bounded lock free queue for exactly one producer thread and one consumer thread.
+// Use this instead of SvrLockedQueue for thread hops that have a single writer, where the locking and the event for every item adds up.
+// The producer will block when the queue is full, so the capacity needs to be picked for the worst case the consumer can fall behind.
+// The write and read positions are on separate cache lines so the two threads do not fight over them.
+// Both sides wait with SvrSignal, which spins for a while before sleeping and only goes through the kernel when the other side is actually asleep.
+// So a consumer that is busy draining the queue, or that gets the next item while spinning, never costs a syscall on either side.
+
+template <class T>
+struct SvrSpscQueue
+{
+    T* items;
+    u32 mask; // Capacity - 1. Capacity must be a power of 2.
+    u32 limit; // How many items can be queued before the producer blocks. Can be lowered from the capacity with set_limit.
+
+    SvrAtom32 closed; // When set, nothing will be waited on anymore.
+
+    // Written by the producer.
+
+    SVR_THREAD_PADDING();
+
+    SvrAtom32 write_pos;
+    SvrSignal consumer_signal; // Woken when something was pushed, or on wake or close.
+
+    // Written by the consumer.
+
+    SVR_THREAD_PADDING();
+
+    SvrAtom32 read_pos;
+    SvrSignal producer_signal; // Woken when something was pulled, or on close.
+    s32 consumer_seen_count; // Count of consumer_signal at the last wait.
+
+    SVR_THREAD_PADDING();
+
+    inline void init(s32 capacity)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+        items = (T*)svr_alloc(sizeof(T) * capacity);
+        mask = (u32)capacity - 1;
+        limit = (u32)capacity;
+
+        reset();
+    }
+
+    inline void free()
+    {
+        if (items)
+        {
+            svr_free(items);
+            items = NULL;
+        }
+    }
+
+    // Clears the queue and opens it again.
+    // Must only be called when no thread is using the queue.
+    inline void reset()
+    {
+        svr_atom_store(&write_pos, 0);
+        svr_atom_store(&read_pos, 0);
+        svr_atom_store(&closed, 0);
+
+        consumer_seen_count = svr_signal_get(&consumer_signal);
+    }
+
+    // Lower how many items can be queued before the producer blocks.
+    // Must only be called when no thread is using the queue.
+    inline void set_limit(s32 num)
+    {
+        assert(num > 0);
+        limit = svr_min((u32)num, mask + 1);
+    }
+
+    // Number of items that can be pulled.
+    inline s32 size()
+    {
+        return (s32)((u32)svr_atom_load(&write_pos) - (u32)svr_atom_load(&read_pos));
+    }
+
+    // In producer thread.
+    // Pushes to the back. Blocks if the queue is full.
+    // Returns false if the queue was closed, in which case the item was not pushed.
+    inline bool push(T* item)
+    {
+        u32 pos = (u32)svr_atom_load(&write_pos);
+
+        while (true)
+        {
+            // Must be read before checking, so a pull between the check and the wait is not missed.
+            s32 seen_count = svr_signal_get(&producer_signal);
+
+            if (svr_atom_load(&closed))
+            {
+                return false;
+            }
+
+            if (pos - (u32)svr_atom_load(&read_pos) < limit)
+            {
+                break;
+            }
+
+            svr_signal_wait(&producer_signal, seen_count);
+        }
+
+        items[pos & mask] = *item;
+        svr_atom_store(&write_pos, (s32)(pos + 1));
+
+        svr_signal_wake(&consumer_signal);
+
+        return true;
+    }
+
+    // In consumer thread.
+    // Pops from the front. Does not block.
+    inline bool pull(T* item)
+    {
+        u32 pos = (u32)svr_atom_load(&read_pos);
+
+        if (pos == (u32)svr_atom_load(&write_pos))
+        {
+            // Nothing to pull.
+            return false;
+        }
+
+        *item = items[pos & mask];
+        svr_atom_store(&read_pos, (s32)(pos + 1));
+
+        svr_signal_wake(&producer_signal);
+
+        return true;
+    }
+
+    // In consumer thread.
+    // Parks until there is something to pull, or until wake or close is called.
+    // Can return without anything to pull, so the caller must check its own state and loop.
+    inline void wait()
+    {
+        s32 prev_seen_count = consumer_seen_count;
+        consumer_seen_count = svr_signal_get(&consumer_signal);
+
+        // Return right away if the signal was woken since the last wait, so a wake that came before this wait is not missed.
+        if (consumer_seen_count != prev_seen_count || size() > 0 || svr_atom_load(&closed))
+        {
+            return;
+        }
+
+        svr_signal_wait(&consumer_signal, consumer_seen_count);
+    }
+
+    // Makes a waiting consumer return so it can look at external state.
+    inline void wake()
+    {
+        svr_signal_wake(&consumer_signal);
+    }
+
+    // Stops all waiting on both sides.
+    // Used when one side is exiting because of an error, so the other side does not block forever.
+    inline void close()
+    {
+        svr_atom_store(&closed, 1);
+
+        svr_signal_wake(&consumer_signal);
+        svr_signal_wake(&producer_signal);
+    }
+};
@@ -1,11 +1,44 @@
 #pragma once
 #include "svr_common.h"
+#include "svr_atom.h"
 
 // Used by the launcher as parameter for the init exports in svr_standalone.dll.
 struct SvrGameInitData
 {
     const char* svr_path; // Does not end with a slash.
-    u32 unused;
+    u32 status_mem_h; // Handle to the shared memory of SvrGameStatus in the game process, or 0 if there is none.
 };
 
 using SvrGameInitFuncType = void(__cdecl*)(SvrGameInitData* init_data);
+
+using SvrGameStatusState = s32;
+
+enum /* SvrGameStatusState */
+{
+    SVR_GAME_STATUS_STARTING, // The game has not loaded svr_standalone.dll yet.
+    SVR_GAME_STATUS_HELLO, // svr_standalone.dll is loaded and is waiting for the game libraries.
+    SVR_GAME_STATUS_INIT, // SVR is initialized and is ready for a movie.
+    SVR_GAME_STATUS_RECORDING, // A movie is being recorded.
+    SVR_GAME_STATUS_ERROR, // Init failed and the game will exit. The error is in the status.
+};
+
+// Progress of svr_standalone.dll that is shared with the launcher, so the launcher can show and forward the progress without reading the log.
+// The launcher creates the shared memory and an auto reset event, and duplicates both handles to the game process.
+// The game sets the event when the state changes, and a few times per second while recording.
+// The game writes with a sequence lock: seq is odd while the game is writing, so the launcher must read again if seq was odd or changed during the read.
+// The same structure is used by the 32-bit and 64-bit processes, so it must have the same layout in both.
+struct SvrGameStatus
+{
+    SvrAtom32 seq;
+    u32 event_h; // Handle to the event in the game process.
+
+    SvrGameStatusState state;
+    s32 num_movies; // Increased every time a movie starts, so a quick stop and start can be seen.
+
+    s64 num_frames; // Frames recorded in the current or last movie.
+    s64 video_time; // Video time of the current or last movie in microseconds.
+    float encode_fps; // Average frames per second of the current or last movie.
+    s32 num_errors; // Increased for every new error.
+
+    char error[512]; // Latest error. Not all errors end the game.
+};
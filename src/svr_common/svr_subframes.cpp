@@ -0,0 +1,100 @@
+#include "svr_subframes.h"
+
+void svr_subframes_init(SvrSubframes* subs, s32 mult, float exposure)
+{
+    subs->mult = mult;
+    subs->exposure = exposure;
+    subs->skip_closed = false;
+    subs->pos = 0;
+
+    // Start from where the shutter opens and correct for rounding, so this agrees with the weights.
+    s32 first_open = (s32)((1.0 - exposure) * mult) + 1;
+    svr_clamp(&first_open, 1, mult);
+
+    while (first_open > 1 && svr_subframes_get_weight(mult, exposure, first_open - 1) > 0.0f)
+    {
+        first_open--;
+    }
+
+    while (first_open < mult && svr_subframes_get_weight(mult, exposure, first_open) <= 0.0f)
+    {
+        first_open++;
+    }
+
+    subs->first_open = first_open;
+}
+
+float svr_subframes_get_weight(s32 mult, float exposure, s32 idx)
+{
+    if (exposure <= 0.0f)
+    {
+        return idx == mult ? 1.0f : 0.0f;
+    }
+
+    double start = (double)(idx - 1) / (double)mult;
+    double end = (double)idx / (double)mult;
+    double open = 1.0 - exposure;
+
+    double covered = end - svr_max(start, open);
+
+    if (covered <= 0.0)
+    {
+        return 0.0f;
+    }
+
+    return (float)(covered / exposure);
+}
+
+float svr_subframes_get_weight_sum(s32 mult, float exposure, s32 idx)
+{
+    // Must be exactly 1 at the end of the movie frame.
+    if (idx >= mult)
+    {
+        return 1.0f;
+    }
+
+    if (exposure <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    double end = (double)idx / (double)mult;
+    double open = 1.0 - exposure;
+
+    double covered = end - open;
+
+    if (covered <= 0.0)
+    {
+        return 0.0f;
+    }
+
+    return (float)(covered / exposure);
+}
+
+s32 svr_subframes_get_next_steps(SvrSubframes* subs)
+{
+    if (subs->skip_closed && subs->pos < subs->first_open - 1)
+    {
+        return subs->first_open - subs->pos;
+    }
+
+    return 1;
+}
+
+SvrSubframe svr_subframes_advance(SvrSubframes* subs)
+{
+    subs->pos += svr_subframes_get_next_steps(subs);
+
+    SvrSubframe ret;
+    ret.weight = svr_subframes_get_weight(subs->mult, subs->exposure, subs->pos);
+    ret.weight_start = svr_subframes_get_weight_sum(subs->mult, subs->exposure, subs->pos - 1);
+    ret.weight_end = svr_subframes_get_weight_sum(subs->mult, subs->exposure, subs->pos);
+    ret.ends_frame = subs->pos == subs->mult;
+
+    if (ret.ends_frame)
+    {
+        subs->pos = 0;
+    }
+
+    return ret;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "svr_common.h"
+
+// Scheduling of the game frames that make up a motion blurred movie frame.
+// Motion blur renders the game mult times per movie frame (the subframes) and adds them together with weights.
+// The shutter is open for the last exposure part of every movie frame, so the subframes before that have no weight.
+// Instead of rendering those, the game time can be advanced past them in one step.
+
+// Subframes are numbered 1 to mult in every movie frame. Subframe i covers the time from (i - 1) / mult to i / mult
+// of the movie frame, and is rendered at the end of that time.
+
+struct SvrSubframes
+{
+    s32 mult;
+    float exposure;
+    s32 first_open; // First subframe that has any weight.
+    bool skip_closed; // Set when the game time is advanced past the subframes that have no weight.
+    s32 pos; // Last subframe that was rendered in the current movie frame, 0 at the start of a movie frame.
+};
+
+// What to do with a rendered subframe.
+struct SvrSubframe
+{
+    float weight; // Weights of all subframes in a movie frame add up to 1.
+    float weight_start; // Sum of the weights of the subframes before this one in the movie frame.
+    float weight_end; // Sum of the weights up to and including this subframe. This is the weight_start of the next subframe, and 1 at the end.
+    bool ends_frame; // Set for the last subframe of a movie frame, after which the movie frame is done.
+};
+
+void svr_subframes_init(SvrSubframes* subs, s32 mult, float exposure);
+
+// Weight of a subframe, which is how much of it is covered by the open shutter.
+// With no exposure, the last subframe is the whole movie frame.
+float svr_subframes_get_weight(s32 mult, float exposure, s32 idx);
+
+// Sum of the weights of subframes 1 to idx.
+float svr_subframes_get_weight_sum(s32 mult, float exposure, s32 idx);
+
+// How many subframes of game time the next rendered subframe should advance.
+// This is 1 unless the subframes with no weight are skipped.
+s32 svr_subframes_get_next_steps(SvrSubframes* subs);
+
+// Call for every rendered subframe. The game time must have been advanced by what svr_subframes_get_next_steps returned.
+SvrSubframe svr_subframes_advance(SvrSubframes* subs);
@@ -124,7 +124,7 @@ SvrVdfSection* svr_vdf_section_find_section(SvrVdfSection* priv, const char* nam
     {
         SvrVdfSection* s = priv->sections[i];
 
-        if (!strcmpi(s->name, name))
+        if (!svr_compare_no_case(s->name, name))
         {
             if (control_idx)
             {
@@ -144,7 +144,7 @@ SvrVdfKeyValue* svr_vdf_section_find_kv(SvrVdfSection* priv, const char* key)
     {
         SvrVdfKeyValue* k = priv->kvs[i];
 
-        if (!strcmpi(k->key, key))
+        if (!svr_compare_no_case(k->key, key))
         {
             return k;
         }
@@ -0,0 +1,963 @@
+#include "encoder_priv.h"
+
+// Offline benchmark of the encoding. Started with "svr_encoder.exe bench [num frames] [width] [height]".
+// Synthetic frames and audio are given straight to the render functions, so this does not need svr_game, the shared memory or a GPU.
+// Since there is no game texture, the frames are converted with the CPU conversion (same as encoder_cpu_conversion).
+// Every video encoder is run with every preset or profile it has, and the results are printed and written to the log.
+
+const s32 BENCH_DEFAULT_FRAMES = 300;
+const s32 BENCH_DEFAULT_WIDTH = 1920;
+const s32 BENCH_DEFAULT_HEIGHT = 1080;
+const s32 BENCH_FPS = 60;
+const s32 BENCH_AUDIO_HZ = 44100;
+const s32 BENCH_AUDIO_CHANNELS = 2;
+const s32 BENCH_QUEUE_ITEMS = 1 << 22; // How many items to send through the queues in the queue benchmark.
+const s32 BENCH_WAKE_ROUNDS = 100000; // How many round trips between two threads to do in the wake benchmark.
+const s32 BENCH_CPU_CONVERT_RUNS = 20; // How many frames to convert for each CPU conversion kernel.
+const s32 BENCH_MOSAMPLE_SUBFRAMES = 32; // How many frames to add together for every motion blur frame.
+const s32 BENCH_MOSAMPLE_RUNS = 4; // How many motion blur frames to make for each CPU motion blur setup.
+const s32 BENCH_SCAN_PATTERNS = 32; // How many patterns to search for in each image in the scan benchmark, about as many as svr_standalone has.
+const s32 BENCH_AUDIO_PACK_SECONDS = 100; // How many seconds of audio to pack with each audio pack version.
+
+// Should be synchronized with proc_profile.cpp.
+const char* BENCH_X264_PRESETS[] =
+{
+    "ultrafast",
+    "superfast",
+    "veryfast",
+    "faster",
+    "fast",
+    "medium",
+    "slow",
+    "slower",
+    "veryslow",
+    "placebo",
+};
+
+// Should be synchronized with proc_profile.cpp.
+const char* BENCH_DNXHR_PROFILES[] =
+{
+    "lb",
+    "sq",
+    "hq",
+};
+
+// Versions of svr_scan_find and svr_audio_pack_s32_to_s16, same order as SvrScanKernel and SvrAudioKernel.
+const char* BENCH_KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+// The scalar and SSE2 versions can always be used, the AVX2 version only if the processor has it.
+s32 bench_get_num_kernels()
+{
+    return svr_cpu_has_avx2() ? 3 : 2;
+}
+
+// For the queue benchmark.
+SvrSpscQueue<s32> bench_spsc_queue;
+SvrLockedQueue<s32> bench_locked_queue;
+SvrEvent bench_locked_wake_event;
+
+void bench_spsc_consumer_proc(void* /* param */)
+{
+    while (true)
+    {
+        bench_spsc_queue.wait();
+
+        s32 item;
+
+        while (bench_spsc_queue.pull(&item))
+        {
+            if (item == -1)
+            {
+                return;
+            }
+        }
+    }
+}
+
+void bench_locked_consumer_proc(void* /* param */)
+{
+    while (true)
+    {
+        svr_event_wait(&bench_locked_wake_event);
+
+        s32 item;
+
+        while (bench_locked_queue.pull(&item))
+        {
+            if (item == -1)
+            {
+                return;
+            }
+        }
+    }
+}
+
+// For the wake benchmark. The main thread pings and the other thread pongs back.
+SvrEvent bench_ping_event;
+SvrEvent bench_pong_event;
+SvrSignal bench_ping_signal;
+SvrSignal bench_pong_signal;
+
+void bench_event_pong_proc(void* /* param */)
+{
+    for (s32 i = 0; i < BENCH_WAKE_ROUNDS; i++)
+    {
+        svr_event_wait(&bench_ping_event);
+        svr_event_set(&bench_pong_event);
+    }
+}
+
+// Wait until the signal has been woken more than seen_count times.
+void bench_wait_signal(SvrSignal* signal, s32 seen_count)
+{
+    while (svr_signal_get(signal) == seen_count)
+    {
+        svr_signal_wait(signal, seen_count);
+    }
+}
+
+void bench_signal_pong_proc(void* /* param */)
+{
+    for (s32 i = 0; i < BENCH_WAKE_ROUNDS; i++)
+    {
+        bench_wait_signal(&bench_ping_signal, i);
+        svr_signal_wake(&bench_pong_signal);
+    }
+}
+
+// Will put both to console and to file.
+void EncoderState::bench_log(const char* format, ...)
+{
+    // The list is used up after the first print on some platforms, so it must be started again for the second.
+    va_list va;
+    va_start(va, format);
+    svr_log_v(format, va);
+    va_end(va);
+
+    va_start(va, format);
+    vprintf(format, va);
+    va_end(va);
+}
+
+s32 EncoderState::bench_run(s32 argc, char** argv)
+{
+    main_thread_id = svr_get_thread_id();
+
+    bench_num_frames = BENCH_DEFAULT_FRAMES;
+    bench_width = BENCH_DEFAULT_WIDTH;
+    bench_height = BENCH_DEFAULT_HEIGHT;
+
+    if (argc >= 3)
+    {
+        bench_num_frames = atoi(argv[2]);
+    }
+
+    if (argc >= 4)
+    {
+        bench_width = atoi(argv[3]);
+    }
+
+    if (argc >= 5)
+    {
+        bench_height = atoi(argv[4]);
+    }
+
+    // The subsampled formats need even sizes.
+    if (bench_num_frames <= 0 || bench_width <= 0 || bench_height <= 0 || (bench_width & 1) || (bench_height & 1))
+    {
+        bench_log("Usage: svr_encoder bench [num frames] [width] [height]\n");
+        bench_log("The width and height must be even\n");
+        return 1;
+    }
+
+    if (!render_init())
+    {
+        return 1;
+    }
+
+    bench_create_sources();
+
+    bench_queues();
+    bench_wake_latency();
+    bench_cpu_kernels();
+    bench_mosample();
+    bench_mosample_yuv();
+    bench_scan();
+    bench_audio_pack();
+
+    bench_log("Encoding %d frames of %dx%d at %d fps with audio\n", bench_num_frames, bench_width, bench_height, BENCH_FPS);
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(RENDER_VIDEO_INFOS); i++)
+    {
+        const RenderVideoInfo* info = &RENDER_VIDEO_INFOS[i];
+
+        if (info->setup == &EncoderState::render_setup_libx264)
+        {
+            for (s32 j = 0; j < SVR_ARRAY_SIZE(BENCH_X264_PRESETS); j++)
+            {
+                bench_video_encoder(info, BENCH_X264_PRESETS[j], "");
+            }
+        }
+
+        else if (info->setup == &EncoderState::render_setup_dnxhr)
+        {
+            for (s32 j = 0; j < SVR_ARRAY_SIZE(BENCH_DNXHR_PROFILES); j++)
+            {
+                bench_video_encoder(info, "", BENCH_DNXHR_PROFILES[j]);
+            }
+        }
+
+        else
+        {
+            bench_video_encoder(info, "", "");
+        }
+    }
+
+    bench_free_sources();
+
+    return 0;
+}
+
+// Create the frames and audio to encode.
+// There are a few different frames of a moving pattern with some noise, so the encoders have motion and detail to work with.
+void EncoderState::bench_create_sources()
+{
+    s32 pitch = svr_align32(bench_width * 4, VID_PLANE_ALIGN);
+    u32 noise = 0x12345678;
+
+    for (s32 i = 0; i < BENCH_NUM_SOURCE_FRAMES; i++)
+    {
+        bench_source_frames[i] = (u8*)svr_align_alloc(pitch * bench_height, VID_PLANE_ALIGN);
+
+        for (s32 y = 0; y < bench_height; y++)
+        {
+            u32* row = (u32*)(bench_source_frames[i] + (y * pitch));
+
+            for (s32 x = 0; x < bench_width; x++)
+            {
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+
+                u32 b = (x + i * 8) & 255;
+                u32 g = (y + i * 4) & 255;
+                u32 r = (((x + y) >> 2) + (noise & 15)) & 255;
+
+                row[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+
+    // One second of a 440 hz tone.
+    s16* samples = (s16*)svr_alloc(sizeof(s16) * BENCH_AUDIO_CHANNELS * BENCH_AUDIO_HZ);
+
+    for (s32 i = 0; i < BENCH_AUDIO_HZ; i++)
+    {
+        s16 v = (s16)(sinf(i * (2.0f * 3.14159265f * 440.0f / BENCH_AUDIO_HZ)) * 8000.0f);
+
+        for (s32 j = 0; j < BENCH_AUDIO_CHANNELS; j++)
+        {
+            samples[i * BENCH_AUDIO_CHANNELS + j] = v;
+        }
+    }
+
+    bench_audio_samples = samples;
+}
+
+void EncoderState::bench_free_sources()
+{
+    for (s32 i = 0; i < BENCH_NUM_SOURCE_FRAMES; i++)
+    {
+        if (bench_source_frames[i])
+        {
+            svr_align_free(bench_source_frames[i], VID_PLANE_ALIGN);
+            bench_source_frames[i] = NULL;
+        }
+    }
+
+    svr_maybe_free((void**)&bench_audio_samples);
+}
+
+// Compare the queue used for the single writer hops with the locked queue it replaced, using the same wake pattern as the render threads.
+void EncoderState::bench_queues()
+{
+    SvrThread thread;
+    s64 start_time;
+    s32 flush_item = -1;
+
+    bench_spsc_queue.init(RENDER_QUEUED_FRAMES);
+
+    start_time = svr_prof_get_real_time();
+    svr_thread_start(&thread, bench_spsc_consumer_proc, NULL);
+
+    for (s32 i = 0; i < BENCH_QUEUE_ITEMS; i++)
+    {
+        bench_spsc_queue.push(&i);
+    }
+
+    bench_spsc_queue.push(&flush_item);
+
+    svr_thread_wait(&thread);
+    svr_thread_close(&thread);
+
+    s64 spsc_time = svr_prof_get_real_time() - start_time;
+
+    bench_spsc_queue.free();
+
+    bench_locked_queue.init(RENDER_QUEUED_FRAMES);
+    svr_event_init(&bench_locked_wake_event);
+
+    start_time = svr_prof_get_real_time();
+    svr_thread_start(&thread, bench_locked_consumer_proc, NULL);
+
+    for (s32 i = 0; i < BENCH_QUEUE_ITEMS; i++)
+    {
+        bench_locked_queue.push(&i);
+        svr_event_set(&bench_locked_wake_event);
+    }
+
+    bench_locked_queue.push(&flush_item);
+    svr_event_set(&bench_locked_wake_event);
+
+    svr_thread_wait(&thread);
+    svr_thread_close(&thread);
+
+    s64 locked_time = svr_prof_get_real_time() - start_time;
+
+    bench_locked_queue.free();
+    svr_event_free(&bench_locked_wake_event);
+
+    bench_log("Queue spsc: %.2f M items/s\n", BENCH_QUEUE_ITEMS / (double)svr_max(spsc_time, (s64)1));
+    bench_log("Queue locked: %.2f M items/s\n", BENCH_QUEUE_ITEMS / (double)svr_max(locked_time, (s64)1));
+}
+
+// Compare the round trip time of waking another thread with a kernel event against a signal, which spins before it sleeps.
+// This is the cost of handing off a frame to a thread that is waiting for it.
+void EncoderState::bench_wake_latency()
+{
+    SvrThread thread;
+    s64 start_time;
+
+    svr_event_init(&bench_ping_event);
+    svr_event_init(&bench_pong_event);
+
+    start_time = svr_prof_get_real_time();
+    svr_thread_start(&thread, bench_event_pong_proc, NULL);
+
+    for (s32 i = 0; i < BENCH_WAKE_ROUNDS; i++)
+    {
+        svr_event_set(&bench_ping_event);
+        svr_event_wait(&bench_pong_event);
+    }
+
+    svr_thread_wait(&thread);
+    svr_thread_close(&thread);
+
+    s64 event_time = svr_prof_get_real_time() - start_time;
+
+    svr_event_free(&bench_ping_event);
+    svr_event_free(&bench_pong_event);
+
+    bench_ping_signal = {};
+    bench_pong_signal = {};
+
+    start_time = svr_prof_get_real_time();
+    svr_thread_start(&thread, bench_signal_pong_proc, NULL);
+
+    for (s32 i = 0; i < BENCH_WAKE_ROUNDS; i++)
+    {
+        svr_signal_wake(&bench_ping_signal);
+        bench_wait_signal(&bench_pong_signal, i);
+    }
+
+    svr_thread_wait(&thread);
+    svr_thread_close(&thread);
+
+    s64 signal_time = svr_prof_get_real_time() - start_time;
+
+    // The real time is in microseconds.
+    bench_log("Wake event: %.2f us round trip\n", event_time / (double)BENCH_WAKE_ROUNDS);
+    bench_log("Wake signal: %.2f us round trip\n", signal_time / (double)BENCH_WAKE_ROUNDS);
+}
+
+// Convert to all three planes with every kernel the processor supports.
+void EncoderState::bench_cpu_kernels()
+{
+    u8* dest_y = (u8*)svr_alloc(bench_width);
+    u8* dest_u = (u8*)svr_alloc(bench_width);
+    u8* dest_v = (u8*)svr_alloc(bench_width);
+
+    s32 pitch = svr_align32(bench_width * 4, VID_PLANE_ALIGN);
+
+    // The kernels are sorted from best to worst, so everything after the selected one is also supported.
+    for (const VidCpuKernel* kernel = vid_cpu_select_kernel(); kernel != VID_CPU_KERNELS + SVR_ARRAY_SIZE(VID_CPU_KERNELS); kernel++)
+    {
+        s64 start_time = svr_prof_get_real_time();
+
+        for (s32 i = 0; i < BENCH_CPU_CONVERT_RUNS; i++)
+        {
+            u8* source = bench_source_frames[i % BENCH_NUM_SOURCE_FRAMES];
+
+            for (s32 y = 0; y < bench_height; y++)
+            {
+                vid_cpu_convert_row(kernel, source + (y * pitch), bench_width, dest_y, dest_u, dest_v);
+            }
+        }
+
+        s64 elapsed = svr_max(svr_prof_get_real_time() - start_time, (s64)1);
+        s64 num_px = (s64)bench_width * bench_height * BENCH_CPU_CONVERT_RUNS;
+
+        bench_log("CPU conversion %s: %.2f M pixels/s\n", kernel->name, num_px / (double)elapsed);
+    }
+
+    svr_free(dest_y);
+    svr_free(dest_u);
+    svr_free(dest_v);
+}
+
+// Motion blur on the CPU in both formats, with one thread and all threads, with every kernel the processor supports.
+// The memory traffic is the reading and writing of the sum for every added frame. The fixed point result is compared against the float result.
+void EncoderState::bench_mosample()
+{
+    const char* FORMAT_NAMES[] = { "float", "fixed" };
+    const s32 FORMAT_PIXEL_SIZES[] = { 16, 8 };
+
+    s32 pitch = svr_align32(bench_width * 4, VID_PLANE_ALIGN);
+    u8* dests[2];
+
+    s32 thread_counts[] = { 1, svr_get_num_processors() };
+    s32 num_thread_counts = thread_counts[1] > 1 ? 2 : 1;
+
+    for (s32 f = 0; f < 2; f++)
+    {
+        dests[f] = (u8*)svr_align_alloc(pitch * bench_height, VID_PLANE_ALIGN);
+
+        for (s32 i = 0; i < num_thread_counts; i++)
+        {
+            SvrMosample mosample;
+            svr_mosample_init(&mosample, bench_width, bench_height, f, thread_counts[i]);
+
+            bool has_avx2 = mosample.use_avx2;
+
+            for (s32 j = has_avx2 ? 0 : 1; j < 2; j++)
+            {
+                mosample.use_avx2 = j == 0;
+
+                s64 add_time = 0;
+                s64 resolve_time = 0;
+
+                for (s32 k = 0; k < BENCH_MOSAMPLE_RUNS; k++)
+                {
+                    svr_mosample_clear(&mosample);
+
+                    s64 start_time = svr_prof_get_real_time();
+
+                    for (s32 l = 0; l < BENCH_MOSAMPLE_SUBFRAMES; l++)
+                    {
+                        float weight_start = l / (float)BENCH_MOSAMPLE_SUBFRAMES;
+                        float weight_end = l == BENCH_MOSAMPLE_SUBFRAMES - 1 ? 1.0f : (l + 1) / (float)BENCH_MOSAMPLE_SUBFRAMES;
+
+                        svr_mosample_add(&mosample, bench_source_frames[l % BENCH_NUM_SOURCE_FRAMES], pitch, weight_start, weight_end);
+                    }
+
+                    s64 mid_time = svr_prof_get_real_time();
+
+                    svr_mosample_resolve(&mosample, dests[f], pitch);
+
+                    add_time += mid_time - start_time;
+                    resolve_time += svr_prof_get_real_time() - mid_time;
+                }
+
+                s64 num_px = (s64)bench_width * bench_height * BENCH_MOSAMPLE_RUNS;
+                s64 num_added_px = num_px * BENCH_MOSAMPLE_SUBFRAMES;
+
+                add_time = svr_max(add_time, (s64)1);
+
+                bench_log("CPU motion blur %s %s with %d threads: add %.2f M pixels/s (%.2f GB/s)  resolve %.2f M pixels/s\n",
+                          FORMAT_NAMES[f], mosample.use_avx2 ? "avx2" : "scalar", mosample.num_workers + 1,
+                          num_added_px / (double)add_time, (num_added_px * FORMAT_PIXEL_SIZES[f] * 2) / (add_time * 1000.0),
+                          num_px / (double)svr_max(resolve_time, (s64)1));
+            }
+
+            svr_mosample_free(&mosample);
+        }
+    }
+
+    s32 max_diff = 0;
+    s64 num_diffs = 0;
+
+    for (s32 y = 0; y < bench_height; y++)
+    {
+        for (s32 x = 0; x < bench_width * 4; x++)
+        {
+            s32 diff = abs(dests[0][(y * pitch) + x] - dests[1][(y * pitch) + x]);
+
+            max_diff = svr_max(max_diff, diff);
+            num_diffs += diff != 0;
+        }
+    }
+
+    bench_log("CPU motion blur fixed against float: %lld values differ, by at most %d\n", num_diffs, max_diff);
+
+    svr_align_free(dests[0], VID_PLANE_ALIGN);
+    svr_align_free(dests[1], VID_PLANE_ALIGN);
+}
+
+// Frame with all planes cleared, so the values that the conversion does not write (the last chroma column of odd sizes) are the same in every frame.
+AVFrame* bench_alloc_frame(AVPixelFormat pix_fmt, s32 width, s32 height)
+{
+    AVFrame* ret = av_frame_alloc();
+    ret->format = pix_fmt;
+    ret->width = width;
+    ret->height = height;
+
+    if (av_frame_get_buffer(ret, VID_PLANE_ALIGN) < 0)
+    {
+        av_frame_free(&ret);
+        return NULL;
+    }
+
+    for (s32 i = 0; i < AV_NUM_DATA_POINTERS && ret->buf[i]; i++)
+    {
+        memset(ret->buf[i]->data, 0, ret->buf[i]->size);
+    }
+
+    return ret;
+}
+
+// Add the same frames as bench_mosample does.
+void bench_fill_mosample(SvrMosample* mosample, u8** source_frames, s32 pitch)
+{
+    svr_mosample_clear(mosample);
+
+    for (s32 i = 0; i < BENCH_MOSAMPLE_SUBFRAMES; i++)
+    {
+        float weight_start = i / (float)BENCH_MOSAMPLE_SUBFRAMES;
+        float weight_end = i == BENCH_MOSAMPLE_SUBFRAMES - 1 ? 1.0f : (i + 1) / (float)BENCH_MOSAMPLE_SUBFRAMES;
+
+        svr_mosample_add(mosample, source_frames[i % BENCH_NUM_SOURCE_FRAMES], pitch, weight_start, weight_end);
+    }
+}
+
+// Resolving CPU motion blur straight into the planes of a frame, with an optional overlay on top.
+// Every row is resolved, blended and converted while it is in the cache, so the BGRA image is never written out and read back again.
+// This only exists to be measured against bench_convert_mosample_separate. Neither svr_game nor svr_encoder does motion blur on the CPU,
+// so nothing that makes a movie uses it, and it is not checked beyond being built from the same row functions as the separate passes.
+struct BenchMosampleJob
+{
+    const VidCpuKernel* kernel;
+    const u8* overlay; // Premultiplied BGRA. Can be NULL.
+    s32 overlay_pitch;
+    AVFrame* frame;
+};
+
+// In mosample threads.
+void bench_mosample_row(void* param, s32 y, u8* row)
+{
+    BenchMosampleJob* job = (BenchMosampleJob*)param;
+    AVFrame* frame = job->frame;
+
+    if (job->overlay)
+    {
+        svr_glyph_atlas_blend_row(row, job->overlay + (y * job->overlay_pitch), frame->width);
+    }
+
+    s32 half_width = frame->width >> 1;
+
+    u32* even_px = SVR_ALLOCA_NUM(u32, half_width);
+    u8* temp_u = SVR_ALLOCA_NUM(u8, half_width);
+    u8* temp_v = SVR_ALLOCA_NUM(u8, half_width);
+
+    vid_cpu_convert_row_into_frame(job->kernel, row, y, frame, even_px, temp_u, temp_v);
+}
+
+// The size of the frame must be the same as the mosample.
+void bench_convert_mosample_fused(const VidCpuKernel* kernel, SvrMosample* mosample, const u8* overlay, s32 overlay_pitch, AVFrame* frame)
+{
+    BenchMosampleJob job;
+    job.kernel = kernel;
+    job.overlay = overlay;
+    job.overlay_pitch = overlay_pitch;
+    job.frame = frame;
+
+    svr_mosample_resolve_rows(mosample, bench_mosample_row, &job);
+}
+
+// Same as above with a pass over the whole image for every step. The resolved image must have the same pitch as the overlay.
+void bench_convert_mosample_separate(const VidCpuKernel* kernel, SvrMosample* mosample, const u8* overlay, s32 overlay_pitch,
+                                     u8* resolved, AVFrame* frame)
+{
+    svr_mosample_resolve(mosample, resolved, overlay_pitch);
+
+    if (overlay)
+    {
+        for (s32 y = 0; y < frame->height; y++)
+        {
+            svr_glyph_atlas_blend_row(resolved + (y * overlay_pitch), overlay + (y * overlay_pitch), frame->width);
+        }
+    }
+
+    vid_cpu_convert_image(kernel, resolved, overlay_pitch, frame);
+}
+
+// Blocks of solid and half transparent white, in premultiplied alpha like the velo overlay.
+u8* bench_create_overlay(s32 width, s32 height, s32 pitch)
+{
+    u8* ret = (u8*)svr_align_alloc(pitch * height, VID_PLANE_ALIGN);
+
+    for (s32 y = 0; y < height; y++)
+    {
+        u32* row = (u32*)(ret + (y * pitch));
+
+        for (s32 x = 0; x < width; x++)
+        {
+            s32 kind = ((x >> 3) + (y >> 3)) % 3;
+            row[x] = kind == 0 ? 0xffffffff : kind == 1 ? 0x80808080 : 0;
+        }
+    }
+
+    return ret;
+}
+
+// Resolve motion blur on the CPU with an overlay into every video format, once as separate passes over the whole image
+// and once with every row going through all steps at once.
+void EncoderState::bench_mosample_yuv()
+{
+    const AVPixelFormat PIX_FMTS[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P };
+
+    const VidCpuKernel* kernel = vid_cpu_select_kernel();
+
+    s32 pitch = svr_align32(bench_width * 4, VID_PLANE_ALIGN);
+
+    u8* resolved = (u8*)svr_align_alloc(pitch * bench_height, VID_PLANE_ALIGN);
+    u8* overlay = bench_create_overlay(bench_width, bench_height, pitch);
+
+    SvrMosample mosample;
+    svr_mosample_init(&mosample, bench_width, bench_height, SVR_MOSAMPLE_FORMAT_FLOAT, 1);
+    bench_fill_mosample(&mosample, bench_source_frames, pitch);
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(PIX_FMTS); i++)
+    {
+        const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(PIX_FMTS[i]);
+
+        AVFrame* frame = bench_alloc_frame(PIX_FMTS[i], bench_width, bench_height);
+
+        if (frame == NULL)
+        {
+            bench_log("CPU motion blur to %s: could not allocate frame\n", desc->name);
+            continue;
+        }
+
+        s64 start_time = svr_prof_get_real_time();
+
+        for (s32 j = 0; j < BENCH_MOSAMPLE_RUNS; j++)
+        {
+            bench_convert_mosample_separate(kernel, &mosample, overlay, pitch, resolved, frame);
+        }
+
+        s64 mid_time = svr_prof_get_real_time();
+
+        for (s32 j = 0; j < BENCH_MOSAMPLE_RUNS; j++)
+        {
+            bench_convert_mosample_fused(kernel, &mosample, overlay, pitch, frame);
+        }
+
+        s64 end_time = svr_prof_get_real_time();
+
+        bench_log("CPU motion blur to %s: separate %.2f ms  fused %.2f ms\n", desc->name,
+                  (mid_time - start_time) / (1000.0 * BENCH_MOSAMPLE_RUNS), (end_time - mid_time) / (1000.0 * BENCH_MOSAMPLE_RUNS));
+
+        av_frame_free(&frame);
+    }
+
+    svr_mosample_free(&mosample);
+
+    svr_align_free(resolved, VID_PLANE_ALIGN);
+    svr_align_free(overlay, VID_PLANE_ALIGN);
+}
+
+// Next value of a xorshift generator.
+u32 bench_next_noise(u32* noise)
+{
+    *noise ^= *noise << 13;
+    *noise ^= *noise >> 17;
+    *noise ^= *noise << 5;
+    return *noise;
+}
+
+// Bytes that look somewhat like x86 code, where a few bytes are a lot more common than the rest (see SCAN_COMMON_BYTES in svr_scan.cpp).
+// The more common the anchor bytes of a pattern are, the more places have to be checked fully, so random bytes would make the scan look too good.
+void bench_fill_scan_image(u8* dest, s32 size, u32 noise)
+{
+    const u8 COMMON_BYTES[] = { 0x00, 0xFF, 0x8B, 0x48, 0x89, 0xCC, 0x0F, 0xE8 };
+
+    for (s32 i = 0; i < size; i++)
+    {
+        u32 v = bench_next_noise(&noise);
+        dest[i] = (v & 3) != 0 ? COMMON_BYTES[(v >> 8) % SVR_ARRAY_SIZE(COMMON_BYTES)] : (u8)(v >> 16);
+    }
+}
+
+// Pattern of the bytes at some place, with about a quarter of the bytes unknown like the addresses in the real patterns.
+// Without a source, the known bytes are random and the pattern will most likely not match anywhere.
+void bench_make_scan_pattern(const u8* source, s32 used, u32* noise, SvrScanPattern* out)
+{
+    char str[SVR_SCAN_MAX_BYTES * 3 + 1];
+    s32 pos = 0;
+
+    for (s32 i = 0; i < used; i++)
+    {
+        u32 v = bench_next_noise(noise);
+
+        if ((v & 3) == 0)
+        {
+            pos += stbsp_snprintf(str + pos, sizeof(str) - pos, "?? ");
+        }
+
+        else
+        {
+            pos += stbsp_snprintf(str + pos, sizeof(str) - pos, "%02X ", source ? source[i] : (v >> 8) & 0xff);
+        }
+    }
+
+    svr_scan_parse_pattern(str, out);
+}
+
+// Finding patterns in images of the same size as the game libraries, with every version of svr_scan_find and with svr_scan_find_many.
+// Half of the patterns are found somewhere in the image and half are not found at all, which has to go through the whole image.
+void EncoderState::bench_scan()
+{
+    const s32 IMAGE_SIZES_MB[] = { 20, 40, 60 };
+
+    s32 num_kernels = bench_get_num_kernels();
+    u32 noise = 0x2468ace1;
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(IMAGE_SIZES_MB); i++)
+    {
+        s32 size = IMAGE_SIZES_MB[i] * 1024 * 1024;
+        u8* image = (u8*)svr_alloc(size);
+
+        bench_fill_scan_image(image, size, noise);
+
+        SvrScanPattern* patterns = SVR_ZALLOC_NUM(SvrScanPattern, BENCH_SCAN_PATTERNS);
+
+        for (s32 j = 0; j < BENCH_SCAN_PATTERNS; j++)
+        {
+            s32 used = 16 + (j % 9);
+            s32 offset = bench_next_noise(&noise) % (size - used);
+
+            bench_make_scan_pattern((j & 1) ? image + offset : NULL, used, &noise, &patterns[j]);
+        }
+
+        char line[512];
+        s32 pos = SVR_SNPRINTF(line, "Scan %d MB:", IMAGE_SIZES_MB[i]);
+
+        for (s32 j = 0; j < num_kernels; j++)
+        {
+            s64 start_time = svr_prof_get_real_time();
+
+            for (s32 k = 0; k < BENCH_SCAN_PATTERNS; k++)
+            {
+                svr_scan_find_with_kernel(image, size, &patterns[k], j);
+            }
+
+            s64 elapsed = svr_max(svr_prof_get_real_time() - start_time, (s64)1);
+
+            pos += stbsp_snprintf(line + pos, sizeof(line) - pos, "  %s %.2f ms", BENCH_KERNEL_NAMES[j], elapsed / 1000.0);
+        }
+
+        s32* results = SVR_ZALLOC_NUM(s32, BENCH_SCAN_PATTERNS);
+
+        SvrScanRegion region;
+        region.data = image;
+        region.size = size;
+        region.patterns = patterns;
+        region.num_patterns = BENCH_SCAN_PATTERNS;
+        region.results = results;
+
+        s64 start_time = svr_prof_get_real_time();
+        svr_scan_find_many(&region, 1, svr_get_num_processors());
+        s64 elapsed = svr_max(svr_prof_get_real_time() - start_time, (s64)1);
+
+        bench_log("%s  many with %d threads %.2f ms (%d patterns)\n", line, svr_get_num_processors(), elapsed / 1000.0, BENCH_SCAN_PATTERNS);
+
+        svr_free(results);
+        svr_free(patterns);
+        svr_free(image);
+    }
+}
+
+// Packing the 32-bit samples of svr_standalone to 16 bits with every version, for one second of audio at a time like the game gives.
+void EncoderState::bench_audio_pack()
+{
+    s32 num_values = BENCH_AUDIO_HZ * BENCH_AUDIO_CHANNELS;
+
+    s32* src = SVR_ZALLOC_NUM(s32, num_values);
+    s16* dest = SVR_ZALLOC_NUM(s16, num_values);
+
+    // The test tone at 8 times the volume, so the loud parts have to be clamped.
+    for (s32 i = 0; i < num_values; i++)
+    {
+        src[i] = bench_audio_samples[i] * 8;
+    }
+
+    char line[256] = {};
+    s32 pos = 0;
+
+    for (s32 i = 0; i < bench_get_num_kernels(); i++)
+    {
+        s64 start_time = svr_prof_get_real_time();
+
+        for (s32 j = 0; j < BENCH_AUDIO_PACK_SECONDS; j++)
+        {
+            svr_audio_pack_s32_to_s16_with_kernel(src, dest, num_values, i);
+        }
+
+        s64 elapsed = svr_max(svr_prof_get_real_time() - start_time, (s64)1);
+        s64 num_packed = (s64)num_values * BENCH_AUDIO_PACK_SECONDS;
+
+        pos += stbsp_snprintf(line + pos, sizeof(line) - pos, "  %s %.2f G values/s", BENCH_KERNEL_NAMES[i], num_packed / (elapsed * 1000.0));
+    }
+
+    bench_log("Audio pack:%s\n", line);
+
+    svr_free(src);
+    svr_free(dest);
+}
+
+// Average time of a trace scope in milliseconds, 0 if it never ran.
+// The scopes are kept after rendering stops, until the next render starts.
+double bench_get_scope_avg_ms(const char* name)
+{
+    SvrTraceStats stats;
+    svr_trace_get_stats(name, &stats);
+
+    return stats.avg_ms;
+}
+
+void EncoderState::bench_video_encoder(const RenderVideoInfo* info, const char* x264_preset, const char* dnxhr_profile)
+{
+    s64 start_time;
+    s64 elapsed;
+    s32 frame_size = svr_align32(bench_width * 4, VID_PLANE_ALIGN) * bench_height; // Same as the frames get in bench_setup_video.
+    s32 samples_per_frame = BENCH_AUDIO_HZ / BENCH_FPS;
+    s32 audio_pos = 0;
+    const char* variant = x264_preset[0] ? x264_preset : dnxhr_profile;
+
+    movie_params = {};
+
+    // DNxHR can only be in MOV.
+    const char* extension = info->setup == &EncoderState::render_setup_dnxhr ? "mov" : "mp4";
+    SVR_SNPRINTF(movie_params.dest_file, "data/BENCH_OUTPUT.%s", extension);
+
+    movie_params.video_width = bench_width;
+    movie_params.video_height = bench_height;
+    movie_params.audio_channels = BENCH_AUDIO_CHANNELS;
+    movie_params.audio_hz = BENCH_AUDIO_HZ;
+    movie_params.audio_bits = 16;
+    SVR_COPY_STRING(info->profile_name, movie_params.video_encoder);
+    SVR_COPY_STRING("aac", movie_params.audio_encoder);
+    SVR_COPY_STRING(x264_preset, movie_params.x264_preset);
+    SVR_COPY_STRING(dnxhr_profile, movie_params.dnxhr_profile);
+    movie_params.video_fps = BENCH_FPS;
+    movie_params.x264_crf = 15;
+    movie_params.x264_intra = false;
+    movie_params.use_audio = true;
+    movie_params.max_queued_mb = 2048;
+    movie_params.cpu_conversion = true;
+
+    bench_peak_mem = 0;
+
+    if (!render_start())
+    {
+        goto rfail;
+    }
+
+    bench_setup_video();
+
+    if (!audio_start())
+    {
+        goto rfail;
+    }
+
+    start_time = svr_prof_get_real_time();
+
+    for (s32 i = 0; i < bench_num_frames; i++)
+    {
+        if (render_check_thread_errors())
+        {
+            goto rfail;
+        }
+
+        AVFrame* frame = render_get_new_video_frame();
+
+        if (!svr_atom_load(&render_started))
+        {
+            av_frame_free(&frame);
+            goto rfail;
+        }
+
+        frame->pts = render_video_pts;
+        render_video_pts++;
+
+        // This is where the download would be.
+        vid_stream_copy(frame->opaque_ref->data, bench_source_frames[i % BENCH_NUM_SOURCE_FRAMES], frame_size);
+        render_encode_video_frame(frame);
+
+        render_push_audio_samples(bench_audio_samples + (audio_pos * BENCH_AUDIO_CHANNELS), samples_per_frame);
+        audio_pos = (audio_pos + samples_per_frame) % BENCH_AUDIO_HZ; // The rate is a multiple of the frame rate so this lines up.
+
+        bench_sample_memory();
+    }
+
+    // Waits for all threads to finish.
+    free_dynamic();
+
+    elapsed = svr_max(svr_prof_get_real_time() - start_time, (s64)1);
+
+    bench_log("%-12s %-10s %8.2f fps  push %6.2f ms  convert %6.2f ms  encode %6.2f ms  write %6.2f ms  peak %5lld MB\n",
+              info->profile_name, variant, bench_num_frames / (elapsed / 1000000.0),
+              bench_get_scope_avg_ms("Push video frame"), bench_get_scope_avg_ms("Convert video frame"),
+              bench_get_scope_avg_ms("Encode video frame"), bench_get_scope_avg_ms("Write"), SVR_FROM_MB(bench_peak_mem));
+
+    goto rexit;
+
+rfail:
+    bench_log("%-12s %-10s failed, see ENCODER_LOG.txt\n", info->profile_name, variant);
+    free_dynamic();
+
+rexit:
+    svr_file_delete(movie_params.dest_file);
+}
+
+// Same as vid_start does for the CPU conversion, but without any textures.
+// The frames are laid out as if the download textures had no padding.
+void EncoderState::bench_setup_video()
+{
+    AVPixelFormat pix_fmt = render_video_ctx->pix_fmt;
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pix_fmt);
+
+    s32 linesizes[4];
+    av_image_fill_linesizes(linesizes, pix_fmt, bench_width);
+
+    vid_num_planes = av_pix_fmt_count_planes(pix_fmt);
+
+    for (s32 i = 0; i < vid_num_planes; i++)
+    {
+        bool is_chroma = i == 1 || i == 2;
+
+        vid_plane_pitches[i] = svr_align32(linesizes[i], VID_PLANE_ALIGN);
+        vid_plane_heights[i] = is_chroma ? AV_CEIL_RSHIFT(bench_height, desc->log2_chroma_h) : bench_height;
+    }
+
+    vid_frames_pitch_matched = true;
+
+    vid_cpu_conversion = true;
+    vid_cpu_pitch = svr_align32(bench_width * 4, VID_PLANE_ALIGN);
+    vid_cpu_start();
+}
+
+void EncoderState::bench_sample_memory()
+{
+    bench_peak_mem = svr_max(bench_peak_mem, svr_get_working_set_size());
+}
@@ -0,0 +1,269 @@
+#include "encoder_priv.h"
+
+// Talking to svr_game through the shared memory (see encoder_shared.h).
+
+bool EncoderState::init(HANDLE in_shared_mem_h)
+{
+    bool ret = false;
+
+    main_thread_id = svr_get_thread_id();
+
+    shared_mem_h = in_shared_mem_h;
+
+    // At this point, the shared memory will already have some data already filled in.
+    shared_mem_ptr = (EncoderSharedMem*)MapViewOfFile(shared_mem_h, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+
+    if (shared_mem_ptr == NULL)
+    {
+        error("ERROR: Could not view encoder shared memory (%lu)\n", GetLastError());
+        goto rfail;
+    }
+
+    game_wake_event_h = (HANDLE)shared_mem_ptr->game_wake_event_h;
+    encoder_wake_event_h = (HANDLE)shared_mem_ptr->encoder_wake_event_h;
+    shared_audio_buffer = (u8*)shared_mem_ptr + shared_mem_ptr->audio_buffer_offset;
+
+    game_process = OpenProcess(SYNCHRONIZE, FALSE, shared_mem_ptr->game_pid);
+
+    if (game_process == NULL)
+    {
+        error("ERROR: Could not open game process (%lu)\n", GetLastError());
+        goto rfail;
+    }
+
+    if (!vid_init())
+    {
+        goto rfail;
+    }
+
+    if (!audio_init())
+    {
+        goto rfail;
+    }
+
+    if (!render_init())
+    {
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    free_static();
+
+rexit:
+    return ret;
+}
+
+void EncoderState::start_event()
+{
+    svr_log("Starting encoder\n");
+
+    // The movie parameters in the shared memory won't change after this point, but we
+    // want to have our own copy either way.
+    movie_params = shared_mem_ptr->movie_params;
+
+    if (!render_start())
+    {
+        goto rfail;
+    }
+
+    if (!vid_start())
+    {
+        goto rfail;
+    }
+
+    if (movie_params.use_audio)
+    {
+        if (!audio_start())
+        {
+            goto rfail;
+        }
+    }
+
+    if (render_video_info)
+    {
+        svr_log("Using video encoder %s\n", render_video_info->profile_name);
+    }
+
+    if (render_audio_info)
+    {
+        svr_log("Using audio encoder %s\n", render_audio_info->profile_name);
+    }
+
+    goto rexit;
+
+rfail:
+    free_dynamic();
+
+rexit:
+    return;
+}
+
+void EncoderState::stop_event()
+{
+    svr_log("Ending encoder\n");
+
+    free_dynamic();
+}
+
+void EncoderState::new_video_frame_event(VidGameTexture* game_tex)
+{
+    if (!render_receive_video(game_tex))
+    {
+        free_dynamic();
+    }
+}
+
+// Take all audio samples that svr_game has written to the audio ring since last time.
+// Audio samples are not events so they are not waited for by svr_game (see encoder_shared.h).
+void EncoderState::receive_audio_samples()
+{
+    u32 write_idx = (u32)svr_atom_load(&shared_mem_ptr->audio_write_idx);
+    u32 read_idx = (u32)svr_atom_load(&shared_mem_ptr->audio_read_idx);
+
+    if (read_idx == write_idx)
+    {
+        return;
+    }
+
+    svr_trace_begin("Audio samples");
+
+    s32 sample_size = render_get_audio_buffer_size(1);
+
+    while (read_idx != write_idx)
+    {
+        // The samples that wrap around to the start of the ring are taken in the next iteration.
+        s32 ring_pos = read_idx % ENCODER_AUDIO_RING_SAMPLES;
+        s32 num_samples = svr_min((s32)(write_idx - read_idx), ENCODER_AUDIO_RING_SAMPLES - ring_pos);
+        num_samples = svr_min(num_samples, ENCODER_MAX_SAMPLES);
+
+        // Nothing to do after an error, but the samples must still be taken so svr_game does not wait for space in the ring.
+        if (svr_atom_load(&render_started))
+        {
+            if (!render_receive_audio((u8*)shared_audio_buffer + (ring_pos * sample_size), num_samples))
+            {
+                free_dynamic();
+            }
+        }
+
+        // The space can be written by svr_game again after this, so the samples must not be used anymore.
+        read_idx += num_samples;
+        svr_atom_store(&shared_mem_ptr->audio_read_idx, (s32)read_idx);
+    }
+
+    svr_trace_end();
+}
+
+// Take all video frames that svr_game has sent since last time.
+// Video frames are not events so they are not waited for by svr_game (see encoder_shared.h).
+void EncoderState::receive_video_frames()
+{
+    s32 write_idx = svr_atom_load(&shared_mem_ptr->video_write_idx);
+
+    while (vid_game_read_idx < write_idx)
+    {
+        VidGameTexture* game_tex = &vid_game_texs[vid_game_read_idx % ENCODER_NUM_VIDEO_TEXTURES];
+        vid_game_read_idx++;
+
+        // Nothing to do after an error, svr_game will see the error and stop sending.
+        if (svr_atom_load(&render_started) == 0)
+        {
+            continue;
+        }
+
+        svr_trace_begin("Video frame");
+        new_video_frame_event(game_tex);
+        svr_trace_end();
+    }
+}
+
+// Event reading from svr_game.
+void EncoderState::event_loop()
+{
+    svr_log("Encoder ready\n");
+
+    HANDLE handles[] =
+    {
+        game_process,
+        encoder_wake_event_h,
+    };
+
+    while (true)
+    {
+        DWORD waited = WaitForMultipleObjects(SVR_ARRAY_SIZE(handles), handles, FALSE, INFINITE);
+        HANDLE waited_h = handles[waited - WAIT_OBJECT_0];
+
+        // Game exited or crashed or something.
+        // If we were recording, we did not get the stop command, so just stop as if we got it.
+        // This will exit this process too.
+        if (waited_h == game_process)
+        {
+            if (svr_atom_load(&render_started))
+            {
+                svr_log("Game exited without telling the encoder, ending movie\n");
+
+                stop_event();
+            }
+
+            break;
+        }
+
+        // We are woken up here because svr_game wants us to do something.
+        // Any code in here needs to be fast because the game is frozen while we handle events, and it can only be ahead of us by a few video frames.
+        // Forward relevant stuff to the actual encoder thread.
+        if (waited_h == encoder_wake_event_h)
+        {
+            // The event must be read before the video frames and audio samples, so everything that was sent before the event is taken first.
+            EncoderSharedEvent event = svr_atom_load(&shared_mem_ptr->event_type);
+
+            receive_video_frames();
+            receive_audio_samples();
+
+            // Only woken up for video frames or audio samples, svr_game is not waiting for us.
+            if (event == ENCODER_EVENT_NONE)
+            {
+                continue;
+            }
+
+            switch (event)
+            {
+                case ENCODER_EVENT_START:
+                {
+                    start_event();
+                    break;
+                }
+
+                case ENCODER_EVENT_STOP:
+                {
+                    stop_event();
+                    break;
+                }
+            }
+
+            // Notify svr_game that we handled this event.
+            // We go back to sleep after this, which puts us in a known paused state.
+            svr_atom_store(&shared_mem_ptr->event_type, ENCODER_EVENT_NONE);
+            SetEvent(game_wake_event_h);
+        }
+    }
+
+    svr_log("Encoder finished\n");
+}
+
+void EncoderState::game_free_static()
+{
+    svr_maybe_close_handle(&game_process);
+    svr_maybe_close_handle(&shared_mem_h);
+
+    if (shared_mem_ptr)
+    {
+        UnmapViewOfFile(shared_mem_ptr);
+        shared_mem_ptr = NULL;
+        shared_audio_buffer = NULL;
+    }
+
+    svr_maybe_close_handle(&game_wake_event_h);
+    svr_maybe_close_handle(&encoder_wake_event_h);
+}
@@ -2,7 +2,7 @@
 
 EncoderState encoder_state;
 
-void av_log_callback(void* avcl, int level, const char* fmt, va_list vl)
+void av_log_callback(void* /* avcl */, int level, const char* fmt, va_list vl)
 {
     // Change this comparison if you need to see more detailed output.
     if (level > AV_LOG_WARNING)
@@ -28,30 +28,45 @@ void av_log_callback(void* avcl, int level, const char* fmt, va_list vl)
 
     svr_log(format, buf);
 
+#ifdef _WIN32
     if (IsDebuggerPresent())
     {
         OutputDebugStringA(svr_va(format, buf));
     }
+#endif
 }
 
 int main(int argc, char** argv)
 {
-#ifdef SVR_DEBUG
+#if defined(SVR_DEBUG) && defined(_WIN32)
     _set_error_mode(_OUT_TO_MSGBOX); // Must be called so we can actually use assert because Microsoft messed it up in console builds.
 #endif
 
-    svr_init_log("data\\ENCODER_LOG.txt", false);
+    svr_init_log("data/ENCODER_LOG.txt", false);
+
+    svr_prof_init();
+    svr_trace_thread_start("ENCODER MAIN THREAD");
+
+    // For release this should be disabled.
+    av_log_set_callback(av_log_callback);
+    av_log_set_level(AV_LOG_WARNING);
+
+    // The benchmark can be started manually, and runs without svr_game.
+    if (argc >= 2 && !strcmp(argv[1], "bench"))
+    {
+        s32 ret = encoder_state.bench_run(argc, argv);
+        encoder_state.free_static();
 
+        return ret;
+    }
+
+#ifdef _WIN32
     if (argc != 2)
     {
         svr_log("ERROR: Encoder has not been started properly. This program can not be started manually\n");
         return 1;
     }
 
-    // For release this should be disabled.
-    av_log_set_callback(av_log_callback);
-    av_log_set_level(AV_LOG_WARNING);
-
     SYSTEMTIME lt;
     GetLocalTime(&lt);
 
@@ -67,4 +82,9 @@ int main(int argc, char** argv)
     encoder_state.free_static();
 
     return 0;
+#else
+    // There is no game to encode for on other platforms.
+    svr_log("ERROR: Only the benchmark can be run on this platform, start with: svr_encoder bench\n");
+    return 1;
+#endif
 }
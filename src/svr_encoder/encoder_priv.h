@@ -2,17 +2,35 @@
 #include "svr_common.h"
 #include "encoder_shared.h"
 #include "svr_log.h"
+#include "svr_trace.h"
 #include "svr_alloc.h"
 #include "svr_locked_array.h"
 #include "svr_locked_queue.h"
+#include "svr_spsc_queue.h"
 #include "svr_atom.h"
 #include "svr_defs.h"
+#include "svr_prof.h"
+#include "svr_platform.h"
+#include "svr_mosample.h"
+#include "svr_glyph_atlas.h"
+#include "svr_scan.h"
+#include "svr_audio.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+// Only the benchmark and the encoding core build on other platforms. Everything that talks to the game uses D3D11 and Windows handles.
+#ifdef _WIN32
 #include <Windows.h>
 #include <d3d11_1.h>
 #include <d3d11shadertracing.h>
 #include <dxgi.h>
-#include <assert.h>
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
 
 extern "C"
 {
@@ -24,6 +42,8 @@ extern "C"
     #include <libavutil/samplefmt.h>
     #include <libavutil/opt.h>
     #include <libavutil/audio_fifo.h>
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
 }
 
 #include "encoder_state.h"
@@ -18,25 +18,43 @@ const RenderAudioInfo RENDER_AUDIO_INFOS[] =
 
 bool EncoderState::render_init()
 {
-    render_frame_queue.init(RENDER_QUEUED_FRAMES);
+    render_init_frame_thread(&render_video_frame_thread, "Push video frame", "Encode video frame");
+    render_init_frame_thread(&render_audio_frame_thread, "Push audio frame", "Encode audio frame");
+
     render_packet_queue.init(RENDER_QUEUED_PACKETS);
+    render_recycled_packets.init(RENDER_QUEUED_PACKETS);
     render_audio_queue.init(RENDER_QUEUED_AUDIO_BUFFERS);
-    render_recycled_video_frames.init(RENDER_QUEUED_FRAMES);
-    render_recycled_audio_frames.init(RENDER_QUEUED_FRAMES);
     render_recycled_audio_buffers.init(RENDER_QUEUED_AUDIO_BUFFERS);
 
-    render_frame_wake_event_h = CreateEventA(NULL, FALSE, FALSE, NULL);
-    render_packet_wake_event_h = CreateEventA(NULL, FALSE, FALSE, NULL);
-    render_audio_wake_event_h = CreateEventA(NULL, FALSE, FALSE, NULL);
-
     return true;
 }
 
+void EncoderState::render_init_frame_thread(RenderFrameThread* ft, const char* push_scope, const char* encode_scope)
+{
+    ft->push_scope = push_scope;
+    ft->encode_scope = encode_scope;
+
+    ft->frame_queue.init(RENDER_QUEUED_FRAMES);
+    ft->recycled_frames.init(RENDER_QUEUED_FRAMES);
+
+    ft->frame_pool = &ft->recycled_frames;
+    ft->packet_dest = &render_packet_queue;
+}
+
+void EncoderState::render_free_frame_thread(RenderFrameThread* ft)
+{
+    ft->frame_queue.free();
+    ft->recycled_frames.free();
+}
+
 bool EncoderState::render_start()
 {
     bool ret = false;
     s32 res;
 
+    // Must be known before the video codec is opened.
+    render_create_chunk_threads();
+
     if (!render_init_output_context())
     {
         goto rfail;
@@ -55,6 +73,15 @@ bool EncoderState::render_start()
         }
     }
 
+    render_setup_video_frame_limit();
+
+    // With chunk encoding the video is behind the audio by up to a chunk for every chunk thread.
+    // The audio packets must then wait in the container until the video has caught up, instead of being written far ahead of it.
+    if (render_num_chunk_threads > 0)
+    {
+        render_output_context->max_interleave_delta = 0;
+    }
+
     res = avformat_write_header(render_output_context, NULL);
 
     if (res < 0)
@@ -64,18 +91,32 @@ bool EncoderState::render_start()
     }
 
     // Threads are ok at the start.
-    svr_atom_store(&render_frame_thread_status, 1);
+    svr_atom_store(&render_video_frame_thread.status, 1);
+    svr_atom_store(&render_audio_frame_thread.status, 1);
     svr_atom_store(&render_packet_thread_status, 1);
     svr_atom_store(&render_audio_thread_status, 1);
 
-    render_frame_thread_message[0] = 0;
+    render_video_frame_thread.message[0] = 0;
+    render_audio_frame_thread.message[0] = 0;
     render_packet_thread_message[0] = 0;
     render_audio_thread_message[0] = 0;
 
-    // Be extra sure that these events are not triggered, so the threads enter a waiting state.
-    ResetEvent(render_frame_wake_event_h);
-    ResetEvent(render_packet_wake_event_h);
-    ResetEvent(render_audio_wake_event_h);
+    render_reset_frame_thread_stats(&render_video_frame_thread);
+    render_reset_frame_thread_stats(&render_audio_frame_thread);
+
+    // No other threads are running now, the previous ones have exited.
+    svr_trace_reset();
+    svr_trace_set_timeline(movie_params.write_trace);
+
+    render_num_allocated_video_frames = 0;
+    render_num_allocated_audio_frames = 0;
+    svr_atom_store(&render_num_allocated_packets, 0);
+
+    // Be extra sure that the queues are empty, so the threads enter a waiting state.
+    // Queues may have been closed by a previous error.
+    render_video_frame_thread.frame_queue.reset();
+    render_audio_frame_thread.frame_queue.reset();
+    render_audio_queue.reset();
 
     svr_atom_store(&render_started, 1);
 
@@ -90,17 +131,54 @@ rexit:
     return ret;
 }
 
+// Uncompressed video frames are large, so if the encoder cannot keep up we must not queue up frames until the system runs out of memory.
+// The frame queue will block the main thread when it has reached the limit, which in turn blocks the game since it waits for us.
+void EncoderState::render_setup_video_frame_limit()
+{
+    s32 frame_size = av_image_get_buffer_size(render_video_ctx->pix_fmt, render_video_ctx->width, render_video_ctx->height, 1);
+    s32 max_frames = RENDER_QUEUED_FRAMES;
+
+    // With CPU conversion every frame also holds the downloaded pixels until it is converted (see vid_cpu_conversion).
+    // The download textures are not created yet, so their pitch is not known. It is at least the aligned width.
+    if (movie_params.cpu_conversion && frame_size > 0)
+    {
+        frame_size += svr_align32(render_video_ctx->width * 4, VID_PLANE_ALIGN) * render_video_ctx->height;
+    }
+
+    if (movie_params.max_queued_mb > 0 && frame_size > 0)
+    {
+        s64 num_frames = ((s64)movie_params.max_queued_mb * 1024 * 1024) / frame_size;
+        svr_clamp(&num_frames, (s64)1, (s64)RENDER_QUEUED_FRAMES);
+
+        max_frames = (s32)num_frames;
+    }
+
+    render_video_frame_thread.frame_queue.set_limit(max_frames);
+
+    // The chunk threads share the limit.
+    if (render_num_chunk_threads > 0)
+    {
+        s32 max_chunk_frames = svr_max(max_frames / render_num_chunk_threads, 1);
+
+        for (s32 i = 0; i < render_num_chunk_threads; i++)
+        {
+            render_chunk_threads[i].frame_queue.set_limit(max_chunk_frames);
+        }
+
+        max_frames = max_chunk_frames * render_num_chunk_threads;
+    }
+
+    svr_log("Allowing %d queued video frames (%d MB)\n", max_frames, (s32)(((s64)max_frames * frame_size) >> 20));
+}
+
 void EncoderState::render_free_static()
 {
-    svr_maybe_close_handle(&render_frame_wake_event_h);
-    svr_maybe_close_handle(&render_packet_wake_event_h);
-    svr_maybe_close_handle(&render_audio_wake_event_h);
+    render_free_frame_thread(&render_video_frame_thread);
+    render_free_frame_thread(&render_audio_frame_thread);
 
-    render_frame_queue.free();
     render_packet_queue.free();
+    render_recycled_packets.free();
     render_audio_queue.free();
-    render_recycled_video_frames.free();
-    render_recycled_audio_frames.free();
     render_recycled_audio_buffers.free();
 }
 
@@ -108,12 +186,25 @@ void EncoderState::render_free_dynamic()
 {
     if (svr_atom_load(&render_started))
     {
+#ifdef _WIN32
         // Submit any remaining textures for encode.
 
         while (vid_drain_textures())
         {
             render_submit_texture();
         }
+#endif
+
+        // Send flush to audio thread if we started it.
+        // This must be done first, because the audio thread also puts samples in the fifo and gives frames to the audio frame thread.
+
+        if (render_audio_thread.h)
+        {
+            RenderAudioThreadInput flush_audio_buf = {};
+            render_audio_queue.push(&flush_audio_buf);
+
+            svr_thread_wait(&render_audio_thread); // Wait for audio thread to finish.
+        }
 
         // Flush out all of the remaining samples in the audio fifo for encode.
 
@@ -122,39 +213,46 @@ void EncoderState::render_free_dynamic()
             render_flush_audio_fifo();
         }
 
-        // Send flush to audio thread if we started it.
+        // Send flushes to the frame threads.
+        // Both must be finished before the packet thread can be flushed.
 
-        if (render_audio_thread_h)
-        {
-            RenderAudioThreadInput flush_audio_buf = {};
-            render_audio_queue.push(&flush_audio_buf);
+        render_flush_frame_thread(&render_video_frame_thread);
+        render_flush_frame_thread(&render_audio_frame_thread);
 
-            SetEvent(render_audio_wake_event_h); // Notify audio thread.
-
-            WaitForSingleObject(render_audio_thread_h, INFINITE); // Wait for audio thread to finish.
+        for (s32 i = 0; i < render_num_chunk_threads; i++)
+        {
+            render_flush_frame_thread(&render_chunk_threads[i]);
         }
 
-        // Send flushes to frame thread.
+        if (render_num_chunk_threads > 0)
+        {
+            for (s32 i = 0; i < render_num_chunk_threads; i++)
+            {
+                render_log_frame_thread_stats(&render_chunk_threads[i], svr_va("video chunk thread %d", i));
+            }
+        }
 
-        if (render_video_ctx)
+        else
         {
-            render_encode_video_frame(NULL);
+            render_log_frame_thread_stats(&render_video_frame_thread, "video");
         }
 
         if (render_audio_ctx)
         {
-            render_encode_audio_frame(NULL);
+            render_log_frame_thread_stats(&render_audio_frame_thread, "audio");
         }
 
-        WaitForSingleObject(render_frame_thread_h, INFINITE); // Wait for frame thread to finish.
-
         // Flush the packet thread.
 
         AVPacket* flush_packet = NULL;
         render_packet_queue.push(&flush_packet);
-        SetEvent(render_packet_wake_event_h); // Notify packet thread.
+        svr_signal_wake(&render_packet_signal); // Notify packet thread.
+
+        svr_thread_wait(&render_packet_thread); // Wait for packet thread to finish.
 
-        WaitForSingleObject(render_packet_thread_h, INFINITE); // Wait for packet thread to finish.
+        render_log_allocations();
+
+        render_log_trace();
 
         av_write_trailer(render_output_context); // Can only be written if avformat_write_header was called.
     }
@@ -163,10 +261,18 @@ void EncoderState::render_free_dynamic()
     {
         // Wake threads so they can exit (if they even started).
         // Since render_started is 0, they will immediately exit.
+        // Closing the queues also makes sure that no thread stays blocked on a full queue.
+
+        render_video_frame_thread.frame_queue.close();
+        render_audio_frame_thread.frame_queue.close();
 
-        SetEvent(render_frame_wake_event_h);
-        SetEvent(render_packet_wake_event_h);
-        SetEvent(render_audio_wake_event_h);
+        for (s32 i = 0; i < render_num_chunk_threads; i++)
+        {
+            render_chunk_threads[i].frame_queue.close();
+        }
+
+        svr_signal_wake(&render_packet_signal);
+        render_audio_queue.close();
     }
 
     if (render_output_context)
@@ -183,6 +289,11 @@ void EncoderState::render_free_dynamic()
     render_video_stream = NULL;
     render_audio_stream = NULL;
 
+    render_video_frame_thread.ctx = NULL;
+    render_video_frame_thread.stream = NULL;
+    render_audio_frame_thread.ctx = NULL;
+    render_audio_frame_thread.stream = NULL;
+
     render_video_info = NULL;
     render_audio_info = NULL;
 
@@ -196,9 +307,12 @@ void EncoderState::render_free_dynamic()
     render_free_recycled_stuff();
     render_free_lingering_thread_inputs();
 
-    svr_maybe_close_handle(&render_frame_thread_h);
-    svr_maybe_close_handle(&render_packet_thread_h);
-    svr_maybe_close_handle(&render_audio_thread_h);
+    svr_thread_close(&render_video_frame_thread.thread);
+    svr_thread_close(&render_audio_frame_thread.thread);
+    svr_thread_close(&render_packet_thread);
+    svr_thread_close(&render_audio_thread);
+
+    render_free_chunk_threads();
 }
 
 // Find the structure matching the configuration in the movie profile.
@@ -240,6 +354,7 @@ bool EncoderState::render_setup_audio_info()
 bool EncoderState::render_init_output_context()
 {
     bool ret = false;
+    s32 res;
 
     // Guess container based on extension.
     render_container = av_guess_format(NULL, movie_params.dest_file, NULL);
@@ -256,7 +371,7 @@ bool EncoderState::render_init_output_context()
         goto rfail;
     }
 
-    s32 res = avformat_alloc_output_context2(&render_output_context, render_container, NULL, NULL);
+    res = avformat_alloc_output_context2(&render_output_context, render_container, NULL, NULL);
 
     if (res < 0)
     {
@@ -285,16 +400,15 @@ bool EncoderState::render_init_video()
 {
     bool ret = false;
     s32 res;
+    char message[256];
+    const AVCodec* codec = NULL;
 
     if (!render_setup_video_info())
     {
         goto rfail;
     }
 
-    // Time base for video. Always based in seconds, so 1/60 for example.
-    AVRational video_q = av_make_q(1, movie_params.video_fps);
-
-    const AVCodec* codec = avcodec_find_encoder_by_name(render_video_info->codec_name);
+    codec = avcodec_find_encoder_by_name(render_video_info->codec_name);
 
     // Maybe seems silly but this is possible to happen if someone replaces the dlls or something.
     if (codec == NULL)
@@ -321,59 +435,104 @@ bool EncoderState::render_init_video()
 
     render_video_stream->id = render_output_context->nb_streams - 1;
 
-    render_video_ctx = avcodec_alloc_context3(codec);
+    render_video_ctx = render_open_video_ctx(false, message, SVR_ARRAY_SIZE(message));
 
     if (render_video_ctx == NULL)
     {
-        error("ERROR: Could not create video render codec context\n");
+        error(message);
         goto rfail;
     }
 
-    render_video_ctx->bit_rate = 0;
-    render_video_ctx->width = movie_params.video_width;
-    render_video_ctx->height = movie_params.video_height;
-    render_video_ctx->time_base = video_q;
-    render_video_ctx->pix_fmt = render_video_info->pixel_format;
-    render_video_ctx->color_primaries = AVCOL_PRI_BT709;
-    render_video_ctx->color_trc = AVCOL_TRC_BT709;
-    render_video_ctx->color_range = AVCOL_RANGE_MPEG;
-    render_video_ctx->colorspace = AVCOL_SPC_BT709;
-
     render_video_stream->time_base = render_video_ctx->time_base;
     render_video_stream->avg_frame_rate = av_inv_q(render_video_ctx->time_base);
 
-    if (render_output_context->oformat->flags & AVFMT_GLOBALHEADER)
+    res = avcodec_parameters_from_context(render_video_stream->codecpar, render_video_ctx);
+
+    if (res < 0)
     {
-        render_video_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        error("ERROR: Could not transfer render video codec parameters to stream (%d)\n", res);
+        goto rfail;
     }
 
-    render_video_ctx->thread_count = 0; // Use all threads.
+    ret = true;
+    goto rexit;
+
+rfail:
 
-    if (render_video_info->setup)
+rexit:
+    return ret;
+}
+
+// Create and open a codec context with the video settings of the movie.
+// With chunk encoding this is also used by the chunk threads, so errors are written to the message instead of using error.
+// The main context is then only used for the stream parameters and never gets a frame.
+AVCodecContext* EncoderState::render_open_video_ctx(bool for_chunk, char* message, s32 message_size)
+{
+    AVCodecContext* ret = NULL;
+    s32 res;
+
+    // Time base for video. Always based in seconds, so 1/60 for example.
+    AVRational video_q = av_make_q(1, movie_params.video_fps);
+
+    const AVCodec* codec = avcodec_find_encoder_by_name(render_video_info->codec_name);
+
+    ret = avcodec_alloc_context3(codec);
+
+    if (ret == NULL)
     {
-        (this->*render_video_info->setup)();
+        stbsp_snprintf(message, message_size, "ERROR: Could not create video render codec context\n");
+        goto rfail;
     }
 
-    res = avcodec_open2(render_video_ctx, codec, NULL);
+    ret->bit_rate = 0;
+    ret->width = movie_params.video_width;
+    ret->height = movie_params.video_height;
+    ret->time_base = video_q;
+    ret->pix_fmt = render_video_info->pixel_format;
+    ret->color_primaries = AVCOL_PRI_BT709;
+    ret->color_trc = AVCOL_TRC_BT709;
+    ret->color_range = AVCOL_RANGE_MPEG;
+    ret->colorspace = AVCOL_SPC_BT709;
 
-    if (res < 0)
+    if (render_output_context->oformat->flags & AVFMT_GLOBALHEADER)
     {
-        error("ERROR: Could not open render video codec (%d)\n", res);
-        goto rfail;
+        ret->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     }
 
-    res = avcodec_parameters_from_context(render_video_stream->codecpar, render_video_ctx);
+    if (render_num_chunk_threads > 0)
+    {
+        // Every chunk is one group of pictures, and the chunk threads share the processor cores.
+        // The main context never encodes anything, so it should not start any encoder threads.
+        ret->gop_size = movie_params.chunk_frames;
+        ret->thread_count = for_chunk ? svr_max(svr_get_num_processors() / render_num_chunk_threads, 1) : 1;
+
+        // Every chunk is encoded by a new codec context, so B-frames would make the decode timestamps of every chunk start
+        // below where the previous chunk ended. Without them the decode timestamps are the same as the frame numbers.
+        ret->max_b_frames = 0;
+    }
+
+    else
+    {
+        ret->thread_count = 0; // Use all threads.
+    }
+
+    if (render_video_info->setup)
+    {
+        (this->*render_video_info->setup)(ret);
+    }
+
+    res = avcodec_open2(ret, codec, NULL);
 
     if (res < 0)
     {
-        error("ERROR: Could not transfer render video codec parameters to stream (%d)\n", res);
+        stbsp_snprintf(message, message_size, "ERROR: Could not open render video codec (%d)\n", res);
         goto rfail;
     }
 
-    ret = true;
     goto rexit;
 
 rfail:
+    avcodec_free_context(&ret);
 
 rexit:
     return ret;
@@ -383,13 +542,16 @@ bool EncoderState::render_init_audio()
 {
     bool ret = false;
     s32 res;
+    s32 hz;
+    AVRational audio_q;
+    const AVCodec* codec = NULL;
 
     if (!render_setup_audio_info())
     {
         goto rfail;
     }
 
-    s32 hz = movie_params.audio_hz;
+    hz = movie_params.audio_hz;
 
     // Set from encoder if it requires a set sample rate.
     if (render_audio_info->hz != 0)
@@ -398,9 +560,9 @@ bool EncoderState::render_init_audio()
     }
 
     // Time base for video. Always based in seconds, so 1/44100 for example.
-    AVRational audio_q = av_make_q(1, hz);
+    audio_q = av_make_q(1, hz);
 
-    const AVCodec* codec = avcodec_find_encoder_by_name(render_audio_info->codec_name);
+    codec = avcodec_find_encoder_by_name(render_audio_info->codec_name);
 
     // Maybe seems silly but this is possible to happen if someone replaces the dlls or something.
     if (codec == NULL)
@@ -494,13 +656,30 @@ rexit:
 
 bool EncoderState::render_check_thread_errors()
 {
-    // Frame thread broke. Nothing more can be submitted.
-    if (svr_atom_load(&render_frame_thread_status) == 0)
+    // Video frame thread broke. Nothing more can be submitted.
+    if (svr_atom_load(&render_video_frame_thread.status) == 0)
     {
-        error(render_frame_thread_message);
+        error(render_video_frame_thread.message);
         return true;
     }
 
+    // Audio frame thread broke. Nothing more can be submitted.
+    if (svr_atom_load(&render_audio_frame_thread.status) == 0)
+    {
+        error(render_audio_frame_thread.message);
+        return true;
+    }
+
+    // Chunk thread broke. Nothing more can be submitted.
+    for (s32 i = 0; i < render_num_chunk_threads; i++)
+    {
+        if (svr_atom_load(&render_chunk_threads[i].status) == 0)
+        {
+            error(render_chunk_threads[i].message);
+            return true;
+        }
+    }
+
     // Packet thread broke. Nothing more can be submitted.
     if (svr_atom_load(&render_packet_thread_status) == 0)
     {
@@ -518,8 +697,9 @@ bool EncoderState::render_check_thread_errors()
     return false;
 }
 
+#ifdef _WIN32
 // The shared game texture has been updated at this point.
-bool EncoderState::render_receive_video()
+bool EncoderState::render_receive_video(VidGameTexture* game_tex)
 {
     bool ret = false;
 
@@ -531,7 +711,9 @@ bool EncoderState::render_receive_video()
     // Submit enough textures so there is enough distance between the write head and the read head.
     // This way we can mitigate the pipeline stalls a bit.
 
-    vid_push_texture_for_conversion();
+    svr_trace_begin("Convert texture");
+    vid_push_texture_for_conversion(game_tex);
+    svr_trace_end();
 
     if (vid_can_map_now())
     {
@@ -547,8 +729,23 @@ rexit:
     return ret;
 }
 
-// The shared audio samples have been updated at this point.
-bool EncoderState::render_receive_audio()
+void EncoderState::render_submit_texture()
+{
+    AVFrame* frame = render_get_new_video_frame();
+    frame->pts = render_video_pts;
+
+    svr_trace_begin("Download");
+    vid_download_texture_into_frame(frame);
+    svr_trace_end();
+
+    render_encode_video_frame(frame);
+
+    render_video_pts++;
+}
+#endif
+
+// The samples are in the audio ring and are only valid during this call.
+bool EncoderState::render_receive_audio(void* samples, s32 num_samples)
 {
     bool ret = false;
 
@@ -557,42 +754,52 @@ bool EncoderState::render_receive_audio()
         goto rfail;
     }
 
+    render_push_audio_samples(samples, num_samples);
+
+    ret = true;
+    goto rexit;
+
+rfail:
+
+rexit:
+    return ret;
+}
+
+// Samples are in the format incoming from svr_game.
+void EncoderState::render_push_audio_samples(void* samples, s32 num_samples)
+{
     // Copy to a new buffer and pass to the audio thread. The audio thread will convert if needed and pass to the encoder.
     // If we don't need to do anything, just pass it along without going through the thread.
 
     if (audio_need_conversion())
     {
-        RenderAudioThreadInput input = render_get_new_audio_buffer(shared_mem_ptr->waiting_audio_samples);
-
-        s32 size = render_get_audio_buffer_size(shared_mem_ptr->waiting_audio_samples);
-        memcpy(input.mem, shared_audio_buffer, size);
+        RenderAudioThreadInput input = render_get_new_audio_buffer(num_samples);
 
-        render_audio_queue.push(&input);
+        s32 size = render_get_audio_buffer_size(num_samples);
+        memcpy(input.mem, samples, size);
 
-        SetEvent(render_audio_wake_event_h); // Notify audio thread.
+        // Audio thread notified through the queue.
+        if (!render_audio_queue.push(&input))
+        {
+            svr_free(input.mem); // Audio thread has stopped.
+        }
     }
 
     else
     {
         RenderAudioThreadInput input = {};
-        input.mem = shared_audio_buffer;
-        input.num_samples = shared_mem_ptr->waiting_audio_samples;
+        input.mem = samples;
+        input.num_samples = num_samples;
 
         render_give_audio_thread_input(&input);
     }
-
-    ret = true;
-    goto rexit;
-
-rfail:
-
-rexit:
-    return ret;
 }
 
 void EncoderState::render_give_audio_thread_input(RenderAudioThreadInput* input)
 {
+    svr_trace_begin("Convert audio");
     audio_convert_to_codec_samples(input);
+    svr_trace_end();
 
     // Must submit everything in the fifo so things don't start drifting away.
     // It's possible that this doesn't do anything in case there aren't enough samples to cover the needed frame size.
@@ -648,27 +855,45 @@ void EncoderState::render_encode_frame_from_audio_fifo(s32 num_samples)
 
 void EncoderState::render_encode_video_frame(AVFrame* frame)
 {
-    render_encode_frame(render_video_ctx, render_video_stream, frame, AVMEDIA_TYPE_VIDEO);
+    // The chunks are given to the chunk threads in turn.
+    if (render_num_chunk_threads > 0)
+    {
+        s64 chunk_idx = frame->pts / movie_params.chunk_frames;
+        render_encode_frame(&render_chunk_threads[chunk_idx % render_num_chunk_threads], frame);
+        return;
+    }
+
+    render_encode_frame(&render_video_frame_thread, frame);
 }
 
 void EncoderState::render_encode_audio_frame(AVFrame* frame)
 {
-    render_encode_frame(render_audio_ctx, render_audio_stream, frame, AVMEDIA_TYPE_AUDIO);
+    render_encode_frame(&render_audio_frame_thread, frame);
 }
 
-void EncoderState::render_encode_frame(AVCodecContext* ctx, AVStream* stream, AVFrame* frame, AVMediaType type)
+void EncoderState::render_encode_frame(RenderFrameThread* ft, AVFrame* frame)
 {
     // Send to frame thread.
+    // Frame thread is notified through the queue.
+    // This will block if the frame thread has too many frames waiting.
+
+    s32 queued = ft->frame_queue.size();
 
-    RenderFrameThreadInput input = {};
-    input.ctx = ctx;
-    input.frame = frame;
-    input.stream = stream;
-    input.type = type;
+    ft->peak_queued = svr_max(ft->peak_queued, queued);
 
-    render_frame_queue.push(&input);
+    if (queued >= (s32)ft->frame_queue.limit)
+    {
+        ft->num_full_waits++;
+    }
+
+    svr_trace_begin(ft->push_scope);
+
+    if (!ft->frame_queue.push(&frame))
+    {
+        av_frame_free(&frame); // Frame thread has stopped.
+    }
 
-    SetEvent(render_frame_wake_event_h); // Notify frame thread.
+    svr_trace_end();
 }
 
 AVFrame* EncoderState::render_get_new_video_frame()
@@ -677,12 +902,13 @@ AVFrame* EncoderState::render_get_new_video_frame()
     s32 res;
 
     // Fast and good if we can reuse.
-    if (render_recycled_video_frames.pull(&ret))
+    if (render_video_frame_thread.recycled_frames.pull(&ret))
     {
         return ret;
     }
 
     ret = av_frame_alloc();
+    render_num_allocated_video_frames++;
 
     if (ret == NULL)
     {
@@ -695,12 +921,25 @@ AVFrame* EncoderState::render_get_new_video_frame()
     ret->height = render_video_ctx->height;
 
     // Allocate buffers for frame.
-    res = av_frame_get_buffer(ret, 0);
+    // Use the same layout as the download textures if we can, so the download is faster.
+    if (vid_frames_pitch_matched)
+    {
+        if (!vid_alloc_frame_planes(ret))
+        {
+            error("ERROR: Could not allocate render video encode frame\n");
+            goto rfail;
+        }
+    }
 
-    if (res < 0)
+    else
     {
-        error("ERROR: Could not allocate render video encode frame\n");
-        goto rfail;
+        res = av_frame_get_buffer(ret, 0);
+
+        if (res < 0)
+        {
+            error("ERROR: Could not allocate render video encode frame\n");
+            goto rfail;
+        }
     }
 
     goto rexit;
@@ -717,12 +956,13 @@ AVFrame* EncoderState::render_get_new_audio_frame()
     s32 res;
 
     // Fast and good if we can reuse.
-    if (render_recycled_audio_frames.pull(&ret))
+    if (render_audio_frame_thread.recycled_frames.pull(&ret))
     {
         return ret;
     }
 
     ret = av_frame_alloc();
+    render_num_allocated_audio_frames++;
 
     if (ret == NULL)
     {
@@ -752,6 +992,40 @@ rexit:
     return ret;
 }
 
+// In video or audio frame thread.
+AVPacket* EncoderState::render_get_new_packet()
+{
+    AVPacket* ret = NULL;
+
+    // Fast and good if we can reuse.
+    if (render_recycled_packets.pull(&ret))
+    {
+        return ret;
+    }
+
+    ret = av_packet_alloc();
+    svr_atom_add(&render_num_allocated_packets, 1);
+
+    return ret;
+}
+
+void EncoderState::render_log_allocations()
+{
+    svr_log("Allocated %d video frames, %d audio frames and %d packets for %lld video frames\n",
+            render_num_allocated_video_frames, render_num_allocated_audio_frames, svr_atom_load(&render_num_allocated_packets), render_video_pts);
+}
+
+// All threads must have finished.
+void EncoderState::render_log_trace()
+{
+    svr_trace_log_stats();
+
+    if (movie_params.write_trace)
+    {
+        svr_trace_write("data/ENCODER_TRACE.json");
+    }
+}
+
 RenderAudioThreadInput EncoderState::render_get_new_audio_buffer(s32 num_samples)
 {
     RenderAudioThreadInput ret = {};
@@ -783,16 +1057,23 @@ void EncoderState::render_free_recycled_stuff()
 {
     AVFrame* frame = NULL;
 
-    while (render_recycled_video_frames.pull(&frame))
+    while (render_video_frame_thread.recycled_frames.pull(&frame))
     {
         av_frame_free(&frame);
     }
 
-    while (render_recycled_audio_frames.pull(&frame))
+    while (render_audio_frame_thread.recycled_frames.pull(&frame))
     {
         av_frame_free(&frame);
     }
 
+    AVPacket* packet = NULL;
+
+    while (render_recycled_packets.pull(&packet))
+    {
+        av_packet_free(&packet);
+    }
+
     RenderAudioThreadInput audio_input = {};
 
     while (render_recycled_audio_buffers.pull(&audio_input))
@@ -819,21 +1100,31 @@ void EncoderState::render_free_lingering_thread_inputs()
         av_packet_free(&packet_input);
     }
 
-    RenderFrameThreadInput frame_input = {};
+    AVFrame* frame_input = NULL;
 
-    while (render_frame_queue.pull(&frame_input))
+    while (render_video_frame_thread.frame_queue.pull(&frame_input))
     {
-        av_frame_free(&frame_input.frame);
+        av_frame_free(&frame_input);
     }
-}
 
-void EncoderState::render_submit_texture()
-{
-    AVFrame* frame = render_get_new_video_frame();
-    frame->pts = render_video_pts;
+    while (render_audio_frame_thread.frame_queue.pull(&frame_input))
+    {
+        av_frame_free(&frame_input);
+    }
 
-    vid_download_texture_into_frame(frame);
-    render_encode_video_frame(frame);
+    for (s32 i = 0; i < render_num_chunk_threads; i++)
+    {
+        RenderFrameThread* ft = &render_chunk_threads[i];
 
-    render_video_pts++;
+        while (ft->frame_queue.pull(&frame_input))
+        {
+            av_frame_free(&frame_input);
+        }
+
+        // The ends of the chunks are NULL.
+        while (ft->chunk_packets.pull(&packet_input))
+        {
+            av_packet_free(&packet_input);
+        }
+    }
 }
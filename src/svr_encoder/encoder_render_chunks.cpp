@@ -0,0 +1,236 @@
+#include "encoder_priv.h"
+
+// Encoding the video in chunks of closed groups of pictures in parallel.
+// A single encoder does not scale to many cores, so the video is split up into chunks of encoder_chunk_frames frames
+// that are encoded by encoder_chunk_threads threads, each with its own codec context that is opened again for every chunk.
+// Chunk N goes to chunk thread N % render_num_chunk_threads, and the packet thread writes the chunks in order.
+// The codec contexts all have the same settings, so the chunks are the same as if they were encoded in one go
+// with a group of pictures of encoder_chunk_frames frames and no B-frames.
+// B-frames are turned off because the delay they add is restarted in every chunk, which would make the decode timestamps
+// go backwards where two chunks meet.
+
+void render_chunk_thread_proc(void* param)
+{
+    RenderFrameThread* ft = (RenderFrameThread*)param;
+
+    const char* name = svr_va("RENDER VIDEO CHUNK THREAD %d", ft->chunk_thread_idx);
+
+    svr_thread_set_name(name);
+    svr_trace_thread_start(name);
+
+    ft->encoder->render_chunk_proc(ft);
+
+    svr_trace_thread_end();
+}
+
+// Create the chunk threads if the movie profile asks for them. Must be called before the video codec is opened.
+void EncoderState::render_create_chunk_threads()
+{
+    render_num_chunk_threads = 0;
+    render_write_chunk_idx = 0;
+
+    // One chunk thread would only make the video worse without doing anything in parallel.
+    if (movie_params.chunk_threads <= 1)
+    {
+        return;
+    }
+
+    render_num_chunk_threads = movie_params.chunk_threads;
+    render_chunk_threads = SVR_ZALLOC_NUM(RenderFrameThread, render_num_chunk_threads);
+
+    for (s32 i = 0; i < render_num_chunk_threads; i++)
+    {
+        RenderFrameThread* ft = &render_chunk_threads[i];
+
+        render_init_frame_thread(ft, "Push video frame", "Encode video frame");
+
+        // Video frames are always created from the recycled frames of the video frame thread.
+        ft->frame_pool = &render_video_frame_thread.recycled_frames;
+        ft->packet_dest = &ft->chunk_packets;
+
+        ft->chunk_packets.init(RENDER_QUEUED_PACKETS);
+
+        ft->encoder = this;
+        ft->chunk_thread_idx = i;
+        ft->chunk_idx = -1;
+
+        svr_atom_store(&ft->status, 1);
+    }
+
+    svr_log("Encoding video in chunks of %d frames with %d threads\n", movie_params.chunk_frames, render_num_chunk_threads);
+}
+
+void EncoderState::render_free_chunk_threads()
+{
+    for (s32 i = 0; i < render_num_chunk_threads; i++)
+    {
+        RenderFrameThread* ft = &render_chunk_threads[i];
+
+        svr_thread_close(&ft->thread);
+
+        render_free_frame_thread(ft);
+        ft->chunk_packets.free();
+    }
+
+    if (render_chunk_threads)
+    {
+        svr_free(render_chunk_threads);
+        render_chunk_threads = NULL;
+    }
+
+    render_num_chunk_threads = 0;
+}
+
+void EncoderState::render_start_chunk_threads()
+{
+    for (s32 i = 0; i < render_num_chunk_threads; i++)
+    {
+        RenderFrameThread* ft = &render_chunk_threads[i];
+
+        // The codec context is opened for every chunk.
+        ft->ctx = NULL;
+        ft->stream = render_video_stream;
+
+        svr_thread_start(&ft->thread, render_chunk_thread_proc, ft);
+    }
+}
+
+// In chunk thread.
+void EncoderState::render_chunk_proc(RenderFrameThread* ft)
+{
+    bool run = true;
+
+    while (run)
+    {
+        ft->frame_queue.wait();
+
+        // Exit thread on external error.
+        if (svr_atom_load(&render_started) == 0)
+        {
+            break;
+        }
+
+        AVFrame* frame = NULL;
+
+        while (ft->frame_queue.pull(&frame))
+        {
+            // Stop on flush frame, after the last chunk has been finished.
+            if (frame == NULL)
+            {
+                run = false;
+
+                if (!render_end_chunk(ft))
+                {
+                    goto rfail;
+                }
+
+                break;
+            }
+
+            s64 chunk_idx = frame->pts / movie_params.chunk_frames;
+
+            if (chunk_idx != ft->chunk_idx)
+            {
+                if (!render_end_chunk(ft))
+                {
+                    ft->frame_pool->push(&frame);
+                    goto rfail;
+                }
+
+                if (!render_begin_chunk(ft, chunk_idx))
+                {
+                    ft->frame_pool->push(&frame);
+                    goto rfail;
+                }
+            }
+
+            if (!render_send_frame(ft, frame))
+            {
+                goto rfail;
+            }
+        }
+    }
+
+    goto rexit;
+
+rfail:
+    svr_atom_store(&ft->status, 0);
+    ft->frame_queue.close(); // Don't let the thread that creates the frames block on us.
+
+rexit:
+    avcodec_free_context(&ft->ctx);
+}
+
+// In chunk thread.
+bool EncoderState::render_begin_chunk(RenderFrameThread* ft, s64 chunk_idx)
+{
+    ft->ctx = render_open_video_ctx(true, ft->message, SVR_ARRAY_SIZE(ft->message));
+
+    if (ft->ctx == NULL)
+    {
+        return false;
+    }
+
+    ft->chunk_idx = chunk_idx;
+    return true;
+}
+
+// In chunk thread.
+// Get the rest of the packets out of the codec and mark the end of the chunk for the packet thread.
+bool EncoderState::render_end_chunk(RenderFrameThread* ft)
+{
+    if (ft->ctx == NULL)
+    {
+        return true;
+    }
+
+    if (!render_send_frame(ft, NULL))
+    {
+        return false;
+    }
+
+    AVPacket* end_packet = NULL;
+    ft->chunk_packets.push(&end_packet);
+    svr_signal_wake(&render_packet_signal); // Notify packet thread.
+
+    avcodec_free_context(&ft->ctx);
+    ft->chunk_idx = -1;
+
+    return true;
+}
+
+// In packet thread.
+// Write the packets of the chunks that are ready, in chunk order.
+bool EncoderState::render_write_chunk_packets()
+{
+    if (render_num_chunk_threads == 0)
+    {
+        return true;
+    }
+
+    while (true)
+    {
+        RenderFrameThread* ft = &render_chunk_threads[render_write_chunk_idx % render_num_chunk_threads];
+
+        AVPacket* packet = NULL;
+
+        if (!ft->chunk_packets.pull(&packet))
+        {
+            break;
+        }
+
+        // End of this chunk, continue with the next chunk which is in the next chunk thread.
+        if (packet == NULL)
+        {
+            render_write_chunk_idx++;
+            continue;
+        }
+
+        if (!render_write_packet(packet))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -1,56 +1,115 @@
 #include "encoder_priv.h"
 
-DWORD CALLBACK render_frame_thread_proc(LPVOID param)
+void render_video_frame_thread_proc(void* param)
 {
-    SetThreadDescription(GetCurrentThread(), L"RENDER FRAME THREAD");
+    svr_thread_set_name("RENDER VIDEO FRAME THREAD");
+    svr_trace_thread_start("RENDER VIDEO FRAME THREAD");
 
     EncoderState* encoder_ptr = (EncoderState*)param;
-    encoder_ptr->render_frame_proc();
+    encoder_ptr->render_frame_proc(&encoder_ptr->render_video_frame_thread);
 
-    return 0; // Not used.
+    svr_trace_thread_end();
 }
 
-DWORD CALLBACK render_packet_thread_proc(LPVOID param)
+void render_audio_frame_thread_proc(void* param)
 {
-    SetThreadDescription(GetCurrentThread(), L"RENDER PACKET THREAD");
+    svr_thread_set_name("RENDER AUDIO FRAME THREAD");
+    svr_trace_thread_start("RENDER AUDIO FRAME THREAD");
+
+    EncoderState* encoder_ptr = (EncoderState*)param;
+    encoder_ptr->render_frame_proc(&encoder_ptr->render_audio_frame_thread);
+
+    svr_trace_thread_end();
+}
+
+void render_packet_thread_proc(void* param)
+{
+    svr_thread_set_name("RENDER PACKET THREAD");
+    svr_trace_thread_start("RENDER PACKET THREAD");
 
     EncoderState* encoder_ptr = (EncoderState*)param;
     encoder_ptr->render_packet_proc();
 
-    return 0; // Not used.
+    svr_trace_thread_end();
 }
 
-DWORD CALLBACK render_audio_thread_proc(LPVOID param)
+void render_audio_thread_proc(void* param)
 {
-    SetThreadDescription(GetCurrentThread(), L"RENDER AUDIO THREAD");
+    svr_thread_set_name("RENDER AUDIO THREAD");
+    svr_trace_thread_start("RENDER AUDIO THREAD");
 
     EncoderState* encoder_ptr = (EncoderState*)param;
     encoder_ptr->render_audio_proc();
 
-    return 0; // Not used.
+    svr_trace_thread_end();
 }
 
 bool EncoderState::render_start_threads()
 {
-    render_frame_thread_h = CreateThread(NULL, 0, render_frame_thread_proc, this, 0, NULL);
-    render_packet_thread_h = CreateThread(NULL, 0, render_packet_thread_proc, this, 0, NULL);
+    if (render_num_chunk_threads > 0)
+    {
+        render_start_chunk_threads();
+    }
+
+    else
+    {
+        render_start_frame_thread(&render_video_frame_thread, render_video_ctx, render_video_stream, render_video_frame_thread_proc);
+    }
+
+    if (render_audio_ctx)
+    {
+        render_start_frame_thread(&render_audio_frame_thread, render_audio_ctx, render_audio_stream, render_audio_frame_thread_proc);
+    }
+
+    svr_thread_start(&render_packet_thread, render_packet_thread_proc, this);
 
     if (audio_need_conversion())
     {
-        render_audio_thread_h = CreateThread(NULL, 0, render_audio_thread_proc, this, 0, NULL);
+        svr_thread_start(&render_audio_thread, render_audio_thread_proc, this);
     }
 
     return true;
 }
 
-// In frame thread.
-void EncoderState::render_frame_proc()
+void EncoderState::render_start_frame_thread(RenderFrameThread* ft, AVCodecContext* ctx, AVStream* stream, SvrThreadProc proc)
+{
+    ft->ctx = ctx;
+    ft->stream = stream;
+    svr_thread_start(&ft->thread, proc, this);
+}
+
+// Send a flush frame to a frame thread and wait for it to finish.
+void EncoderState::render_flush_frame_thread(RenderFrameThread* ft)
+{
+    if (ft->thread.h == NULL)
+    {
+        return;
+    }
+
+    render_encode_frame(ft, NULL);
+
+    svr_thread_wait(&ft->thread); // Wait for frame thread to finish.
+}
+
+void EncoderState::render_log_frame_thread_stats(RenderFrameThread* ft, const char* name)
+{
+    svr_log("Most queued %s frames was %d out of %d, waited for the encoder %d times\n", name, ft->peak_queued, (s32)ft->frame_queue.limit, ft->num_full_waits);
+}
+
+void EncoderState::render_reset_frame_thread_stats(RenderFrameThread* ft)
+{
+    ft->peak_queued = 0;
+    ft->num_full_waits = 0;
+}
+
+// In video or audio frame thread.
+void EncoderState::render_frame_proc(RenderFrameThread* ft)
 {
     bool run = true;
 
     while (run)
     {
-        WaitForSingleObject(render_frame_wake_event_h, INFINITE);
+        ft->frame_queue.wait();
 
         // Exit thread on external error.
         if (svr_atom_load(&render_started) == 0)
@@ -58,83 +117,103 @@ void EncoderState::render_frame_proc()
             break;
         }
 
-        RenderFrameThreadInput input = {};
+        AVFrame* frame = NULL;
 
-        while (render_frame_queue.pull(&input))
+        while (ft->frame_queue.pull(&frame))
         {
-            if (input.frame == NULL)
+            if (frame == NULL)
             {
                 run = false; // Stop on flush frame.
             }
 
-            s32 res = avcodec_send_frame(input.ctx, input.frame);
-
-            // Recycle frames.
-            // We don't want to allocate big frames if we don't have to.
-            // Flush frame must not be reused.
-            if (input.frame)
-            {
-                if (input.type == AVMEDIA_TYPE_VIDEO)
-                {
-                    render_recycled_video_frames.push(&input.frame);
-                }
-
-                if (input.type == AVMEDIA_TYPE_AUDIO)
-                {
-                    render_recycled_audio_frames.push(&input.frame);
-                }
-            }
-
-            if (res < 0)
+            if (!render_send_frame(ft, frame))
             {
-                SVR_SNPRINTF(render_frame_thread_message, "ERROR: Could not send raw frame to encoder (%d)\n", res);
                 goto rfail;
             }
+        }
+    }
 
-            while (res == 0)
-            {
-                AVPacket* packet = av_packet_alloc();
+    goto rexit;
 
-                res = avcodec_receive_packet(input.ctx, packet);
+rfail:
+    svr_atom_store(&ft->status, 0);
+    ft->frame_queue.close(); // Don't let the thread that creates the frames block on us.
 
-                // This will return AVERROR(EAGAIN) when we need to send more data.
-                // This will return AVERROR_EOF when we are sending a flush frame.
-                if (res == AVERROR(EAGAIN) || res == AVERROR_EOF)
-                {
-                    // TODO Should not allocate and then free the packet like this.
-                    av_packet_free(&packet);
-                    break;
-                }
+rexit:
+    return;
+}
 
-                if (res < 0)
-                {
-                    SVR_SNPRINTF(render_frame_thread_message, "ERROR: Could not receive packet from encoder (%d)\n", res);
-                    av_packet_free(&packet);
-                    goto rfail;
-                }
+// In video or audio frame thread, or in chunk thread.
+// Send a frame to the codec and pass on the packets that come out. A NULL frame flushes the codec.
+bool EncoderState::render_send_frame(RenderFrameThread* ft, AVFrame* frame)
+{
+    // Video frames have only been downloaded at this point when converting on the CPU.
+    if (frame && frame->opaque_ref)
+    {
+        svr_trace_begin("Convert video frame");
+        vid_cpu_convert_frame(frame);
+        svr_trace_end();
+    }
 
-                if (res == 0)
-                {
-                    packet->pts = av_rescale_q(packet->pts, input.ctx->time_base, input.stream->time_base);
-                    packet->dts = av_rescale_q(packet->dts, input.ctx->time_base, input.stream->time_base);
-                    packet->duration = av_rescale_q(packet->duration, input.ctx->time_base, input.stream->time_base);
-                    packet->stream_index = input.stream->index;
-
-                    // Send to packet thread.
-                    render_packet_queue.push(&packet);
-                    SetEvent(render_packet_wake_event_h); // Notify packet thread.
-                }
-            }
+    svr_trace_begin(ft->encode_scope);
+
+    s32 res = avcodec_send_frame(ft->ctx, frame);
+
+    // Recycle frames.
+    // We don't want to allocate big frames if we don't have to.
+    // Flush frame must not be reused.
+    if (frame)
+    {
+        ft->frame_pool->push(&frame);
+    }
+
+    if (res < 0)
+    {
+        SVR_SNPRINTF(ft->message, "ERROR: Could not send raw frame to encoder (%d)\n", res);
+        goto rfail;
+    }
+
+    while (res == 0)
+    {
+        AVPacket* packet = render_get_new_packet();
+
+        res = avcodec_receive_packet(ft->ctx, packet);
+
+        // This will return AVERROR(EAGAIN) when we need to send more data.
+        // This will return AVERROR_EOF when we are sending a flush frame.
+        // Nothing was written to the packet so it can be given back as is.
+        if (res == AVERROR(EAGAIN) || res == AVERROR_EOF)
+        {
+            render_recycled_packets.push(&packet);
+            break;
+        }
+
+        if (res < 0)
+        {
+            SVR_SNPRINTF(ft->message, "ERROR: Could not receive packet from encoder (%d)\n", res);
+            av_packet_free(&packet);
+            goto rfail;
+        }
+
+        if (res == 0)
+        {
+            packet->pts = av_rescale_q(packet->pts, ft->ctx->time_base, ft->stream->time_base);
+            packet->dts = av_rescale_q(packet->dts, ft->ctx->time_base, ft->stream->time_base);
+            packet->duration = av_rescale_q(packet->duration, ft->ctx->time_base, ft->stream->time_base);
+            packet->stream_index = ft->stream->index;
+
+            // Send to packet thread.
+            ft->packet_dest->push(&packet);
+            svr_signal_wake(&render_packet_signal); // Notify packet thread.
         }
     }
 
-    goto rexit;
+    svr_trace_end();
+    return true;
 
 rfail:
-    svr_atom_store(&render_frame_thread_status, 0);
-
-rexit:
-    return;
+    svr_trace_end();
+    return false;
 }
 
 // In packet thread.
@@ -144,7 +223,8 @@ void EncoderState::render_packet_proc()
 
     while (run)
     {
-        WaitForSingleObject(render_packet_wake_event_h, INFINITE);
+        // Must be read before the queue, so packets that are pushed after we have looked are not missed.
+        s32 seen_count = svr_signal_get(&render_packet_signal);
 
         // Exit thread on external error.
         if (svr_atom_load(&render_started) == 0)
@@ -159,18 +239,29 @@ void EncoderState::render_packet_proc()
             if (packet == NULL)
             {
                 run = false; // Stop on flush packet.
-            }
 
-            s32 res = av_interleaved_write_frame(render_output_context, packet);
-
-            av_packet_free(&packet);
+                // The chunk threads have all finished before the flush, so the rest of the chunks must be written before the container is flushed.
+                if (!render_write_chunk_packets())
+                {
+                    goto rfail;
+                }
+            }
 
-            if (res < 0)
+            if (!render_write_packet(packet))
             {
-                SVR_SNPRINTF(render_packet_thread_message, "ERROR: Could not write encoded packet to container (%d)\n", res);
                 goto rfail;
             }
         }
+
+        if (!render_write_chunk_packets())
+        {
+            goto rfail;
+        }
+
+        if (run)
+        {
+            svr_signal_wait(&render_packet_signal, seen_count);
+        }
     }
 
     goto rexit;
@@ -182,6 +273,31 @@ rexit:
     return;
 }
 
+// In packet thread.
+bool EncoderState::render_write_packet(AVPacket* packet)
+{
+    svr_trace_begin("Write");
+    s32 res = av_interleaved_write_frame(render_output_context, packet);
+    svr_trace_end();
+
+    // Recycle packets.
+    // The container takes the packet data, so this only gives back the empty packet.
+    // Flush packet must not be reused.
+    if (packet)
+    {
+        av_packet_unref(packet);
+        render_recycled_packets.push(&packet);
+    }
+
+    if (res < 0)
+    {
+        SVR_SNPRINTF(render_packet_thread_message, "ERROR: Could not write encoded packet to container (%d)\n", res);
+        return false;
+    }
+
+    return true;
+}
+
 // In audio thread.
 void EncoderState::render_audio_proc()
 {
@@ -189,7 +305,7 @@ void EncoderState::render_audio_proc()
 
     while (run)
     {
-        WaitForSingleObject(render_audio_wake_event_h, INFINITE);
+        render_audio_queue.wait();
 
         // Exit thread on external error.
         if (svr_atom_load(&render_started) == 0)
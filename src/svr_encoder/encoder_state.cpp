@@ -1,234 +1,35 @@
 #include "encoder_priv.h"
 
-bool EncoderState::init(HANDLE in_shared_mem_h)
-{
-    bool ret = false;
-
-    main_thread_id = GetCurrentThreadId();
-
-    shared_mem_h = in_shared_mem_h;
-
-    // At this point, the shared memory will already have some data already filled in.
-    shared_mem_ptr = (EncoderSharedMem*)MapViewOfFile(shared_mem_h, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
-
-    if (shared_mem_ptr == NULL)
-    {
-        error("ERROR: Could not view encoder shared memory (%lu)\n", GetLastError());
-        goto rfail;
-    }
-
-    game_wake_event_h = (HANDLE)shared_mem_ptr->game_wake_event_h;
-    encoder_wake_event_h = (HANDLE)shared_mem_ptr->encoder_wake_event_h;
-    shared_audio_buffer = (u8*)shared_mem_ptr + shared_mem_ptr->audio_buffer_offset;
-
-    game_process = OpenProcess(SYNCHRONIZE, FALSE, shared_mem_ptr->game_pid);
-
-    if (game_process == NULL)
-    {
-        error("ERROR: Could not open game process (%lu)\n", GetLastError());
-        goto rfail;
-    }
-
-    if (!vid_init())
-    {
-        goto rfail;
-    }
-
-    if (!audio_init())
-    {
-        goto rfail;
-    }
-
-    if (!render_init())
-    {
-        goto rfail;
-    }
-
-    ret = true;
-    goto rexit;
-
-rfail:
-    free_static();
-
-rexit:
-    return ret;
-}
-
-void EncoderState::start_event()
-{
-    svr_log("Starting encoder\n");
-
-    // The movie parameters in the shared memory won't change after this point, but we
-    // want to have our own copy either way.
-    movie_params = shared_mem_ptr->movie_params;
-
-    if (!render_start())
-    {
-        goto rfail;
-    }
-
-    if (!vid_start())
-    {
-        goto rfail;
-    }
-
-    if (movie_params.use_audio)
-    {
-        if (!audio_start())
-        {
-            goto rfail;
-        }
-    }
-
-    if (render_video_info)
-    {
-        svr_log("Using video encoder %s\n", render_video_info->profile_name);
-    }
-
-    if (render_audio_info)
-    {
-        svr_log("Using audio encoder %s\n", render_audio_info->profile_name);
-    }
-
-    goto rexit;
-
-rfail:
-    free_dynamic();
-
-rexit:
-    return;
-}
-
-void EncoderState::stop_event()
-{
-    svr_log("Ending encoder\n");
-
-    free_dynamic();
-}
-
-void EncoderState::new_video_frame_event()
-{
-    if (!render_receive_video())
-    {
-        free_dynamic();
-    }
-}
-
-void EncoderState::new_audio_samples_event()
-{
-    if (!render_receive_audio())
-    {
-        free_dynamic();
-    }
-}
-
-// Event reading from svr_game.
-void EncoderState::event_loop()
-{
-    svr_log("Encoder ready\n");
-
-    HANDLE handles[] =
-    {
-        game_process,
-        encoder_wake_event_h,
-    };
-
-    while (true)
-    {
-        DWORD waited = WaitForMultipleObjects(SVR_ARRAY_SIZE(handles), handles, FALSE, INFINITE);
-        HANDLE waited_h = handles[waited - WAIT_OBJECT_0];
-
-        // Game exited or crashed or something.
-        // If we were recording, we did not get the stop command, so just stop as if we got it.
-        // This will exit this process too.
-        if (waited_h == game_process)
-        {
-            if (svr_atom_load(&render_started))
-            {
-                svr_log("Game exited without telling the encoder, ending movie\n");
-
-                stop_event();
-            }
-
-            break;
-        }
-
-        // We are woken up here because svr_game wants us to do something.
-        // Any code in here needs to be fast because the game is frozen at this point.
-        // Forward relevant stuff to the actual encoder thread.
-        if (waited_h == encoder_wake_event_h)
-        {
-            // Clear out any error from previous calls.
-            shared_mem_ptr->error = 0;
-            shared_mem_ptr->error_message[0] = 0;
-
-            switch (shared_mem_ptr->event_type)
-            {
-                case ENCODER_EVENT_START:
-                {
-                    start_event();
-                    break;
-                }
-
-                case ENCODER_EVENT_STOP:
-                {
-                    stop_event();
-                    break;
-                }
-
-                case ENCODER_EVENT_NEW_VIDEO:
-                {
-                    new_video_frame_event();
-                    break;
-                }
-
-                case ENCODER_EVENT_NEW_AUDIO:
-                {
-                    new_audio_samples_event();
-                    break;
-                }
-            }
-
-            // Notify svr_game that we handled this event.
-            // We go back to sleep after this, which puts us in a known paused state.
-            SetEvent(game_wake_event_h);
-        }
-    }
-
-    svr_log("Encoder finished\n");
-}
-
 void EncoderState::free_static()
 {
-    svr_maybe_close_handle(&game_process);
-    svr_maybe_close_handle(&shared_mem_h);
-
-    if (shared_mem_ptr)
-    {
-        UnmapViewOfFile(shared_mem_ptr);
-        shared_mem_ptr = NULL;
-        shared_audio_buffer = NULL;
-    }
-
-    svr_maybe_close_handle(&game_wake_event_h);
-    svr_maybe_close_handle(&encoder_wake_event_h);
+#ifdef _WIN32
+    game_free_static();
+#endif
 
     render_free_static();
+
+#ifdef _WIN32
     vid_free_static();
+#endif
+
     audio_free_static();
 }
 
 void EncoderState::free_dynamic()
 {
     render_free_dynamic();
+
+#ifdef _WIN32
     vid_free_dynamic();
+#endif
+
     audio_free_dynamic();
 }
 
 void EncoderState::error(const char* format, ...)
 {
     // Must only be called by the main thread because the shared memory can only be written by the main thread.
-    assert(GetCurrentThreadId() == main_thread_id);
+    assert(svr_get_thread_id() == main_thread_id);
 
     // Set this early so we don't try to flush the encoders or something.
     // If we have an error then we must stop right now, and not try to process any more data.
@@ -236,10 +37,19 @@ void EncoderState::error(const char* format, ...)
 
     va_list va;
     va_start(va, format);
+
+    // There is no game to show the error to when running the benchmark.
+    if (shared_mem_ptr == NULL)
+    {
+        svr_log_v(format, va);
+        va_end(va);
+        return;
+    }
+
     SVR_VSNPRINTF(shared_mem_ptr->error_message, format, va);
     va_end(va);
 
-    // Set error which svr_game will read after we return.
+    // Set error which svr_game will read after we return, or when it sends the next video frame.
     // Error message has been written to the shared memory through the error function.
-    shared_mem_ptr->error = 1;
+    svr_atom_store(&shared_mem_ptr->error, 1);
 }
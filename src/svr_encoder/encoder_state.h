@@ -5,18 +5,14 @@ const s32 RENDER_QUEUED_PACKETS = 8192; // Max number of compressed AVPacket* to
 const s32 VID_QUEUED_TEXTURES = 16; // Max number of converted uncompressed frames to store in RAM before encode.
 const s32 RENDER_QUEUED_AUDIO_BUFFERS = 8192; // Max number of audio buffers to queue up for conversion and encoding.
 const s32 VID_MAX_PLANES = 3; // At most, YUV uses 3 planes.
+const s32 VID_PLANE_ALIGN = 64; // Alignment of video frame planes. Codecs want this for their SIMD and the downloads copy this much per iteration.
 const s32 AUDIO_MAX_CHANS = 8;
+const s32 BENCH_NUM_SOURCE_FRAMES = 16; // Different frames to cycle through in the benchmark.
 
 struct RenderVideoInfo;
 struct RenderAudioInfo;
-
-struct RenderFrameThreadInput
-{
-    AVCodecContext* ctx;
-    AVFrame* frame;
-    AVStream* stream;
-    AVMediaType type;
-};
+struct VidCpuKernel;
+struct EncoderState;
 
 struct RenderAudioThreadInput
 {
@@ -24,36 +20,102 @@ struct RenderAudioThreadInput
     s32 num_samples; // How many samples there actually are.
 };
 
+#ifdef _WIN32
+// One of the textures that svr_game writes video frames to (see encoder_shared.h).
+struct VidGameTexture
+{
+    HANDLE h;
+    ID3D11Texture2D* tex;
+    ID3D11ShaderResourceView* srv;
+    IDXGIKeyedMutex* lock;
+};
+
 struct VidTextureDownloadInput
 {
     ID3D11Texture2D* dl_texs[VID_MAX_PLANES]; // In system memory.
 };
+#endif
+
+// State for a thread that sends uncompressed frames to a codec and receives compressed packets.
+// Video and audio have one thread each, so a slow video frame does not hold up the audio frames queued behind it.
+struct RenderFrameThread
+{
+    SvrThread thread;
+
+    AVCodecContext* ctx;
+    AVStream* stream;
+
+    // Uncompressed frames ready to be encoded.
+    // Written to by the thread that creates the frames, read by this thread.
+    // Only one thread creates frames at a time, so this does not need a lock. This thread is woken through the queue.
+    // Order matters.
+    SvrSpscQueue<AVFrame*> frame_queue;
+
+    // Frames that have been encoded.
+    // Written to by this thread, read by the thread that creates the frames.
+    // Order doesn't matter.
+    SvrLockedArray<AVFrame*> recycled_frames;
+
+    // Where encoded frames are given back to. This is recycled_frames, except for the chunk threads which give their frames
+    // to the video frame thread so there is one place to take video frames from.
+    SvrLockedArray<AVFrame*>* frame_pool;
+
+    // Where encoded packets are sent. This is render_packet_queue, except for the chunk threads which use chunk_packets.
+    SvrLockedQueue<AVPacket*>* packet_dest;
+
+    // Queue occupancy, written by the thread that creates the frames. Logged when rendering stops.
+    s32 peak_queued; // Most frames that were waiting at once.
+    s32 num_full_waits; // How many times the queue was at its limit and we had to wait for this thread.
+
+    // Trace scope names (see svr_trace.h).
+    const char* push_scope; // Pushing to the queue, in the thread that creates the frames.
+    const char* encode_scope; // Sending frames and receiving packets, in this thread.
+
+    SvrAtom32 status; // Will be set to 0 by this thread if it failed. Message will be in message.
+    char message[256]; // Error message for this thread.
+
+    // Chunk threads only (see encoder_render_chunks.cpp):
+
+    EncoderState* encoder;
+    s32 chunk_thread_idx;
+    s64 chunk_idx; // Chunk that ctx is encoding, or -1 when no codec context is open.
+
+    // Packets of the chunks of this thread in order, with NULL after the last packet of every chunk.
+    // Written to by this thread, read by the packet thread.
+    // Order matters.
+    SvrLockedQueue<AVPacket*> chunk_packets;
+};
 
 struct EncoderState
 {
     // -----------------------------------------------
     // Game and program state:
 
-    EncoderSharedMem* shared_mem_ptr;
+    EncoderSharedMem* shared_mem_ptr; // NULL when running the benchmark.
+    void* shared_audio_buffer; // The audio ring that svr_game writes the audio samples to (see encoder_shared.h).
+
+    u32 main_thread_id;
+
+    EncoderSharedMovieParams movie_params; // Copied from the shared memory on movie start.
+
+#ifdef _WIN32
+    // Talking to svr_game, see encoder_game.cpp.
 
     HANDLE game_process;
     HANDLE shared_mem_h;
     HANDLE game_wake_event_h;
     HANDLE encoder_wake_event_h;
-    HANDLE game_texture_h;
-    void* shared_audio_buffer; // Where svr_game will put the audio samples.
-
-    DWORD main_thread_id;
-
-    EncoderSharedMovieParams movie_params; // Copied from the shared memory on movie start.
 
     bool init(HANDLE in_shared_mem_h);
 
     void start_event();
     void stop_event();
-    void new_video_frame_event();
-    void new_audio_samples_event();
+    void new_video_frame_event(VidGameTexture* game_tex);
+    void receive_audio_samples();
+    void receive_video_frames();
     void event_loop();
+    void game_free_static();
+#endif
 
     void free_static();
     void free_dynamic();
@@ -76,49 +138,49 @@ struct EncoderState
     // The threads start when rendering starts, and stop when rendering stops.
     // This makes it really easy to synchronize when stopping.
 
-    // Frame thread:
-
-    SVR_THREAD_PADDING();
-
-    HANDLE render_frame_thread_h; // Thread used to process uncompressed video frames and audio samples.
+    // How many of each thing that has been allocated during the movie. Logged when rendering stops.
+    // These should stop going up once the encoding is in a steady state and everything is being recycled.
+    s32 render_num_allocated_video_frames; // Written by the main thread.
+    s32 render_num_allocated_audio_frames; // Written by the main thread or the audio thread.
+    SvrAtom32 render_num_allocated_packets; // Written by both frame threads.
 
-    // Event set by the main and audio threads to notify that there are new frames to encode.
-    HANDLE render_frame_wake_event_h;
+    // Frame threads:
 
-    // Uncompressed frames and samples ready to be encoded.
-    // Written to by the main and audio threads, read by the frame thread.
-    // Order matters.
-    SvrLockedQueue<RenderFrameThreadInput> render_frame_queue;
+    SVR_THREAD_PADDING();
 
-    // Video frames that have been encoded.
-    // Written to by the frame thread, read by the main thread.
-    // Order doesn't matter.
-    SvrLockedArray<AVFrame*> render_recycled_video_frames;
+    // Thread used to encode uncompressed video frames.
+    // Frames are written by the main thread.
+    RenderFrameThread render_video_frame_thread;
 
-    // Audio frames that have been encoded.
-    // Written to by the frame thread, read by the main thread.
-    // Order doesn't matter.
-    SvrLockedArray<AVFrame*> render_recycled_audio_frames;
+    SVR_THREAD_PADDING();
 
-    SvrAtom32 render_frame_thread_status; // Will be set to 0 by frame thread if it failed. Message will be in render_frame_thread_message.
-    char render_frame_thread_message[256]; // Error message for the frame thread.
+    // Thread used to encode uncompressed audio frames.
+    // Frames are written by the audio thread when the audio is converted, otherwise by the main thread.
+    // The queue only allows one writer, so the main thread only flushes the audio fifo after the audio thread has stopped.
+    RenderFrameThread render_audio_frame_thread;
 
     // Packet thread:
 
     SVR_THREAD_PADDING();
 
-    HANDLE render_packet_thread_h; // Thread used to process encoded packets for writing to the container.
+    SvrThread render_packet_thread; // Thread used to process encoded packets for writing to the container.
 
-    // Event set by the frame thread to notify that there are encoded packets to write.
-    // When rendering stops, this will be set by the main thread instead.
-    HANDLE render_packet_wake_event_h;
+    // Woken by the frame threads to notify that there are encoded packets to write.
+    // When rendering stops, this will be woken by the main thread instead.
+    SvrSignal render_packet_signal;
 
     // Compressed packets ready to be written.
-    // Written to by the frame thread, read by the packet thread.
+    // Written to by both frame threads, read by the packet thread.
+    // Packets of the same stream are in order, and the container interleaves the streams.
     // When rendering stops, this will be written to by the main thread instead.
     // Order matters.
     SvrLockedQueue<AVPacket*> render_packet_queue;
 
+    // Packets that have been written.
+    // Written to by the packet thread, read by both frame threads.
+    // Order doesn't matter.
+    SvrLockedArray<AVPacket*> render_recycled_packets;
+
     SvrAtom32 render_packet_thread_status; // Will be set to 0 by packet thread if it failed. Message will be in render_packet_thread_message.
     char render_packet_thread_message[256]; // Error message for the packet thread.
 
@@ -126,15 +188,13 @@ struct EncoderState
 
     SVR_THREAD_PADDING();
 
-    HANDLE render_audio_thread_h; // Thread used to process incoming audio buffers for conversion and encoding.
-
-    // Event set by the main thread to notify that there are new audio buffers to process.
-    HANDLE render_audio_wake_event_h;
+    SvrThread render_audio_thread; // Thread used to process incoming audio buffers for conversion and encoding.
 
     // Uncompressed audio samples ready to be converted and encoded.
     // Written to by the main thread, read by the audio thread.
+    // The audio thread is woken through the queue.
     // Order matters.
-    SvrLockedQueue<RenderAudioThreadInput> render_audio_queue;
+    SvrSpscQueue<RenderAudioThreadInput> render_audio_queue;
 
     // Raw audio buffers.
     // Written to by the audio thread, read by the main thread.
@@ -144,6 +204,17 @@ struct EncoderState
     SvrAtom32 render_audio_thread_status; // Will be set to 0 by audio thread if it failed. Message will be in render_audio_thread_message.
     char render_audio_thread_message[256]; // Error message for the audio thread.
 
+    // Chunk threads:
+    // With chunk encoding (EncoderSharedMovieParams::chunk_threads), the video is cut into chunks of a fixed number of frames
+    // that are encoded at the same time on separate codec contexts, instead of on the video frame thread which is then not started.
+    // Chunk N is encoded by chunk thread N % render_num_chunk_threads, and the packet thread writes the chunks in order.
+
+    SVR_THREAD_PADDING();
+
+    RenderFrameThread* render_chunk_threads;
+    s32 render_num_chunk_threads; // 0 when the video is not encoded in chunks.
+    s64 render_write_chunk_idx; // Next chunk for the packet thread to write.
+
     SVR_THREAD_PADDING();
 
     const RenderVideoInfo* render_video_info;
@@ -166,50 +237,94 @@ struct EncoderState
     bool render_start_threads();
     void render_free_static();
     void render_free_dynamic();
-    void render_frame_proc();
+    void render_init_frame_thread(RenderFrameThread* ft, const char* push_scope, const char* encode_scope);
+    void render_free_frame_thread(RenderFrameThread* ft);
+    void render_start_frame_thread(RenderFrameThread* ft, AVCodecContext* ctx, AVStream* stream, SvrThreadProc proc);
+    void render_flush_frame_thread(RenderFrameThread* ft);
+    void render_log_frame_thread_stats(RenderFrameThread* ft, const char* name);
+    void render_reset_frame_thread_stats(RenderFrameThread* ft);
+    void render_setup_video_frame_limit();
+    void render_frame_proc(RenderFrameThread* ft);
+    bool render_send_frame(RenderFrameThread* ft, AVFrame* frame);
     void render_packet_proc();
+    bool render_write_packet(AVPacket* packet);
+    void render_create_chunk_threads();
+    void render_free_chunk_threads();
+    void render_start_chunk_threads();
+    void render_chunk_proc(RenderFrameThread* ft);
+    bool render_begin_chunk(RenderFrameThread* ft, s64 chunk_idx);
+    bool render_end_chunk(RenderFrameThread* ft);
+    bool render_write_chunk_packets();
     void render_audio_proc();
     bool render_setup_video_info();
     bool render_setup_audio_info();
     bool render_init_output_context();
     bool render_init_video();
+    AVCodecContext* render_open_video_ctx(bool for_chunk, char* message, s32 message_size);
     bool render_init_audio();
     bool render_check_thread_errors();
-    bool render_receive_video();
-    bool render_receive_audio();
+    bool render_receive_audio(void* samples, s32 num_samples);
+    void render_push_audio_samples(void* samples, s32 num_samples);
     void render_give_audio_thread_input(RenderAudioThreadInput* input);
     void render_flush_audio_fifo();
     void render_submit_audio_fifo();
     void render_encode_frame_from_audio_fifo(s32 num_samples);
     void render_encode_video_frame(AVFrame* frame);
     void render_encode_audio_frame(AVFrame* frame);
-    void render_encode_frame(AVCodecContext* ctx, AVStream* stream, AVFrame* frame, AVMediaType type);
+    void render_encode_frame(RenderFrameThread* ft, AVFrame* frame);
+    AVPacket* render_get_new_packet();
+    void render_log_allocations();
+    void render_log_trace();
     AVFrame* render_get_new_video_frame();
     AVFrame* render_get_new_audio_frame();
     RenderAudioThreadInput render_get_new_audio_buffer(s32 num_samples);
     s32 render_get_audio_buffer_size(s32 num_samples);
     void render_free_recycled_stuff();
     void render_free_lingering_thread_inputs();
+
+#ifdef _WIN32
+    bool render_receive_video(VidGameTexture* game_tex);
     void render_submit_texture();
+#endif
 
-    void render_setup_dnxhr();
-    void render_setup_libx264();
+    void render_setup_dnxhr(AVCodecContext* ctx);
+    void render_setup_libx264(AVCodecContext* ctx);
 
     // -----------------------------------------------
     // Video state:
 
+    s32 vid_num_planes;
+    s32 vid_plane_heights[VID_MAX_PLANES];
+
+    // Row pitch of the download textures.
+    // If these are aligned well enough, the video frames are allocated with the same layout so each plane can be downloaded with one copy.
+    s32 vid_plane_pitches[VID_MAX_PLANES];
+    bool vid_frames_pitch_matched;
+
+    // When converting on the CPU, the game texture is downloaded as is and the video frame thread converts it.
+    // The download queue then only uses the first download texture of each entry, which is in the game texture format.
+    // Every video frame has a buffer for the downloaded pixels in opaque_ref.
+    bool vid_cpu_conversion;
+    s32 vid_cpu_pitch; // Row pitch of the download textures, and of the pixel buffer in the video frames.
+    const VidCpuKernel* vid_cpu_kernel;
+
+    AVBufferRef* vid_alloc_aligned_buffer(s32 size);
+    bool vid_alloc_frame_planes(AVFrame* frame);
+    void vid_cpu_start();
+    void vid_cpu_convert_frame(AVFrame* frame);
+
+#ifdef _WIN32
+    // Getting the video frames out of the game textures, see encoder_video.cpp.
+
     ID3D11Device1* vid_d3d11_device;
     ID3D11DeviceContext* vid_d3d11_context;
     void* vid_shader_mem;
     s32 vid_shader_size;
 
-    ID3D11Texture2D* vid_game_tex; // Texture that svr_game updates.
-    ID3D11ShaderResourceView* vid_game_tex_srv;
-    IDXGIKeyedMutex* vid_game_tex_lock;
+    VidGameTexture vid_game_texs[ENCODER_NUM_VIDEO_TEXTURES]; // Textures that svr_game writes video frames to.
+    s32 vid_game_read_idx; // How many video frames we have taken from svr_game.
 
     ID3D11ComputeShader* vid_conversion_cs;
-    s32 vid_num_planes;
-    s32 vid_plane_heights[VID_MAX_PLANES];
 
     ID3D11ComputeShader* vid_nv12_cs;
     ID3D11ComputeShader* vid_yuv422_cs;
@@ -237,13 +352,18 @@ struct EncoderState
     bool vid_load_shader(const char* name);
     bool vid_create_shader(const char* name, void** shader, D3D11_SHADER_TYPE type);
     bool vid_start();
-    bool vid_open_game_texture();
+    bool vid_open_game_textures();
+    bool vid_open_game_texture(VidGameTexture* game_tex);
     void vid_create_conversion_texs();
-    void vid_push_texture_for_conversion();
+    void vid_push_texture_for_conversion(VidGameTexture* game_tex);
+    void vid_create_cpu_download_texs();
+    void vid_find_plane_pitches();
+    s32 vid_find_download_pitch(ID3D11Texture2D* tex);
     void vid_download_texture_into_frame(AVFrame* dest_frame);
     bool vid_can_map_now();
     bool vid_drain_textures();
     s32 vid_get_num_cs_threads(s32 unit);
+#endif
 
     // -----------------------------------------------
     // Audio state:
@@ -269,6 +389,33 @@ struct EncoderState
     void audio_copy_samples_to_frame(AVFrame* dest_frame, s32 num_samples);
     s32 audio_num_queued_samples();
     bool audio_need_conversion();
+
+    // -----------------------------------------------
+    // Benchmark state:
+
+    s32 bench_num_frames;
+    s32 bench_width;
+    s32 bench_height;
+
+    u8* bench_source_frames[BENCH_NUM_SOURCE_FRAMES]; // BGRA, same layout as the downloaded frames.
+    s16* bench_audio_samples; // One second of interleaved samples in the format incoming from svr_game.
+
+    s64 bench_peak_mem; // Highest working set during the current run.
+
+    s32 bench_run(s32 argc, char** argv);
+    void bench_log(const char* format, ...);
+    void bench_create_sources();
+    void bench_free_sources();
+    void bench_queues();
+    void bench_wake_latency();
+    void bench_cpu_kernels();
+    void bench_mosample();
+    void bench_mosample_yuv();
+    void bench_scan();
+    void bench_audio_pack();
+    void bench_video_encoder(const RenderVideoInfo* info, const char* x264_preset, const char* dnxhr_profile);
+    void bench_setup_video();
+    void bench_sample_memory();
 };
 
 struct RenderVideoInfo
@@ -278,8 +425,8 @@ struct RenderVideoInfo
     AVPixelFormat pixel_format; // An encoder may support several pixel formats, so we select the one we like the most.
 
     // Set state according to the movie profile.
-    // This is called before the codec is opened.
-    void(EncoderState::*setup)();
+    // This is called before the codec is opened. With chunk encoding this is called for every codec context.
+    void(EncoderState::*setup)(AVCodecContext* ctx);
 };
 
 struct RenderAudioInfo
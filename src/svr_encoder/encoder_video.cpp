@@ -127,29 +127,39 @@ void EncoderState::vid_free_static()
 
 void EncoderState::vid_free_dynamic()
 {
-    svr_maybe_close_handle(&game_texture_h);
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
+    {
+        VidGameTexture* game_tex = &vid_game_texs[i];
 
-    svr_maybe_release(&vid_game_tex);
-    svr_maybe_release(&vid_game_tex_srv);
-    svr_maybe_release(&vid_game_tex_lock);
+        svr_maybe_close_handle(&game_tex->h);
+        svr_maybe_release(&game_tex->tex);
+        svr_maybe_release(&game_tex->srv);
+        svr_maybe_release(&game_tex->lock);
+    }
 
     for (s32 i = 0; i < VID_MAX_PLANES; i++)
     {
         svr_maybe_release(&vid_converted_texs[i]);
     }
 
-    for (s32 i = 0; i < VID_QUEUED_TEXTURES; i++)
+    // Not created when running the benchmark.
+    if (vid_texture_download_queue)
     {
-        VidTextureDownloadInput* inp = &vid_texture_download_queue[i];
-
-        for (s32 j = 0; j < VID_MAX_PLANES; j++)
+        for (s32 i = 0; i < VID_QUEUED_TEXTURES; i++)
         {
-            svr_maybe_release(&inp->dl_texs[j]);
+            VidTextureDownloadInput* inp = &vid_texture_download_queue[i];
+
+            for (s32 j = 0; j < VID_MAX_PLANES; j++)
+            {
+                svr_maybe_release(&inp->dl_texs[j]);
+            }
         }
     }
 
     vid_conversion_cs = NULL;
     vid_num_planes = 0;
+    vid_frames_pitch_matched = false;
+    vid_cpu_conversion = false;
 }
 
 bool EncoderState::vid_load_shader(const char* name)
@@ -233,11 +243,20 @@ bool EncoderState::vid_start()
 {
     bool ret = false;
 
-    if (!vid_open_game_texture())
+    if (!vid_open_game_textures())
     {
         goto rfail;
     }
 
+    vid_game_read_idx = 0;
+
+    vid_cpu_conversion = movie_params.cpu_conversion;
+
+    if (vid_cpu_conversion)
+    {
+        vid_cpu_start();
+    }
+
     vid_create_conversion_texs();
 
     render_download_write_idx = 0;
@@ -252,12 +271,31 @@ rexit:
     return ret;
 }
 
-bool EncoderState::vid_open_game_texture()
+bool EncoderState::vid_open_game_textures()
+{
+    // The handles were duplicated to us by svr_game so we must close them.
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
+    {
+        vid_game_texs[i].h = (HANDLE)shared_mem_ptr->game_texture_hs[i];
+    }
+
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
+    {
+        if (!vid_open_game_texture(&vid_game_texs[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool EncoderState::vid_open_game_texture(VidGameTexture* game_tex)
 {
     bool ret = false;
     HRESULT hr;
 
-    hr = vid_d3d11_device->OpenSharedResource1((HANDLE)shared_mem_ptr->game_texture_h, IID_PPV_ARGS(&vid_game_tex));
+    hr = vid_d3d11_device->OpenSharedResource1(game_tex->h, IID_PPV_ARGS(&game_tex->tex));
 
     if (FAILED(hr))
     {
@@ -265,9 +303,9 @@ bool EncoderState::vid_open_game_texture()
         goto rfail;
     }
 
-    vid_d3d11_device->CreateShaderResourceView(vid_game_tex, NULL, &vid_game_tex_srv);
+    vid_d3d11_device->CreateShaderResourceView(game_tex->tex, NULL, &game_tex->srv);
 
-    vid_game_tex->QueryInterface(IID_PPV_ARGS(&vid_game_tex_lock));
+    game_tex->tex->QueryInterface(IID_PPV_ARGS(&game_tex->lock));
 
     ret = true;
     goto rexit;
@@ -281,6 +319,7 @@ rexit:
 struct VidPlaneDesc
 {
     DXGI_FORMAT format;
+    s32 bytes_per_px;
     s32 shift_x;
     s32 shift_y;
 };
@@ -297,8 +336,8 @@ void EncoderState::vid_create_conversion_texs()
             vid_conversion_cs = vid_nv12_cs;
             vid_num_planes = 2;
 
-            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 0, 0 };
-            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8G8_UINT, 1, 1 };
+            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0, 0 };
+            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8G8_UINT, 2, 1, 1 };
             break;
         }
 
@@ -307,9 +346,9 @@ void EncoderState::vid_create_conversion_texs()
             vid_conversion_cs = vid_yuv422_cs;
             vid_num_planes = 3;
 
-            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 0, 0 };
-            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0 };
-            plane_descs[2] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0 };
+            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0, 0 };
+            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 1, 0 };
+            plane_descs[2] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 1, 0 };
             break;
         }
 
@@ -318,9 +357,9 @@ void EncoderState::vid_create_conversion_texs()
             vid_conversion_cs = vid_yuv444_cs;
             vid_num_planes = 3;
 
-            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 0, 0 };
-            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 0, 0 };
-            plane_descs[2] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 0, 0 };
+            plane_descs[0] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0, 0 };
+            plane_descs[1] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0, 0 };
+            plane_descs[2] = VidPlaneDesc { DXGI_FORMAT_R8_UINT, 1, 0, 0 };
             break;
         }
 
@@ -347,10 +386,24 @@ void EncoderState::vid_create_conversion_texs()
 
         vid_plane_heights[i] = tex_desc.Height;
 
+        // When converting on the CPU we write directly into the video frames, so we can choose the layout.
+        if (vid_cpu_conversion)
+        {
+            vid_plane_pitches[i] = svr_align32(tex_desc.Width * plane_desc->bytes_per_px, VID_PLANE_ALIGN);
+            continue;
+        }
+
         vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &vid_converted_texs[i]);
         vid_d3d11_device->CreateUnorderedAccessView(vid_converted_texs[i], NULL, &vid_converted_uavs[i]);
     }
 
+    if (vid_cpu_conversion)
+    {
+        vid_create_cpu_download_texs();
+        vid_frames_pitch_matched = true;
+        return;
+    }
+
     for (s32 i = 0; i < VID_QUEUED_TEXTURES; i++)
     {
         VidTextureDownloadInput* input = &vid_texture_download_queue[i];
@@ -371,21 +424,91 @@ void EncoderState::vid_create_conversion_texs()
             vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &input->dl_texs[j]);
         }
     }
+
+    vid_find_plane_pitches();
+}
+
+// When converting on the CPU, the game texture is downloaded as is.
+void EncoderState::vid_create_cpu_download_texs()
+{
+    D3D11_TEXTURE2D_DESC tex_desc;
+    vid_game_texs[0].tex->GetDesc(&tex_desc);
+
+    tex_desc.Usage = D3D11_USAGE_STAGING;
+    tex_desc.BindFlags = 0;
+    tex_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    tex_desc.MiscFlags = 0; // Don't want the sharing flags of the game texture.
+
+    for (s32 i = 0; i < VID_QUEUED_TEXTURES; i++)
+    {
+        VidTextureDownloadInput* input = &vid_texture_download_queue[i];
+        vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &input->dl_texs[0]);
+    }
+
+    vid_cpu_pitch = vid_find_download_pitch(vid_texture_download_queue[0].dl_texs[0]);
+}
+
+// All download textures of a plane are created the same way so they will have the same pitch.
+void EncoderState::vid_find_plane_pitches()
+{
+    vid_frames_pitch_matched = true;
+
+    for (s32 i = 0; i < vid_num_planes; i++)
+    {
+        vid_plane_pitches[i] = vid_find_download_pitch(vid_texture_download_queue[0].dl_texs[i]);
+
+        if (vid_plane_pitches[i] <= 0 || (vid_plane_pitches[i] % VID_PLANE_ALIGN))
+        {
+            vid_frames_pitch_matched = false;
+        }
+    }
+}
+
+// The row pitch of the download textures is up to the driver, so we have to map them to know.
+s32 EncoderState::vid_find_download_pitch(ID3D11Texture2D* tex)
+{
+    D3D11_MAPPED_SUBRESOURCE map;
+    HRESULT hr = vid_d3d11_context->Map(tex, 0, D3D11_MAP_READ, 0, &map);
+
+    if (FAILED(hr))
+    {
+        return 0;
+    }
+
+    vid_d3d11_context->Unmap(tex, 0);
+
+    return map.RowPitch;
 }
 
 // Convert pixel formats and push result to be retrieved later.
 // This must be done to not stall too much.
-void EncoderState::vid_push_texture_for_conversion()
+void EncoderState::vid_push_texture_for_conversion(VidGameTexture* game_tex)
 {
-    vid_game_tex_lock->AcquireSync(ENCODER_PROC_ID, INFINITE); // Allow us to read now.
+    s64 wrapped_write_idx = render_download_write_idx & (VID_QUEUED_TEXTURES - 1);
+    VidTextureDownloadInput* input = &vid_texture_download_queue[wrapped_write_idx];
+
+    // Conversion will be done by the video frame thread after the download.
+    if (vid_cpu_conversion)
+    {
+        game_tex->lock->AcquireSync(ENCODER_PROC_ID, INFINITE); // Allow us to read now.
+        vid_d3d11_context->CopyResource(input->dl_texs[0], game_tex->tex);
+        game_tex->lock->ReleaseSync(ENCODER_GAME_ID); // Give back to game.
+
+        vid_d3d11_context->Flush();
+
+        render_download_write_idx++;
+        return;
+    }
+
+    game_tex->lock->AcquireSync(ENCODER_PROC_ID, INFINITE); // Allow us to read now.
 
     vid_d3d11_context->CSSetShader(vid_conversion_cs, NULL, 0);
-    vid_d3d11_context->CSSetShaderResources(0, 1, &vid_game_tex_srv);
+    vid_d3d11_context->CSSetShaderResources(0, 1, &game_tex->srv);
     vid_d3d11_context->CSSetUnorderedAccessViews(0, vid_num_planes, vid_converted_uavs, NULL);
 
     vid_d3d11_context->Dispatch(vid_get_num_cs_threads(movie_params.video_width), vid_get_num_cs_threads(movie_params.video_height), 1);
 
-    vid_game_tex_lock->ReleaseSync(ENCODER_GAME_ID); // Give back to game.
+    game_tex->lock->ReleaseSync(ENCODER_GAME_ID); // Give back to game.
 
     ID3D11ShaderResourceView* null_srv = NULL;
     ID3D11UnorderedAccessView* null_uav = NULL;
@@ -393,9 +516,6 @@ void EncoderState::vid_push_texture_for_conversion()
     vid_d3d11_context->CSSetShaderResources(0, 1, &null_srv);
     vid_d3d11_context->CSSetUnorderedAccessViews(0, 1, &null_uav, NULL);
 
-    s64 wrapped_write_idx = render_download_write_idx & (VID_QUEUED_TEXTURES - 1);
-    VidTextureDownloadInput* input = &vid_texture_download_queue[wrapped_write_idx];
-
     for (s32 i = 0; i < vid_num_planes; i++)
     {
         vid_d3d11_context->CopyResource(input->dl_texs[i], vid_converted_texs[i]);
@@ -420,6 +540,20 @@ void EncoderState::vid_download_texture_into_frame(AVFrame* dest_frame)
     s64 wrapped_read_idx = render_download_read_idx & (VID_QUEUED_TEXTURES - 1);
     VidTextureDownloadInput* input = &vid_texture_download_queue[wrapped_read_idx];
 
+    // The video frame thread will convert the pixels.
+    if (vid_cpu_conversion)
+    {
+        D3D11_MAPPED_SUBRESOURCE map;
+        vid_d3d11_context->Map(input->dl_texs[0], 0, D3D11_MAP_READ, 0, &map);
+
+        vid_stream_copy(dest_frame->opaque_ref->data, (u8*)map.pData, vid_cpu_pitch * dest_frame->height);
+
+        vid_d3d11_context->Unmap(input->dl_texs[0], 0);
+
+        render_download_read_idx++;
+        return;
+    }
+
     D3D11_MAPPED_SUBRESOURCE maps[VID_MAX_PLANES];
 
     for (s32 i = 0; i < vid_num_planes; i++)
@@ -431,6 +565,14 @@ void EncoderState::vid_download_texture_into_frame(AVFrame* dest_frame)
     {
         D3D11_MAPPED_SUBRESOURCE* map = &maps[i];
         s32 height = vid_plane_heights[i];
+
+        // Same layout so the whole plane can be copied at once.
+        if (vid_frames_pitch_matched && (s32)map->RowPitch == dest_frame->linesize[i])
+        {
+            vid_stream_copy(dest_frame->data[i], (u8*)map->pData, map->RowPitch * height);
+            continue;
+        }
+
         u8* source_ptr = (u8*)map->pData;
         s32 source_line_size = map->RowPitch;
         u8* dest_ptr = dest_frame->data[i];
@@ -0,0 +1,363 @@
+#include "encoder_priv.h"
+
+// Conversion from game texture format to video encoder format on the CPU.
+// This is the same math as in tex2vid.hlsl, and is used instead of the compute shaders when the GPU is the bottleneck.
+// The math is done in the same order as the shader with floats, so every instruction set here gives the exact same output.
+// The precise model must be forced here because the project uses the fast model, which would otherwise be allowed to rearrange things.
+// GPUs may fuse the multiplies and adds of the shader, so there can still be a difference of 1 in some pixels compared to the GPU.
+// For the subsampled formats, the shader has every pixel in a block write the chroma and the last one wins, which is not defined.
+// Here we always use the top left pixel of the block.
+
+#ifdef _WIN32
+#pragma float_control(precise, on, push)
+#endif
+
+using VidCpuRowFn = void(*)(u8* source, s32 num, u8* dest_y, u8* dest_u, u8* dest_v);
+
+struct VidCpuKernel
+{
+    const char* name;
+    VidCpuRowFn row_fn; // Converts BGRA pixels to the Y, U and V channels. Channels that are NULL are not written.
+    s32 block_size; // How many pixels the row function processes at a time. Rows given to it must be a multiple of this.
+};
+
+const s32 VID_CPU_MAX_BLOCK_SIZE = 64;
+
+// Same as tex2vid.hlsl.
+const float VID_CPU_RANGE = 1.164383f;
+
+const float VID_CPU_Y_R = +0.212600f;
+const float VID_CPU_Y_G = +0.715200f;
+const float VID_CPU_Y_B = +0.072200f;
+
+const float VID_CPU_U_R = -0.114572f;
+const float VID_CPU_U_G = -0.385428f;
+const float VID_CPU_U_B = +0.500000f;
+
+const float VID_CPU_V_R = +0.500000f;
+const float VID_CPU_V_G = -0.454153f;
+const float VID_CPU_V_B = -0.045847f;
+
+// --------------------------------------------------------------------------------------------------------------------
+// SSE2. Always available in 64-bit.
+
+__m128 vid_cpu_unorm_sse2(__m128i v)
+{
+    // Same as the texture load (unorm to float) and the range scale in the shader.
+    __m128 f = _mm_cvtepi32_ps(v);
+    f = _mm_div_ps(f, _mm_set1_ps(255.0f));
+    f = _mm_mul_ps(f, _mm_set1_ps(255.0f));
+    f = _mm_div_ps(f, _mm_set1_ps(VID_CPU_RANGE));
+    return f;
+}
+
+__m128i vid_cpu_dot_sse2(__m128 r, __m128 g, __m128 b, float base, float kr, float kg, float kb)
+{
+    __m128 v = _mm_add_ps(_mm_set1_ps(base), _mm_mul_ps(r, _mm_set1_ps(kr)));
+    v = _mm_add_ps(v, _mm_mul_ps(g, _mm_set1_ps(kg)));
+    v = _mm_add_ps(v, _mm_mul_ps(b, _mm_set1_ps(kb)));
+    return _mm_cvttps_epi32(v); // Shader truncates when storing to uint.
+}
+
+// Values are always between 0 and 255 so the signed pack is fine.
+__m128i vid_cpu_pack_sse2(__m128i* v)
+{
+    return _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+}
+
+void vid_cpu_row_sse2(u8* source, s32 num, u8* dest_y, u8* dest_u, u8* dest_v)
+{
+    __m128i mask = _mm_set1_epi32(0xff);
+
+    for (s32 i = 0; i < num; i += 16)
+    {
+        __m128i ys[4];
+        __m128i us[4];
+        __m128i vs[4];
+
+        for (s32 j = 0; j < 4; j++)
+        {
+            __m128i px = _mm_loadu_si128((__m128i*)(source + (i + j * 4) * 4));
+
+            __m128 b = vid_cpu_unorm_sse2(_mm_and_si128(px, mask));
+            __m128 g = vid_cpu_unorm_sse2(_mm_and_si128(_mm_srli_epi32(px, 8), mask));
+            __m128 r = vid_cpu_unorm_sse2(_mm_and_si128(_mm_srli_epi32(px, 16), mask));
+
+            ys[j] = vid_cpu_dot_sse2(r, g, b, 16.0f, VID_CPU_Y_R, VID_CPU_Y_G, VID_CPU_Y_B);
+            us[j] = vid_cpu_dot_sse2(r, g, b, 128.0f, VID_CPU_U_R, VID_CPU_U_G, VID_CPU_U_B);
+            vs[j] = vid_cpu_dot_sse2(r, g, b, 128.0f, VID_CPU_V_R, VID_CPU_V_G, VID_CPU_V_B);
+        }
+
+        if (dest_y) _mm_storeu_si128((__m128i*)(dest_y + i), vid_cpu_pack_sse2(ys));
+        if (dest_u) _mm_storeu_si128((__m128i*)(dest_u + i), vid_cpu_pack_sse2(us));
+        if (dest_v) _mm_storeu_si128((__m128i*)(dest_v + i), vid_cpu_pack_sse2(vs));
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2.
+
+SVR_TARGET_AVX2 __m256 vid_cpu_unorm_avx2(__m256i v)
+{
+    __m256 f = _mm256_cvtepi32_ps(v);
+    f = _mm256_div_ps(f, _mm256_set1_ps(255.0f));
+    f = _mm256_mul_ps(f, _mm256_set1_ps(255.0f));
+    f = _mm256_div_ps(f, _mm256_set1_ps(VID_CPU_RANGE));
+    return f;
+}
+
+SVR_TARGET_AVX2 __m256i vid_cpu_dot_avx2(__m256 r, __m256 g, __m256 b, float base, float kr, float kg, float kb)
+{
+    __m256 v = _mm256_add_ps(_mm256_set1_ps(base), _mm256_mul_ps(r, _mm256_set1_ps(kr)));
+    v = _mm256_add_ps(v, _mm256_mul_ps(g, _mm256_set1_ps(kg)));
+    v = _mm256_add_ps(v, _mm256_mul_ps(b, _mm256_set1_ps(kb)));
+    return _mm256_cvttps_epi32(v);
+}
+
+// The packs work within each 128-bit lane, so the result has to be put back in order.
+SVR_TARGET_AVX2 __m256i vid_cpu_pack_avx2(__m256i* v)
+{
+    __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+    return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+SVR_TARGET_AVX2 void vid_cpu_row_avx2(u8* source, s32 num, u8* dest_y, u8* dest_u, u8* dest_v)
+{
+    __m256i mask = _mm256_set1_epi32(0xff);
+
+    for (s32 i = 0; i < num; i += 32)
+    {
+        __m256i ys[4];
+        __m256i us[4];
+        __m256i vs[4];
+
+        for (s32 j = 0; j < 4; j++)
+        {
+            __m256i px = _mm256_loadu_si256((__m256i*)(source + (i + j * 8) * 4));
+
+            __m256 b = vid_cpu_unorm_avx2(_mm256_and_si256(px, mask));
+            __m256 g = vid_cpu_unorm_avx2(_mm256_and_si256(_mm256_srli_epi32(px, 8), mask));
+            __m256 r = vid_cpu_unorm_avx2(_mm256_and_si256(_mm256_srli_epi32(px, 16), mask));
+
+            ys[j] = vid_cpu_dot_avx2(r, g, b, 16.0f, VID_CPU_Y_R, VID_CPU_Y_G, VID_CPU_Y_B);
+            us[j] = vid_cpu_dot_avx2(r, g, b, 128.0f, VID_CPU_U_R, VID_CPU_U_G, VID_CPU_U_B);
+            vs[j] = vid_cpu_dot_avx2(r, g, b, 128.0f, VID_CPU_V_R, VID_CPU_V_G, VID_CPU_V_B);
+        }
+
+        if (dest_y) _mm256_storeu_si256((__m256i*)(dest_y + i), vid_cpu_pack_avx2(ys));
+        if (dest_u) _mm256_storeu_si256((__m256i*)(dest_u + i), vid_cpu_pack_avx2(us));
+        if (dest_v) _mm256_storeu_si256((__m256i*)(dest_v + i), vid_cpu_pack_avx2(vs));
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX-512. Only needs the foundation set.
+
+SVR_TARGET_AVX512 __m512 vid_cpu_unorm_avx512(__m512i v)
+{
+    __m512 f = _mm512_cvtepi32_ps(v);
+    f = _mm512_div_ps(f, _mm512_set1_ps(255.0f));
+    f = _mm512_mul_ps(f, _mm512_set1_ps(255.0f));
+    f = _mm512_div_ps(f, _mm512_set1_ps(VID_CPU_RANGE));
+    return f;
+}
+
+SVR_TARGET_AVX512 __m512i vid_cpu_dot_avx512(__m512 r, __m512 g, __m512 b, float base, float kr, float kg, float kb)
+{
+    __m512 v = _mm512_add_ps(_mm512_set1_ps(base), _mm512_mul_ps(r, _mm512_set1_ps(kr)));
+    v = _mm512_add_ps(v, _mm512_mul_ps(g, _mm512_set1_ps(kg)));
+    v = _mm512_add_ps(v, _mm512_mul_ps(b, _mm512_set1_ps(kb)));
+    return _mm512_cvttps_epi32(v);
+}
+
+SVR_TARGET_AVX512 void vid_cpu_row_avx512(u8* source, s32 num, u8* dest_y, u8* dest_u, u8* dest_v)
+{
+    __m512i mask = _mm512_set1_epi32(0xff);
+
+    for (s32 i = 0; i < num; i += 64)
+    {
+        for (s32 j = 0; j < 4; j++)
+        {
+            s32 idx = i + j * 16;
+
+            __m512i px = _mm512_loadu_si512(source + idx * 4);
+
+            __m512 b = vid_cpu_unorm_avx512(_mm512_and_si512(px, mask));
+            __m512 g = vid_cpu_unorm_avx512(_mm512_and_si512(_mm512_srli_epi32(px, 8), mask));
+            __m512 r = vid_cpu_unorm_avx512(_mm512_and_si512(_mm512_srli_epi32(px, 16), mask));
+
+            __m512i y = vid_cpu_dot_avx512(r, g, b, 16.0f, VID_CPU_Y_R, VID_CPU_Y_G, VID_CPU_Y_B);
+            __m512i u = vid_cpu_dot_avx512(r, g, b, 128.0f, VID_CPU_U_R, VID_CPU_U_G, VID_CPU_U_B);
+            __m512i v = vid_cpu_dot_avx512(r, g, b, 128.0f, VID_CPU_V_R, VID_CPU_V_G, VID_CPU_V_B);
+
+            if (dest_y) _mm_storeu_si128((__m128i*)(dest_y + idx), _mm512_cvtusepi32_epi8(y));
+            if (dest_u) _mm_storeu_si128((__m128i*)(dest_u + idx), _mm512_cvtusepi32_epi8(u));
+            if (dest_v) _mm_storeu_si128((__m128i*)(dest_v + idx), _mm512_cvtusepi32_epi8(v));
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+const VidCpuKernel VID_CPU_KERNELS[] =
+{
+    VidCpuKernel { "avx512", vid_cpu_row_avx512, 64 },
+    VidCpuKernel { "avx2", vid_cpu_row_avx2, 32 },
+    VidCpuKernel { "sse2", vid_cpu_row_sse2, 16 },
+};
+
+// Pick the best kernel that the processor and the system supports.
+const VidCpuKernel* vid_cpu_select_kernel()
+{
+    bool has_avx2 = svr_cpu_has_avx2();
+    bool has_avx512 = svr_cpu_has_avx512();
+
+    if (has_avx512)
+    {
+        return &VID_CPU_KERNELS[0];
+    }
+
+    if (has_avx2)
+    {
+        return &VID_CPU_KERNELS[1];
+    }
+
+    return &VID_CPU_KERNELS[2];
+}
+
+// Convert a row of any length.
+// The last pixels that don't fill a whole block are converted separately.
+void vid_cpu_convert_row(const VidCpuKernel* kernel, u8* source, s32 num, u8* dest_y, u8* dest_u, u8* dest_v)
+{
+    s32 num_whole = num - (num % kernel->block_size);
+
+    kernel->row_fn(source, num_whole, dest_y, dest_u, dest_v);
+
+    s32 num_rest = num - num_whole;
+
+    if (num_rest == 0)
+    {
+        return;
+    }
+
+    u8 rest_source[VID_CPU_MAX_BLOCK_SIZE * 4] = {};
+    u8 rest_y[VID_CPU_MAX_BLOCK_SIZE];
+    u8 rest_u[VID_CPU_MAX_BLOCK_SIZE];
+    u8 rest_v[VID_CPU_MAX_BLOCK_SIZE];
+
+    memcpy(rest_source, source + num_whole * 4, num_rest * 4);
+
+    kernel->row_fn(rest_source, kernel->block_size, dest_y ? rest_y : NULL, dest_u ? rest_u : NULL, dest_v ? rest_v : NULL);
+
+    if (dest_y) memcpy(dest_y + num_whole, rest_y, num_rest);
+    if (dest_u) memcpy(dest_u + num_whole, rest_u, num_rest);
+    if (dest_v) memcpy(dest_v + num_whole, rest_v, num_rest);
+}
+
+// Take every other pixel of a row, starting from the first.
+void vid_cpu_gather_even_pixels(u8* source, s32 num_dest, u32* dest)
+{
+    u32* source_px = (u32*)source;
+
+    for (s32 i = 0; i < num_dest; i++)
+    {
+        dest[i] = source_px[i * 2];
+    }
+}
+
+// Convert row y of BGRA pixels into the planes of a frame.
+// The temp buffers must have room for half the width.
+void vid_cpu_convert_row_into_frame(const VidCpuKernel* kernel, u8* source_row, s32 y, AVFrame* frame, u32* even_px, u8* temp_u, u8* temp_v)
+{
+    s32 width = frame->width;
+
+    // The chroma planes of the subsampled formats are rounded down in size, same as the textures for the shaders.
+    s32 half_width = width >> 1;
+    s32 half_height = frame->height >> 1;
+
+    u8* dest_y = frame->data[0] + (y * frame->linesize[0]);
+
+    switch (frame->format)
+    {
+        case AV_PIX_FMT_NV12:
+        {
+            vid_cpu_convert_row(kernel, source_row, width, dest_y, NULL, NULL);
+
+            if ((y & 1) || (y >> 1) >= half_height)
+            {
+                break;
+            }
+
+            vid_cpu_gather_even_pixels(source_row, half_width, even_px);
+            vid_cpu_convert_row(kernel, (u8*)even_px, half_width, NULL, temp_u, temp_v);
+
+            u8* dest_uv = frame->data[1] + ((y >> 1) * frame->linesize[1]);
+
+            for (s32 j = 0; j < half_width; j++)
+            {
+                dest_uv[j * 2 + 0] = temp_u[j];
+                dest_uv[j * 2 + 1] = temp_v[j];
+            }
+
+            break;
+        }
+
+        case AV_PIX_FMT_YUV422P:
+        {
+            u8* dest_u = frame->data[1] + (y * frame->linesize[1]);
+            u8* dest_v = frame->data[2] + (y * frame->linesize[2]);
+
+            vid_cpu_convert_row(kernel, source_row, width, dest_y, NULL, NULL);
+
+            vid_cpu_gather_even_pixels(source_row, half_width, even_px);
+            vid_cpu_convert_row(kernel, (u8*)even_px, half_width, NULL, dest_u, dest_v);
+            break;
+        }
+
+        case AV_PIX_FMT_YUV444P:
+        {
+            u8* dest_u = frame->data[1] + (y * frame->linesize[1]);
+            u8* dest_v = frame->data[2] + (y * frame->linesize[2]);
+
+            vid_cpu_convert_row(kernel, source_row, width, dest_y, dest_u, dest_v);
+            break;
+        }
+
+        // This must work because the render info is our own thing.
+        default: assert(false);
+    }
+}
+
+// Convert a whole image of BGRA pixels into the planes of a frame.
+void vid_cpu_convert_image(const VidCpuKernel* kernel, u8* source, s32 source_pitch, AVFrame* frame)
+{
+    s32 half_width = frame->width >> 1;
+
+    u32* even_px = SVR_ALLOCA_NUM(u32, half_width);
+    u8* temp_u = SVR_ALLOCA_NUM(u8, half_width);
+    u8* temp_v = SVR_ALLOCA_NUM(u8, half_width);
+
+    for (s32 i = 0; i < frame->height; i++)
+    {
+        vid_cpu_convert_row_into_frame(kernel, source + (i * source_pitch), i, frame, even_px, temp_u, temp_v);
+    }
+}
+
+#ifdef _WIN32
+#pragma float_control(pop)
+#endif
+
+void EncoderState::vid_cpu_start()
+{
+    vid_cpu_kernel = vid_cpu_select_kernel();
+
+    svr_log("Using CPU video conversion (%s)\n", vid_cpu_kernel->name);
+}
+
+// In video frame thread.
+// Convert the downloaded BGRA pixels of a frame into its planes.
+void EncoderState::vid_cpu_convert_frame(AVFrame* frame)
+{
+    vid_cpu_convert_image(vid_cpu_kernel, frame->opaque_ref->data, vid_cpu_pitch, frame);
+}
+
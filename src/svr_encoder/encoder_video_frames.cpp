@@ -0,0 +1,95 @@
+#include "encoder_priv.h"
+
+// Memory of the video frames. Used by both the GPU and the CPU conversion, and by the benchmark.
+
+void vid_free_aligned_buffer(void* /* opaque */, u8* data)
+{
+    svr_align_free(data, VID_PLANE_ALIGN);
+}
+
+AVBufferRef* EncoderState::vid_alloc_aligned_buffer(s32 size)
+{
+    // Codecs may read a bit past the end.
+    u8* mem = (u8*)svr_align_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE, VID_PLANE_ALIGN);
+
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+
+    AVBufferRef* ret = av_buffer_create(mem, size, vid_free_aligned_buffer, NULL, 0);
+
+    if (ret == NULL)
+    {
+        svr_align_free(mem, VID_PLANE_ALIGN);
+    }
+
+    return ret;
+}
+
+// Allocate the planes of a video frame with the same layout as the download textures.
+// Used instead of av_frame_get_buffer when the pitches are matched.
+bool EncoderState::vid_alloc_frame_planes(AVFrame* frame)
+{
+    for (s32 i = 0; i < vid_num_planes; i++)
+    {
+        frame->buf[i] = vid_alloc_aligned_buffer(vid_plane_pitches[i] * vid_plane_heights[i]);
+
+        if (frame->buf[i] == NULL)
+        {
+            return false;
+        }
+
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = vid_plane_pitches[i];
+    }
+
+    // Also need somewhere to download the pixels to.
+    if (vid_cpu_conversion)
+    {
+        frame->opaque_ref = vid_alloc_aligned_buffer(vid_cpu_pitch * frame->height);
+
+        if (frame->opaque_ref == NULL)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Copy with non temporal stores, so the destination does not push out other things from the cache.
+// The destination is read by a different thread later, so there is no use of having it in this cache.
+// Both pointers must be aligned to 16.
+void vid_stream_copy(u8* dest, u8* source, s32 size)
+{
+    __m128i* dest_ptr = (__m128i*)dest;
+    __m128i* source_ptr = (__m128i*)source;
+
+    s32 num = size / VID_PLANE_ALIGN;
+
+    for (s32 i = 0; i < num; i++)
+    {
+        __m128i a = _mm_load_si128(source_ptr + 0);
+        __m128i b = _mm_load_si128(source_ptr + 1);
+        __m128i c = _mm_load_si128(source_ptr + 2);
+        __m128i d = _mm_load_si128(source_ptr + 3);
+
+        _mm_stream_si128(dest_ptr + 0, a);
+        _mm_stream_si128(dest_ptr + 1, b);
+        _mm_stream_si128(dest_ptr + 2, c);
+        _mm_stream_si128(dest_ptr + 3, d);
+
+        source_ptr += 4;
+        dest_ptr += 4;
+    }
+
+    s32 num_rest = size - (num * VID_PLANE_ALIGN);
+
+    if (num_rest)
+    {
+        memcpy(dest_ptr, source_ptr, num_rest);
+    }
+
+    _mm_sfence(); // Make the stores visible to the other threads.
+}
@@ -2,8 +2,15 @@
 #include "encoder_main.cpp"
 #include "encoder_state.cpp"
 #include "encoder_audio.cpp"
+#include "encoder_video_frames.cpp"
+#ifdef _WIN32
+#include "encoder_game.cpp"
 #include "encoder_video.cpp"
+#endif
+#include "encoder_video_cpu.cpp"
 #include "encoder_render.cpp"
 #include "encoder_dnxhr.cpp"
 #include "encoder_libx264.cpp"
 #include "encoder_render_threads.cpp"
+#include "encoder_render_chunks.cpp"
+#include "encoder_bench.cpp"
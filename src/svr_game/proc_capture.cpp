@@ -0,0 +1,258 @@
+#include "proc_priv.h"
+
+// Writes everything given to svr_api to a capture file that can be replayed later (see svr_capture.h).
+// Reading back the game texture stalls the game until the frame is done on the GPU, so this is slow and only meant for making test input.
+
+const u8 CAPTURE_PADDING[SVR_CAPTURE_ALIGN] = {};
+
+bool ProcState::capture_start()
+{
+    bool ret = false;
+
+    if (movie_profile.capture_output == NULL)
+    {
+        return true;
+    }
+
+    D3D11_TEXTURE2D_DESC game_desc;
+    svr_game_texture.tex->GetDesc(&game_desc);
+
+    s32 bpp = capture_get_format_bpp(game_desc.Format);
+
+    if (bpp == 0)
+    {
+        svr_log("ERROR: Capture does not support game texture format %d\n", (s32)game_desc.Format);
+        goto rfail;
+    }
+
+    if (!capture_create_download_tex(&game_desc))
+    {
+        goto rfail;
+    }
+
+    capture_pitch = game_desc.Width * bpp;
+    capture_frame_mem = svr_alloc(capture_pitch * game_desc.Height);
+    capture_num_frames = 0;
+
+    capture_file_h = CreateFileA(movie_profile.capture_output, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (capture_file_h == INVALID_HANDLE_VALUE)
+    {
+        capture_file_h = NULL;
+        svr_log("ERROR: Could not create capture file %s (%lu)\n", movie_profile.capture_output, GetLastError());
+        goto rfail;
+    }
+
+    SvrCaptureHeader header = {};
+    header.magic = SVR_CAPTURE_MAGIC;
+    header.version = SVR_CAPTURE_VERSION;
+    header.video_width = game_desc.Width;
+    header.video_height = game_desc.Height;
+    header.video_format = game_desc.Format;
+    header.video_pitch = capture_pitch;
+    header.audio_params = svr_audio_params;
+    header.game_rate = get_game_rate();
+
+    if (!capture_write(&header, sizeof(SvrCaptureHeader)))
+    {
+        goto rfail;
+    }
+
+    svr_log("Capturing to %s\n", movie_profile.capture_output);
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    capture_free_dynamic();
+
+rexit:
+    return ret;
+}
+
+void ProcState::capture_end()
+{
+    if (capture_file_h)
+    {
+        svr_log("Captured %d frames\n", capture_num_frames);
+    }
+
+    capture_free_dynamic();
+}
+
+void ProcState::capture_free_dynamic()
+{
+    svr_maybe_release(&capture_download_tex);
+    svr_maybe_close_handle(&capture_file_h);
+
+    if (capture_frame_mem)
+    {
+        svr_free(capture_frame_mem);
+        capture_frame_mem = NULL;
+    }
+}
+
+// Returns 0 for formats we cannot capture.
+s32 ProcState::capture_get_format_bpp(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        {
+            return 4;
+        }
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+        {
+            return 8;
+        }
+    }
+
+    return 0;
+}
+
+bool ProcState::capture_create_download_tex(D3D11_TEXTURE2D_DESC* game_desc)
+{
+    bool ret = false;
+    HRESULT hr;
+
+    D3D11_TEXTURE2D_DESC tex_desc = {};
+    tex_desc.Width = game_desc->Width;
+    tex_desc.Height = game_desc->Height;
+    tex_desc.MipLevels = 1;
+    tex_desc.ArraySize = 1;
+    tex_desc.Format = game_desc->Format;
+    tex_desc.SampleDesc.Count = 1;
+    tex_desc.Usage = D3D11_USAGE_STAGING;
+    tex_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    hr = vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &capture_download_tex);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: Could not create capture download texture (%#x)\n", hr);
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+
+rexit:
+    return ret;
+}
+
+bool ProcState::capture_write(void* data, s32 size)
+{
+    DWORD written;
+
+    if (!WriteFile(capture_file_h, data, size, &written, NULL) || written != (DWORD)size)
+    {
+        svr_log("ERROR: Could not write to capture file (%lu)\n", GetLastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool ProcState::capture_write_chunk(SvrCaptureChunkType type, void* data, s32 size)
+{
+    SvrCaptureChunk chunk = {};
+    chunk.type = type;
+    chunk.size = size;
+
+    s32 padding = svr_align32(size, SVR_CAPTURE_ALIGN) - size;
+
+    return capture_write(&chunk, sizeof(SvrCaptureChunk)) && capture_write(data, size) && capture_write((void*)CAPTURE_PADDING, padding);
+}
+
+// Don't stop the movie for this, but there is no point in continuing the capture as it cannot be replayed correctly.
+void ProcState::capture_stop_on_error()
+{
+    svr_log("Stopping capture\n");
+    capture_free_dynamic();
+}
+
+void ProcState::capture_video_frame()
+{
+    HRESULT hr;
+    D3D11_MAPPED_SUBRESOURCE mapped;
+
+    vid_d3d11_context->CopyResource(capture_download_tex, svr_game_texture.tex);
+
+    hr = vid_d3d11_context->Map(capture_download_tex, 0, D3D11_MAP_READ, 0, &mapped);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: Could not map capture download texture (%#x)\n", hr);
+        capture_stop_on_error();
+        return;
+    }
+
+    D3D11_TEXTURE2D_DESC tex_desc;
+    capture_download_tex->GetDesc(&tex_desc);
+
+    void* frame = mapped.pData;
+
+    // The rows have to be packed if the driver added padding.
+    if (mapped.RowPitch != (UINT)capture_pitch)
+    {
+        u8* dest = (u8*)capture_frame_mem;
+        u8* src = (u8*)mapped.pData;
+
+        for (UINT i = 0; i < tex_desc.Height; i++)
+        {
+            memcpy(dest, src, capture_pitch);
+            dest += capture_pitch;
+            src += mapped.RowPitch;
+        }
+
+        frame = capture_frame_mem;
+    }
+
+    bool written = capture_write_chunk(SVR_CAPTURE_CHUNK_VIDEO, frame, capture_pitch * tex_desc.Height);
+
+    vid_d3d11_context->Unmap(capture_download_tex, 0);
+
+    if (!written)
+    {
+        capture_stop_on_error();
+        return;
+    }
+
+    capture_num_frames++;
+}
+
+void ProcState::capture_audio_samples(SvrWaveSample* samples, s32 num_samples)
+{
+    if (!capture_write_chunk(SVR_CAPTURE_CHUNK_AUDIO, samples, sizeof(SvrWaveSample) * num_samples))
+    {
+        capture_stop_on_error();
+    }
+}
+
+void ProcState::capture_velo(SvrVec3 source)
+{
+    float xyz[3] = { source.x, source.y, source.z };
+
+    if (!capture_write_chunk(SVR_CAPTURE_CHUNK_VELO, xyz, sizeof(xyz)))
+    {
+        capture_stop_on_error();
+    }
+}
+
+void ProcState::capture_frame_steps(s32 steps)
+{
+    if (!capture_write_chunk(SVR_CAPTURE_CHUNK_FRAME_STEPS, &steps, sizeof(s32)))
+    {
+        capture_stop_on_error();
+    }
+}
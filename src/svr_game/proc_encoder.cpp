@@ -1,5 +1,8 @@
 #include "proc_priv.h"
 
+const s32 ENCODER_SHARE_TEX_WAIT_MS = 100; // How long to wait for a share texture before checking that svr_encoder is still ok.
+const s32 ENCODER_AUDIO_WAIT_MS = 1; // How long to wait between checks for space in the audio ring when it is full.
+
 bool ProcState::encoder_init()
 {
     bool ret = false;
@@ -19,8 +22,6 @@ bool ProcState::encoder_init()
 
     svr_console_msg_and_log("Started encoder process\n");
 
-    encoder_pending_samples.init(ENCODER_MAX_SAMPLES * 2);
-
     ret = true;
     goto rexit;
 
@@ -42,7 +43,7 @@ void ProcState::encoder_free_static()
     {
         CloseHandle(encoder_shared_mem_h);
         encoder_shared_mem_h = NULL;
-        encoder_audio_buffer = NULL;
+        encoder_audio_ring = NULL;
     }
 
     if (encoder_shared_ptr)
@@ -62,25 +63,31 @@ void ProcState::encoder_free_static()
         CloseHandle(encoder_wake_event_h);
         encoder_wake_event_h = NULL;
     }
-
-    encoder_pending_samples.free();
 }
 
 void ProcState::encoder_free_dynamic()
 {
-    svr_maybe_release(&encoder_share_tex);
-    svr_maybe_release(&encoder_share_tex_srv);
-    svr_maybe_release(&encoder_share_tex_uav);
-    svr_maybe_release(&encoder_share_tex_rtv);
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
+    {
+        encoder_free_share_texture(&encoder_share_texs[i]);
+    }
+}
+
+void ProcState::encoder_free_share_texture(ProcShareTexture* share_tex)
+{
+    svr_maybe_release(&share_tex->tex);
+    svr_maybe_release(&share_tex->srv);
+    svr_maybe_release(&share_tex->uav);
+    svr_maybe_release(&share_tex->rtv);
 
-    if (encoder_share_tex_h)
+    if (share_tex->h)
     {
-        CloseHandle(encoder_share_tex_h);
-        encoder_share_tex_h = NULL;
+        CloseHandle(share_tex->h);
+        share_tex->h = NULL;
     }
 
-    svr_maybe_release(&encoder_d2d1_share_tex);
-    svr_maybe_release(&encoder_share_tex_lock);
+    svr_maybe_release(&share_tex->d2d1_bitmap);
+    svr_maybe_release(&share_tex->lock);
 }
 
 bool ProcState::encoder_create_shared_mem()
@@ -92,7 +99,7 @@ bool ProcState::encoder_create_shared_mem()
     sa.bInheritHandle = TRUE; // Allow encoder process to use this handle too.
 
     s32 mem_size = sizeof(EncoderSharedMem);
-    mem_size += sizeof(SvrWaveSample) * ENCODER_MAX_SAMPLES; // Space for audio buffer.
+    mem_size += sizeof(SvrWaveSample) * ENCODER_AUDIO_RING_SAMPLES; // Space for audio ring.
 
     // Create shared memory handle without a name. The handle will be passed as a parameter to the encoder process
     // and it will open in that way, since we use inherited handles.
@@ -131,7 +138,7 @@ bool ProcState::encoder_create_shared_mem()
     offset += sizeof(EncoderSharedMem);
     encoder_shared_ptr->audio_buffer_offset = offset;
 
-    encoder_audio_buffer = (u8*)encoder_shared_ptr + encoder_shared_ptr->audio_buffer_offset;
+    encoder_audio_ring = (SvrWaveSample*)((u8*)encoder_shared_ptr + encoder_shared_ptr->audio_buffer_offset);
 
     ret = true;
     goto rexit;
@@ -200,9 +207,12 @@ bool ProcState::encoder_start()
         goto rfail;
     }
 
-    if (!encoder_create_d2d1_bitmap())
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
     {
-        goto rfail;
+        if (!encoder_create_d2d1_bitmap(&encoder_share_texs[i]))
+        {
+            goto rfail;
+        }
     }
 
     if (!encoder_set_shared_mem_params())
@@ -210,9 +220,15 @@ bool ProcState::encoder_start()
         goto rfail;
     }
 
-    encoder_share_tex_lock->AcquireSync(ENCODER_GAME_ID, INFINITE); // Set initial owner now.
+    encoder_share_tex_idx = 0;
+    encoder_video_write_idx = 0;
+    encoder_audio_write_idx = 0;
 
-    encoder_pending_samples.clear();
+    // Set initial owner now.
+    if (!encoder_acquire_share_tex())
+    {
+        goto rfail;
+    }
 
     ret = true;
     goto rexit;
@@ -239,6 +255,11 @@ bool ProcState::encoder_set_shared_mem_params()
     params->audio_bits = svr_audio_params.audio_bits;
     params->x264_crf = movie_profile.video_x264_crf;
     params->x264_intra = movie_profile.video_x264_intra;
+    params->max_queued_mb = movie_profile.encoder_max_queued_mb;
+    params->cpu_conversion = movie_profile.encoder_cpu_conversion;
+    params->chunk_threads = movie_profile.encoder_chunk_threads;
+    params->chunk_frames = movie_profile.encoder_chunk_frames;
+    params->write_trace = movie_profile.trace_enabled;
     params->use_audio = movie_profile.audio_enabled;
 
     SVR_COPY_STRING(movie_path, params->dest_file);
@@ -247,23 +268,30 @@ bool ProcState::encoder_set_shared_mem_params()
     SVR_COPY_STRING(movie_profile.video_dnxhr_profile, params->dnxhr_profile);
     SVR_COPY_STRING(movie_profile.audio_encoder, params->audio_encoder);
 
-    // Must duplicate the handle for the encoder to be able to open it.
+    // Must duplicate the handles for the encoder to be able to open them.
     // Doesn't matter if you specify to inherit handles when creating the DXGI handle.
 
-    HANDLE new_handle;
-    BOOL res = DuplicateHandle(GetCurrentProcess(), encoder_share_tex_h, encoder_proc, &new_handle, 0, TRUE, DUPLICATE_SAME_ACCESS);
-
-    if (res == 0)
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
     {
-        svr_log("ERROR: Could not duplicate share texture handle (%lu)\n", GetLastError());
-        goto rfail;
+        HANDLE new_handle;
+        BOOL res = DuplicateHandle(GetCurrentProcess(), encoder_share_texs[i].h, encoder_proc, &new_handle, 0, TRUE, DUPLICATE_SAME_ACCESS);
+
+        if (res == 0)
+        {
+            svr_log("ERROR: Could not duplicate share texture handle (%lu)\n", GetLastError());
+            goto rfail;
+        }
+
+        encoder_shared_ptr->game_texture_hs[i] = (u32)new_handle; // Transfer to encoder process, so don't close here.
     }
 
-    encoder_shared_ptr->waiting_audio_samples = 0;
-    encoder_shared_ptr->game_texture_h = (u32)new_handle; // Transfer to encoder process, so don't close here.
+    svr_atom_store(&encoder_shared_ptr->video_write_idx, 0);
+    svr_atom_store(&encoder_shared_ptr->audio_write_idx, 0);
+    svr_atom_store(&encoder_shared_ptr->audio_read_idx, 0);
 
-    encoder_shared_ptr->error = 0;
+    svr_atom_store(&encoder_shared_ptr->error, 0);
     encoder_shared_ptr->error_message[0] = 0;
+    encoder_error_shown = false;
 
     // Now wake svr_encoder up and let it wait for new data.
     if (!encoder_send_event(ENCODER_EVENT_START))
@@ -281,6 +309,19 @@ rexit:
 }
 
 bool ProcState::encoder_create_share_textures()
+{
+    for (s32 i = 0; i < ENCODER_NUM_VIDEO_TEXTURES; i++)
+    {
+        if (!encoder_create_share_texture(&encoder_share_texs[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ProcState::encoder_create_share_texture(ProcShareTexture* share_tex)
 {
     bool ret = false;
     HRESULT hr;
@@ -296,7 +337,7 @@ bool ProcState::encoder_create_share_textures()
     tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET; // Must have these flags!
     tex_desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_NTHANDLE | D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
 
-    hr = vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &encoder_share_tex);
+    hr = vid_d3d11_device->CreateTexture2D(&tex_desc, NULL, &share_tex->tex);
 
     if (FAILED(hr))
     {
@@ -304,12 +345,12 @@ bool ProcState::encoder_create_share_textures()
         goto rfail;
     }
 
-    vid_d3d11_device->CreateShaderResourceView(encoder_share_tex, NULL, &encoder_share_tex_srv);
-    vid_d3d11_device->CreateUnorderedAccessView(encoder_share_tex, NULL, &encoder_share_tex_uav);
-    vid_d3d11_device->CreateRenderTargetView(encoder_share_tex, NULL, &encoder_share_tex_rtv);
+    vid_d3d11_device->CreateShaderResourceView(share_tex->tex, NULL, &share_tex->srv);
+    vid_d3d11_device->CreateUnorderedAccessView(share_tex->tex, NULL, &share_tex->uav);
+    vid_d3d11_device->CreateRenderTargetView(share_tex->tex, NULL, &share_tex->rtv);
 
     IDXGIResource1* dxgi_res = NULL;
-    hr = encoder_share_tex->QueryInterface(IID_PPV_ARGS(&dxgi_res));
+    hr = share_tex->tex->QueryInterface(IID_PPV_ARGS(&dxgi_res));
 
     if (FAILED(hr))
     {
@@ -317,7 +358,7 @@ bool ProcState::encoder_create_share_textures()
         goto rfail;
     }
 
-    hr = dxgi_res->CreateSharedHandle(NULL, DXGI_SHARED_RESOURCE_READ, NULL, &encoder_share_tex_h);
+    hr = dxgi_res->CreateSharedHandle(NULL, DXGI_SHARED_RESOURCE_READ, NULL, &share_tex->h);
 
     if (FAILED(hr))
     {
@@ -325,7 +366,7 @@ bool ProcState::encoder_create_share_textures()
         goto rfail;
     }
 
-    encoder_share_tex->QueryInterface(IID_PPV_ARGS(&encoder_share_tex_lock));
+    share_tex->tex->QueryInterface(IID_PPV_ARGS(&share_tex->lock));
 
     ret = true;
     goto rexit;
@@ -339,11 +380,7 @@ rexit:
 
 void ProcState::encoder_end()
 {
-    if (movie_profile.audio_enabled)
-    {
-        encoder_flush_audio();
-    }
-
+    // All audio samples and video frames that have been sent will be taken by svr_encoder before it stops.
     encoder_send_event(ENCODER_EVENT_STOP);
 }
 
@@ -355,12 +392,20 @@ void ProcState::encoder_end()
 // checking the return value of this function.
 bool ProcState::encoder_send_event(EncoderSharedEvent event)
 {
-    encoder_shared_ptr->event_type = event;
+    // Don't bother svr_encoder anymore after it has failed, other than letting it clean up.
+    if (event != ENCODER_EVENT_STOP && !encoder_check_error())
+    {
+        return false;
+    }
+
+    svr_atom_store(&encoder_shared_ptr->event_type, event);
+
+    svr_trace_begin("Encoder event");
 
     SetEvent(encoder_wake_event_h); // Let svr_encoder wake up and handle the event.
 
     // Block the calling thread until the event has been processed by svr_encoder.
-    // We need to do this to ensure the audio and video data access doesn't suffer from any race condition.
+    // We need to do this to ensure the access to the movie parameters in the shared memory doesn't suffer from any race condition.
     // All the event handling is short and fast so this is a very short wait.
     // When this returns, svr_encoder will be paused and in a known state waiting to be woken up again.
     // This call also makes synchronization easier in this process.
@@ -374,6 +419,8 @@ bool ProcState::encoder_send_event(EncoderSharedEvent event)
     DWORD waited = WaitForMultipleObjects(SVR_ARRAY_SIZE(handles), handles, FALSE, INFINITE);
     HANDLE waited_h = handles[waited - WAIT_OBJECT_0];
 
+    svr_trace_end();
+
     // Encoder exited or crashed or something.
     if (waited_h == encoder_proc)
     {
@@ -381,30 +428,72 @@ bool ProcState::encoder_send_event(EncoderSharedEvent event)
         return false;
     }
 
-    if (waited_h == game_wake_event_h)
+    return encoder_check_error();
+}
+
+// Errors from svr_encoder stay set until the next movie, since they can come from video frames that we did not wait for.
+bool ProcState::encoder_check_error()
+{
+    if (svr_atom_load(&encoder_shared_ptr->error) == 0)
     {
-        if (encoder_shared_ptr->error)
-        {
-            // Any error in svr_encoder is written to its log.
-            // We also want to log the error in the console and in our log.
-            svr_console_msg_and_log(encoder_shared_ptr->error_message);
-            svr_console_msg_and_log("See ENCODER_LOG.txt for more information\n");
-            return false;
-        }
+        return true;
     }
 
-    return true;
+    if (!encoder_error_shown)
+    {
+        // Any error in svr_encoder is written to its log.
+        // We also want to log the error in the console and in our log.
+        svr_console_msg_and_log(encoder_shared_ptr->error_message);
+        svr_console_msg_and_log("See ENCODER_LOG.txt for more information\n");
+
+        encoder_error_shown = true;
+    }
+
+    return false;
 }
 
-bool ProcState::encoder_send_shared_tex()
+// The texture that should be written to for the next video frame.
+ProcShareTexture* ProcState::encoder_get_share_tex()
+{
+    return &encoder_share_texs[encoder_share_tex_idx];
+}
+
+// Wait until svr_encoder has given back the current share texture.
+// This only blocks if svr_encoder has not taken the video frames in all the other textures yet.
+bool ProcState::encoder_acquire_share_tex()
 {
     bool ret = false;
+    HRESULT hr;
 
-    encoder_share_tex_lock->ReleaseSync(ENCODER_PROC_ID); // Allow encoder to read.
+    svr_trace_begin("Wait for share texture");
 
-    if (!encoder_send_event(ENCODER_EVENT_NEW_VIDEO))
+    while (true)
     {
-        goto rfail;
+        // Don't wait forever as svr_encoder may stop without giving the texture back.
+        hr = encoder_get_share_tex()->lock->AcquireSync(ENCODER_GAME_ID, ENCODER_SHARE_TEX_WAIT_MS);
+
+        if (hr == S_OK)
+        {
+            break;
+        }
+
+        // Also fails with WAIT_ABANDONED if svr_encoder has closed the texture without giving it back.
+        if ((DWORD)hr != WAIT_TIMEOUT)
+        {
+            svr_log("ERROR: Could not acquire share texture (%#x)\n", hr);
+            goto rfail;
+        }
+
+        if (WaitForSingleObject(encoder_proc, 0) == WAIT_OBJECT_0)
+        {
+            svr_console_msg_and_log("Encoder exited or crashed\n");
+            goto rfail;
+        }
+
+        if (!encoder_check_error())
+        {
+            goto rfail;
+        }
     }
 
     ret = true;
@@ -413,20 +502,31 @@ bool ProcState::encoder_send_shared_tex()
 rfail:
 
 rexit:
-    encoder_share_tex_lock->AcquireSync(ENCODER_GAME_ID, INFINITE); // Give back to us now.
+    svr_trace_end();
     return ret;
 }
 
-bool ProcState::encoder_send_audio_samples(SvrWaveSample* samples, s32 num_samples)
+// Give the current share texture to svr_encoder and continue with the next one.
+// This does not wait for svr_encoder to take the video frame.
+bool ProcState::encoder_send_shared_tex()
 {
-    // During motion blur capture, we will be getting really low number of samples in here (like 12).
-    // This is way too little to wake up the encoder for and block the game.
-    // Queue up a larger amount and send that instead.
-    encoder_pending_samples.push_range(samples, num_samples);
-
     bool ret = false;
 
-    if (!encoder_submit_pending_samples())
+    if (!encoder_check_error())
+    {
+        goto rfail;
+    }
+
+    encoder_get_share_tex()->lock->ReleaseSync(ENCODER_PROC_ID); // Allow encoder to read.
+
+    encoder_video_write_idx++;
+    svr_atom_store(&encoder_shared_ptr->video_write_idx, encoder_video_write_idx);
+
+    SetEvent(encoder_wake_event_h); // Let svr_encoder wake up and take the video frame.
+
+    encoder_share_tex_idx = encoder_video_write_idx % ENCODER_NUM_VIDEO_TEXTURES;
+
+    if (!encoder_acquire_share_tex())
     {
         goto rfail;
     }
@@ -440,33 +540,51 @@ rexit:
     return ret;
 }
 
-// Send any remaining samples just before the rendering stops.
-void ProcState::encoder_flush_audio()
+// Write the samples to the audio ring (see encoder_shared.h).
+// This does not wait for svr_encoder to take the samples, unless the ring is full.
+bool ProcState::encoder_send_audio_samples(SvrWaveSample* samples, s32 num_samples)
 {
-    while (encoder_pending_samples.size() > 0)
-    {
-        s32 samples_to_write = svr_min(encoder_pending_samples.size(), ENCODER_MAX_SAMPLES);
+    bool ret = false;
 
-        if (!encoder_send_audio_from_pending(samples_to_write))
-        {
-            break;
-        }
+    if (!encoder_check_error())
+    {
+        goto rfail;
     }
-}
-
-// Send full batches of audio.
-bool ProcState::encoder_submit_pending_samples()
-{
-    bool ret = false;
 
-    while (encoder_pending_samples.size() >= ENCODER_MAX_SAMPLES)
+    while (num_samples > 0)
     {
-        s32 samples_to_write = ENCODER_MAX_SAMPLES;
+        s32 free_samples = encoder_get_free_audio_samples();
 
-        if (!encoder_send_audio_from_pending(samples_to_write))
+        if (free_samples == 0)
         {
-            goto rfail;
+            if (!encoder_wait_for_audio_space())
+            {
+                goto rfail;
+            }
+
+            continue;
         }
+
+        // Only write up to the end of the ring here, the rest continues from the start of the ring.
+        s32 ring_pos = encoder_audio_write_idx % ENCODER_AUDIO_RING_SAMPLES;
+        s32 num_to_write = svr_min(num_samples, free_samples);
+        num_to_write = svr_min(num_to_write, ENCODER_AUDIO_RING_SAMPLES - ring_pos);
+
+        memcpy(encoder_audio_ring + ring_pos, samples, sizeof(SvrWaveSample) * num_to_write);
+
+        samples += num_to_write;
+        num_samples -= num_to_write;
+
+        encoder_audio_write_idx += num_to_write;
+        svr_atom_store(&encoder_shared_ptr->audio_write_idx, (s32)encoder_audio_write_idx);
+    }
+
+    // During motion blur capture, we will be getting really low number of samples in here (like 12).
+    // This is way too little to wake up svr_encoder for, and it is woken up for every video frame anyway.
+    // Only wake it up for the audio when a lot of samples are waiting.
+    if (ENCODER_AUDIO_RING_SAMPLES - encoder_get_free_audio_samples() >= ENCODER_MAX_SAMPLES)
+    {
+        SetEvent(encoder_wake_event_h);
     }
 
     ret = true;
@@ -478,19 +596,34 @@ rexit:
     return ret;
 }
 
-// Shared code between encoder_submit_pending_samples and encoder_flush_audio.
-bool ProcState::encoder_send_audio_from_pending(s32 num_samples)
+s32 ProcState::encoder_get_free_audio_samples()
+{
+    u32 read_idx = (u32)svr_atom_load(&encoder_shared_ptr->audio_read_idx);
+    return ENCODER_AUDIO_RING_SAMPLES - (s32)(encoder_audio_write_idx - read_idx);
+}
+
+// The audio ring is full, so svr_encoder has fallen far behind. Wait until it has taken some samples.
+// This should almost never happen, so svr_encoder does not signal us when it takes samples and we check every now and then instead.
+bool ProcState::encoder_wait_for_audio_space()
 {
     bool ret = false;
 
-    assert(encoder_pending_samples.size() >= num_samples);
+    svr_trace_begin("Wait for audio space");
 
-    encoder_pending_samples.pull_range((SvrWaveSample*)encoder_audio_buffer, num_samples);
-    encoder_shared_ptr->waiting_audio_samples = num_samples;
+    SetEvent(encoder_wake_event_h); // Let svr_encoder wake up and take the samples.
 
-    if (!encoder_send_event(ENCODER_EVENT_NEW_AUDIO))
+    while (encoder_get_free_audio_samples() == 0)
     {
-        goto rfail;
+        if (WaitForSingleObject(encoder_proc, ENCODER_AUDIO_WAIT_MS) == WAIT_OBJECT_0)
+        {
+            svr_console_msg_and_log("Encoder exited or crashed\n");
+            goto rfail;
+        }
+
+        if (!encoder_check_error())
+        {
+            goto rfail;
+        }
     }
 
     ret = true;
@@ -499,19 +632,20 @@ bool ProcState::encoder_send_audio_from_pending(s32 num_samples)
 rfail:
 
 rexit:
+    svr_trace_end();
     return ret;
 }
 
-bool ProcState::encoder_create_d2d1_bitmap()
+bool ProcState::encoder_create_d2d1_bitmap(ProcShareTexture* share_tex)
 {
     bool ret = false;
     HRESULT hr;
 
     IDXGISurface* dxgi_surface = NULL;
-    encoder_share_tex->QueryInterface(IID_PPV_ARGS(&dxgi_surface));
+    share_tex->tex->QueryInterface(IID_PPV_ARGS(&dxgi_surface));
 
     // Create passthrough reference to the used render target. This is not a real texture.
-    hr = vid_d2d1_context->CreateBitmapFromDxgiSurface(dxgi_surface, NULL, &encoder_d2d1_share_tex);
+    hr = vid_d2d1_context->CreateBitmapFromDxgiSurface(dxgi_surface, NULL, &share_tex->d2d1_bitmap);
 
     if (FAILED(hr))
     {
@@ -3,6 +3,15 @@
 struct __declspec(align(16)) MosampleCb
 {
     float mosample_weight;
+    float mosample_weight_start;
+    float mosample_weight_end;
+};
+
+// Must be synchronized with mosample_buffer_1 in the shaders.
+struct __declspec(align(16)) MosampleTablesCb
+{
+    u32 mosample_to_fixed[256];
+    u32 mosample_fixed_thresholds[256];
 };
 
 bool ProcState::mosample_init()
@@ -48,6 +57,25 @@ bool ProcState::mosample_create_buffer()
         goto rfail;
     }
 
+    MosampleTablesCb tables_data;
+    svr_mosample_get_fixed_tables(tables_data.mosample_to_fixed, tables_data.mosample_fixed_thresholds);
+
+    D3D11_BUFFER_DESC tables_cb_desc = {};
+    tables_cb_desc.ByteWidth = sizeof(MosampleTablesCb);
+    tables_cb_desc.Usage = D3D11_USAGE_IMMUTABLE;
+    tables_cb_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA tables_cb_res = {};
+    tables_cb_res.pSysMem = &tables_data;
+
+    hr = vid_d3d11_device->CreateBuffer(&tables_cb_desc, &tables_cb_res, &mosample_tables_cb);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: Could not create mosample tables constant buffer (%#x)\n", hr);
+        goto rfail;
+    }
+
     ret = true;
     goto rexit;
 
@@ -80,17 +108,85 @@ rexit:
     return ret;
 }
 
+// The fixed point shaders are only created the first time a profile asks for the fixed point format.
+// If they cannot be created, the floating point format is used instead.
+bool ProcState::mosample_create_fixed_shaders()
+{
+    bool ret = false;
+
+    if (mosample_fixed_cs && mosample_fixed_downsample_cs)
+    {
+        ret = true;
+        goto rexit;
+    }
+
+    if (!vid_create_shader("mosample_fixed", (void**)&mosample_fixed_cs, D3D11_COMPUTE_SHADER))
+    {
+        goto rfail;
+    }
+
+    if (!vid_create_shader("downsample_fixed", (void**)&mosample_fixed_downsample_cs, D3D11_COMPUTE_SHADER))
+    {
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    svr_maybe_release(&mosample_fixed_cs);
+    svr_maybe_release(&mosample_fixed_downsample_cs);
+
+rexit:
+    return ret;
+}
+
+// The fixed point format needs to both read and write the work texture in the shader, which is optional for this format.
+bool ProcState::mosample_has_fixed_support()
+{
+    D3D11_FEATURE_DATA_FORMAT_SUPPORT2 fmt_support2;
+    fmt_support2.InFormat = DXGI_FORMAT_R16G16B16A16_UINT;
+
+    if (FAILED(vid_d3d11_device->CheckFeatureSupport(D3D11_FEATURE_FORMAT_SUPPORT2, &fmt_support2, sizeof(D3D11_FEATURE_DATA_FORMAT_SUPPORT2))))
+    {
+        return false;
+    }
+
+    bool has_typed_uav_load = fmt_support2.OutFormatSupport2 & D3D11_FORMAT_SUPPORT2_UAV_TYPED_LOAD;
+    bool has_typed_uav_store = fmt_support2.OutFormatSupport2 & D3D11_FORMAT_SUPPORT2_UAV_TYPED_STORE;
+
+    return has_typed_uav_load && has_typed_uav_store;
+}
+
 bool ProcState::mosample_create_textures()
 {
     bool ret = false;
     HRESULT hr;
 
+    mosample_use_fixed = false;
+
+    if (movie_profile.mosample_fixed_point)
+    {
+        mosample_use_fixed = mosample_has_fixed_support();
+
+        if (!mosample_use_fixed)
+        {
+            svr_log("Fixed point motion blur is not supported by the graphics device, using floating point\n");
+        }
+
+        else if (!mosample_create_fixed_shaders())
+        {
+            mosample_use_fixed = false;
+            svr_log("Could not create the fixed point motion blur shaders, using floating point\n");
+        }
+    }
+
     D3D11_TEXTURE2D_DESC tex_desc = {};
     tex_desc.Width = movie_width;
     tex_desc.Height = movie_height;
     tex_desc.MipLevels = 1;
     tex_desc.ArraySize = 1;
-    tex_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT; // Must be high precision!
+    tex_desc.Format = mosample_use_fixed ? DXGI_FORMAT_R16G16B16A16_UINT : DXGI_FORMAT_R32G32B32A32_FLOAT; // Must be high precision!
     tex_desc.SampleDesc.Count = 1;
     tex_desc.Usage = D3D11_USAGE_DEFAULT;
     tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET;
@@ -108,7 +204,7 @@ bool ProcState::mosample_create_textures()
     vid_d3d11_device->CreateUnorderedAccessView(mosample_work_tex, NULL, &mosample_work_tex_uav);
 
     // The work texture may get reused by the runtime between renderings, so we must clear it.
-    vid_clear_rtv(mosample_work_tex_rtv, 0.0f, 0.0f, 0.0f, 1.0f);
+    mosample_clear_work_tex();
 
     ret = true;
     goto rexit;
@@ -119,20 +215,29 @@ rexit:
     return ret;
 }
 
-void ProcState::mosample_free_static()
+void ProcState::mosample_free_textures()
 {
     svr_maybe_release(&mosample_work_tex);
     svr_maybe_release(&mosample_work_tex_rtv);
     svr_maybe_release(&mosample_work_tex_srv);
     svr_maybe_release(&mosample_work_tex_uav);
+}
+
+void ProcState::mosample_free_static()
+{
+    mosample_free_textures();
 
     svr_maybe_release(&mosample_cs);
     svr_maybe_release(&mosample_downsample_cs);
+    svr_maybe_release(&mosample_fixed_cs);
+    svr_maybe_release(&mosample_fixed_downsample_cs);
     svr_maybe_release(&mosample_cb);
+    svr_maybe_release(&mosample_tables_cb);
 }
 
 void ProcState::mosample_free_dynamic()
 {
+    mosample_free_textures();
 }
 
 bool ProcState::mosample_start()
@@ -144,10 +249,7 @@ bool ProcState::mosample_start()
         goto rfail;
     }
 
-    mosample_remainder = 0.0f;
-
-    s32 sps = movie_profile.video_fps * movie_profile.mosample_mult;
-    mosample_remainder_step = (1.0f / sps) / (1.0f / movie_profile.video_fps);
+    svr_subframes_init(&mosample_subframes, movie_profile.mosample_mult, movie_profile.mosample_exposure);
 
     ret = true;
     goto rexit;
@@ -160,23 +262,46 @@ rexit:
 
 void ProcState::mosample_end()
 {
+    // The format of the work texture depends on the profile of the next movie.
+    mosample_free_textures();
+}
+
+// Black is the only color that will work here, because the motion sampling is additive.
+void ProcState::mosample_clear_work_tex()
+{
+    if (mosample_use_fixed)
+    {
+        UINT clear_values[] = { 0, 0, 0, 0 };
+        vid_d3d11_context->ClearUnorderedAccessViewUint(mosample_work_tex_uav, clear_values);
+    }
+
+    else
+    {
+        vid_clear_rtv(mosample_work_tex_rtv, 0.0f, 0.0f, 0.0f, 1.0f);
+    }
 }
 
 // TODO Probably consider to process several frames at once instead of just 1.
-void ProcState::mosample_process(float weight)
+void ProcState::mosample_process(SvrSubframe sub)
 {
-    if (weight != mosample_weight_cache)
+    svr_trace_begin("Mosample");
+
+    if (sub.weight != mosample_weight_cache.weight || sub.weight_start != mosample_weight_cache.weight_start || sub.weight_end != mosample_weight_cache.weight_end)
     {
         MosampleCb cb_data;
-        cb_data.mosample_weight = weight;
+        cb_data.mosample_weight = sub.weight;
+        cb_data.mosample_weight_start = sub.weight_start;
+        cb_data.mosample_weight_end = sub.weight_end;
 
-        mosample_weight_cache = weight;
+        mosample_weight_cache = sub;
         vid_update_constant_buffer(mosample_cb, &cb_data, sizeof(MosampleCb));
     }
 
-    vid_d3d11_context->CSSetShader(mosample_cs, NULL, 0);
+    ID3D11Buffer* cbs[] = { mosample_cb, mosample_tables_cb };
+
+    vid_d3d11_context->CSSetShader(mosample_use_fixed ? mosample_fixed_cs : mosample_cs, NULL, 0);
     vid_d3d11_context->CSSetShaderResources(0, 1, &svr_game_texture.srv);
-    vid_d3d11_context->CSSetConstantBuffers(0, 1, &mosample_cb);
+    vid_d3d11_context->CSSetConstantBuffers(0, SVR_ARRAY_SIZE(cbs), cbs);
     vid_d3d11_context->CSSetUnorderedAccessViews(0, 1, &mosample_work_tex_uav, NULL);
 
     vid_d3d11_context->Dispatch(vid_get_num_cs_threads(movie_width), vid_get_num_cs_threads(movie_height), 1);
@@ -188,66 +313,36 @@ void ProcState::mosample_process(float weight)
 
     vid_d3d11_context->CSSetShaderResources(0, 1, &null_srv);
     vid_d3d11_context->CSSetUnorderedAccessViews(0, 1, &null_uav, NULL);
+
+    svr_trace_end();
 }
 
 void ProcState::mosample_new_video_frame()
 {
-    float old_rem = mosample_remainder;
-    float exposure = movie_profile.mosample_exposure;
-
-    mosample_remainder += mosample_remainder_step;
+    SvrSubframe sub = svr_subframes_advance(&mosample_subframes);
 
-    if (mosample_remainder <= (1.0f - exposure))
+    if (sub.weight > 0.0f)
     {
+        mosample_process(sub);
     }
 
-    else if (mosample_remainder < 1.0f)
+    if (sub.ends_frame)
     {
-        float weight = (mosample_remainder - svr_max(1.0f - exposure, old_rem)) * (1.0f / exposure);
-        mosample_process(weight);
-    }
-
-    else
-    {
-        float weight = (1.0f - svr_max(1.0f - exposure, old_rem)) * (1.0f / exposure);
-
-        mosample_process(weight);
-
         mosample_downsample_to_share_tex();
 
         process_finished_shared_tex();
 
-        mosample_remainder -= 1.0f;
-
-        s32 additional = mosample_remainder;
-
-        if (additional > 0)
-        {
-            for (s32 i = 0; i < additional; i++)
-            {
-                process_finished_shared_tex();
-            }
-
-            mosample_remainder -= additional;
-        }
-
-        // Black is the only color that will work here, because the motion sampling is additive.
-        vid_clear_rtv(mosample_work_tex_rtv, 0.0f, 0.0f, 0.0f, 1.0f);
-
-        if (mosample_remainder > FLT_EPSILON && mosample_remainder > (1.0f - exposure))
-        {
-            weight = ((mosample_remainder - (1.0f - exposure)) * (1.0f / exposure));
-            mosample_process(weight);
-        }
+        mosample_clear_work_tex();
     }
 }
 
-// Downsample 128 bpp texture to 32 bpp texture.
+// Downsample 128 bpp (or 64 bpp fixed point) texture to 32 bpp texture.
 void ProcState::mosample_downsample_to_share_tex()
 {
-    vid_d3d11_context->CSSetShader(mosample_downsample_cs, NULL, 0);
+    vid_d3d11_context->CSSetShader(mosample_use_fixed ? mosample_fixed_downsample_cs : mosample_downsample_cs, NULL, 0);
     vid_d3d11_context->CSSetShaderResources(0, 1, &mosample_work_tex_srv);
-    vid_d3d11_context->CSSetUnorderedAccessViews(0, 1, &encoder_share_tex_uav, NULL);
+    vid_d3d11_context->CSSetConstantBuffers(1, 1, &mosample_tables_cb);
+    vid_d3d11_context->CSSetUnorderedAccessViews(0, 1, &encoder_get_share_tex()->uav, NULL);
 
     vid_d3d11_context->Dispatch(vid_get_num_cs_threads(movie_width), vid_get_num_cs_threads(movie_height), 1);
 
@@ -2,6 +2,7 @@
 #include "svr_common.h"
 #include "svr_defs.h"
 #include "svr_log.h"
+#include "svr_trace.h"
 #include "svr_console.h"
 #include "svr_queue.h"
 #include "encoder_shared.h"
@@ -17,8 +18,12 @@
 #include "svr_prof.h"
 #include <stb_sprintf.h>
 #include "svr_api.h"
+#include "svr_capture.h"
 #include "svr_ini.h"
 #include "svr_alloc.h"
+#include "svr_subframes.h"
+#include "svr_mosample.h"
+#include "svr_glyph_atlas.h"
 #include <Shlwapi.h>
 #include <math.h>
 #include <float.h>
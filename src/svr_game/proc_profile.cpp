@@ -138,12 +138,18 @@ bool ProcState::movie_load_profile(const char* name, bool required)
     ret &= OPT_STR_LIST(ini_root, "video_x264_preset", X264_PRESET_TABLE, &movie_profile.video_x264_preset);
     ret &= OPT_BOOL(ini_root, "video_x264_intra", &movie_profile.video_x264_intra);
     ret &= OPT_STR_LIST(ini_root, "video_dnxhr_profile", DNXHR_PROFILE_TABLE, &movie_profile.video_dnxhr_profile);
+    ret &= OPT_S32(ini_root, "encoder_max_queued_mb", 0, INT32_MAX, &movie_profile.encoder_max_queued_mb);
+    ret &= OPT_BOOL(ini_root, "encoder_cpu_conversion", &movie_profile.encoder_cpu_conversion);
+    ret &= OPT_S32(ini_root, "encoder_chunk_threads", 0, 64, &movie_profile.encoder_chunk_threads);
+    ret &= OPT_S32(ini_root, "encoder_chunk_frames", 1, INT32_MAX, &movie_profile.encoder_chunk_frames);
     ret &= OPT_BOOL(ini_root, "audio_enabled", &movie_profile.audio_enabled);
     ret &= OPT_STR_LIST(ini_root, "audio_encoder", AUDIO_ENCODER_TABLE, &movie_profile.audio_encoder);
 
     ret &= OPT_BOOL(ini_root, "motion_blur_enabled", &movie_profile.mosample_enabled);
     ret &= OPT_S32(ini_root, "motion_blur_fps_mult", 2, INT32_MAX, &movie_profile.mosample_mult);
     ret &= OPT_FLOAT(ini_root, "motion_blur_exposure", 0.0f, 1.0f, &movie_profile.mosample_exposure);
+    ret &= OPT_BOOL(ini_root, "motion_blur_skip_closed", &movie_profile.mosample_skip_closed);
+    ret &= OPT_BOOL(ini_root, "motion_blur_fixed_point", &movie_profile.mosample_fixed_point);
 
     ret &= OPT_BOOL(ini_root, "velo_enabled", &movie_profile.velo_enabled);
     OPT_STR(ini_root, "velo_output", &movie_profile.velo_output);
@@ -158,6 +164,10 @@ bool ProcState::movie_load_profile(const char* name, bool required)
     ret &= OPT_STR_MAP(ini_root, "velo_anchor", VELO_ANCHOR_TABLE, &movie_profile.velo_anchor);
     ret &= OPT_STR_MAP(ini_root, "velo_length", VELO_LENGTH_TABLE, &movie_profile.velo_length);
 
+    OPT_STR(ini_root, "capture_output", &movie_profile.capture_output);
+
+    ret &= OPT_BOOL(ini_root, "trace_enabled", &movie_profile.trace_enabled);
+
     if (!required)
     {
         ret = true;
@@ -64,6 +64,15 @@ rexit:
 
 void ProcState::new_video_frame()
 {
+    svr_trace_begin("New video frame");
+
+    if (capture_file_h)
+    {
+        svr_trace_begin("Capture");
+        capture_video_frame();
+        svr_trace_end();
+    }
+
     // If we are using mosample, we will have to accumulate enough frames before we can start sending.
     // Mosample will internally send the frames when they are ready.
     if (movie_profile.mosample_enabled)
@@ -74,14 +83,25 @@ void ProcState::new_video_frame()
     // No mosample, just send the frame over directly.
     else
     {
-        vid_d3d11_context->CopyResource(encoder_share_tex, svr_game_texture.tex);
+        vid_d3d11_context->CopyResource(encoder_get_share_tex()->tex, svr_game_texture.tex);
         process_finished_shared_tex();
     }
+
+    svr_trace_end();
 }
 
 void ProcState::new_audio_samples(SvrWaveSample *samples, s32 num_samples)
 {
+    svr_trace_begin("New audio samples");
+
+    if (capture_file_h)
+    {
+        capture_audio_samples(samples, num_samples);
+    }
+
     encoder_send_audio_samples(samples, num_samples);
+
+    svr_trace_end();
 }
 
 bool ProcState::is_velo_enabled()
@@ -94,14 +114,18 @@ bool ProcState::is_audio_enabled()
     return movie_profile.audio_enabled;
 }
 
-// Call this when you have written everything you need to encoder_share_tex.
+// Call this when you have written everything you need to the current share texture.
 void ProcState::process_finished_shared_tex()
 {
     // Now is the time to draw the velo if we have it.
     if (movie_profile.velo_enabled)
     {
         if (movie_profile.velo_output == NULL)
+        {
+            svr_trace_begin("Velo");
             velo_draw();
+            svr_trace_end();
+        }
         else
         {
             velo_file << svr_va("%i %.2f %.2f %.2f\n", *demo_tick_ptr, velo_vector.x, velo_vector.y, velo_vector.z);
@@ -125,6 +149,10 @@ bool ProcState::start(const char *dest_file, const char *profile, ProcGameTextur
     svr_game_texture = *game_texture;
     svr_audio_params = *audio_params;
 
+    // Only the game thread records into the trace.
+    svr_trace_reset();
+    svr_trace_thread_start("GAME MAIN THREAD");
+
     // Build output video path.
 
     SVR_SNPRINTF(movie_path, "%s\\movies\\", svr_resource_path);
@@ -170,11 +198,18 @@ bool ProcState::start(const char *dest_file, const char *profile, ProcGameTextur
         }
     }
 
+    svr_trace_set_timeline(movie_profile.trace_enabled);
+
     if (!vid_start())
     {
         goto rfail;
     }
 
+    if (!capture_start())
+    {
+        goto rfail;
+    }
+
     if (!mosample_start())
     {
         goto rfail;
@@ -203,8 +238,10 @@ rexit:
 void ProcState::end()
 {
     encoder_end();
+    log_trace();
     mosample_end();
     velo_end();
+    capture_end();
     vid_end();
 
     svr_game_texture = {};
@@ -223,9 +260,21 @@ void ProcState::free_dynamic()
     encoder_free_dynamic();
     mosample_free_dynamic();
     velo_free_dynamic();
+    capture_free_dynamic();
     vid_free_dynamic();
 }
 
+// Where the time went in this process. The encoder does the same for its threads.
+void ProcState::log_trace()
+{
+    svr_trace_log_stats();
+
+    if (movie_profile.trace_enabled)
+    {
+        svr_trace_write(svr_va("%s\\data\\SVR_TRACE.json", svr_resource_path));
+    }
+}
+
 s32 ProcState::get_game_rate()
 {
     if (movie_profile.mosample_enabled)
@@ -235,3 +284,26 @@ s32 ProcState::get_game_rate()
 
     return movie_profile.video_fps;
 }
+
+// How many frames of get_game_rate the next game frame should advance.
+// Only the callers that ask for this will have frames skipped, the others keep getting every frame.
+s32 ProcState::get_next_frame_steps()
+{
+    if (!movie_profile.mosample_enabled)
+    {
+        return 1;
+    }
+
+    if (movie_profile.mosample_skip_closed && !mosample_subframes.skip_closed)
+    {
+        mosample_subframes.skip_closed = true;
+
+        // Replays have to skip the same frames.
+        if (capture_file_h)
+        {
+            capture_frame_steps(svr_subframes_get_next_steps(&mosample_subframes));
+        }
+    }
+
+    return svr_subframes_get_next_steps(&mosample_subframes);
+}
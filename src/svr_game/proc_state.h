@@ -11,6 +11,20 @@ struct ProcGameTexture
     ID3D11ShaderResourceView* srv;
 };
 
+// Texture that video frames are written to for svr_encoder.
+// High precision textures are not allowed to be shared, so we need to downsample the result of the mosample to 32 bpp.
+// This texture is the final result from all prior processing, such as motion blur and velo text.
+struct ProcShareTexture
+{
+    ID3D11Texture2D* tex;
+    ID3D11UnorderedAccessView* uav;
+    ID3D11RenderTargetView* rtv;
+    ID3D11ShaderResourceView* srv;
+    HANDLE h;
+    ID2D1Bitmap1* d2d1_bitmap; // Not a real texture, but a reference to tex.
+    IDXGIKeyedMutex* lock;
+};
+
 using ProcVeloAnchor = s32;
 
 enum /* ProcVeloAnchor */
@@ -40,12 +54,18 @@ struct MovieProfile
     s32 video_fps;
     s32 video_x264_crf;
     s32 video_x264_intra;
+    s32 encoder_max_queued_mb;
+    s32 encoder_cpu_conversion;
+    s32 encoder_chunk_threads;
+    s32 encoder_chunk_frames;
     s32 audio_enabled;
 
     // Mosample options:
     s32 mosample_enabled;
     s32 mosample_mult;
     float mosample_exposure;
+    s32 mosample_skip_closed;
+    s32 mosample_fixed_point;
 
     // Velo options:
     s32 velo_enabled;
@@ -60,6 +80,12 @@ struct MovieProfile
     SvrVec2I velo_align;
     ProcVeloAnchor velo_anchor;
     ProcVeloLength velo_length;
+
+    // Capture options:
+    char* capture_output;
+
+    // Profiling options:
+    s32 trace_enabled;
 };
 
 struct ProcState
@@ -83,6 +109,8 @@ struct ProcState
     void free_static();
     void free_dynamic();
     s32 get_game_rate();
+    s32 get_next_frame_steps();
+    void log_trace();
 
     // -----------------------------------------------
     // Video state:
@@ -126,6 +154,15 @@ struct ProcState
 
     UINT16 velo_number_glyph_idxs[10]; // Glyph indexes for all numbers so we don't have to look that up every time.
 
+    // The numbers with their fill and border are drawn once when the movie starts, and put together into a line for every frame.
+    SvrGlyphAtlas velo_atlas;
+    u8* velo_line_pixels;
+    s32 velo_line_pitch;
+    SvrVec2I velo_line_size; // Size of the current line.
+    ID2D1Bitmap1* velo_line_bitmap; // Line that is drawn to the share texture.
+    s32 velo_line_speed; // Speed that is in the line, so the same line is not put together again. Negative when there is no line.
+    s32 velo_line_length; // Number of digits in the line.
+
     SvrVec3 velo_vector;
     std::ofstream velo_file;
 
@@ -135,6 +172,11 @@ struct ProcState
     bool velo_create_font_face();
     void velo_setup_tab_metrix();
     void velo_setup_glyph_idxs();
+    bool velo_create_atlas();
+    bool velo_draw_atlas_glyphs(ID2D1Bitmap1* target, ID2D1PathGeometry** geoms);
+    bool velo_read_atlas_pixels(ID2D1Bitmap1* target);
+    void velo_free_atlas();
+    void velo_update_line(s32 speed);
     bool velo_start();
     void velo_end();
     void velo_draw();
@@ -145,7 +187,7 @@ struct ProcState
     // -----------------------------------------------
     // Motion blur state:
 
-    // High precision texture used for the result of mosample (total 128 bits per pixel).
+    // High precision texture used for the result of mosample (total 128 bits per pixel, or 64 bits per pixel in fixed point).
     ID3D11Texture2D* mosample_work_tex;
     ID3D11RenderTargetView* mosample_work_tex_rtv;
     ID3D11ShaderResourceView* mosample_work_tex_srv;
@@ -153,25 +195,37 @@ struct ProcState
 
     ID3D11ComputeShader* mosample_cs;
     ID3D11ComputeShader* mosample_downsample_cs;
+    ID3D11ComputeShader* mosample_fixed_cs;
+    ID3D11ComputeShader* mosample_fixed_downsample_cs;
+
+    // Set when the work texture is in the fixed point format, see svr_mosample.h.
+    bool mosample_use_fixed;
 
     // Constains the mosample weight.
     ID3D11Buffer* mosample_cb;
 
+    // Tables for the fixed point format.
+    ID3D11Buffer* mosample_tables_cb;
+
     // To not upload data all the time.
-    float mosample_weight_cache;
+    SvrSubframe mosample_weight_cache;
 
-    float mosample_remainder;
-    float mosample_remainder_step;
+    // Which game frames are rendered and their weights.
+    SvrSubframes mosample_subframes;
 
     bool mosample_init();
     bool mosample_create_buffer();
     bool mosample_create_shaders();
+    bool mosample_create_fixed_shaders();
     bool mosample_create_textures();
+    bool mosample_has_fixed_support();
+    void mosample_free_textures();
+    void mosample_clear_work_tex();
     void mosample_free_static();
     void mosample_free_dynamic();
     bool mosample_start();
     void mosample_end();
-    void mosample_process(float weight);
+    void mosample_process(SvrSubframe sub);
     void mosample_new_video_frame();
     void mosample_downsample_to_share_tex();
 
@@ -183,23 +237,18 @@ struct ProcState
     HANDLE game_wake_event_h;
     HANDLE encoder_wake_event_h;
     EncoderSharedMem* encoder_shared_ptr;
-    void* encoder_audio_buffer;
-
-    // FIFO of audio samples we need to send to the encoder.
-    // During motion blur capture, the number of samples sent from the game will be very low (like 12).
-    // We should not wake up the encoder and wait for just that little, so queue up a bunch instead and send many.
-    SvrDynQueue<SvrWaveSample> encoder_pending_samples;
-
-    // Intermediate texture needed for texture sharing.
-    // High precision textures are not allowed to be shared, so we need to downsample the result of the mosample to 32 bpp.
-    // This texture is the final result from all prior processing, such as motion blur and velo text.
-    ID3D11Texture2D* encoder_share_tex;
-    ID3D11UnorderedAccessView* encoder_share_tex_uav;
-    ID3D11RenderTargetView* encoder_share_tex_rtv;
-    ID3D11ShaderResourceView* encoder_share_tex_srv;
-    HANDLE encoder_share_tex_h;
-    ID2D1Bitmap1* encoder_d2d1_share_tex; // Not a real texture, but a reference to encoder_share_tex.
-    IDXGIKeyedMutex* encoder_share_tex_lock;
+
+    // Ring of audio samples for svr_encoder (see encoder_shared.h).
+    SvrWaveSample* encoder_audio_ring;
+    u32 encoder_audio_write_idx; // How many audio samples have been sent.
+
+    // Ring of textures for sending video frames (see encoder_shared.h).
+    // We can continue with the next frame while svr_encoder reads the previous ones, and only have to wait when all of them are in use.
+    ProcShareTexture encoder_share_texs[ENCODER_NUM_VIDEO_TEXTURES];
+    s32 encoder_share_tex_idx; // The texture the next video frame is written to. We own this one.
+    s32 encoder_video_write_idx; // How many video frames have been sent.
+
+    bool encoder_error_shown; // Errors from svr_encoder are only shown once.
 
     bool encoder_init();
     void encoder_free_static();
@@ -208,15 +257,41 @@ struct ProcState
     bool encoder_start_process();
     bool encoder_start();
     bool encoder_create_share_textures();
+    bool encoder_create_share_texture(ProcShareTexture* share_tex);
+    void encoder_free_share_texture(ProcShareTexture* share_tex);
+    ProcShareTexture* encoder_get_share_tex();
+    bool encoder_acquire_share_tex();
+    bool encoder_check_error();
     bool encoder_set_shared_mem_params();
     void encoder_end();
     bool encoder_send_event(EncoderSharedEvent event);
     bool encoder_send_shared_tex();
     bool encoder_send_audio_samples(SvrWaveSample* samples, s32 num_samples);
-    void encoder_flush_audio();
-    bool encoder_submit_pending_samples();
-    bool encoder_send_audio_from_pending(s32 num_samples);
-    bool encoder_create_d2d1_bitmap();
+    s32 encoder_get_free_audio_samples();
+    bool encoder_wait_for_audio_space();
+    bool encoder_create_d2d1_bitmap(ProcShareTexture* share_tex);
+
+    // -----------------------------------------------
+    // Capture state:
+
+    HANDLE capture_file_h; // Only set when capturing.
+    ID3D11Texture2D* capture_download_tex; // For reading the game texture.
+    void* capture_frame_mem; // Tightly packed rows, for when the row pitch of the download texture has padding.
+    s32 capture_pitch;
+    s32 capture_num_frames;
+
+    bool capture_start();
+    void capture_end();
+    void capture_free_dynamic();
+    s32 capture_get_format_bpp(DXGI_FORMAT format);
+    bool capture_create_download_tex(D3D11_TEXTURE2D_DESC* game_desc);
+    bool capture_write(void* data, s32 size);
+    bool capture_write_chunk(SvrCaptureChunkType type, void* data, s32 size);
+    void capture_stop_on_error();
+    void capture_video_frame();
+    void capture_audio_samples(SvrWaveSample* samples, s32 num_samples);
+    void capture_velo(SvrVec3 source);
+    void capture_frame_steps(s32 steps);
 
     // -----------------------------------------------
     // Movie state:
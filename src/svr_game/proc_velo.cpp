@@ -1,6 +1,12 @@
 #include "proc_priv.h"
 #include <fstream>
 
+// Most digits the speed can have.
+const s32 VELO_MAX_DIGITS = 10;
+
+// Empty space around the glyphs in the atlas, for antialiasing and hinting that goes outside the outline.
+const s32 VELO_ATLAS_PADDING = 2;
+
 bool ProcState::velo_init()
 {
     return true;
@@ -12,6 +18,7 @@ void ProcState::velo_free_static()
 
 void ProcState::velo_free_dynamic()
 {
+    velo_free_atlas();
     svr_maybe_release(&velo_font_face);
 }
 
@@ -110,6 +117,238 @@ void ProcState::velo_setup_glyph_idxs()
     velo_font_face->GetGlyphIndicesW(CPS, SVR_ARRAY_SIZE(CPS), velo_number_glyph_idxs);
 }
 
+// Draw every number once into a texture and read it back into velo_atlas.
+// The numbers are drawn in the same way as they used to be drawn for every frame, so they look the same except that every glyph starts on a whole pixel.
+bool ProcState::velo_create_atlas()
+{
+    bool ret = false;
+    HRESULT hr;
+
+    ID2D1PathGeometry* geoms[10] = {};
+    ID2D1Bitmap1* target = NULL;
+    D2D1_BITMAP_PROPERTIES1 props;
+    D2D1_RECT_F bounds = D2D1::RectF(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+    s32 origin_x;
+    s32 origin_y;
+    s32 cell_width;
+    s32 cell_height;
+
+    // Find the area that all glyphs fit in, including the border.
+    for (s32 i = 0; i < 10; i++)
+    {
+        ID2D1GeometrySink* sink = NULL;
+        D2D1_RECT_F glyph_bounds;
+
+        vid_d2d1_factory->CreatePathGeometry(&geoms[i]);
+        geoms[i]->Open(&sink);
+        velo_font_face->GetGlyphRunOutline(movie_profile.velo_font_size, &velo_number_glyph_idxs[i], NULL, NULL, 1, FALSE, FALSE, sink);
+        sink->Close();
+        svr_release(sink);
+
+        if (movie_profile.velo_font_border_size > 0)
+        {
+            geoms[i]->GetWidenedBounds(movie_profile.velo_font_border_size, NULL, NULL, &glyph_bounds);
+        }
+
+        else
+        {
+            geoms[i]->GetBounds(NULL, &glyph_bounds);
+        }
+
+        // Glyphs without an outline have empty bounds.
+        if (glyph_bounds.left > glyph_bounds.right)
+        {
+            continue;
+        }
+
+        bounds.left = svr_min(bounds.left, glyph_bounds.left);
+        bounds.top = svr_min(bounds.top, glyph_bounds.top);
+        bounds.right = svr_max(bounds.right, glyph_bounds.right);
+        bounds.bottom = svr_max(bounds.bottom, glyph_bounds.bottom);
+    }
+
+    if (bounds.left > bounds.right)
+    {
+        bounds = D2D1::RectF(0, 0, 0, 0);
+    }
+
+    origin_x = -(s32)floorf(bounds.left) + VELO_ATLAS_PADDING;
+    origin_y = -(s32)floorf(bounds.top) + VELO_ATLAS_PADDING;
+    cell_width = origin_x + (s32)ceilf(bounds.right) + VELO_ATLAS_PADDING;
+    cell_height = origin_y + (s32)ceilf(bounds.bottom) + VELO_ATLAS_PADDING;
+
+    svr_glyph_atlas_init(&velo_atlas, 10, cell_width, cell_height, origin_x, origin_y);
+
+    props = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+    hr = vid_d2d1_context->CreateBitmap(D2D1::SizeU(10 * cell_width, cell_height), NULL, 0, &props, &target);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: ID2D1DeviceContext::CreateBitmap returned %#x for the velo atlas\n", hr);
+        goto rfail;
+    }
+
+    if (!velo_draw_atlas_glyphs(target, geoms))
+    {
+        goto rfail;
+    }
+
+    if (!velo_read_atlas_pixels(target))
+    {
+        goto rfail;
+    }
+
+    // Room for the longest line, which is then copied to the share texture in one draw.
+    velo_line_size = svr_glyph_atlas_get_line_size(&velo_atlas, VELO_MAX_DIGITS, velo_tab_advance_x);
+    velo_line_pitch = velo_line_size.x * 4;
+    velo_line_pixels = (u8*)svr_zalloc(velo_line_pitch * velo_line_size.y);
+    velo_line_speed = -1;
+
+    props = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_NONE, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+    hr = vid_d2d1_context->CreateBitmap(D2D1::SizeU(velo_line_size.x, velo_line_size.y), NULL, 0, &props, &velo_line_bitmap);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: ID2D1DeviceContext::CreateBitmap returned %#x for the velo line\n", hr);
+        goto rfail;
+    }
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    velo_free_atlas();
+
+rexit:
+    for (s32 i = 0; i < 10; i++)
+    {
+        svr_maybe_release(&geoms[i]);
+    }
+
+    svr_maybe_release(&target);
+
+    return ret;
+}
+
+bool ProcState::velo_draw_atlas_glyphs(ID2D1Bitmap1* target, ID2D1PathGeometry** geoms)
+{
+    HRESULT hr;
+
+    vid_d2d1_context->BeginDraw();
+    vid_d2d1_context->SetTarget(target);
+    vid_d2d1_context->Clear(D2D1::ColorF(0, 0, 0, 0));
+
+    // ClearType needs to know what is behind the text, which is not known here.
+    vid_d2d1_context->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+
+    for (s32 i = 0; i < 10; i++)
+    {
+        SvrVec2I pos;
+        pos.x = i * velo_atlas.cell_width + velo_atlas.origin_x;
+        pos.y = velo_atlas.origin_y;
+
+        if (movie_profile.velo_font_border_size > 0)
+        {
+            vid_d2d1_context->SetTransform(D2D1::Matrix3x2F::Translation(pos.x, pos.y));
+
+            // Draw the fill.
+            vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_color));
+            vid_d2d1_context->FillGeometry(geoms[i], vid_d2d1_solid_brush);
+
+            // Draw the border.
+            vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_border_color));
+            vid_d2d1_context->DrawGeometry(geoms[i], vid_d2d1_solid_brush, movie_profile.velo_font_border_size);
+        }
+
+        // Use more specialized path with no border.
+        else
+        {
+            DWRITE_GLYPH_RUN run = {};
+            run.fontFace = velo_font_face;
+            run.fontEmSize = movie_profile.velo_font_size;
+            run.glyphCount = 1;
+            run.glyphIndices = &velo_number_glyph_idxs[i];
+
+            vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_color));
+            vid_d2d1_context->DrawGlyphRun(vid_fill_d2d1_pt(pos), &run, vid_d2d1_solid_brush);
+        }
+    }
+
+    vid_d2d1_context->SetTransform(D2D1::Matrix3x2F::Identity());
+    vid_d2d1_context->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_DEFAULT);
+
+    hr = vid_d2d1_context->EndDraw();
+    vid_d2d1_context->SetTarget(NULL);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: Could not draw the velo atlas (%#x)\n", hr);
+        return false;
+    }
+
+    return true;
+}
+
+bool ProcState::velo_read_atlas_pixels(ID2D1Bitmap1* target)
+{
+    bool ret = false;
+    HRESULT hr;
+
+    ID2D1Bitmap1* download = NULL;
+    D2D1_MAPPED_RECT mapped;
+    D2D1_BITMAP_PROPERTIES1 props = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+                                                            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+
+    hr = vid_d2d1_context->CreateBitmap(D2D1::SizeU(10 * velo_atlas.cell_width, velo_atlas.cell_height), NULL, 0, &props, &download);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: ID2D1DeviceContext::CreateBitmap returned %#x for reading the velo atlas\n", hr);
+        goto rfail;
+    }
+
+    download->CopyFromBitmap(NULL, target, NULL);
+
+    hr = download->Map(D2D1_MAP_OPTIONS_READ, &mapped);
+
+    if (FAILED(hr))
+    {
+        svr_log("ERROR: ID2D1Bitmap1::Map returned %#x for the velo atlas\n", hr);
+        goto rfail;
+    }
+
+    for (s32 i = 0; i < velo_atlas.cell_height; i++)
+    {
+        memcpy(velo_atlas.pixels + i * velo_atlas.pitch, mapped.bits + i * mapped.pitch, velo_atlas.pitch);
+    }
+
+    download->Unmap();
+
+    ret = true;
+    goto rexit;
+
+rfail:
+
+rexit:
+    svr_maybe_release(&download);
+
+    return ret;
+}
+
+void ProcState::velo_free_atlas()
+{
+    svr_glyph_atlas_free(&velo_atlas);
+    svr_maybe_release(&velo_line_bitmap);
+
+    if (velo_line_pixels)
+    {
+        svr_free(velo_line_pixels);
+        velo_line_pixels = NULL;
+    }
+
+    velo_line_size = {};
+}
+
 bool ProcState::velo_start()
 {
     bool ret = false;
@@ -132,6 +371,14 @@ bool ProcState::velo_start()
     velo_setup_tab_metrix();
     velo_setup_glyph_idxs();
 
+    if (movie_profile.velo_enabled && movie_profile.velo_output == NULL)
+    {
+        if (!velo_create_atlas())
+        {
+            goto rfail;
+        }
+    }
+
     ret = true;
     goto rexit;
 
@@ -145,42 +392,59 @@ rexit:
 void ProcState::velo_end()
 {
     if (velo_file.is_open()) velo_file.close();
+
+    // The atlas depends on the profile of the next movie.
+    velo_free_atlas();
 }
 
-void ProcState::velo_draw()
+// Put the numbers of the speed together into the line image and upload it.
+void ProcState::velo_update_line(s32 speed)
 {
-    float length = velo_get_length();
-    s32 speed = (s32)(sqrtf(length) + 0.5f);
-
     char buf[128];
     s32 text_length = SVR_SNPRINTF(buf, "%d", speed);
 
-    UINT16* idxs = SVR_ALLOCA_NUM(UINT16, text_length);
-    float* advances = SVR_ALLOCA_NUM(float, text_length);
+    s32 digits[VELO_MAX_DIGITS];
 
-    // Map the glyph indexes.
     for (s32 i = 0; i < text_length; i++)
     {
-        s32 idx = buf[i] - '0';
-        idxs[i] = velo_number_glyph_idxs[idx];
+        digits[i] = buf[i] - '0';
     }
 
-    // Emulation of tabular font feature where every number is monospaced.
-    // For the full feature, the font itself also changes its shaping for the glyphs to be wider, but that is not important.
-    // This also prevents the text from jittering when it changes during the centering logic. Typically caused by the 1 character sometimes being thinner than other characters.
+    // Every number has the same advance, see velo_setup_tab_metrix.
+    velo_line_size = svr_glyph_atlas_get_line_size(&velo_atlas, text_length, velo_tab_advance_x);
 
-    for (s32 i = 0; i < text_length; i++)
+    for (s32 i = 0; i < velo_line_size.y; i++)
+    {
+        memset(velo_line_pixels + i * velo_line_pitch, 0, velo_line_size.x * 4);
+    }
+
+    svr_glyph_atlas_draw_line(&velo_atlas, digits, text_length, velo_tab_advance_x, velo_atlas.origin_x, velo_atlas.origin_y,
+                              velo_line_pixels, velo_line_pitch, velo_line_size.x, velo_line_size.y);
+
+    D2D1_RECT_U rect = D2D1::RectU(0, 0, velo_line_size.x, velo_line_size.y);
+    velo_line_bitmap->CopyFromMemory(&rect, velo_line_pixels, velo_line_pitch);
+
+    velo_line_speed = speed;
+    velo_line_length = text_length;
+}
+
+void ProcState::velo_draw()
+{
+    float length = velo_get_length();
+
+    // Keep to the digits that fit in the line.
+    s32 speed = (s32)svr_min(sqrtf(length) + 0.5f, 999999999.0f);
+
+    if (speed != velo_line_speed)
     {
-        advances[i] = velo_tab_advance_x;
+        velo_update_line(speed);
     }
 
     // Vertical positioning is done from the baseline.
 
-    float w = text_length * velo_tab_advance_x;
-    float h = velo_tab_height;
+    float w = velo_line_length * velo_tab_advance_x;
 
     s32 real_w = (s32)ceilf(w);
-    s32 real_h = (s32)ceilf(h);
     s32 shift_x = real_w / 2;
 
     SvrVec2I pos = velo_draw_pos;
@@ -195,51 +459,17 @@ void ProcState::velo_draw()
         pos.x -= real_w;
     }
 
-    vid_d2d1_context->BeginDraw();
-    vid_d2d1_context->SetTarget(encoder_d2d1_share_tex);
-
-    if (movie_profile.velo_font_border_size > 0)
-    {
-        ID2D1PathGeometry* geom;
-        vid_d2d1_factory->CreatePathGeometry(&geom);
-
-        ID2D1GeometrySink* sink;
-        geom->Open(&sink);
-
-        velo_font_face->GetGlyphRunOutline(movie_profile.velo_font_size, idxs, advances, NULL, text_length, FALSE, FALSE, sink);
-
-        sink->Close();
-
-        vid_d2d1_context->SetTransform(D2D1::Matrix3x2F::Translation(pos.x, pos.y));
+    // The line has the origin of the first glyph at the cell origin.
+    s32 left = pos.x - velo_atlas.origin_x;
+    s32 top = pos.y - velo_atlas.origin_y;
 
-        // Draw the fill.
-        vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_color));
-        vid_d2d1_context->FillGeometry(geom, vid_d2d1_solid_brush);
+    D2D1_RECT_F dest_rect = D2D1::RectF(left, top, left + velo_line_size.x, top + velo_line_size.y);
+    D2D1_RECT_F source_rect = D2D1::RectF(0, 0, velo_line_size.x, velo_line_size.y);
 
-        // Draw the border.
-        vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_border_color));
-        vid_d2d1_context->DrawGeometry(geom, vid_d2d1_solid_brush, movie_profile.velo_font_border_size);
-
-        svr_release(geom);
-        geom = NULL;
-
-        svr_release(sink);
-        sink = NULL;
-    }
+    vid_d2d1_context->BeginDraw();
+    vid_d2d1_context->SetTarget(encoder_get_share_tex()->d2d1_bitmap);
 
-    // Use more specialized path with no border.
-    else
-    {
-        DWRITE_GLYPH_RUN run = {};
-        run.fontFace = velo_font_face;
-        run.fontEmSize = movie_profile.velo_font_size;
-        run.glyphCount = text_length;
-        run.glyphIndices = idxs;
-        run.glyphAdvances = advances;
-
-        vid_d2d1_solid_brush->SetColor(vid_fill_d2d1_color(movie_profile.velo_font_color));
-        vid_d2d1_context->DrawGlyphRun(vid_fill_d2d1_pt(pos), &run, vid_d2d1_solid_brush);
-    }
+    vid_d2d1_context->DrawBitmap(velo_line_bitmap, &dest_rect, 1.0f, D2D1_INTERPOLATION_MODE_NEAREST_NEIGHBOR, &source_rect, NULL);
 
     vid_d2d1_context->EndDraw();
     vid_d2d1_context->SetTarget(NULL);
@@ -247,6 +477,11 @@ void ProcState::velo_draw()
 
 void ProcState::velo_give(SvrVec3 source)
 {
+    if (capture_file_h)
+    {
+        capture_velo(source);
+    }
+
     velo_vector = source;
 }
 
@@ -310,6 +310,17 @@ int svr_get_game_rate()
     return proc_state.get_game_rate();
 }
 
+int svr_get_next_frame_steps()
+{
+    if (!svr_movie_running)
+    {
+        OutputDebugStringA("SVR (svr_get_next_frame_steps): Movie is not started. It is not allowed to call this now\n");
+        return 1;
+    }
+
+    return proc_state.get_next_frame_steps();
+}
+
 void svr_stop()
 {
     if (!svr_movie_running)
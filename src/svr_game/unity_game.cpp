@@ -1,4 +1,5 @@
 #include "proc_priv.h"
+#include "proc_capture.cpp"
 #include "proc_encoder.cpp"
 #include "proc_mosample.cpp"
 #include "proc_state.cpp"
@@ -9,7 +9,7 @@ struct IpcStructure
     decltype(GetProcAddress)* GetProcAddress;
     decltype(SetDllDirectoryA)* SetDllDirectoryA;
 
-    u32 unused;
+    u32 status_mem_h; // Passed on in SvrGameInitData.
 
     char library_name[256]; // The path to the library to load.
     char export_name[256]; // The export function to call.
@@ -118,7 +118,7 @@ VOID CALLBACK ipc_remote_func(ULONG_PTR param)
 
     SvrGameInitData init_data;
     init_data.svr_path = data->svr_path;
-    init_data.unused = 0;
+    init_data.status_mem_h = data->status_mem_h;
 
     init_func(&init_data);
 
@@ -126,7 +126,7 @@ VOID CALLBACK ipc_remote_func(ULONG_PTR param)
     data->SetDllDirectoryA(NULL);
 }
 
-void LauncherState::ipc_setup_in_remote_process(LauncherGame* game, HANDLE process, HANDLE thread)
+void LauncherState::ipc_setup_in_remote_process(LauncherGame* game, HANDLE process, HANDLE thread, u32 status_mem_h)
 {
     // Allocate a sufficient enough size in the target process.
     // It needs to be able to contain all function bytes and the structure containing variable length strings.
@@ -156,7 +156,7 @@ void LauncherState::ipc_setup_in_remote_process(LauncherGame* game, HANDLE proce
     structure.LoadLibraryA = LoadLibraryA;
     structure.GetProcAddress = GetProcAddress;
     structure.SetDllDirectoryA = SetDllDirectoryA;
-    structure.unused = 0;
+    structure.status_mem_h = status_mem_h;
 
 #ifdef _WIN64
     SVR_COPY_STRING(svr_va("%s\\svr_standalone64.dll", working_dir), structure.library_name);
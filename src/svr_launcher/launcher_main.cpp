@@ -15,6 +15,13 @@ int main(int argc, char** argv)
     return 0;
 #endif
 
+    // Replaying a capture does not start any game, and svr_game will create the log file itself.
+    if (argc >= 4 && !strcmpi(argv[1], "replay"))
+    {
+        const char* profile = argc >= 5 ? argv[4] : NULL;
+        return launcher_state.replay_capture(argv[2], argv[3], profile);
+    }
+
     // For standalone mode, the launcher creates the log file that the game then appends to.
     svr_init_log("data\\SVR_LOG.txt", false);
 
@@ -16,5 +16,8 @@
 #include <WbemIdl.h>
 #include "svr_alloc.h"
 #include <Shlwapi.h>
+#include "svr_prof.h"
+#include "svr_api.h"
+#include "svr_capture.h"
 
 #include "launcher_state.h"
@@ -0,0 +1,370 @@
+#include "launcher_priv.h"
+
+// Replays a capture file made with capture_output through svr_game and svr_encoder, without any game (see svr_capture.h).
+// The calls are made in the same order as they were captured, so the produced movie will be the same every time.
+// A hardware D3D11 device is used if there is one, otherwise WARP is used so this can run on machines without a GPU.
+
+// How much of the capture file to map at once. The whole file is not mapped because it would not fit in the address space of 32-bit.
+const s64 REPLAY_VIEW_SIZE = 64LL * 1024LL * 1024LL;
+
+struct LauncherReplayApi
+{
+    decltype(svr_api_version)* api_version;
+    decltype(svr_init)* init;
+    decltype(svr_start)* start;
+    decltype(svr_get_game_rate)* get_game_rate;
+    decltype(svr_get_next_frame_steps)* get_next_frame_steps;
+    decltype(svr_stop)* stop;
+    decltype(svr_frame)* frame;
+    decltype(svr_give_velocity)* give_velocity;
+    decltype(svr_give_audio)* give_audio;
+};
+
+bool replay_load_api(HMODULE module, LauncherReplayApi* api)
+{
+    api->api_version = (decltype(api->api_version))GetProcAddress(module, "svr_api_version");
+    api->init = (decltype(api->init))GetProcAddress(module, "svr_init");
+    api->start = (decltype(api->start))GetProcAddress(module, "svr_start");
+    api->get_game_rate = (decltype(api->get_game_rate))GetProcAddress(module, "svr_get_game_rate");
+    api->get_next_frame_steps = (decltype(api->get_next_frame_steps))GetProcAddress(module, "svr_get_next_frame_steps");
+    api->stop = (decltype(api->stop))GetProcAddress(module, "svr_stop");
+    api->frame = (decltype(api->frame))GetProcAddress(module, "svr_frame");
+    api->give_velocity = (decltype(api->give_velocity))GetProcAddress(module, "svr_give_velocity");
+    api->give_audio = (decltype(api->give_audio))GetProcAddress(module, "svr_give_audio");
+
+    return api->api_version && api->init && api->start && api->get_game_rate && api->get_next_frame_steps && api->stop && api->frame && api->give_velocity && api->give_audio;
+}
+
+s32 LauncherState::replay_capture(const char* capture_path, const char* movie_name, const char* profile)
+{
+    s32 ret = 1;
+    HRESULT hr;
+    SvrCaptureHeader header;
+    HMODULE game_module = NULL;
+    LauncherReplayApi api = {};
+    ID3D11Device* device = NULL;
+    ID3D11DeviceContext* context = NULL;
+    ID3D11Texture2D* game_tex = NULL;
+    ID3D11ShaderResourceView* game_srv = NULL;
+    s64 offset = 0;
+    s32 num_frames = 0;
+    s64 start_time = 0;
+    s64 elapsed = 0;
+
+    // Same as in init, the game library and the encoder are next to us.
+    GetModuleFileNameA(NULL, working_dir, MAX_PATH);
+    PathRemoveFileSpecA(working_dir);
+
+    svr_prof_init();
+
+    if (!replay_open_capture(capture_path))
+    {
+        goto rfail;
+    }
+
+    if (replay_file_size < (s64)sizeof(SvrCaptureHeader))
+    {
+        launcher_log("ERROR: %s is not a capture file\n", capture_path);
+        goto rfail;
+    }
+
+    header = *(SvrCaptureHeader*)replay_map(0, sizeof(SvrCaptureHeader));
+
+    if (header.magic != SVR_CAPTURE_MAGIC)
+    {
+        launcher_log("ERROR: %s is not a capture file\n", capture_path);
+        goto rfail;
+    }
+
+    if (header.version != SVR_CAPTURE_VERSION)
+    {
+        launcher_log("ERROR: Capture file has version %d but only version %d can be replayed\n", header.version, SVR_CAPTURE_VERSION);
+        goto rfail;
+    }
+
+    launcher_log("Replaying %s (%dx%d, format %u, %d fps)\n", capture_path, header.video_width, header.video_height, header.video_format, header.game_rate);
+
+    char game_dll_path[MAX_PATH];
+
+#ifdef _WIN64
+    SVR_SNPRINTF(game_dll_path, "%s\\svr_game64.dll", working_dir);
+#else
+    SVR_SNPRINTF(game_dll_path, "%s\\svr_game.dll", working_dir);
+#endif
+
+    game_module = LoadLibraryA(game_dll_path);
+
+    if (game_module == NULL)
+    {
+        launcher_log("ERROR: Could not load %s (%lu)\n", game_dll_path, GetLastError());
+        goto rfail;
+    }
+
+    if (!replay_load_api(game_module, &api))
+    {
+        launcher_log("ERROR: %s is missing exports\n", game_dll_path);
+        goto rfail;
+    }
+
+    if (api.api_version() != SVR_API_VERSION)
+    {
+        launcher_log("ERROR: %s has API version %d but version %d is needed\n", game_dll_path, api.api_version(), SVR_API_VERSION);
+        goto rfail;
+    }
+
+    if (!replay_create_device(&device, &context))
+    {
+        goto rfail;
+    }
+
+    D3D11_TEXTURE2D_DESC tex_desc = {};
+    tex_desc.Width = header.video_width;
+    tex_desc.Height = header.video_height;
+    tex_desc.MipLevels = 1;
+    tex_desc.ArraySize = 1;
+    tex_desc.Format = (DXGI_FORMAT)header.video_format;
+    tex_desc.SampleDesc.Count = 1;
+    tex_desc.Usage = D3D11_USAGE_DEFAULT;
+    tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; // Required by svr_start.
+
+    hr = device->CreateTexture2D(&tex_desc, NULL, &game_tex);
+
+    if (FAILED(hr))
+    {
+        launcher_log("ERROR: Could not create game texture (%#x)\n", hr);
+        goto rfail;
+    }
+
+    hr = device->CreateShaderResourceView(game_tex, NULL, &game_srv);
+
+    if (FAILED(hr))
+    {
+        launcher_log("ERROR: Could not create game texture view (%#x)\n", hr);
+        goto rfail;
+    }
+
+    // The reference to the device is given to svr_init.
+    ID3D11Device* init_device = device;
+    device = NULL;
+
+    if (!api.init(working_dir, init_device))
+    {
+        launcher_log("ERROR: Could not init SVR, see SVR_LOG.txt\n");
+        goto rfail;
+    }
+
+    SvrStartMovieData movie_data = {};
+    movie_data.game_tex_view = game_srv; // The reference to the view is given to svr_start.
+    movie_data.audio_params = header.audio_params;
+    game_srv = NULL;
+
+    if (!api.start(movie_name, profile, &movie_data))
+    {
+        launcher_log("ERROR: Could not start movie, see SVR_LOG.txt\n");
+        goto rfail;
+    }
+
+    if (api.get_game_rate() != header.game_rate)
+    {
+        launcher_log("WARNING: Capture was made with %d fps but the profile uses %d fps, the movie will not be the same\n", header.game_rate, api.get_game_rate());
+    }
+
+    start_time = svr_prof_get_real_time();
+
+    offset = sizeof(SvrCaptureHeader);
+
+    while (offset + (s64)sizeof(SvrCaptureChunk) <= replay_file_size)
+    {
+        SvrCaptureChunk chunk = *(SvrCaptureChunk*)replay_map(offset, sizeof(SvrCaptureChunk));
+        offset += sizeof(SvrCaptureChunk);
+
+        if (chunk.size < 0 || offset + chunk.size > replay_file_size)
+        {
+            launcher_log("WARNING: Capture file is truncated, stopping the replay early\n");
+            break;
+        }
+
+        u8* data = replay_map(offset, chunk.size);
+        offset += svr_align32(chunk.size, SVR_CAPTURE_ALIGN);
+
+        switch (chunk.type)
+        {
+            case SVR_CAPTURE_CHUNK_VIDEO:
+            {
+                if (chunk.size != header.video_pitch * header.video_height)
+                {
+                    launcher_log("ERROR: Video chunk has size %d but %d was expected\n", chunk.size, header.video_pitch * header.video_height);
+                    goto rstop;
+                }
+
+                context->UpdateSubresource(game_tex, 0, NULL, data, header.video_pitch, 0);
+                api.frame();
+
+                num_frames++;
+                break;
+            }
+
+            case SVR_CAPTURE_CHUNK_AUDIO:
+            {
+                api.give_audio((SvrWaveSample*)data, chunk.size / (s32)sizeof(SvrWaveSample));
+                break;
+            }
+
+            case SVR_CAPTURE_CHUNK_VELO:
+            {
+                float xyz[3];
+                memcpy(xyz, data, sizeof(xyz));
+                api.give_velocity(xyz);
+                break;
+            }
+
+            // The frames in the capture were already skipped, so this only has to be asked for to get the same weights.
+            case SVR_CAPTURE_CHUNK_FRAME_STEPS:
+            {
+                api.get_next_frame_steps();
+                break;
+            }
+
+            default:
+            {
+                launcher_log("WARNING: Skipping unknown chunk type %d\n", chunk.type);
+                break;
+            }
+        }
+    }
+
+rstop:
+    api.stop();
+
+    elapsed = svr_prof_get_real_time() - start_time;
+
+    launcher_log("Replayed %d frames in %.2f seconds (%.2f fps)\n", num_frames, elapsed / 1000000.0, num_frames / svr_max(elapsed / 1000000.0, 0.000001));
+
+    ret = 0;
+    goto rexit;
+
+rfail:
+
+rexit:
+    svr_maybe_release(&game_srv);
+    svr_maybe_release(&game_tex);
+    svr_maybe_release(&context);
+    svr_maybe_release(&device);
+
+    replay_close_capture();
+
+    return ret;
+}
+
+bool LauncherState::replay_open_capture(const char* capture_path)
+{
+    bool ret = false;
+    LARGE_INTEGER file_size;
+    SYSTEM_INFO sys_info;
+
+    replay_file_h = CreateFileA(capture_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (replay_file_h == INVALID_HANDLE_VALUE)
+    {
+        replay_file_h = NULL;
+        launcher_log("ERROR: Could not open capture file %s (%lu)\n", capture_path, GetLastError());
+        goto rfail;
+    }
+
+    GetFileSizeEx(replay_file_h, &file_size);
+    replay_file_size = file_size.QuadPart;
+
+    replay_mapping_h = CreateFileMappingA(replay_file_h, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (replay_mapping_h == NULL)
+    {
+        launcher_log("ERROR: Could not map capture file %s (%lu)\n", capture_path, GetLastError());
+        goto rfail;
+    }
+
+    // Views must start on this boundary.
+    GetSystemInfo(&sys_info);
+    replay_granularity = sys_info.dwAllocationGranularity;
+
+    ret = true;
+    goto rexit;
+
+rfail:
+    replay_close_capture();
+
+rexit:
+    return ret;
+}
+
+void LauncherState::replay_close_capture()
+{
+    if (replay_view)
+    {
+        UnmapViewOfFile(replay_view);
+        replay_view = NULL;
+    }
+
+    svr_maybe_close_handle(&replay_mapping_h);
+    svr_maybe_close_handle(&replay_file_h);
+}
+
+// Returns memory of the capture file at the given offset. The size must be within the file.
+// The memory is only valid until the next call.
+u8* LauncherState::replay_map(s64 offset, s64 size)
+{
+    if (replay_view && offset >= replay_view_start && offset + size <= replay_view_start + replay_view_size)
+    {
+        return replay_view + (offset - replay_view_start);
+    }
+
+    if (replay_view)
+    {
+        UnmapViewOfFile(replay_view);
+        replay_view = NULL;
+    }
+
+    replay_view_start = offset - (offset % replay_granularity);
+    replay_view_size = svr_max(REPLAY_VIEW_SIZE, offset + size - replay_view_start);
+    replay_view_size = svr_min(replay_view_size, replay_file_size - replay_view_start);
+
+    replay_view = (u8*)MapViewOfFile(replay_mapping_h, FILE_MAP_READ, (DWORD)(replay_view_start >> 32), (DWORD)replay_view_start, (SIZE_T)replay_view_size);
+
+    if (replay_view == NULL)
+    {
+        launcher_error("Could not map view of capture file (%lu).", GetLastError());
+    }
+
+    return replay_view + (offset - replay_view_start);
+}
+
+bool LauncherState::replay_create_device(ID3D11Device** device, ID3D11DeviceContext** context)
+{
+    // Same requirements as svr_init has for game devices.
+    UINT device_create_flags = D3D11_CREATE_DEVICE_SINGLETHREADED | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+
+    const D3D_FEATURE_LEVEL DEVICE_LEVELS[] =
+    {
+        D3D_FEATURE_LEVEL_12_0
+    };
+
+    HRESULT hr;
+
+    hr = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, device_create_flags, DEVICE_LEVELS, 1, D3D11_SDK_VERSION, device, NULL, context);
+
+    if (SUCCEEDED(hr))
+    {
+        return true;
+    }
+
+    launcher_log("Could not create hardware D3D11 device (%#x), using WARP\n", hr);
+
+    hr = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_WARP, NULL, device_create_flags, DEVICE_LEVELS, 1, D3D11_SDK_VERSION, device, NULL, context);
+
+    if (FAILED(hr))
+    {
+        launcher_log("ERROR: Could not create WARP D3D11 device (%#x)\n", hr);
+        return false;
+    }
+
+    return true;
+}
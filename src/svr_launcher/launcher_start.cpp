@@ -1,46 +1,10 @@
 #include "launcher_priv.h"
 
-#include <fstream>
-#include <thread>
-
-bool file_watcher = true;
-
-// Ugly solution to getting the log from the game to the launcher console.
-void watch_log(const char* fileName)
-{
-    std::string log, logFile(fileName);
-    std::streamoff p = 0;
-    std::ifstream ifs(logFile.c_str());
-
-    bool firstPass = true;
-
-    while (true)
-    {
-        if (!file_watcher) break;
-        ifs.seekg(p);
-        while (getline(ifs, log))
-        {
-            if (!firstPass)
-            {
-                if (log.rfind("Hello from", 0) == 0) fprintf(stderr, "HELLO\n");
-                else if (log.rfind("Init for", 0) == 0) fprintf(stderr, "INIT\n");
-            }
-            if (ifs.tellg() == -1) p = p + log.size();
-            else p = ifs.tellg();
-        }
-        ifs.clear();
-        firstPass = false;
-    }
-}
-
 // Base arguments that every game will have.
 const char* BASE_GAME_ARGS = "-steam -insecure +sv_lan 1 -console -novid";
 
 s32 LauncherState::start_game(LauncherGame* game, std::string launch_options)
 {
-    char log_path[MAX_PATH];
-    SVR_SNPRINTF(log_path, "%s\\data\\SVR_LOG.txt", working_dir);
-
     // We don't need the game directory necessarily (mods work differently) since we apply the -game parameter.
     // All known Source games will use SetCurrentDirectory to the mod (game) directory anyway.
 
@@ -66,7 +30,10 @@ s32 LauncherState::start_game(LauncherGame* game, std::string launch_options)
         launcher_error("Could not initialize standalone SVR. If you use an antivirus, add exception or disable.");
     }
 
-    ipc_setup_in_remote_process(game, info.hProcess, info.hThread);
+    // Must be done before the process starts, as the status is given to svr_standalone.dll when it is loaded.
+    u32 remote_status_mem_h = status_create(info.hProcess);
+
+    ipc_setup_in_remote_process(game, info.hProcess, info.hThread, remote_status_mem_h);
 
     svr_log("Launcher finished, rest of the log is from the game\n");
     svr_log("---------------------------------------------------\n");
@@ -81,15 +48,9 @@ s32 LauncherState::start_game(LauncherGame* game, std::string launch_options)
 
     CloseHandle(info.hThread);
 
-    // Transfer file log to launcher.
-    std::thread t1(watch_log, log_path);
-
     // We DO have to wait here since we DO print to the launcher console from the game.
-    std::thread t2(WaitForSingleObject, info.hProcess, INFINITE);
-    t2.join();
-
-    file_watcher = false;
-    t1.join();
+    status_wait_for_exit(info.hProcess);
+    status_free();
 
     DWORD exit; 
     GetExitCodeProcess(info.hProcess, &exit);
@@ -62,6 +62,7 @@ __declspec(noreturn) void LauncherState::launcher_error(const char* format, ...)
     va_end(va);
 
     svr_log("!!! LAUNCHER ERROR: %s\n", message);
+    svr_log_flush(); // ExitProcess below will end the log thread.
 
     MessageBoxA(NULL, message, "SVR", MB_TASKMODAL | MB_ICONERROR | MB_OK);
 
@@ -60,5 +60,36 @@ struct LauncherState
     // -----------------------------------------------
     // IPC state:
 
-    void ipc_setup_in_remote_process(LauncherGame* game, HANDLE process, HANDLE thread);
+    void ipc_setup_in_remote_process(LauncherGame* game, HANDLE process, HANDLE thread, u32 status_mem_h);
+
+    // -----------------------------------------------
+    // Status state:
+
+    HANDLE status_mem_h;
+    HANDLE status_event_h;
+    SvrGameStatus* status_ptr; // Written by the game.
+    SvrGameStatus status_last; // What was printed last.
+
+    u32 status_create(HANDLE process);
+    void status_free();
+    bool status_read(SvrGameStatus* dest);
+    void status_print_changes();
+    void status_wait_for_exit(HANDLE process);
+
+    // -----------------------------------------------
+    // Replay state:
+
+    HANDLE replay_file_h;
+    HANDLE replay_mapping_h;
+    u8* replay_view; // The part of the capture file that is mapped right now.
+    s64 replay_view_start;
+    s64 replay_view_size;
+    s64 replay_file_size;
+    s64 replay_granularity;
+
+    s32 replay_capture(const char* capture_path, const char* movie_name, const char* profile);
+    bool replay_open_capture(const char* capture_path);
+    void replay_close_capture();
+    u8* replay_map(s64 offset, s64 size);
+    bool replay_create_device(ID3D11Device** device, ID3D11DeviceContext** context);
 };
@@ -0,0 +1,195 @@
+#include "launcher_priv.h"
+
+// Receiving of the progress from svr_standalone.dll in the game (see SvrGameStatus).
+// Changes are printed to stderr with one line per change, so that programs that start the launcher can follow the progress:
+// HELLO
+// INIT
+// MOVIE START
+// PROGRESS <frames> <video seconds> <fps>
+// MOVIE END
+// ERROR <message>
+
+const s32 LAUNCHER_STATUS_READ_TRIES = 1000000;
+
+// Create the shared memory and the event, and give them to the game. Returns the handle to the shared memory in the game process.
+u32 LauncherState::status_create(HANDLE process)
+{
+    HANDLE remote_mem_h = NULL;
+    HANDLE remote_event_h = NULL;
+
+    status_mem_h = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SvrGameStatus), NULL);
+
+    if (status_mem_h == NULL)
+    {
+        svr_log("CreateFileMappingA failed with code %lu\n", GetLastError());
+        goto rfail;
+    }
+
+    status_ptr = (SvrGameStatus*)MapViewOfFile(status_mem_h, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SvrGameStatus));
+
+    if (status_ptr == NULL)
+    {
+        svr_log("MapViewOfFile failed with code %lu\n", GetLastError());
+        goto rfail;
+    }
+
+    status_event_h = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+    if (status_event_h == NULL)
+    {
+        svr_log("CreateEventA failed with code %lu\n", GetLastError());
+        goto rfail;
+    }
+
+    if (!DuplicateHandle(GetCurrentProcess(), status_mem_h, process, &remote_mem_h, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+        svr_log("DuplicateHandle failed with code %lu\n", GetLastError());
+        goto rfail;
+    }
+
+    if (!DuplicateHandle(GetCurrentProcess(), status_event_h, process, &remote_event_h, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+        svr_log("DuplicateHandle failed with code %lu\n", GetLastError());
+        goto rfail;
+    }
+
+    // Handles only have 32 bits significant, so they can be shared between 32-bit and 64-bit processes.
+    memset(status_ptr, 0, sizeof(SvrGameStatus));
+    status_ptr->event_h = (u32)(size_t)remote_event_h;
+
+    memset(&status_last, 0, sizeof(SvrGameStatus));
+
+    return (u32)(size_t)remote_mem_h;
+
+rfail:
+    // We can still start the game, but there will be no progress.
+    status_free();
+    return 0;
+}
+
+void LauncherState::status_free()
+{
+    if (status_ptr)
+    {
+        UnmapViewOfFile(status_ptr);
+        status_ptr = NULL;
+    }
+
+    svr_maybe_close_handle(&status_mem_h);
+    svr_maybe_close_handle(&status_event_h);
+}
+
+// Copy the status so that it is not written to during the read.
+// Fails if the game never finishes the write, which happens if it crashes during it.
+bool LauncherState::status_read(SvrGameStatus* dest)
+{
+    for (s32 i = 0; i < LAUNCHER_STATUS_READ_TRIES; i++)
+    {
+        s32 seq = svr_atom_load(&status_ptr->seq);
+
+        // Being written right now.
+        if (seq & 1)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        memcpy(dest, status_ptr, sizeof(SvrGameStatus));
+
+        // Reads of the copy must not be moved after the check.
+        svr_atom_full_barrier();
+
+        if (svr_atom_load(&status_ptr->seq) == seq)
+        {
+            // Don't trust the game to have ended the string.
+            dest->error[SVR_ARRAY_SIZE(dest->error) - 1] = 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void LauncherState::status_print_changes()
+{
+    SvrGameStatus status;
+
+    if (!status_read(&status))
+    {
+        return;
+    }
+
+    SvrGameStatus* last = &status_last;
+
+    // States can be skipped between two reads, so print everything that must have happened since the last read.
+
+    bool was_starting = last->state == SVR_GAME_STATUS_STARTING;
+    bool was_before_init = was_starting || last->state == SVR_GAME_STATUS_HELLO;
+    bool is_init = status.state == SVR_GAME_STATUS_INIT || status.state == SVR_GAME_STATUS_RECORDING;
+    bool was_recording = last->state == SVR_GAME_STATUS_RECORDING;
+    bool is_recording = status.state == SVR_GAME_STATUS_RECORDING;
+    bool new_movie = status.num_movies != last->num_movies;
+
+    if (was_starting && status.state != SVR_GAME_STATUS_STARTING)
+    {
+        fprintf(stderr, "HELLO\n");
+    }
+
+    if (was_before_init && is_init)
+    {
+        fprintf(stderr, "INIT\n");
+    }
+
+    if (was_recording && new_movie)
+    {
+        fprintf(stderr, "MOVIE END\n");
+    }
+
+    if (new_movie)
+    {
+        fprintf(stderr, "MOVIE START\n");
+    }
+
+    if (new_movie || status.num_frames != last->num_frames)
+    {
+        fprintf(stderr, "PROGRESS %lld %0.3f %0.2f\n", status.num_frames, status.video_time / 1000000.0, status.encode_fps);
+    }
+
+    if ((was_recording || new_movie) && !is_recording)
+    {
+        fprintf(stderr, "MOVIE END\n");
+    }
+
+    if (status.num_errors != last->num_errors)
+    {
+        fprintf(stderr, "ERROR %s\n", status.error);
+    }
+
+    *last = status;
+}
+
+// Print the progress until the game exits.
+void LauncherState::status_wait_for_exit(HANDLE process)
+{
+    // Without the status there is nothing to do but wait.
+    if (status_ptr == NULL)
+    {
+        WaitForSingleObject(process, INFINITE);
+        return;
+    }
+
+    HANDLE handles[] = { process, status_event_h };
+
+    while (true)
+    {
+        DWORD res = WaitForMultipleObjects(SVR_ARRAY_SIZE(handles), handles, FALSE, INFINITE);
+
+        // The last changes may have been written just before exiting.
+        status_print_changes();
+
+        if (res != WAIT_OBJECT_0 + 1)
+        {
+            break;
+        }
+    }
+}
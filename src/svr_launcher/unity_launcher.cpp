@@ -1,7 +1,9 @@
 #include "launcher_priv.h"
 #include "launcher_main.cpp"
 #include "launcher_ipc.cpp"
+#include "launcher_replay.cpp"
 #include "launcher_start.cpp"
 #include "launcher_state.cpp"
+#include "launcher_status.cpp"
 #include "launcher_steam.cpp"
 #include "launcher_sys.cpp"
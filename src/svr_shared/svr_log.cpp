@@ -1,56 +1,321 @@
 #include "svr_log.h"
 #include "svr_common.h"
-#include <assert.h>
+#include "svr_alloc.h"
+#include "svr_atom.h"
+#include "svr_platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <signal.h>
+#endif
+
+// Messages are formatted straight into a ring of records by the calling thread, and a writer thread puts them in the file.
+// This way no thread that logs ever waits for the disk or for another thread that logs.
+// Any thread can log, so a record is claimed by moving the write position with a compare exchange.
+// Every record has a sequence number that says if it is free for the writer at some position or if it is filled (bounded queue by Dmitry Vyukov).
+// If the writer falls behind so much that the ring is full, the message is dropped and counted instead.
+
+const s32 LOG_RING_RECORDS = 1024; // Must be a power of two.
+const s32 LOG_RECORD_SIZE = 1024; // We don't deal with huge messages and truncate as needed.
+const s32 LOG_BATCH_SIZE = 256 * 1024; // Records are copied here so they can be written to the file in few calls.
+const s32 LOG_CRASH_LOCK_SPINS = 1000000; // How long to try to get the lock when crashing, as the thread that has it may be dead.
+
+struct LogRecord
+{
+    SvrAtom32 seq; // Same as the position when free, the position + 1 when filled.
+    s32 length;
+    char text[LOG_RECORD_SIZE - 8];
+};
+
+SvrFile log_file;
+LogRecord* log_records;
+SvrAtom32 log_write_pos; // Next position to claim.
+SvrAtom32 log_num_dropped;
+
+SvrThread log_writer_thread;
+SvrSignal log_writer_signal;
+SvrAtom32 log_writer_stop;
+
+// Everything below is only touched by whoever has the drain lock, which is normally the writer thread.
+SvrAtom32 log_drain_lock;
+u32 log_read_pos;
+char* log_batch;
+s32 log_batch_size;
+s32 log_num_reported_dropped;
 
-HANDLE log_file_handle;
-SRWLOCK log_lock;
+#ifdef _WIN32
+LPTOP_LEVEL_EXCEPTION_FILTER log_prev_crash_filter;
+#endif
 
-void log_function(const char* text, s32 length)
+bool log_crash_hook_installed;
+
+bool log_try_lock_drain()
 {
-    assert(log_file_handle);
+    s32 expr = 0;
+    return svr_atom_cmpxchg(&log_drain_lock, &expr, 1);
+}
 
-    AcquireSRWLockExclusive(&log_lock);
-    WriteFile(log_file_handle, text, sizeof(char) * length, NULL, NULL);
-    ReleaseSRWLockExclusive(&log_lock);
+void log_lock_drain()
+{
+    while (!log_try_lock_drain())
+    {
+        svr_wait_until_atom_is(&log_drain_lock, 0);
+    }
 }
 
-void svr_init_log(const char* log_file_path, bool append)
+// For when we crash or exit. Other threads may be stopped or killed at any point, so don't wait forever.
+bool log_lock_drain_for_crash()
+{
+    for (s32 i = 0; i < LOG_CRASH_LOCK_SPINS; i++)
+    {
+        if (log_try_lock_drain())
+        {
+            return true;
+        }
+
+        svr_cpu_pause();
+    }
+
+    return false;
+}
+
+void log_unlock_drain()
+{
+    svr_atom_store(&log_drain_lock, 0);
+    svr_notify_atom_changed(&log_drain_lock);
+}
+
+void log_write_batch()
 {
-    if (log_file_handle)
+    if (log_batch_size > 0)
+    {
+        svr_file_write(&log_file, log_batch, log_batch_size);
+        log_batch_size = 0;
+    }
+}
+
+void log_add_to_batch(const char* text, s32 length)
+{
+    if (log_batch_size + length > LOG_BATCH_SIZE)
+    {
+        log_write_batch();
+    }
+
+    memcpy(log_batch + log_batch_size, text, length);
+    log_batch_size += length;
+}
+
+// Write out all filled records. Must have the drain lock.
+void log_drain()
+{
+    while (true)
+    {
+        LogRecord* record = &log_records[log_read_pos & (LOG_RING_RECORDS - 1)];
+
+        if (svr_atom_load(&record->seq) != (s32)(log_read_pos + 1))
+        {
+            break;
+        }
+
+        log_add_to_batch(record->text, record->length);
+
+        // Give it back to the producers for the next lap.
+        svr_atom_store(&record->seq, (s32)(log_read_pos + LOG_RING_RECORDS));
+        log_read_pos++;
+    }
+
+    s32 num_dropped = svr_atom_load(&log_num_dropped);
+
+    if (num_dropped != log_num_reported_dropped)
+    {
+        char buf[128];
+        s32 length = SVR_SNPRINTF(buf, "!!! %d log messages were dropped because the log could not keep up\n", num_dropped - log_num_reported_dropped);
+        log_add_to_batch(buf, length);
+
+        log_num_reported_dropped = num_dropped;
+    }
+
+    log_write_batch();
+}
+
+void log_writer_proc(void* /* param */)
+{
+    svr_thread_set_name("SVR log writer");
+
+    while (true)
+    {
+        // Read before draining so that records published during the drain wake us again.
+        s32 seen_count = svr_signal_get(&log_writer_signal);
+
+        log_lock_drain();
+        log_drain();
+        log_unlock_drain();
+
+        if (svr_atom_load(&log_writer_stop))
+        {
+            break;
+        }
+
+        svr_signal_wait(&log_writer_signal, seen_count);
+    }
+}
+
+// Best effort to get the last messages out when the process goes down.
+void log_flush_for_crash()
+{
+    if (log_file.h == NULL)
     {
         return;
     }
 
-    DWORD open_flags = append ? OPEN_EXISTING : CREATE_ALWAYS;
-    log_file_handle = CreateFileA(log_file_path, GENERIC_WRITE, FILE_SHARE_READ, NULL, open_flags, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (log_lock_drain_for_crash())
+    {
+        log_drain();
+        log_unlock_drain();
+    }
+}
 
-    // The file might be set to read only or something. Don't bother then.
-    if (log_file_handle == INVALID_HANDLE_VALUE)
+#ifdef _WIN32
+LONG CALLBACK log_crash_filter(EXCEPTION_POINTERS* info)
+{
+    log_flush_for_crash();
+
+    if (log_prev_crash_filter)
+    {
+        return log_prev_crash_filter(info);
+    }
+
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+#else
+void log_crash_handler(s32 sig)
+{
+    log_flush_for_crash();
+
+    // The handler has been reset to the default one, so this ends the process normally.
+    raise(sig);
+}
+#endif
+
+// On a normal exit the other threads are already gone when this is called.
+void log_exit_proc()
+{
+    log_flush_for_crash();
+}
+
+// Only done once, the hooks stay for the lifetime of the process and do nothing when the log is not open.
+void log_install_crash_hooks()
+{
+    if (log_crash_hook_installed)
+    {
+        return;
+    }
+
+    log_crash_hook_installed = true;
+
+#ifdef _WIN32
+    log_prev_crash_filter = SetUnhandledExceptionFilter(log_crash_filter);
+#else
+    s32 signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+    struct sigaction action = {};
+    action.sa_handler = log_crash_handler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(signals); i++)
+    {
+        sigaction(signals[i], &action, NULL);
+    }
+#endif
+
+    atexit(log_exit_proc);
+}
+
+void svr_init_log(const char* log_file_path, bool append)
+{
+    if (log_file.h)
     {
-        log_file_handle = NULL;
         return;
     }
 
-    if (append)
+    // The file might be set to read only or something. Don't bother then.
+    if (!svr_file_open(&log_file, log_file_path, append ? SVR_FILE_MODE_APPEND : SVR_FILE_MODE_WRITE))
     {
-        // We need to move the file pointer to append new text.
+        return;
+    }
 
-        LARGE_INTEGER dist_to_move = {};
-        SetFilePointerEx(log_file_handle, dist_to_move, NULL, FILE_END);
+    log_records = (LogRecord*)svr_alloc(sizeof(LogRecord) * LOG_RING_RECORDS);
+    log_batch = (char*)svr_alloc(LOG_BATCH_SIZE);
+
+    for (s32 i = 0; i < LOG_RING_RECORDS; i++)
+    {
+        svr_atom_store(&log_records[i].seq, i);
     }
+
+    svr_atom_store(&log_write_pos, 0);
+    svr_atom_store(&log_num_dropped, 0);
+    svr_atom_store(&log_writer_stop, 0);
+    log_read_pos = 0;
+    log_batch_size = 0;
+    log_num_reported_dropped = 0;
+
+    log_install_crash_hooks();
+
+    // If the thread cannot be started, everything is written when flushing.
+    svr_thread_start(&log_writer_thread, log_writer_proc, NULL);
 }
 
 void svr_free_log()
 {
-    svr_maybe_close_handle(&log_file_handle);
+    if (log_file.h == NULL)
+    {
+        return;
+    }
+
+    if (log_writer_thread.h)
+    {
+        svr_atom_store(&log_writer_stop, 1);
+        svr_signal_wake(&log_writer_signal);
+
+        svr_thread_wait(&log_writer_thread);
+        svr_thread_close(&log_writer_thread);
+    }
+
+    // Messages could have been added after the last drain of the writer.
+    svr_log_flush();
+
+    svr_file_close(&log_file);
+
+    svr_maybe_free((void**)&log_records);
+    svr_maybe_free((void**)&log_batch);
+}
+
+void svr_log_flush()
+{
+    if (log_file.h == NULL)
+    {
+        return;
+    }
+
+    log_lock_drain();
+    log_drain();
+    log_unlock_drain();
+}
+
+s32 svr_log_get_num_dropped()
+{
+    return svr_atom_load(&log_num_dropped);
 }
 
 // Below log functions not used for integrated SVR, but we may get here still from game_log.
 
 void svr_log(const char* format, ...)
 {
-    if (log_file_handle == NULL)
+    if (log_file.h == NULL)
     {
         return;
     }
@@ -63,14 +328,46 @@ void svr_log(const char* format, ...)
 
 void svr_log_v(const char* format, va_list va)
 {
-    if (log_file_handle == NULL)
+    if (log_file.h == NULL)
     {
         return;
     }
 
-    // We don't deal with huge messages and truncate as needed.
+    s32 pos = svr_atom_load(&log_write_pos);
+    LogRecord* record;
+
+    while (true)
+    {
+        record = &log_records[pos & (LOG_RING_RECORDS - 1)];
+
+        s32 diff = svr_atom_load(&record->seq) - pos;
+
+        // Free for this position, try to claim it. On failure pos is updated to the new position.
+        if (diff == 0)
+        {
+            if (svr_atom_cmpxchg(&log_write_pos, &pos, pos + 1))
+            {
+                break;
+            }
+        }
+
+        // The writer has not taken this record yet from the previous lap, so the ring is full.
+        else if (diff < 0)
+        {
+            svr_atom_add(&log_num_dropped, 1);
+            return;
+        }
+
+        // Another thread claimed it before us.
+        else
+        {
+            pos = svr_atom_load(&log_write_pos);
+        }
+    }
+
+    record->length = SVR_VSNPRINTF(record->text, format, va);
+    record->length = svr_min(record->length, (s32)SVR_ARRAY_SIZE(record->text) - 1);
 
-    char buf[1024];
-    s32 count = SVR_VSNPRINTF(buf, format, va);
-    log_function(buf, count);
+    svr_atom_store(&record->seq, pos + 1);
+    svr_signal_wake(&log_writer_signal);
 }
@@ -1,7 +1,10 @@
 #pragma once
+#include "svr_common.h"
 #include <stdarg.h>
 
-#ifdef SVR_LOG_DLL
+#ifndef _WIN32
+#define SVR_LOG_API __attribute__((visibility("default")))
+#elif defined(SVR_LOG_DLL)
 #define SVR_LOG_API __declspec(dllexport)
 #else
 #define SVR_LOG_API __declspec(dllimport)
@@ -9,6 +12,7 @@
 
 // File logging stuff.
 // This is a DLL so the same state can be shared between svr_standalone.dll and svr_game.dll, as they are both loaded in the same process.
+// Logging never waits for the disk. The messages are written to the file by a background thread, and are flushed when the process crashes or exits.
 
 extern "C"
 {
@@ -16,6 +20,12 @@ extern "C"
 SVR_LOG_API void svr_init_log(const char* log_file_path, bool append);
 SVR_LOG_API void svr_free_log();
 
+// Write out all pending messages now. Use before ending the process in a way that the exit hook would not see.
+SVR_LOG_API void svr_log_flush();
+
+// How many messages have been dropped because the background thread could not keep up.
+SVR_LOG_API s32 svr_log_get_num_dropped();
+
 SVR_LOG_API void svr_log(const char* format, ...);
 SVR_LOG_API void svr_log_v(const char* format, va_list va);
 
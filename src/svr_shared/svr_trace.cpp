@@ -0,0 +1,678 @@
+#include "svr_trace.h"
+#include "svr_log.h"
+#include "svr_alloc.h"
+#include "svr_array.h"
+#include "svr_platform.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Every thread keeps the statistics of its own scopes, so recording never has to lock or move memory.
+// The statistics are kept as the scopes end, so they cover the whole movie no matter how long it is.
+// The timeline is only recorded when it is enabled, where every thread appends its scopes to its own list of chunks.
+// The lock is only taken when a thread records for the first time, and the other functions require that nobody is recording.
+
+const s32 TRACE_MAX_THREADS = 64;
+const s32 TRACE_MAX_SCOPES = 128; // Different scope names per thread, any more are counted as dropped.
+const s32 TRACE_CHUNK_EVENTS = 16384;
+const s32 TRACE_MAX_CHUNKS = 64; // Up to 1M scopes per thread in the timeline, any more are left out of it.
+const s32 TRACE_MAX_DEPTH = 32;
+
+// Durations are counted in buckets that are 1/8 of a power of two of clock ticks wide, for the percentiles.
+// A percentile is taken as the middle of its bucket, which is within 1/16 of the exact value.
+const s32 TRACE_HIST_SUB_BITS = 3;
+const s32 TRACE_HIST_BUCKETS = 64 << TRACE_HIST_SUB_BITS;
+
+struct TraceEvent
+{
+    const char* name;
+    s64 start; // Clock ticks.
+    s64 end; // 0 when the scope has not ended.
+    s32 depth;
+};
+
+// Statistics of all scopes with the same name.
+struct TraceScope
+{
+    const char* name;
+    s32 depth; // Lowest depth this was seen at, for indenting.
+    s64 runs;
+    s64 total; // Clock ticks.
+    s64 max;
+    s64 hist[TRACE_HIST_BUCKETS];
+};
+
+struct TraceOpenScope
+{
+    s32 scope_idx; // -1 for scopes that were dropped.
+    s32 event_idx; // -1 when there is no timeline or it is full.
+    s64 start;
+};
+
+struct TraceThread
+{
+    char name[64];
+    u32 id;
+    bool ended; // Set by svr_trace_thread_end, can be freed on reset.
+
+    // Scopes in the order they were first seen. Names are compared by pointer here.
+    TraceScope* scopes[TRACE_MAX_SCOPES];
+    s32 num_scopes;
+    s64 num_dropped;
+
+    TraceEvent* chunks[TRACE_MAX_CHUNKS];
+    s32 num_events;
+    s64 num_events_dropped;
+
+    // Scopes deeper than the stack are only counted in the depth.
+    TraceOpenScope stack[TRACE_MAX_DEPTH];
+    s32 depth;
+};
+
+SvrMutex trace_lock;
+TraceThread* trace_threads[TRACE_MAX_THREADS];
+s32 trace_num_threads;
+s64 trace_freq;
+bool trace_timeline;
+
+thread_local TraceThread* trace_cur_thread;
+thread_local bool trace_cur_thread_failed; // Too many threads, don't try to register again.
+
+TraceThread* trace_register_thread()
+{
+    TraceThread* ret = NULL;
+
+    svr_mutex_lock(&trace_lock);
+
+    if (trace_num_threads < TRACE_MAX_THREADS)
+    {
+        ret = SVR_ZALLOC(TraceThread);
+        ret->id = svr_get_thread_id();
+        SVR_SNPRINTF(ret->name, "Thread %u", ret->id);
+
+        trace_threads[trace_num_threads] = ret;
+        trace_num_threads++;
+    }
+
+    svr_mutex_unlock(&trace_lock);
+
+    if (ret == NULL)
+    {
+        trace_cur_thread_failed = true;
+    }
+
+    trace_cur_thread = ret;
+    return ret;
+}
+
+inline TraceThread* trace_get_thread()
+{
+    if (trace_cur_thread)
+    {
+        return trace_cur_thread;
+    }
+
+    if (trace_cur_thread_failed)
+    {
+        return NULL;
+    }
+
+    return trace_register_thread();
+}
+
+inline TraceEvent* trace_get_event(TraceThread* t, s32 idx)
+{
+    return &t->chunks[idx / TRACE_CHUNK_EVENTS][idx % TRACE_CHUNK_EVENTS];
+}
+
+inline s64 trace_get_ticks()
+{
+    return svr_get_clock_ticks();
+}
+
+s64 trace_get_freq()
+{
+    if (trace_freq == 0)
+    {
+        trace_freq = svr_get_clock_freq();
+    }
+
+    return trace_freq;
+}
+
+// The exponent and the top bits of the mantissa of the duration as a double. Durations of 0 and 1 tick are both in the first bucket.
+inline s32 trace_get_hist_bucket(s64 ticks)
+{
+    if (ticks <= 1)
+    {
+        return 0;
+    }
+
+    double v = (double)ticks;
+
+    u64 bits;
+    memcpy(&bits, &v, sizeof(double));
+
+    return (s32)(bits >> (52 - TRACE_HIST_SUB_BITS)) - (1023 << TRACE_HIST_SUB_BITS);
+}
+
+// Middle of the durations that go in a bucket.
+double trace_get_hist_bucket_middle(s32 bucket)
+{
+    s32 sub = bucket & ((1 << TRACE_HIST_SUB_BITS) - 1);
+    return ldexp(1.0 + (sub + 0.5) / (1 << TRACE_HIST_SUB_BITS), bucket >> TRACE_HIST_SUB_BITS);
+}
+
+void svr_trace_thread_start(const char* name)
+{
+    TraceThread* t = trace_get_thread();
+
+    if (t == NULL)
+    {
+        return;
+    }
+
+    SVR_COPY_STRING(name, t->name);
+}
+
+void svr_trace_thread_end()
+{
+    TraceThread* t = trace_cur_thread;
+
+    if (t == NULL)
+    {
+        return;
+    }
+
+    // Scopes that are still open will not be included.
+    t->depth = 0;
+    t->ended = true;
+
+    trace_cur_thread = NULL;
+}
+
+void svr_trace_set_timeline(bool enable)
+{
+    trace_timeline = enable;
+}
+
+s32 trace_find_thread_scope(TraceThread* t, const char* name)
+{
+    for (s32 i = 0; i < t->num_scopes; i++)
+    {
+        if (t->scopes[i]->name == name)
+        {
+            t->scopes[i]->depth = svr_min(t->scopes[i]->depth, t->depth);
+            return i;
+        }
+    }
+
+    if (t->num_scopes == TRACE_MAX_SCOPES)
+    {
+        return -1;
+    }
+
+    TraceScope* scope = SVR_ZALLOC(TraceScope);
+    scope->name = name;
+    scope->depth = t->depth;
+
+    t->scopes[t->num_scopes] = scope;
+    t->num_scopes++;
+
+    return t->num_scopes - 1;
+}
+
+s32 trace_add_event(TraceThread* t, const char* name)
+{
+    s32 chunk_idx = t->num_events / TRACE_CHUNK_EVENTS;
+
+    if (chunk_idx == TRACE_MAX_CHUNKS)
+    {
+        t->num_events_dropped++;
+        return -1;
+    }
+
+    if (t->chunks[chunk_idx] == NULL)
+    {
+        t->chunks[chunk_idx] = (TraceEvent*)svr_alloc(sizeof(TraceEvent) * TRACE_CHUNK_EVENTS);
+    }
+
+    s32 idx = t->num_events;
+    t->num_events++;
+
+    TraceEvent* e = trace_get_event(t, idx);
+    e->name = name;
+    e->depth = t->depth;
+    e->end = 0;
+
+    return idx;
+}
+
+void svr_trace_begin(const char* name)
+{
+    TraceThread* t = trace_get_thread();
+
+    if (t == NULL)
+    {
+        return;
+    }
+
+    if (t->depth >= TRACE_MAX_DEPTH)
+    {
+        t->num_dropped++;
+        t->depth++;
+        return;
+    }
+
+    TraceOpenScope* open = &t->stack[t->depth];
+    open->scope_idx = trace_find_thread_scope(t, name);
+    open->event_idx = -1;
+
+    if (open->scope_idx == -1)
+    {
+        t->num_dropped++;
+    }
+
+    if (trace_timeline)
+    {
+        open->event_idx = trace_add_event(t, name);
+    }
+
+    t->depth++;
+
+    open->start = trace_get_ticks(); // Last so the above is not measured.
+}
+
+void svr_trace_end()
+{
+    s64 now = trace_get_ticks();
+
+    TraceThread* t = trace_cur_thread;
+
+    // Scopes that were open during a reset are ignored.
+    if (t == NULL || t->depth == 0)
+    {
+        return;
+    }
+
+    t->depth--;
+
+    if (t->depth >= TRACE_MAX_DEPTH)
+    {
+        return;
+    }
+
+    TraceOpenScope* open = &t->stack[t->depth];
+
+    if (open->scope_idx >= 0)
+    {
+        TraceScope* scope = t->scopes[open->scope_idx];
+        s64 duration = now - open->start;
+
+        scope->runs++;
+        scope->total += duration;
+        scope->max = svr_max(scope->max, duration);
+        scope->hist[trace_get_hist_bucket(duration)]++;
+    }
+
+    if (open->event_idx >= 0)
+    {
+        TraceEvent* e = trace_get_event(t, open->event_idx);
+        e->start = open->start;
+        e->end = now;
+    }
+}
+
+void trace_free_thread_scopes(TraceThread* t)
+{
+    for (s32 i = 0; i < t->num_scopes; i++)
+    {
+        svr_free(t->scopes[i]);
+        t->scopes[i] = NULL;
+    }
+
+    t->num_scopes = 0;
+}
+
+void trace_free_thread(TraceThread* t)
+{
+    trace_free_thread_scopes(t);
+
+    for (s32 i = 0; i < TRACE_MAX_CHUNKS; i++)
+    {
+        svr_maybe_free((void**)&t->chunks[i]);
+    }
+
+    svr_free(t);
+}
+
+void svr_trace_reset()
+{
+    svr_mutex_lock(&trace_lock);
+
+    s32 num_kept = 0;
+
+    for (s32 i = 0; i < trace_num_threads; i++)
+    {
+        TraceThread* t = trace_threads[i];
+
+        if (t->ended)
+        {
+            trace_free_thread(t);
+            continue;
+        }
+
+        // Keep the chunks around for the next movie.
+        trace_free_thread_scopes(t);
+        t->num_dropped = 0;
+        t->num_events = 0;
+        t->num_events_dropped = 0;
+        t->depth = 0;
+
+        trace_threads[num_kept] = t;
+        num_kept++;
+    }
+
+    trace_num_threads = num_kept;
+
+    svr_mutex_unlock(&trace_lock);
+}
+
+// Combine the scopes of all threads by name, in the order they were first seen.
+void trace_gather_scopes(SvrDynArray<TraceScope>* scopes)
+{
+    *scopes = {};
+    scopes->init(32);
+
+    for (s32 i = 0; i < trace_num_threads; i++)
+    {
+        TraceThread* t = trace_threads[i];
+
+        for (s32 j = 0; j < t->num_scopes; j++)
+        {
+            TraceScope* source = t->scopes[j];
+
+            // Scopes that have never ended.
+            if (source->runs == 0)
+            {
+                continue;
+            }
+
+            TraceScope* dest = NULL;
+
+            for (s32 k = 0; k < scopes->size; k++)
+            {
+                if (!strcmp(scopes->at(k).name, source->name))
+                {
+                    dest = &scopes->at(k);
+                    break;
+                }
+            }
+
+            if (dest == NULL)
+            {
+                scopes->push(*source);
+                continue;
+            }
+
+            dest->depth = svr_min(dest->depth, source->depth);
+            dest->runs += source->runs;
+            dest->total += source->total;
+            dest->max = svr_max(dest->max, source->max);
+
+            for (s32 k = 0; k < TRACE_HIST_BUCKETS; k++)
+            {
+                dest->hist[k] += source->hist[k];
+            }
+        }
+    }
+}
+
+double trace_ticks_to_ms(double ticks)
+{
+    return (ticks * 1000.0) / (double)trace_get_freq();
+}
+
+// Nearest rank percentile, not above the longest duration.
+double trace_get_percentile_ms(TraceScope* scope, s32 percent)
+{
+    s64 rank = (s64)ceil((percent / 100.0) * scope->runs);
+    svr_clamp(&rank, (s64)1, scope->runs);
+
+    s64 seen = 0;
+    s32 bucket = 0;
+
+    for (; bucket < TRACE_HIST_BUCKETS - 1; bucket++)
+    {
+        seen += scope->hist[bucket];
+
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+
+    return trace_ticks_to_ms(svr_min(trace_get_hist_bucket_middle(bucket), (double)scope->max));
+}
+
+void trace_fill_stats(TraceScope* scope, SvrTraceStats* stats)
+{
+    stats->runs = scope->runs;
+    stats->total_ms = trace_ticks_to_ms((double)scope->total);
+    stats->avg_ms = stats->total_ms / (double)scope->runs;
+    stats->p50_ms = trace_get_percentile_ms(scope, 50);
+    stats->p95_ms = trace_get_percentile_ms(scope, 95);
+    stats->p99_ms = trace_get_percentile_ms(scope, 99);
+    stats->max_ms = trace_ticks_to_ms((double)scope->max);
+}
+
+bool svr_trace_get_stats(const char* name, SvrTraceStats* stats)
+{
+    bool ret = false;
+
+    SvrDynArray<TraceScope> scopes;
+    trace_gather_scopes(&scopes);
+
+    for (s32 i = 0; i < scopes.size; i++)
+    {
+        if (!strcmp(scopes[i].name, name))
+        {
+            trace_fill_stats(&scopes[i], stats);
+            ret = true;
+            break;
+        }
+    }
+
+    if (!ret)
+    {
+        *stats = {};
+    }
+
+    scopes.free();
+    return ret;
+}
+
+void svr_trace_log_stats()
+{
+    SvrDynArray<TraceScope> scopes;
+    trace_gather_scopes(&scopes);
+
+    if (scopes.size == 0)
+    {
+        scopes.free();
+        return;
+    }
+
+    svr_log("%-40s %8s %12s %10s %10s %10s %10s %10s\n", "Scope (ms)", "Runs", "Total", "Average", "p50", "p95", "p99", "Max");
+
+    for (s32 i = 0; i < scopes.size; i++)
+    {
+        TraceScope* scope = &scopes[i];
+
+        SvrTraceStats stats;
+        trace_fill_stats(scope, &stats);
+
+        // Indent by depth to show the hierarchy.
+        char name[128];
+        SVR_SNPRINTF(name, "%*s%s", scope->depth * 2, "", scope->name);
+
+        svr_log("%-40s %8lld %12.2f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, stats.runs, stats.total_ms, stats.avg_ms, stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms);
+    }
+
+    for (s32 i = 0; i < trace_num_threads; i++)
+    {
+        TraceThread* t = trace_threads[i];
+
+        if (t->num_dropped > 0)
+        {
+            svr_log("WARNING: %lld scopes were dropped in thread %s\n", t->num_dropped, t->name);
+        }
+
+        if (t->num_events_dropped > 0)
+        {
+            svr_log("WARNING: %lld scopes were left out of the timeline in thread %s\n", t->num_events_dropped, t->name);
+        }
+    }
+
+    scopes.free();
+}
+
+// Buffered writing, since there will be a lot of small writes.
+struct TraceWriter
+{
+    SvrFile file;
+    char* buf;
+    s32 used;
+    bool failed;
+};
+
+const s32 TRACE_WRITER_SIZE = 1024 * 1024;
+
+void trace_flush(TraceWriter* w)
+{
+    if (w->used > 0 && !w->failed)
+    {
+        if (!svr_file_write(&w->file, w->buf, w->used))
+        {
+            w->failed = true;
+        }
+    }
+
+    w->used = 0;
+}
+
+void trace_write(TraceWriter* w, const char* format, ...)
+{
+    // No single write is near this long.
+    if (w->used > TRACE_WRITER_SIZE - 1024)
+    {
+        trace_flush(w);
+    }
+
+    va_list va;
+    va_start(va, format);
+    w->used += vsnprintf(w->buf + w->used, TRACE_WRITER_SIZE - w->used, format, va);
+    va_end(va);
+}
+
+// Names are only written as JSON strings, so quotes and backslashes must not get through.
+void trace_copy_json_string(const char* source, char* dest, s32 dest_chars)
+{
+    s32 i = 0;
+
+    for (; *source && i < dest_chars - 1; source++)
+    {
+        char c = *source;
+
+        if (c == '"' || c == '\\' || c < ' ')
+        {
+            c = '_';
+        }
+
+        dest[i] = c;
+        i++;
+    }
+
+    dest[i] = 0;
+}
+
+bool svr_trace_write(const char* path)
+{
+    bool ret = false;
+    TraceWriter w = {};
+    u32 pid = svr_get_process_id();
+    s64 base = INT64_MAX;
+    double us_per_tick = 1000000.0 / (double)trace_get_freq();
+    char name[128];
+
+    if (!svr_file_open(&w.file, path, SVR_FILE_MODE_WRITE))
+    {
+        svr_log("ERROR: Could not create trace file %s\n", path);
+        goto rfail;
+    }
+
+    w.buf = (char*)svr_alloc(TRACE_WRITER_SIZE);
+
+    // Times start from the first scope so they are easier to read.
+    for (s32 i = 0; i < trace_num_threads; i++)
+    {
+        TraceThread* t = trace_threads[i];
+
+        if (t->num_events > 0)
+        {
+            base = svr_min(base, trace_get_event(t, 0)->start);
+        }
+    }
+
+    trace_write(&w, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    trace_write(&w, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":\"SVR %u\"}}", pid, pid);
+
+    for (s32 i = 0; i < trace_num_threads; i++)
+    {
+        TraceThread* t = trace_threads[i];
+
+        trace_copy_json_string(t->name, name, SVR_ARRAY_SIZE(name));
+
+        trace_write(&w, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", pid, t->id, name);
+        trace_write(&w, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"sort_index\":%d}}", pid, t->id, i);
+
+        for (s32 j = 0; j < t->num_events; j++)
+        {
+            TraceEvent* e = trace_get_event(t, j);
+
+            if (e->end == 0)
+            {
+                continue;
+            }
+
+            trace_copy_json_string(e->name, name, SVR_ARRAY_SIZE(name));
+
+            trace_write(&w, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        name, pid, t->id, (e->start - base) * us_per_tick, (e->end - e->start) * us_per_tick);
+        }
+    }
+
+    trace_write(&w, "\n]}\n");
+    trace_flush(&w);
+
+    if (w.failed)
+    {
+        svr_log("ERROR: Could not write to trace file %s\n", path);
+        goto rfail;
+    }
+
+    svr_log("Wrote trace to %s\n", path);
+
+    ret = true;
+    goto rexit;
+
+rfail:
+
+rexit:
+    svr_file_close(&w.file);
+    svr_maybe_free((void**)&w.buf);
+
+    return ret;
+}
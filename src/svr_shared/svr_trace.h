@@ -0,0 +1,66 @@
+#pragma once
+#include "svr_common.h"
+
+#ifndef _WIN32
+#define SVR_TRACE_API __attribute__((visibility("default")))
+#elif defined(SVR_TRACE_DLL)
+#define SVR_TRACE_API __declspec(dllexport)
+#else
+#define SVR_TRACE_API __declspec(dllimport)
+#endif
+
+// Hierarchical profiler for finding out where the time goes during a movie.
+// Named scopes are recorded with svr_trace_begin and svr_trace_end, and can be nested. Every thread records into its own buffer, so no locks are taken while recording.
+// At the end of a movie, the times per scope are written to the log with svr_trace_log_stats. These are kept as the scopes end, so they cover any length of movie.
+// The percentiles come from a histogram and are within about 6% of the exact value.
+// The whole timeline can also be recorded with svr_trace_set_timeline, and written with svr_trace_write.
+// This is a DLL so the same state can be shared between svr_standalone.dll and svr_game.dll, as they are both loaded in the same process.
+
+// Scope names must be string literals (or otherwise live forever), as only the pointer is stored.
+// Scopes with the same name are combined in the statistics, also between threads.
+
+struct SvrTraceStats
+{
+    s64 runs;
+    double total_ms;
+    double avg_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+extern "C"
+{
+
+// Name the calling thread in the trace. Threads that don't call this are given a name from their id when they record their first scope.
+SVR_TRACE_API void svr_trace_thread_start(const char* name);
+
+// Must be called by threads that exit, so svr_trace_reset can free their buffer.
+// The recorded scopes remain until the next reset.
+SVR_TRACE_API void svr_trace_thread_end();
+
+// Also record every scope for svr_trace_write. This is off by default, as the timeline of a long movie takes a lot of memory.
+// No other thread can be recording while this is called.
+SVR_TRACE_API void svr_trace_set_timeline(bool enable);
+
+SVR_TRACE_API void svr_trace_begin(const char* name);
+SVR_TRACE_API void svr_trace_end();
+
+// Remove everything that has been recorded so far.
+// No other thread can be recording while this is called.
+SVR_TRACE_API void svr_trace_reset();
+
+// Returns false if there are no recorded scopes with this name.
+// No other thread can be recording while this is called.
+SVR_TRACE_API bool svr_trace_get_stats(const char* name, SvrTraceStats* stats);
+
+// Write the statistics of all scopes to the log.
+// No other thread can be recording while this is called.
+SVR_TRACE_API void svr_trace_log_stats();
+
+// Write the recorded timeline in the Chrome trace event format, which can be opened in chrome://tracing or ui.perfetto.dev.
+// No other thread can be recording while this is called.
+SVR_TRACE_API bool svr_trace_write(const char* path);
+
+}
@@ -21,7 +21,7 @@ void game_audio_v2_mix_audio_for_one_frame()
 
     s64 paint_time = game_get_snd_paint_time_1();
 
-    float time_ahead_to_mix = 1.0f / (float)game_state.rec_game_rate;
+    float time_ahead_to_mix = (float)game_state.rec_frame_steps / (float)game_state.rec_game_rate;
     float num_frac_samples_to_mix = (time_ahead_to_mix * game_state.search_desc.snd_sample_rate) + game_state.snd_lost_mix_time;
 
     s64 num_samples_to_mix = (s64)num_frac_samples_to_mix;
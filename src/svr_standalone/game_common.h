@@ -178,6 +178,8 @@ struct GameState
     ITaskbarList3* wind_taskbar_list; // The taskbar progress bar.
 
     s64 rec_num_frames; // Number of processed frames.
+    s64 rec_num_steps; // Processed game time in frames of rec_game_rate. More than rec_num_frames when motion blur skips frames.
+    s32 rec_frame_steps; // How many frames of rec_game_rate the current game frame advances (see svr_get_next_frame_steps).
     s64 rec_start_time; // Time of start for timing purposes.
     s32 rec_game_rate; // Frames per second the game is processing game at (includes motion blur).
     s32 rec_timeout; // After how many seconds to automatically end the movie.
@@ -190,6 +192,12 @@ struct GameState
     float snd_lost_mix_time; // Time that was lost between the fps to sample rate conversion. This is added back next frame.
     s32 snd_num_samples; // Used by audio variant 2.
     s32 snd_skipped_samples; // The number of samples to submit must align to 4 sample boundaries, that means there may be samples over that we have to process in the next frame.
+    SvrDynArray<SvrWaveSample> snd_send_buf; // Converted samples to give to SVR. Kept between paints so it only grows a few times.
+
+    HANDLE status_mem_h; // Shared memory from the launcher. Not set when not started by the launcher.
+    HANDLE status_event_h;
+    SvrGameStatus* status_ptr;
+    s64 status_next_update_time;
 };
 
 extern GameState game_state;
@@ -209,6 +217,12 @@ bool game_wait_for_libs_to_load(const char** libs, s32 num, s32 timeout);
 // A start address can be specified to chain several pattern scans together.
 void* game_scan_pattern(const char* dll, const char* pattern, void* from);
 
+// Patterns that are scanned for between these are only collected, and then all found at once in game_scan_end_collect.
+// Later scans of the same patterns use the found addresses.
+void game_scan_begin_collect();
+void game_scan_end_collect();
+void game_scan_free_results();
+
 // -----------------------------------------------
 // game_util.cpp:
 
@@ -312,6 +326,17 @@ void game_wind_update_progress(s64 now);
 void game_wind_update();
 void game_wind_reset();
 
+// -----------------------------------------------
+// game_status.cpp:
+
+void game_status_init(SvrGameInitData* init_data);
+SvrGameStatus* game_status_begin_write();
+void game_status_end_write(SvrGameStatus* status);
+void game_status_set_state(SvrGameStatusState state);
+void game_status_set_error(const char* message);
+void game_status_update();
+void game_status_write_progress(s64 now);
+
 // -----------------------------------------------
 // game_rec.cpp:
 
@@ -322,6 +347,7 @@ void game_rec_update_autostop();
 void game_rec_show_start_movie_usage();
 void game_rec_start_movie(void* cmd_args);
 void game_rec_end_movie();
+void game_rec_update_frame_steps();
 bool game_rec_run_frame();
 void game_rec_do_record_frame();
 
@@ -13,6 +13,8 @@ void game_init(SvrGameInitData* init_data)
     game_state.main_thread_id = GetCurrentThreadId();
     game_state.svr_path = init_data->svr_path;
 
+    game_status_init(init_data);
+
     game_wind_early_init();
 
     // Init needs to be done async because we need to wait for the libraries to load while the game loads as normal.
@@ -30,6 +32,7 @@ void game_init_log()
 
     // Need to notify that we have started because a lot of things can go wrong in standalone launch.
     svr_log("Hello from the game\n");
+    game_status_set_state(SVR_GAME_STATUS_HELLO);
 }
 
 void game_init_error(const char* format, ...)
@@ -44,6 +47,10 @@ void game_init_error(const char* format, ...)
     va_end(va);
 
     svr_log("!!! ERROR: %s\n", message);
+    svr_log_flush(); // ExitProcess below will end the log thread.
+
+    game_status_set_error(message);
+    game_status_set_state(SVR_GAME_STATUS_ERROR);
 
     // Try and hide the game window if we have it.
     // This needs to be done because we are in a separate thread here, and we want the main thread to block as well.
@@ -99,6 +106,8 @@ void game_init_async_proc()
     svr_console_msg("-------------------------------------------------------\n");
     svr_console_msg("SVR initialized\n");
     svr_console_msg("-------------------------------------------------------\n");
+
+    game_status_set_state(SVR_GAME_STATUS_INIT);
 }
 
 struct GameCapsPrint
@@ -1,6 +1,10 @@
 #include "game_priv.h"
 
+static_assert(sizeof(GameSndSample0) == sizeof(s32) * 2, "GameSndSample0 must be two interleaved 32-bit values");
+static_assert(sizeof(SvrWaveSample) == sizeof(s16) * 2, "SvrWaveSample must be two interleaved 16-bit values");
+
 // Convert sample format and send.
+// The engine mixes into 32-bit values which can go outside of the 16-bit range when loud, so these are clamped.
 void game_prepare_and_send_sound_0(GameSndSample0* paint_buf, s32 num_samples)
 {
     if (!svr_is_audio_enabled())
@@ -8,15 +12,12 @@ void game_prepare_and_send_sound_0(GameSndSample0* paint_buf, s32 num_samples)
         return;
     }
 
-    SvrWaveSample* buf = (SvrWaveSample*)_alloca(sizeof(SvrWaveSample) * num_samples);
+    SvrDynArray<SvrWaveSample>* buf = &game_state.snd_send_buf;
+    buf->expand_if_needed(num_samples);
 
-    for (s32 i = 0; i < num_samples; i++)
-    {
-        GameSndSample0* sample = &paint_buf[i];
-        buf[i] = SvrWaveSample { (s16)sample->left, (s16)sample->right };
-    }
+    svr_audio_pack_s32_to_s16((s32*)paint_buf, (s16*)buf->mem, num_samples * 2);
 
-    svr_give_audio(buf, num_samples);
+    svr_give_audio(buf->mem, num_samples);
 }
 
 // ----------------------------------------------------------------
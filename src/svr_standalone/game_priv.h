@@ -4,10 +4,15 @@
 #include "svr_defs.h"
 #include "svr_standalone_common.h"
 #include "svr_log.h"
+#include "svr_trace.h"
 #include "svr_array.h"
 #include "svr_ini.h"
 #include "svr_alloc.h"
 #include "svr_console.h"
+#include "svr_scan.h"
+#include "svr_scan_cache.h"
+#include "svr_audio.h"
+#include "svr_platform.h"
 #include <Windows.h>
 #include <Psapi.h>
 #include <strsafe.h>
@@ -18,5 +23,6 @@
 #include <d3d9.h>
 #include <ShlObj_core.h>
 #include <MinHook.h>
+#include <intrin.h>
 
 #include "game_common.h"
@@ -14,7 +14,7 @@ void game_rec_update_timeout()
     s64 end_frame = game_state.rec_timeout * game_state.rec_game_rate;
 
     // No more frames should be processed.
-    if (game_state.rec_num_frames >= end_frame)
+    if (game_state.rec_num_steps >= end_frame)
     {
         game_rec_end_movie();
     }
@@ -230,6 +230,8 @@ void game_rec_start_movie(void* cmd_args)
 
     if (!svr_start(movie_name, profile_name, &startmovie_data))
     {
+        game_status_set_error("Could not start movie, see SVR_LOG.txt");
+
         // Reverse above changes if something went wrong.
         game_run_cfgs_for_event("end");
         goto rfail;
@@ -239,7 +241,8 @@ void game_rec_start_movie(void* cmd_args)
 
     game_state.rec_game_rate = svr_get_game_rate();
 
-    game_engine_client_command(svr_va("host_framerate %d\n", game_state.rec_game_rate));
+    game_state.rec_frame_steps = 0;
+    game_rec_update_frame_steps();
 
     // Allow recording the next frame.
     game_state.rec_state = GAME_REC_WAITING;
@@ -247,6 +250,7 @@ void game_rec_start_movie(void* cmd_args)
     // Reset recording state.
 
     game_state.rec_num_frames = 0;
+    game_state.rec_num_steps = 0;
     game_state.rec_start_time = svr_prof_get_real_time();
 
     game_state.snd_skipped_samples = 0;
@@ -255,6 +259,8 @@ void game_rec_start_movie(void* cmd_args)
 
     svr_console_msg_and_log("Starting movie to %s\n", movie_name);
 
+    game_status_set_state(SVR_GAME_STATUS_RECORDING);
+
     goto rexit;
 
 rfail:;
@@ -286,11 +292,39 @@ void game_rec_end_movie()
 
     svr_stop();
 
+    // Final progress of the movie.
+    game_status_write_progress(now);
+    game_status_set_state(SVR_GAME_STATUS_INIT);
+
     game_run_cfgs_for_event("end");
 
     game_wind_reset();
 }
 
+// Set how far the next game frame advances. This is one frame of the game rate, except for when motion blur skips frames.
+void game_rec_update_frame_steps()
+{
+    s32 steps = svr_get_next_frame_steps();
+
+    if (steps == game_state.rec_frame_steps)
+    {
+        return;
+    }
+
+    game_state.rec_frame_steps = steps;
+
+    if (steps == 1)
+    {
+        game_engine_client_command(svr_va("host_framerate %d\n", game_state.rec_game_rate));
+    }
+
+    // Values of 1 and below are taken as the frame time in seconds instead of frames per second.
+    else
+    {
+        game_engine_client_command(svr_va("host_framerate %0.9f\n", (double)steps / (double)game_state.rec_game_rate));
+    }
+}
+
 bool game_rec_run_frame()
 {
     game_rec_update_recording_state();
@@ -307,13 +341,24 @@ bool game_rec_run_frame()
 
 void game_rec_do_record_frame()
 {
+    svr_trace_begin("Game frame");
+
+    svr_trace_begin("Game audio");
     game_audio_frame();
+    svr_trace_end();
+
     game_velo_frame();
 
     svr_frame();
 
     game_state.rec_num_frames++;
+    game_state.rec_num_steps += game_state.rec_frame_steps;
+
+    game_rec_update_frame_steps();
 
     game_wind_update();
+    game_status_update();
     game_rec_update_timeout();
+
+    svr_trace_end();
 }
@@ -1,95 +1,278 @@
 #include "game_priv.h"
 
 // Memory scanning.
+// The pattern matching itself is in svr_scan.cpp.
 
-// How many bytes there can be in a pattern scan.
-const s32 GAME_MAX_SCAN_BYTES = 256;
-
-struct GameScanPattern
+// Pattern that is searched for ahead of time.
+struct GameScanResult
 {
-    // A value of -1 means unknown byte.
-    s16 bytes[GAME_MAX_SCAN_BYTES];
-    s16 used;
+    const char* dll;
+    const char* pattern;
+    void* addr; // NULL if not found or if the module is not loaded.
 };
 
-bool game_is_hex_char(char c)
+SvrDynArray<GameScanResult> game_scan_results;
+bool game_scan_collecting; // When set, game_scan_pattern only collects the patterns.
+
+GameScanResult* game_scan_find_result(const char* dll, const char* pattern)
 {
-    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F');
+    for (s32 i = 0; i < game_scan_results.size; i++)
+    {
+        GameScanResult* res = &game_scan_results[i];
+
+        if (!strcmpi(res->dll, dll) && !strcmp(res->pattern, pattern))
+        {
+            return res;
+        }
+    }
+
+    return NULL;
 }
 
-void game_pattern_bytes_from_string(const char* input, GameScanPattern* out)
+void game_scan_begin_collect()
 {
-    const char* ptr = input;
+    game_scan_collecting = true;
+}
 
-    out->used = 0;
+// Hash the file of a loaded module. The loaded image cannot be used because it is changed by relocations.
+bool game_scan_hash_module(HMODULE module, u64* hash)
+{
+    char path[MAX_PATH];
 
-    for (; *ptr != 0; ptr++)
+    if (GetModuleFileNameA(module, path, SVR_ARRAY_SIZE(path)) == 0)
     {
-        assert(out->used < GAME_MAX_SCAN_BYTES);
+        return false;
+    }
 
-        if (game_is_hex_char(*ptr))
+    SvrFileView view;
+
+    if (!svr_file_view_open(&view, path))
+    {
+        return false;
+    }
+
+    *hash = svr_scan_cache_hash(view.data, view.size);
+
+    svr_file_view_close(&view);
+    return true;
+}
+
+// Module that has to be scanned because not all of its patterns are in the cache.
+struct GameScanModule
+{
+    const char* dll;
+    bool has_hash; // Results are not cached if the module could not be hashed.
+    u64 hash;
+    s32* result_idxs; // Index in game_scan_results for every pattern in the region.
+};
+
+// Search for all collected patterns in one go. Every module is only swept through once, and the modules are searched in parallel.
+// Results of modules that have not changed since the last time are taken from the scan cache instead.
+void game_scan_end_collect()
+{
+    game_scan_collecting = false;
+
+    char cache_path[MAX_PATH];
+    SVR_SNPRINTF(cache_path, "%s\\data\\SVR_SCAN_CACHE.txt", game_state.svr_path);
+
+    SvrScanCache cache = {};
+    svr_scan_cache_load(&cache, cache_path);
+
+    // Group the patterns by module.
+
+    SvrDynArray<const char*> dlls = {};
+
+    for (s32 i = 0; i < game_scan_results.size; i++)
+    {
+        const char* dll = game_scan_results[i].dll;
+        bool found = false;
+
+        for (s32 j = 0; j < dlls.size; j++)
         {
-            assert(game_is_hex_char(*(ptr + 1))); // Next must be the next 4 bits.
+            if (!strcmpi(dlls[j], dll))
+            {
+                found = true;
+                break;
+            }
+        }
 
-            out->bytes[out->used] = strtol(ptr, NULL, 16);
-            out->used++;
-            ptr++;
+        if (!found)
+        {
+            dlls.push(dll);
         }
+    }
+
+    SvrDynArray<SvrScanRegion> regions = {};
+    SvrDynArray<GameScanModule> modules = {}; // Same order as the regions.
 
-        else if (*ptr == '?')
+    s32 num_cached = 0;
+
+    for (s32 i = 0; i < dlls.size; i++)
+    {
+        HMODULE module_h = GetModuleHandleA(dlls[i]);
+        MODULEINFO info;
+
+        // Module is not loaded. Not an error because we allow fallthrough scanning of multiple patterns.
+        if (!GetModuleInformation(GetCurrentProcess(), module_h, &info, sizeof(MODULEINFO)))
         {
-            assert(*(ptr + 1) == '?'); // Next must be question mark.
+            continue;
+        }
+
+        GameScanModule module;
+        module.dll = dlls[i];
+        module.has_hash = game_scan_hash_module(module_h, &module.hash);
 
-            out->bytes[out->used] = -1;
-            out->used++;
-            ptr++;
+        if (module.has_hash)
+        {
+            svr_scan_cache_set_module(&cache, module.dll, module.hash);
         }
-    }
 
-    assert(out->used > 0); // Must have written something.
-}
+        s32 num_patterns = 0;
 
-bool game_compare_data(u8* data, GameScanPattern* pattern)
-{
-    s32 index = 0;
-    s16* bytes = pattern->bytes;
+        for (s32 j = 0; j < game_scan_results.size; j++)
+        {
+            if (!strcmpi(game_scan_results[j].dll, dlls[i]))
+            {
+                num_patterns++;
+            }
+        }
+
+        SvrScanRegion region;
+        region.data = (u8*)info.lpBaseOfDll;
+        region.size = info.SizeOfImage;
+        region.patterns = SVR_ZALLOC_NUM(SvrScanPattern, num_patterns);
+        region.num_patterns = 0;
+        region.results = SVR_ZALLOC_NUM(s32, num_patterns);
+
+        module.result_idxs = SVR_ZALLOC_NUM(s32, num_patterns);
+
+        for (s32 j = 0; j < game_scan_results.size; j++)
+        {
+            GameScanResult* res = &game_scan_results[j];
+
+            if (strcmpi(res->dll, dlls[i]))
+            {
+                continue;
+            }
+
+            SvrScanPattern* pattern = &region.patterns[region.num_patterns];
+            svr_scan_parse_pattern(res->pattern, pattern);
+
+            s32 rva;
+
+            if (module.has_hash && svr_scan_cache_find(&cache, module.dll, module.hash, res->pattern, &rva))
+            {
+                if (rva == -1)
+                {
+                    num_cached++;
+                    continue;
+                }
+
+                // The match is checked again because a wrong address would crash. If it does not match the cache is wrong and the pattern is scanned for.
+                // Written so that a broken offset from the file can not overflow.
+                if (rva <= region.size - pattern->used && svr_scan_find(region.data + rva, pattern->used, pattern))
+                {
+                    res->addr = region.data + rva;
+                    num_cached++;
+                    continue;
+                }
+
+                svr_scan_cache_remove(&cache, module.dll, res->pattern);
+            }
 
-    for (s32 i = 0; i < pattern->used; i++)
+            module.result_idxs[region.num_patterns] = j;
+            region.num_patterns++;
+        }
+
+        if (region.num_patterns == 0)
+        {
+            svr_free(region.patterns);
+            svr_free(region.results);
+            svr_free(module.result_idxs);
+            continue;
+        }
+
+        regions.push(region);
+        modules.push(module);
+    }
+
+    svr_scan_find_many(regions.mem, regions.size, svr_get_num_processors());
+
+    for (s32 i = 0; i < regions.size; i++)
     {
-        s16 byte = *bytes;
+        SvrScanRegion* region = &regions[i];
+        GameScanModule* module = &modules[i];
 
-        if (byte > -1 && *data != byte)
+        for (s32 j = 0; j < region->num_patterns; j++)
         {
-            return false;
+            GameScanResult* res = &game_scan_results[module->result_idxs[j]];
+
+            if (region->results[j] != -1)
+            {
+                res->addr = region->data + region->results[j];
+            }
+
+            if (module->has_hash)
+            {
+                svr_scan_cache_add(&cache, module->dll, module->hash, res->pattern, region->results[j]);
+            }
         }
 
-        data++;
-        bytes++;
-        index++;
+        svr_free(region->patterns);
+        svr_free(region->results);
+        svr_free(module->result_idxs);
+    }
+
+    svr_log("Searched for %d patterns in %d modules (%d patterns were cached)\n", game_scan_results.size - num_cached, regions.size, num_cached);
+
+    if (cache.changed)
+    {
+        if (!svr_scan_cache_save(&cache, cache_path))
+        {
+            svr_log("Could not save the scan cache to %s\n", cache_path);
+        }
     }
 
-    return index == pattern->used;
+    svr_scan_cache_free(&cache);
+
+    regions.free();
+    modules.free();
+    dlls.free();
 }
 
-void* game_find_pattern(void* start, s32 search_length, GameScanPattern* pattern)
+void game_scan_free_results()
 {
-    s16 length = pattern->used;
+    game_scan_results.free();
+}
 
-    for (s32 i = 0; i <= search_length - length; i++)
+void* game_scan_pattern(const char* dll, const char* pattern, void* from)
+{
+    // Patterns that continue from a previous result are searched for when they are used.
+    if (from == NULL)
     {
-        u8* addr = (u8*)start + i;
+        if (game_scan_collecting)
+        {
+            if (game_scan_find_result(dll, pattern) == NULL)
+            {
+                game_scan_results.push(GameScanResult { dll, pattern, NULL });
+            }
 
-        if (game_compare_data(addr, pattern))
+            return NULL;
+        }
+
+        GameScanResult* res = game_scan_find_result(dll, pattern);
+
+        if (res)
         {
-            return addr;
+            return res->addr;
         }
     }
 
-    return NULL;
-}
+    else if (game_scan_collecting)
+    {
+        return NULL;
+    }
 
-void* game_scan_pattern(const char* dll, const char* pattern, void* from)
-{
     MODULEINFO info;
 
     if (!GetModuleInformation(GetCurrentProcess(), GetModuleHandleA(dll), &info, sizeof(MODULEINFO)))
@@ -98,8 +281,8 @@ void* game_scan_pattern(const char* dll, const char* pattern, void* from)
         return NULL;
     }
 
-    GameScanPattern pattern_bytes = {};
-    game_pattern_bytes_from_string(pattern, &pattern_bytes);
+    SvrScanPattern pattern_bytes = {};
+    svr_scan_parse_pattern(pattern, &pattern_bytes);
 
     if (from == NULL)
     {
@@ -112,6 +295,9 @@ void* game_scan_pattern(const char* dll, const char* pattern, void* from)
         assert(((u8*)from >= info.lpBaseOfDll) && (u8*)from < ((u8*)info.lpBaseOfDll + info.SizeOfImage));
     }
 
-    void* ret = game_find_pattern(from, info.SizeOfImage, &pattern_bytes);
+    // Only search the rest of the module when continuing from a previous result.
+    s32 search_length = (s32)(((u8*)info.lpBaseOfDll + info.SizeOfImage) - (u8*)from);
+
+    void* ret = svr_scan_find((u8*)from, search_length, &pattern_bytes);
     return ret;
 }
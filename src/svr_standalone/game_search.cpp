@@ -1043,6 +1043,29 @@ GameFnProxy game_select_opts(GameProxyOpt* opts, s32 num, const char* array_name
     return {};
 }
 
+// Call all the functions to get the patterns they scan for, see game_scan_begin_collect.
+void game_collect_opts(GameOverrideOpt* opts, s32 num)
+{
+    for (s32 i = 0; i < num; i++)
+    {
+        if (opts[i].cond)
+        {
+            opts[i].func();
+        }
+    }
+}
+
+void game_collect_opts(GameProxyOpt* opts, s32 num)
+{
+    for (s32 i = 0; i < num; i++)
+    {
+        if (opts[i].cond)
+        {
+            opts[i].func();
+        }
+    }
+}
+
 bool game_lib_already_added(SvrDynArray<const char*>* libs, const char* test)
 {
     for (s32 i = 0; i < libs->size; i++)
@@ -1182,6 +1205,33 @@ void game_search_fill_desc(GameSearchDesc* desc)
 #define ALL_TRUE(OPTS) svr_check_all_true(OPTS, SVR_ARRAY_SIZE(OPTS))
 #define ANY_TRUE(OPTS) svr_check_one_true(OPTS, SVR_ARRAY_SIZE(OPTS))
 #define SELECT_CAPS(OPTS) game_select_caps(OPTS, SVR_ARRAY_SIZE(OPTS))
+#define COLLECT_OPT(OPTS) game_collect_opts(OPTS, SVR_ARRAY_SIZE(OPTS))
+
+    // Find all patterns at once first, so every module only has to be scanned through one time.
+    // The selection below then uses the found addresses.
+
+    game_scan_begin_collect();
+
+    COLLECT_OPT(GAME_START_MOVIE_OVERRIDES);
+    COLLECT_OPT(GAME_END_MOVIE_OVERRIDES);
+    COLLECT_OPT(GAME_FILTER_TIME_OVERRIDES);
+    COLLECT_OPT(GAME_CVAR_RESTRICT_PROXIES);
+    COLLECT_OPT(GAME_ENGINE_CLIENT_COMMAND_PROXIES);
+    COLLECT_OPT(GAME_CMD_ARGS_PROXIES);
+    COLLECT_OPT(GAME_D3D9EX_DEVICE_PTR_PROXIES);
+    COLLECT_OPT(GAME_ENTITY_VELOCITY_PROXIES);
+    COLLECT_OPT(GAME_PLAYER_BY_INDEX_PROXIES);
+    COLLECT_OPT(GAME_SPEC_TARGET_PROXIES);
+    COLLECT_OPT(GAME_LOCAL_PLAYER_PROXIES);
+    COLLECT_OPT(GAME_SPEC_TARGET_OR_LOCAL_PLAYER_PROXIES);
+    COLLECT_OPT(GAME_SND_PAINT_TIME_PROXIES);
+    COLLECT_OPT(GAME_SND_PAINT_CHANS_OVERRIDES);
+    COLLECT_OPT(GAME_SND_TX_STEREO_OVERRIDES);
+    COLLECT_OPT(GAME_SND_DEVICE_TX_SAMPLES_OVERRIDES);
+    COLLECT_OPT(GAME_SND_PAINT_BUFFER_PROXIES);
+    COLLECT_OPT(GAME_SIGNON_STATE_PROXIES);
+
+    game_scan_end_collect();
 
     // Core required:
     desc->start_movie_override = SELECT_OPT(GAME_START_MOVIE_OVERRIDES);
@@ -1224,6 +1274,8 @@ void game_search_fill_desc(GameSearchDesc* desc)
     // Autostop required:
     desc->signon_state_proxy = SELECT_OPT(GAME_SIGNON_STATE_PROXIES);
 
+    game_scan_free_results();
+
     // Engine constants. Maybe should scan for these instead.
     desc->signon_state_none = 0; // Not connected.
     desc->signon_state_full = 6; // Fully connected.
@@ -1335,4 +1387,5 @@ void game_search_fill_desc(GameSearchDesc* desc)
 #undef ALL_TRUE
 #undef ANY_TRUE
 #undef SELECT_CAPS
+#undef COLLECT_OPT
 }
@@ -0,0 +1,128 @@
+#include "game_priv.h"
+
+// Reporting of the progress to the launcher (see SvrGameStatus).
+// Nothing is reported when the game was not started by the launcher.
+
+const s64 GAME_STATUS_UPDATE_INTERVAL = 250000; // How often to send the progress when recording, in microseconds.
+
+void game_status_init(SvrGameInitData* init_data)
+{
+    if (init_data->status_mem_h == 0)
+    {
+        return;
+    }
+
+    game_state.status_mem_h = (HANDLE)(size_t)init_data->status_mem_h;
+    game_state.status_ptr = (SvrGameStatus*)MapViewOfFile(game_state.status_mem_h, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SvrGameStatus));
+
+    if (game_state.status_ptr == NULL)
+    {
+        return;
+    }
+
+    game_state.status_event_h = (HANDLE)(size_t)game_state.status_ptr->event_h;
+}
+
+// Must be paired with game_status_end_write. Only one thread must write at a time.
+SvrGameStatus* game_status_begin_write()
+{
+    SvrGameStatus* status = game_state.status_ptr;
+
+    if (status == NULL)
+    {
+        return NULL;
+    }
+
+    // Odd while writing.
+    svr_atom_add(&status->seq, 1);
+
+    return status;
+}
+
+void game_status_end_write(SvrGameStatus* status)
+{
+    svr_atom_add(&status->seq, 1);
+
+    SetEvent(game_state.status_event_h);
+}
+
+void game_status_set_state(SvrGameStatusState state)
+{
+    SvrGameStatus* status = game_status_begin_write();
+
+    if (status == NULL)
+    {
+        return;
+    }
+
+    status->state = state;
+
+    if (state == SVR_GAME_STATUS_RECORDING)
+    {
+        status->num_movies++;
+        status->num_frames = 0;
+        status->video_time = 0;
+        status->encode_fps = 0.0f;
+    }
+
+    game_status_end_write(status);
+
+    game_state.status_next_update_time = 0;
+}
+
+void game_status_set_error(const char* message)
+{
+    SvrGameStatus* status = game_status_begin_write();
+
+    if (status == NULL)
+    {
+        return;
+    }
+
+    SVR_COPY_STRING(message, status->error);
+    status->num_errors++;
+
+    game_status_end_write(status);
+}
+
+// Send the recording progress. The launcher is not in a hurry, so this is throttled.
+void game_status_update()
+{
+    if (game_state.status_ptr == NULL)
+    {
+        return;
+    }
+
+    s64 now = svr_prof_get_real_time();
+
+    if (now < game_state.status_next_update_time)
+    {
+        return;
+    }
+
+    game_state.status_next_update_time = now + GAME_STATUS_UPDATE_INTERVAL;
+
+    game_status_write_progress(now);
+}
+
+void game_status_write_progress(s64 now)
+{
+    SvrGameStatus* status = game_status_begin_write();
+
+    if (status == NULL)
+    {
+        return;
+    }
+
+    status->num_frames = game_state.rec_num_frames;
+    status->video_time = svr_rescale(game_state.rec_num_steps, 1000000, game_state.rec_game_rate);
+
+    s64 elapsed = now - game_state.rec_start_time;
+
+    if (elapsed > 0)
+    {
+        status->encode_fps = (float)((double)game_state.rec_num_frames / (elapsed / 1000000.0));
+    }
+
+    game_status_end_write(status);
+}
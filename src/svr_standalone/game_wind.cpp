@@ -52,7 +52,7 @@ void game_wind_update_title(s64 now)
 {
     // Transform number of frames in a unit of frames per second into an elapsed period in microseconds.
     // This is the video time.
-    SvrSplitTime video_split = svr_split_time(svr_rescale(game_state.rec_num_frames, 1000000, game_state.rec_game_rate));
+    SvrSplitTime video_split = svr_split_time(svr_rescale(game_state.rec_num_steps, 1000000, game_state.rec_game_rate));
 
     // This is the real elapsed time.
     SvrSplitTime real_split = svr_split_time(now - game_state.rec_start_time);
@@ -73,7 +73,7 @@ void game_wind_update_progress(s64 now)
 
     s64 end_frame = game_state.rec_timeout * game_state.rec_game_rate;
 
-    game_state.wind_taskbar_list->SetProgressValue(game_state.wind_hwnd, game_state.rec_num_frames, end_frame);
+    game_state.wind_taskbar_list->SetProgressValue(game_state.wind_hwnd, game_state.rec_num_steps, end_frame);
 }
 
 void game_wind_update()
@@ -6,6 +6,7 @@
 #include "game_scan.cpp"
 #include "game_hook.cpp"
 #include "game_wind.cpp"
+#include "game_status.cpp"
 #include "game_rec.cpp"
 #include "game_cfg.cpp"
 #include "game_proxies.cpp"
@@ -0,0 +1,117 @@
+#include "test_priv.h"
+#include "svr_audio.h"
+
+// Every version of svr_audio_pack_s32_to_s16 must clamp to the 16-bit range, for every length and at every place in the blocks.
+// The values around the limits are compared against what they must become, and random values against a plain clamp.
+// Nothing may be written past the end.
+bool test_audio_pack()
+{
+    struct Golden
+    {
+        s32 value;
+        s16 expected;
+    };
+
+    const Golden GOLDEN[] =
+    {
+        Golden { 0, 0 },
+        Golden { 1, 1 },
+        Golden { -1, -1 },
+        Golden { 12345, 12345 },
+        Golden { -12345, -12345 },
+        Golden { 32766, 32766 },
+        Golden { 32767, 32767 },
+        Golden { 32768, 32767 },
+        Golden { -32767, -32767 },
+        Golden { -32768, -32768 },
+        Golden { -32769, -32768 },
+        Golden { 65535, 32767 }, // Would be -1 if it wrapped around.
+        Golden { 65536, 32767 }, // Would be 0 if it wrapped around.
+        Golden { -65536, -32768 },
+        Golden { 98304, 32767 }, // Would be -32768 if it wrapped around.
+        Golden { 0x7FFF0000, 32767 },
+        Golden { INT32_MAX, 32767 },
+        Golden { INT32_MIN, -32768 },
+        Golden { INT32_MIN + 1, -32768 },
+    };
+
+    const s32 MAX_VALUES = 100;
+    const s16 GUARD = 0x5A5A;
+
+    s32 src[MAX_VALUES];
+    s16 expected[MAX_VALUES];
+    s16 dest_mem[MAX_VALUES + 2];
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+    u32 noise = 0x0badf00d;
+
+    for (s32 i = 0; i < test_get_num_kernels(); i++)
+    {
+        // Golden values in every order, and random values of every size.
+        for (s32 j = 0; j < 2; j++)
+        {
+            for (s32 offset = 0; offset < SVR_ARRAY_SIZE(GOLDEN); offset++)
+            {
+                for (s32 k = 0; k < MAX_VALUES; k++)
+                {
+                    if (j == 0)
+                    {
+                        const Golden* golden = &GOLDEN[(k + offset) % SVR_ARRAY_SIZE(GOLDEN)];
+                        src[k] = golden->value;
+                        expected[k] = golden->expected;
+                    }
+
+                    else
+                    {
+                        // Shift by a random amount so that there are both small and large values.
+                        src[k] = (s32)test_next_noise(&noise) >> (test_next_noise(&noise) % 24);
+
+                        s32 v = src[k];
+                        svr_clamp(&v, -32768, 32767);
+                        expected[k] = (s16)v;
+                    }
+                }
+
+                // Destinations that are and are not aligned to the blocks.
+                s16* dest = dest_mem + (offset & 1);
+
+                for (s32 num = 0; num <= MAX_VALUES; num++)
+                {
+                    for (s32 k = 0; k <= MAX_VALUES; k++)
+                    {
+                        dest[k] = GUARD;
+                    }
+
+                    svr_audio_pack_s32_to_s16_with_kernel(src, dest, num, i);
+
+                    bool ok = dest[num] == GUARD;
+
+                    for (s32 k = 0; k < num; k++)
+                    {
+                        ok &= dest[k] == expected[k];
+                    }
+
+                    if (!ok)
+                    {
+                        test_log("svr_audio_pack_s32_to_s16: %s with %d %s values starting at %d\n", TEST_KERNEL_NAMES[i], num, j == 0 ? "golden" : "random", offset);
+                        num_failed++;
+                    }
+
+                    num_checked++;
+                }
+            }
+        }
+    }
+
+    test_log("svr_audio_pack_s32_to_s16: %d of %d packs give the expected values\n", num_checked - num_failed, num_checked);
+
+    return num_failed == 0;
+}
+
+bool test_audio()
+{
+    bool ret = true;
+    ret &= test_audio_pack();
+    return ret;
+}
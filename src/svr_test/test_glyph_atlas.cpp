@@ -0,0 +1,251 @@
+#include "test_priv.h"
+#include "svr_glyph_atlas.h"
+#include <math.h>
+
+const s32 TEST_GLYPH_CELL_WIDTH = 7;
+const s32 TEST_GLYPH_CELL_HEIGHT = 9;
+const s32 TEST_GLYPH_ORIGIN_X = 2;
+const s32 TEST_GLYPH_ORIGIN_Y = 6;
+const s32 TEST_GLYPH_COUNT = 4;
+const s32 TEST_GLYPH_DEST_WIDTH = 23;
+const s32 TEST_GLYPH_DEST_HEIGHT = 17;
+const s32 TEST_GLYPH_DEST_PITCH = (TEST_GLYPH_DEST_WIDTH + 3) * 4; // Some space after every row that must not be written.
+const s32 TEST_GLYPH_GUARD_ROWS = 2; // Rows above and below the image that must not be written.
+const u8 TEST_GLYPH_GUARD = 0xA5;
+
+// Premultiplied BGRA pixel. Every value of alpha is as likely, but fully empty and fully covered are made more common since most of a glyph is one of these.
+u32 test_make_glyph_pixel(u32* noise)
+{
+    u32 v = test_next_noise(noise);
+
+    u32 a;
+
+    switch (v & 3)
+    {
+        case 0: a = 0; break;
+        case 1: a = 255; break;
+        default: a = (v >> 8) & 255; break;
+    }
+
+    u32 b = a == 0 ? 0 : test_next_noise(noise) % (a + 1);
+    u32 g = a == 0 ? 0 : test_next_noise(noise) % (a + 1);
+    u32 r = a == 0 ? 0 : test_next_noise(noise) % (a + 1);
+
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Premultiplied over of one pixel done in floats, rounded to the nearest value.
+void test_blend_pixel_reference(u8* d, const u8* s)
+{
+    double a = s[3] / 255.0;
+
+    for (s32 c = 0; c < 4; c++)
+    {
+        double v = s[c] + d[c] * (1.0 - a);
+        d[c] = (u8)svr_min(floor(v + 0.5), 255.0);
+    }
+}
+
+// Every pixel of a row put over another must be the float premultiplied over of the two, for every row length.
+// Nothing may be written past the end of the row.
+bool test_glyph_atlas_blend()
+{
+    const s32 MAX_PIXELS = 67;
+    const s32 NUM_ROUNDS = 50;
+
+    u8 source[MAX_PIXELS * 4];
+    u8 dest[(MAX_PIXELS + 1) * 4];
+    u8 expected[(MAX_PIXELS + 1) * 4];
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+    u32 noise = 0x600dcafe;
+
+    for (s32 i = 0; i < NUM_ROUNDS; i++)
+    {
+        for (s32 num = 0; num <= MAX_PIXELS; num++)
+        {
+            for (s32 j = 0; j < MAX_PIXELS; j++)
+            {
+                u32 s = test_make_glyph_pixel(&noise);
+                u32 d = test_next_noise(&noise);
+
+                // Also opaque destinations, like the video frames.
+                if (i & 1)
+                {
+                    d |= 0xff000000;
+                }
+
+                memcpy(source + (j * 4), &s, 4);
+                memcpy(dest + (j * 4), &d, 4);
+            }
+
+            memset(dest + (num * 4), TEST_GLYPH_GUARD, sizeof(dest) - (num * 4));
+            memcpy(expected, dest, sizeof(dest));
+
+            for (s32 j = 0; j < num; j++)
+            {
+                test_blend_pixel_reference(expected + (j * 4), source + (j * 4));
+            }
+
+            svr_glyph_atlas_blend_row(dest, source, num);
+
+            if (memcmp(dest, expected, sizeof(dest)))
+            {
+                s32 first_diff = 0;
+
+                while (dest[first_diff] == expected[first_diff])
+                {
+                    first_diff++;
+                }
+
+                test_log("svr_glyph_atlas_blend_row: %d pixels, value %d of pixel %d is %d instead of %d\n",
+                         num, first_diff & 3, first_diff >> 2, dest[first_diff], expected[first_diff]);
+
+                num_failed++;
+            }
+
+            num_checked++;
+        }
+    }
+
+    test_log("svr_glyph_atlas_blend_row: %d of %d rows give the float premultiplied over\n", num_checked - num_failed, num_checked);
+
+    return num_failed == 0;
+}
+
+// Lines of glyphs drawn at every place around the image, so that every glyph is clipped at every edge, and lines are entirely outside
+// on every side. Every pixel must be the float premultiplied over of the cells on it in the order of the line, and nothing outside the image may be written.
+bool test_glyph_atlas_draw_line()
+{
+    const float ADVANCES[] = { 5.5f, 7.0f, 9.25f }; // The first one makes the glyphs overlap, so the order matters.
+    const s32 GLYPHS[] = { 2, 0, 3, 3, 1 };
+    const s32 NUM_GLYPHS[] = { 0, 1, 5 };
+
+    s32 dest_size = TEST_GLYPH_DEST_PITCH * (TEST_GLYPH_DEST_HEIGHT + (2 * TEST_GLYPH_GUARD_ROWS));
+
+    u8* start_mem = (u8*)svr_alloc(dest_size);
+    u8* dest_mem = (u8*)svr_alloc(dest_size);
+    u8* expected_mem = (u8*)svr_alloc(dest_size);
+
+    u8* dest = dest_mem + (TEST_GLYPH_GUARD_ROWS * TEST_GLYPH_DEST_PITCH);
+    u8* expected = expected_mem + (TEST_GLYPH_GUARD_ROWS * TEST_GLYPH_DEST_PITCH);
+
+    u32 noise = 0x5eed1e55;
+
+    SvrGlyphAtlas atlas;
+    svr_glyph_atlas_init(&atlas, TEST_GLYPH_COUNT, TEST_GLYPH_CELL_WIDTH, TEST_GLYPH_CELL_HEIGHT, TEST_GLYPH_ORIGIN_X, TEST_GLYPH_ORIGIN_Y);
+
+    for (s32 i = 0; i < TEST_GLYPH_COUNT; i++)
+    {
+        u8* cell = svr_glyph_atlas_get_cell(&atlas, i);
+
+        for (s32 y = 0; y < TEST_GLYPH_CELL_HEIGHT; y++)
+        {
+            for (s32 x = 0; x < TEST_GLYPH_CELL_WIDTH; x++)
+            {
+                u32 v = test_make_glyph_pixel(&noise);
+                memcpy(cell + (y * atlas.pitch) + (x * 4), &v, 4);
+            }
+        }
+    }
+
+    memset(start_mem, TEST_GLYPH_GUARD, dest_size);
+
+    for (s32 y = 0; y < TEST_GLYPH_DEST_HEIGHT; y++)
+    {
+        for (s32 x = 0; x < TEST_GLYPH_DEST_WIDTH; x++)
+        {
+            u32 v = test_next_noise(&noise) | 0xff000000;
+            memcpy(start_mem + ((y + TEST_GLYPH_GUARD_ROWS) * TEST_GLYPH_DEST_PITCH) + (x * 4), &v, 4);
+        }
+    }
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(ADVANCES); i++)
+    {
+        float advance = ADVANCES[i];
+
+        for (s32 j = 0; j < SVR_ARRAY_SIZE(NUM_GLYPHS); j++)
+        {
+            s32 num_glyphs = NUM_GLYPHS[j];
+            s32 line_width = (s32)ceil(advance * SVR_ARRAY_SIZE(GLYPHS)) + TEST_GLYPH_CELL_WIDTH;
+
+            // From the whole line being left of the image to being right of it, and from above to below.
+            for (s32 y = -TEST_GLYPH_CELL_HEIGHT; y <= TEST_GLYPH_DEST_HEIGHT + TEST_GLYPH_CELL_HEIGHT; y++)
+            {
+                for (s32 x = -line_width; x <= TEST_GLYPH_DEST_WIDTH + TEST_GLYPH_CELL_WIDTH; x++)
+                {
+                    memcpy(dest_mem, start_mem, dest_size);
+                    memcpy(expected_mem, start_mem, dest_size);
+
+                    for (s32 k = 0; k < num_glyphs; k++)
+                    {
+                        u8* cell = svr_glyph_atlas_get_cell(&atlas, GLYPHS[k]);
+                        s32 left = x + (s32)floor(k * (double)advance + 0.5) - TEST_GLYPH_ORIGIN_X;
+                        s32 top = y - TEST_GLYPH_ORIGIN_Y;
+
+                        for (s32 cy = 0; cy < TEST_GLYPH_CELL_HEIGHT; cy++)
+                        {
+                            for (s32 cx = 0; cx < TEST_GLYPH_CELL_WIDTH; cx++)
+                            {
+                                s32 px = left + cx;
+                                s32 py = top + cy;
+
+                                if (px < 0 || px >= TEST_GLYPH_DEST_WIDTH || py < 0 || py >= TEST_GLYPH_DEST_HEIGHT)
+                                {
+                                    continue;
+                                }
+
+                                test_blend_pixel_reference(expected + (py * TEST_GLYPH_DEST_PITCH) + (px * 4), cell + (cy * atlas.pitch) + (cx * 4));
+                            }
+                        }
+                    }
+
+                    svr_glyph_atlas_draw_line(&atlas, GLYPHS, num_glyphs, advance, x, y,
+                                              dest, TEST_GLYPH_DEST_PITCH, TEST_GLYPH_DEST_WIDTH, TEST_GLYPH_DEST_HEIGHT);
+
+                    if (memcmp(dest_mem, expected_mem, dest_size))
+                    {
+                        s32 first_diff = 0;
+
+                        while (dest_mem[first_diff] == expected_mem[first_diff])
+                        {
+                            first_diff++;
+                        }
+
+                        s32 diff_y = (first_diff / TEST_GLYPH_DEST_PITCH) - TEST_GLYPH_GUARD_ROWS;
+                        s32 diff_x = (first_diff % TEST_GLYPH_DEST_PITCH) / 4;
+
+                        test_log("svr_glyph_atlas_draw_line: %d glyphs %.2f apart at %d %d, pixel %d %d is wrong\n",
+                                 num_glyphs, advance, x, y, diff_x, diff_y);
+
+                        num_failed++;
+                    }
+
+                    num_checked++;
+                }
+            }
+        }
+    }
+
+    test_log("svr_glyph_atlas_draw_line: %d of %d lines give the float premultiplied over of the cells\n", num_checked - num_failed, num_checked);
+
+    svr_glyph_atlas_free(&atlas);
+
+    svr_free(start_mem);
+    svr_free(dest_mem);
+    svr_free(expected_mem);
+
+    return num_failed == 0;
+}
+
+bool test_glyph_atlas()
+{
+    bool ret = true;
+    ret &= test_glyph_atlas_blend();
+    ret &= test_glyph_atlas_draw_line();
+    return ret;
+}
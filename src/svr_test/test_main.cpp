@@ -0,0 +1,72 @@
+#include "test_priv.h"
+
+// Started with "svr_test [name]" to run one test, or without a name to run all of them. Returns 1 if any test failed.
+
+struct TestEntry
+{
+    const char* name;
+    bool(*fn)();
+};
+
+const TestEntry TESTS[] =
+{
+    TestEntry { "scan", test_scan },
+    TestEntry { "scan_cache", test_scan_cache },
+    TestEntry { "audio", test_audio },
+    TestEntry { "subframes", test_subframes },
+    TestEntry { "mosample", test_mosample },
+    TestEntry { "glyph_atlas", test_glyph_atlas },
+};
+
+void test_log(const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    vprintf(format, va);
+    va_end(va);
+}
+
+const char* TEST_KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+s32 test_get_num_kernels()
+{
+    return svr_cpu_has_avx2() ? 3 : 2;
+}
+
+u32 test_next_noise(u32* noise)
+{
+    *noise ^= *noise << 13;
+    *noise ^= *noise >> 17;
+    *noise ^= *noise << 5;
+    return *noise;
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = argc >= 2 ? argv[1] : NULL;
+
+    s32 num_run = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(TESTS); i++)
+    {
+        if (name && strcmp(name, TESTS[i].name))
+        {
+            continue;
+        }
+
+        bool passed = TESTS[i].fn();
+        test_log("%s: %s\n", TESTS[i].name, passed ? "passed" : "FAILED");
+
+        num_run++;
+        num_failed += !passed;
+    }
+
+    if (num_run == 0)
+    {
+        test_log("There is no test named %s\n", name);
+        return 1;
+    }
+
+    return num_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,377 @@
+#include "test_priv.h"
+#include "svr_mosample.h"
+#include <math.h>
+
+const s32 TEST_MOSAMPLE_SOURCES = 16; // Different frames to cycle through.
+const s32 TEST_MOSAMPLE_ALIGN = 64; // Same as the video frame planes in svr_encoder.
+const s32 TEST_MOSAMPLE_THREADS = 4; // More than one, so that the rows are split in bands between the threads.
+
+// BGRA frames of a moving pattern with some noise, like the frames of the encoder benchmark.
+void test_make_mosample_sources(s32 width, s32 height, s32 pitch, u8** sources)
+{
+    u32 noise = 0x12345678;
+
+    for (s32 i = 0; i < TEST_MOSAMPLE_SOURCES; i++)
+    {
+        sources[i] = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+        memset(sources[i], 0, pitch * height);
+
+        for (s32 y = 0; y < height; y++)
+        {
+            u32* row = (u32*)(sources[i] + (y * pitch));
+
+            for (s32 x = 0; x < width; x++)
+            {
+                u32 v = test_next_noise(&noise);
+
+                u32 b = (x + i * 8) & 255;
+                u32 g = (y + i * 4) & 255;
+                u32 r = (((x + y) >> 2) + (v & 15)) & 255;
+
+                row[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+}
+
+// Weights of a frame in the fixed point check. Uneven weights are like an exposure that is not flat.
+void test_get_mosample_weights(s32 index, s32 num_frames, bool uneven, float* weight_start, float* weight_end)
+{
+    float start = index / (float)num_frames;
+    float end = (index + 1) / (float)num_frames;
+
+    if (uneven)
+    {
+        start *= start;
+        end *= end;
+    }
+
+    *weight_start = start;
+    *weight_end = index == num_frames - 1 ? 1.0f : end;
+}
+
+// Check the fixed point format against the float math it stands in for, with the sum done in doubles.
+// Every frame can add at most one step of rounding, and the table values can be off from the linear values by table_error steps,
+// so the fixed point result must be between the 8 bit values of the reference minus and plus that.
+// Frames that do not change must come back exactly, and the scalar and AVX2 versions must give the same result.
+bool test_mosample_fixed()
+{
+    const s32 NUM_FRAMES[] = { 2, 7, 32, 240 };
+
+    // Not a multiple of the vector sizes, so the ends of the rows are done by the scalar code in the AVX2 version.
+    s32 width = 509;
+    s32 height = 67;
+    s32 pitch = svr_align32(width * 4, TEST_MOSAMPLE_ALIGN);
+    s32 num_values = width * height * 4;
+
+    u8* sources[TEST_MOSAMPLE_SOURCES];
+    test_make_mosample_sources(width, height, pitch, sources);
+
+    u8* dests[2]; // Fixed point result of each kernel.
+    u8* float_dest = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+    double* reference = (double*)svr_alloc(sizeof(double) * num_values);
+
+    dests[0] = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+    dests[1] = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+
+    SvrMosample mosample;
+    svr_mosample_init(&mosample, width, height, SVR_MOSAMPLE_FORMAT_FIXED, TEST_MOSAMPLE_THREADS);
+
+    SvrMosample float_mosample;
+    svr_mosample_init(&float_mosample, width, height, SVR_MOSAMPLE_FORMAT_FLOAT, TEST_MOSAMPLE_THREADS);
+
+    bool has_avx2 = mosample.use_avx2;
+
+    double table_error = 0.0;
+
+    for (s32 i = 0; i < 256; i++)
+    {
+        table_error = svr_max(table_error, fabs(svr_mosample_to_fixed((u8)i) - svr_mosample_to_linear((u8)i) * 65535.0));
+    }
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+    s32 max_float_diff = 0;
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(NUM_FRAMES); i++)
+    {
+        s32 num_frames = NUM_FRAMES[i];
+
+        // Float products of the weights are not exact either, which is a lot less than a step for every frame.
+        double max_error = table_error + num_frames + num_frames / 64.0;
+
+        for (s32 j = 0; j < 2; j++)
+        {
+            bool uneven = j == 1;
+
+            memset(reference, 0, sizeof(double) * num_values);
+            svr_mosample_clear(&mosample);
+            svr_mosample_clear(&float_mosample);
+
+            for (s32 k = 0; k < num_frames; k++)
+            {
+                float weight_start;
+                float weight_end;
+                test_get_mosample_weights(k, num_frames, uneven, &weight_start, &weight_end);
+
+                u8* source = sources[k % TEST_MOSAMPLE_SOURCES];
+                double weight = ((double)weight_end - (double)weight_start) * 65535.0;
+
+                for (s32 y = 0; y < height; y++)
+                {
+                    for (s32 x = 0; x < width * 4; x++)
+                    {
+                        reference[(y * width * 4) + x] += svr_mosample_to_linear(source[(y * pitch) + x]) * weight;
+                    }
+                }
+
+                svr_mosample_add(&float_mosample, source, pitch, weight_start, weight_end);
+            }
+
+            svr_mosample_resolve(&float_mosample, float_dest, pitch);
+
+            for (s32 k = has_avx2 ? 0 : 1; k < 2; k++)
+            {
+                mosample.use_avx2 = k == 0;
+
+                svr_mosample_clear(&mosample);
+
+                for (s32 l = 0; l < num_frames; l++)
+                {
+                    float weight_start;
+                    float weight_end;
+                    test_get_mosample_weights(l, num_frames, uneven, &weight_start, &weight_end);
+
+                    svr_mosample_add(&mosample, sources[l % TEST_MOSAMPLE_SOURCES], pitch, weight_start, weight_end);
+                }
+
+                svr_mosample_resolve(&mosample, dests[k], pitch);
+
+                s64 num_outside = 0;
+
+                for (s32 y = 0; y < height; y++)
+                {
+                    for (s32 x = 0; x < width * 4; x++)
+                    {
+                        u8 v = dests[k][(y * pitch) + x];
+
+                        // Alpha is not summed in the fixed point format.
+                        if ((x & 3) == 3)
+                        {
+                            num_outside += v != 255;
+                            continue;
+                        }
+
+                        double sum = reference[(y * width * 4) + x];
+                        s32 low = (s32)floor(sum - max_error);
+                        s32 high = (s32)ceil(sum + max_error);
+                        svr_clamp(&low, 0, 65535);
+                        svr_clamp(&high, 0, 65535);
+
+                        num_outside += v < svr_mosample_from_fixed((u16)low) || v > svr_mosample_from_fixed((u16)high);
+                        max_float_diff = svr_max(max_float_diff, abs(v - float_dest[(y * pitch) + x]));
+                    }
+                }
+
+                if (num_outside != 0)
+                {
+                    test_log("svr_mosample fixed point: %d %s frames %s, %lld values are outside the error bound\n",
+                             num_frames, uneven ? "uneven" : "even", mosample.use_avx2 ? "avx2" : "scalar", num_outside);
+
+                    num_failed++;
+                }
+
+                num_checked++;
+            }
+
+            if (has_avx2)
+            {
+                s64 num_diffs = 0;
+
+                for (s32 y = 0; y < height; y++)
+                {
+                    num_diffs += memcmp(dests[0] + (y * pitch), dests[1] + (y * pitch), width * 4) != 0;
+                }
+
+                if (num_diffs != 0)
+                {
+                    test_log("svr_mosample fixed point: %d %s frames, %lld rows differ between avx2 and scalar\n",
+                             num_frames, uneven ? "uneven" : "even", num_diffs);
+
+                    num_failed++;
+                }
+
+                num_checked++;
+            }
+        }
+
+        // The same frame every time.
+        for (s32 k = has_avx2 ? 0 : 1; k < 2; k++)
+        {
+            mosample.use_avx2 = k == 0;
+
+            svr_mosample_clear(&mosample);
+
+            for (s32 l = 0; l < num_frames; l++)
+            {
+                float weight_start;
+                float weight_end;
+                test_get_mosample_weights(l, num_frames, true, &weight_start, &weight_end);
+
+                svr_mosample_add(&mosample, sources[0], pitch, weight_start, weight_end);
+            }
+
+            svr_mosample_resolve(&mosample, dests[k], pitch);
+
+            s64 num_diffs = 0;
+
+            for (s32 y = 0; y < height; y++)
+            {
+                num_diffs += memcmp(dests[k] + (y * pitch), sources[0] + (y * pitch), width * 4) != 0;
+            }
+
+            if (num_diffs != 0)
+            {
+                test_log("svr_mosample fixed point: %d frames of the same image %s, %lld rows do not come back exactly\n",
+                         num_frames, mosample.use_avx2 ? "avx2" : "scalar", num_diffs);
+
+                num_failed++;
+            }
+
+            num_checked++;
+        }
+    }
+
+    test_log("svr_mosample fixed point: %d of %d setups pass, the result differs from the float format by at most %d\n",
+             num_checked - num_failed, num_checked, max_float_diff);
+
+    svr_mosample_free(&mosample);
+    svr_mosample_free(&float_mosample);
+
+    svr_align_free(dests[0], TEST_MOSAMPLE_ALIGN);
+    svr_align_free(dests[1], TEST_MOSAMPLE_ALIGN);
+    svr_align_free(float_dest, TEST_MOSAMPLE_ALIGN);
+    svr_free(reference);
+
+    for (s32 i = 0; i < TEST_MOSAMPLE_SOURCES; i++)
+    {
+        svr_align_free(sources[i], TEST_MOSAMPLE_ALIGN);
+    }
+
+    return num_failed == 0;
+}
+
+// Where svr_mosample_resolve_rows puts the rows in the rows check.
+struct TestMosampleRows
+{
+    u8* dest;
+    s32 pitch;
+    s32 width;
+    s32* row_counts; // How many times every row was given.
+};
+
+// In mosample threads. Every row is only given to one thread, so the counts do not need to be atomic.
+void test_mosample_copy_row(void* param, s32 y, u8* row)
+{
+    TestMosampleRows* rows = (TestMosampleRows*)param;
+
+    memcpy(rows->dest + (y * rows->pitch), row, rows->width * 4);
+    rows->row_counts[y]++;
+}
+
+// Giving the rows to a function must give every row once, with the same values as resolving into an image.
+// Checked with both formats and with one and several threads, since the threads take the rows in bands.
+bool test_mosample_rows()
+{
+    const s32 THREAD_COUNTS[] = { 1, 3 };
+
+    s32 width = 509;
+    s32 height = 67;
+    s32 pitch = svr_align32(width * 4, TEST_MOSAMPLE_ALIGN);
+
+    u8* sources[TEST_MOSAMPLE_SOURCES];
+    test_make_mosample_sources(width, height, pitch, sources);
+
+    u8* dests[2]; // Resolved into an image, and given as rows.
+    dests[0] = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+    dests[1] = (u8*)svr_align_alloc(pitch * height, TEST_MOSAMPLE_ALIGN);
+
+    s32* row_counts = (s32*)svr_alloc(sizeof(s32) * height);
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < 2; i++)
+    {
+        for (s32 j = 0; j < SVR_ARRAY_SIZE(THREAD_COUNTS); j++)
+        {
+            SvrMosample mosample;
+            svr_mosample_init(&mosample, width, height, i, THREAD_COUNTS[j]);
+
+            for (s32 k = 0; k < TEST_MOSAMPLE_SOURCES; k++)
+            {
+                float weight_start;
+                float weight_end;
+                test_get_mosample_weights(k, TEST_MOSAMPLE_SOURCES, true, &weight_start, &weight_end);
+
+                svr_mosample_add(&mosample, sources[k], pitch, weight_start, weight_end);
+            }
+
+            memset(dests[0], 0, pitch * height);
+            memset(dests[1], 0, pitch * height);
+            memset(row_counts, 0, sizeof(s32) * height);
+
+            svr_mosample_resolve(&mosample, dests[0], pitch);
+
+            TestMosampleRows rows;
+            rows.dest = dests[1];
+            rows.pitch = pitch;
+            rows.width = width;
+            rows.row_counts = row_counts;
+
+            svr_mosample_resolve_rows(&mosample, test_mosample_copy_row, &rows);
+
+            s32 num_wrong_counts = 0;
+            s32 num_diffs = 0;
+
+            for (s32 y = 0; y < height; y++)
+            {
+                num_wrong_counts += row_counts[y] != 1;
+                num_diffs += memcmp(dests[0] + (y * pitch), dests[1] + (y * pitch), width * 4) != 0;
+            }
+
+            if (num_wrong_counts != 0 || num_diffs != 0)
+            {
+                test_log("svr_mosample_resolve_rows: %s with %d threads, %d rows are not given once and %d rows differ from svr_mosample_resolve\n",
+                         i == SVR_MOSAMPLE_FORMAT_FLOAT ? "float" : "fixed", THREAD_COUNTS[j], num_wrong_counts, num_diffs);
+
+                num_failed++;
+            }
+
+            num_checked++;
+
+            svr_mosample_free(&mosample);
+        }
+    }
+
+    test_log("svr_mosample_resolve_rows: %d of %d setups give the same rows as svr_mosample_resolve\n", num_checked - num_failed, num_checked);
+
+    svr_align_free(dests[0], TEST_MOSAMPLE_ALIGN);
+    svr_align_free(dests[1], TEST_MOSAMPLE_ALIGN);
+    svr_free(row_counts);
+
+    for (s32 i = 0; i < TEST_MOSAMPLE_SOURCES; i++)
+    {
+        svr_align_free(sources[i], TEST_MOSAMPLE_ALIGN);
+    }
+
+    return num_failed == 0;
+}
+
+bool test_mosample()
+{
+    bool ret = true;
+    ret &= test_mosample_fixed();
+    ret &= test_mosample_rows();
+    return ret;
+}
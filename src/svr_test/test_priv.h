@@ -0,0 +1,31 @@
+#pragma once
+#include "svr_common.h"
+#include "svr_alloc.h"
+#include "svr_platform.h"
+#include "svr_scan.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tests of the parts of svr_common that can be run without the game, Direct3D or FFmpeg.
+// Every test prints what did not match and returns false if anything did not.
+
+// Written to stdout, so that ctest shows it for the tests that fail.
+void test_log(const char* format, ...);
+
+// Names of the scalar, SSE2 and AVX2 versions, in the order of the kernel enums.
+extern const char* TEST_KERNEL_NAMES[];
+
+// The scalar and SSE2 versions can always be used, the AVX2 version only if the processor has it.
+s32 test_get_num_kernels();
+
+// Next value of a xorshift generator.
+u32 test_next_noise(u32* noise);
+
+bool test_scan();
+bool test_scan_cache();
+bool test_audio();
+bool test_subframes();
+bool test_mosample();
+bool test_glyph_atlas();
@@ -0,0 +1,339 @@
+#include "test_priv.h"
+
+const s32 TEST_SCAN_SIZE = 256 * 1024 + 77; // Not a whole number of blocks.
+const s32 TEST_SCAN_PATTERNS = 200;
+const s32 TEST_SCAN_BLOCK_SIZE = 1024 * 1024; // Same as SCAN_BLOCK_SIZE in svr_scan.cpp.
+const s32 TEST_SCAN_MANY_PATTERNS = 512; // Most patterns in a region in the svr_scan_find_many test.
+const s32 TEST_SCAN_MANY_PAST_END = 64; // Bytes after every region in the svr_scan_find_many test, which must not be searched.
+
+// Bytes that look somewhat like x86 code, where a few bytes are a lot more common than the rest (see SCAN_COMMON_BYTES in svr_scan.cpp).
+// Random bytes would almost never match the anchor bytes, so the full compare would hardly be tested.
+void test_fill_scan_image(u8* dest, s32 size, u32 noise)
+{
+    const u8 COMMON_BYTES[] = { 0x00, 0xFF, 0x8B, 0x48, 0x89, 0xCC, 0x0F, 0xE8 };
+
+    for (s32 i = 0; i < size; i++)
+    {
+        u32 v = test_next_noise(&noise);
+        dest[i] = (v & 3) != 0 ? COMMON_BYTES[(v >> 8) % SVR_ARRAY_SIZE(COMMON_BYTES)] : (u8)(v >> 16);
+    }
+}
+
+// Pattern of the bytes at some place, where every byte is unknown with a chance of 1 in unknown_chance.
+// Without a source, the known bytes are random and the pattern will most likely not match anywhere.
+void test_make_scan_pattern(const u8* source, s32 used, s32 unknown_chance, u32* noise, SvrScanPattern* out)
+{
+    char str[SVR_SCAN_MAX_BYTES * 3 + 1];
+    s32 pos = 0;
+
+    for (s32 i = 0; i < used; i++)
+    {
+        u32 v = test_next_noise(noise);
+
+        if (v % unknown_chance == 0)
+        {
+            pos += snprintf(str + pos, sizeof(str) - pos, "?? ");
+        }
+
+        else
+        {
+            pos += snprintf(str + pos, sizeof(str) - pos, "%02X ", source ? source[i] : (v >> 8) & 0xff);
+        }
+    }
+
+    svr_scan_parse_pattern(str, out);
+}
+
+// Byte by byte compare at every place, to compare the real versions with.
+u8* test_scan_find_simple(u8* start, s32 search_length, SvrScanPattern* pattern)
+{
+    for (s32 i = 0; i <= search_length - pattern->used; i++)
+    {
+        bool match = true;
+
+        for (s32 j = 0; j < pattern->used && match; j++)
+        {
+            match = pattern->bytes[j] == -1 || pattern->bytes[j] == start[i + j];
+        }
+
+        if (match)
+        {
+            return start + i;
+        }
+    }
+
+    return NULL;
+}
+
+// Fill an image and make patterns that are found at the start, in the middle and in the last bytes, or not at all.
+SvrScanPattern* test_make_scan_patterns(u8* image, s32 size, u32 noise)
+{
+    SvrScanPattern* patterns = SVR_ZALLOC_NUM(SvrScanPattern, TEST_SCAN_PATTERNS);
+
+    for (s32 i = 0; i < TEST_SCAN_PATTERNS; i++)
+    {
+        s32 used = 1 + (i % 40);
+        s32 offset = 0;
+
+        switch (i % 4)
+        {
+            case 0: offset = size - used - (i % 48); break; // Near the end.
+            case 1: offset = test_next_noise(&noise) % (size - used); break;
+            case 2: offset = i % 48; break; // Near the start.
+            case 3: offset = -1; break; // Random bytes.
+        }
+
+        test_make_scan_pattern(offset >= 0 ? image + offset : NULL, used, 4, &noise, &patterns[i]);
+    }
+
+    return patterns;
+}
+
+s64 test_get_scan_offset(u8* found, u8* image)
+{
+    return found ? (s64)(found - image) : -1;
+}
+
+// Every version of svr_scan_find must find the same place as the byte by byte compare, in the part of the image from start to end.
+bool test_scan_find_in(u8* image, s32 start, s32 end, SvrScanPattern* pattern)
+{
+    bool ret = true;
+
+    u8* expected = test_scan_find_simple(image + start, end - start, pattern);
+
+    for (s32 i = 0; i < test_get_num_kernels(); i++)
+    {
+        u8* found = svr_scan_find_with_kernel(image + start, end - start, pattern, i);
+
+        if (found != expected)
+        {
+            test_log("svr_scan_find: pattern of %d bytes from %d to %d, %s found %lld instead of %lld\n",
+                     pattern->used, start, end, TEST_KERNEL_NAMES[i], test_get_scan_offset(found, image), test_get_scan_offset(expected, image));
+
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+// The patterns are searched for in the whole image and in parts that start and end in different places.
+// The short parts at the end of the image start at every place in a block and end at every place near the patterns that are there,
+// so the last positions of the blocks and the positions that don't fill a whole block are both checked right next to a match.
+bool test_scan_find()
+{
+    const s32 WINDOW_STARTS[] = { 0, 1, 31 };
+    const s32 WINDOW_END_CUTS[] = { 0, 5 };
+    const s32 TAIL_SIZE = 300;
+
+    s32 size = TEST_SCAN_SIZE;
+    u8* image = (u8*)svr_alloc(size);
+
+    test_fill_scan_image(image, size, 0x13579bdf);
+    SvrScanPattern* patterns = test_make_scan_patterns(image, size, 0x2468ace1);
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < TEST_SCAN_PATTERNS; i++)
+    {
+        for (s32 j = 0; j < SVR_ARRAY_SIZE(WINDOW_STARTS); j++)
+        {
+            for (s32 k = 0; k < SVR_ARRAY_SIZE(WINDOW_END_CUTS); k++)
+            {
+                num_failed += !test_scan_find_in(image, WINDOW_STARTS[j], size - WINDOW_END_CUTS[k], &patterns[i]);
+                num_checked++;
+            }
+        }
+
+        for (s32 j = 0; j < 32; j++)
+        {
+            for (s32 k = 0; k <= 64; k++)
+            {
+                num_failed += !test_scan_find_in(image, size - TAIL_SIZE + j, size - k, &patterns[i]);
+                num_checked++;
+            }
+        }
+    }
+
+    test_log("svr_scan_find: %d of %d searches find the right place with every version\n", num_checked - num_failed, num_checked);
+
+    svr_free(patterns);
+    svr_free(image);
+
+    return num_failed == 0;
+}
+
+// Add a pattern of the bytes at offset, if it fits in the region and the bytes after it.
+void test_add_many_pattern(u8* data, s32 size, s32 offset, s32 used, u32* noise, SvrScanPattern* patterns, s32* num_patterns)
+{
+    if (offset < 0 || offset + used > size + TEST_SCAN_MANY_PAST_END || *num_patterns == TEST_SCAN_MANY_PATTERNS)
+    {
+        return;
+    }
+
+    test_make_scan_pattern(data + offset, used, 4, noise, &patterns[*num_patterns]);
+    (*num_patterns)++;
+}
+
+// Patterns for a region in the svr_scan_find_many test.
+s32 test_make_many_patterns(u8* data, s32 size, u32* noise, SvrScanPattern* patterns)
+{
+    s32 num = 0;
+
+    // Across every block boundary, at every place so that the anchor bytes are on both sides.
+    for (s32 i = TEST_SCAN_BLOCK_SIZE; i < size; i += TEST_SCAN_BLOCK_SIZE)
+    {
+        for (s32 j = 0; j <= 24; j++)
+        {
+            test_add_many_pattern(data, size, i - 24 + j, 24, noise, patterns, &num);
+        }
+    }
+
+    // At the start and at the end.
+    for (s32 i = 0; i < 8; i++)
+    {
+        test_add_many_pattern(data, size, i, 6 + i, noise, patterns, &num);
+        test_add_many_pattern(data, size, size - (6 + i) - i, 6 + i, noise, patterns, &num);
+    }
+
+    // Partly after the end, so they are only found if the search goes too far.
+    for (s32 i = 1; i < 8; i++)
+    {
+        test_add_many_pattern(data, size, size - 8 + i, 8, noise, patterns, &num);
+    }
+
+    // Short patterns that are found in many places, where the first place must be the result.
+    for (s32 i = 0; i < 32; i++)
+    {
+        s32 used = 1 + (i % 4);
+        test_add_many_pattern(data, size, test_next_noise(noise) % svr_max(size - used, 1), used, noise, patterns, &num);
+    }
+
+    // Longer patterns at random places.
+    for (s32 i = 0; i < 32; i++)
+    {
+        s32 used = 8 + (i % 33);
+        test_add_many_pattern(data, size, test_next_noise(noise) % svr_max(size - used, 1), used, noise, patterns, &num);
+    }
+
+    // Random bytes that are most likely not found anywhere, which are also longer than the small regions.
+    for (s32 i = 0; i < 16; i++)
+    {
+        test_make_scan_pattern(NULL, 8 + i * 3, 4, noise, &patterns[num]);
+        num++;
+    }
+
+    // Only unknown bytes, which match at the start if the region is long enough.
+    const s32 UNKNOWN_LENGTHS[] = { 1, 7, 64, SVR_SCAN_MAX_BYTES };
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(UNKNOWN_LENGTHS); i++)
+    {
+        test_make_scan_pattern(NULL, UNKNOWN_LENGTHS[i], 1, noise, &patterns[num]);
+        num++;
+    }
+
+    return num;
+}
+
+// svr_scan_find_many must give the same result as svr_scan_find for every pattern.
+// The regions are larger than a block and smaller than many of the patterns, and are filled with both code-like and random bytes.
+// Every region is followed by more bytes, so that a search that goes past the end can find a pattern there.
+bool test_scan_find_many()
+{
+    const s32 REGION_SIZES[] = { 3 * TEST_SCAN_BLOCK_SIZE + 123, TEST_SCAN_BLOCK_SIZE, 700, 10, 0 };
+    const s32 THREAD_COUNTS[] = { 1, 3, 8 };
+    const s32 NUM_REGIONS = SVR_ARRAY_SIZE(REGION_SIZES);
+
+    SvrScanRegion regions[NUM_REGIONS];
+    s32* expected[NUM_REGIONS];
+
+    u32 noise = 0x0f1e2d3c;
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < 2; i++)
+    {
+        for (s32 j = 0; j < NUM_REGIONS; j++)
+        {
+            SvrScanRegion* region = &regions[j];
+            region->size = REGION_SIZES[j];
+            region->data = (u8*)svr_alloc(region->size + TEST_SCAN_MANY_PAST_END);
+
+            if (i == 0)
+            {
+                test_fill_scan_image(region->data, region->size + TEST_SCAN_MANY_PAST_END, test_next_noise(&noise));
+            }
+
+            else
+            {
+                for (s32 k = 0; k < region->size + TEST_SCAN_MANY_PAST_END; k++)
+                {
+                    region->data[k] = (u8)test_next_noise(&noise);
+                }
+            }
+
+            region->patterns = SVR_ZALLOC_NUM(SvrScanPattern, TEST_SCAN_MANY_PATTERNS);
+            region->num_patterns = test_make_many_patterns(region->data, region->size, &noise, region->patterns);
+            region->results = SVR_ZALLOC_NUM(s32, TEST_SCAN_MANY_PATTERNS);
+
+            expected[j] = SVR_ZALLOC_NUM(s32, TEST_SCAN_MANY_PATTERNS);
+
+            for (s32 k = 0; k < region->num_patterns; k++)
+            {
+                u8* found = svr_scan_find(region->data, region->size, &region->patterns[k]);
+                expected[j][k] = (s32)test_get_scan_offset(found, region->data);
+            }
+        }
+
+        for (s32 j = 0; j < SVR_ARRAY_SIZE(THREAD_COUNTS); j++)
+        {
+            for (s32 k = 0; k < NUM_REGIONS; k++)
+            {
+                memset(regions[k].results, 0xAA, sizeof(s32) * TEST_SCAN_MANY_PATTERNS);
+            }
+
+            svr_scan_find_many(regions, NUM_REGIONS, THREAD_COUNTS[j]);
+
+            for (s32 k = 0; k < NUM_REGIONS; k++)
+            {
+                SvrScanRegion* region = &regions[k];
+
+                for (s32 l = 0; l < region->num_patterns; l++)
+                {
+                    if (region->results[l] != expected[k][l])
+                    {
+                        test_log("svr_scan_find_many: %s region of %d bytes with %d threads, pattern %d of %d bytes found at %d instead of %d\n",
+                                 i == 0 ? "code-like" : "random", region->size, THREAD_COUNTS[j], l, region->patterns[l].used,
+                                 region->results[l], expected[k][l]);
+
+                        num_failed++;
+                    }
+
+                    num_checked++;
+                }
+            }
+        }
+
+        for (s32 j = 0; j < NUM_REGIONS; j++)
+        {
+            svr_free(regions[j].data);
+            svr_free(regions[j].patterns);
+            svr_free(regions[j].results);
+            svr_free(expected[j]);
+        }
+    }
+
+    test_log("svr_scan_find_many: %d of %d results are the same as svr_scan_find\n", num_checked - num_failed, num_checked);
+
+    return num_failed == 0;
+}
+
+bool test_scan()
+{
+    bool ret = true;
+    ret &= test_scan_find();
+    ret &= test_scan_find_many();
+    return ret;
+}
@@ -0,0 +1,339 @@
+#include "test_priv.h"
+#include "svr_scan_cache.h"
+
+struct TestHashVector
+{
+    const char* text;
+    u64 hash;
+};
+
+struct TestHashLength
+{
+    s32 length;
+    u64 hash;
+};
+
+// Reference values of XXH64 with seed 0.
+const TestHashVector TEST_HASH_VECTORS[] =
+{
+    TestHashVector { "", 0xEF46DB3751D8E999ULL },
+    TestHashVector { "a", 0xD24EC4F1A98C6E5BULL },
+    TestHashVector { "abc", 0x44BC2CF5AD770999ULL },
+    TestHashVector { "message digest", 0x066ED728FCEEB3BEULL },
+    TestHashVector { "Nobody inspects the spammish repetition", 0xFBCEA83C8A378BF1ULL },
+    TestHashVector { "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 0xFD5E2CE9520872DDULL },
+};
+
+// Reference values of XXH64 with seed 0 for the start of the bytes of test_fill_hash_bytes.
+// Every way through the hash is taken: the tails of 1 to 31 bytes, and the 32 byte blocks with and without a tail.
+const TestHashLength TEST_HASH_LENGTHS[] =
+{
+    TestHashLength { 1, 0x8A4127811B21E730ULL },
+    TestHashLength { 3, 0x971B45123C017972ULL },
+    TestHashLength { 4, 0x3AB1F636641B9118ULL },
+    TestHashLength { 5, 0x19419EFA7B546AB2ULL },
+    TestHashLength { 7, 0x2694258517FB05EDULL },
+    TestHashLength { 8, 0x48C639F1E090807FULL },
+    TestHashLength { 9, 0xCFE4320F93FD3545ULL },
+    TestHashLength { 12, 0x6AC241CDD57A557BULL },
+    TestHashLength { 15, 0x6C35EAECD308A350ULL },
+    TestHashLength { 16, 0x46352EC31FA887A5ULL },
+    TestHashLength { 31, 0x8DB4FB151DB92E81ULL },
+    TestHashLength { 32, 0xDE421707D503BB0BULL },
+    TestHashLength { 33, 0x4DC140D3D98A44AEULL },
+    TestHashLength { 36, 0x9B7158F02C295AC9ULL },
+    TestHashLength { 63, 0xBBF08AE2DCCEE05DULL },
+    TestHashLength { 64, 0x0B520397EFD2875FULL },
+    TestHashLength { 65, 0x1164D18065DD6F72ULL },
+    TestHashLength { 100, 0x02CA9F38258887DDULL },
+    TestHashLength { 1000, 0xED41D3221C322FB5ULL },
+    TestHashLength { 4096, 0xEED81EA5F6ABF294ULL },
+};
+
+const s32 TEST_HASH_BYTES = 4096;
+
+void test_fill_hash_bytes(u8* dest, s32 size)
+{
+    for (s32 i = 0; i < size; i++)
+    {
+        dest[i] = (u8)((i * 131 + 7) >> 2);
+    }
+}
+
+bool test_scan_cache_hash()
+{
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(TEST_HASH_VECTORS); i++)
+    {
+        const TestHashVector* v = &TEST_HASH_VECTORS[i];
+        u64 hash = svr_scan_cache_hash(v->text, strlen(v->text));
+
+        if (hash != v->hash)
+        {
+            test_log("svr_scan_cache_hash: \"%s\" gives %016llx instead of %016llx\n", v->text, hash, v->hash);
+            num_failed++;
+        }
+
+        num_checked++;
+    }
+
+    // One byte in, so the reads are not aligned.
+    u8* bytes = (u8*)svr_alloc(TEST_HASH_BYTES + 1);
+    test_fill_hash_bytes(bytes + 1, TEST_HASH_BYTES);
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(TEST_HASH_LENGTHS); i++)
+    {
+        const TestHashLength* v = &TEST_HASH_LENGTHS[i];
+        u64 hash = svr_scan_cache_hash(bytes + 1, v->length);
+
+        if (hash != v->hash)
+        {
+            test_log("svr_scan_cache_hash: %d bytes give %016llx instead of %016llx\n", v->length, hash, v->hash);
+            num_failed++;
+        }
+
+        num_checked++;
+    }
+
+    svr_free(bytes);
+
+    test_log("svr_scan_cache_hash: %d of %d hashes are the same as XXH64\n", num_checked - num_failed, num_checked);
+
+    return num_failed == 0;
+}
+
+// Both caches must have the same entries in the same order.
+bool test_compare_scan_caches(SvrScanCache* a, SvrScanCache* b)
+{
+    if (a->entries.size != b->entries.size)
+    {
+        return false;
+    }
+
+    for (s32 i = 0; i < a->entries.size; i++)
+    {
+        SvrScanCacheEntry* x = &a->entries[i];
+        SvrScanCacheEntry* y = &b->entries[i];
+
+        if (strcmp(x->module, y->module) || x->module_hash != y->module_hash || strcmp(x->pattern, y->pattern) || x->rva != y->rva)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Add some results and save and load them again.
+bool test_scan_cache_round_trip()
+{
+    const char* PATH = "test_scan_cache.txt";
+
+    bool ret = true;
+
+    SvrScanCache cache = {};
+    svr_scan_cache_add(&cache, "client.dll", 0x0123456789ABCDEFULL, "8B 0D ?? ?? ?? ?? 85 C9", 0x1234);
+    svr_scan_cache_add(&cache, "client.dll", 0x0123456789ABCDEFULL, "55 8B EC", -1);
+    svr_scan_cache_add(&cache, "engine.dll", 0xFFFFFFFFFFFFFFFFULL, "??", 0);
+    svr_scan_cache_add(&cache, "engine.dll", 0, "E8 ?? ?? ?? ?? 84 C0 74", INT32_MAX);
+
+    // Replaced, not added again.
+    svr_scan_cache_add(&cache, "engine.dll", 0, "??", 77);
+
+    if (cache.entries.size != 4 || !cache.changed)
+    {
+        test_log("svr_scan_cache_add: %d entries instead of 4\n", cache.entries.size);
+        ret = false;
+    }
+
+    SvrScanCache loaded = {};
+
+    if (!svr_scan_cache_save(&cache, PATH))
+    {
+        test_log("svr_scan_cache_save: could not write %s\n", PATH);
+        ret = false;
+    }
+
+    else
+    {
+        if (cache.changed)
+        {
+            test_log("svr_scan_cache_save: the cache is still changed\n");
+            ret = false;
+        }
+
+        svr_scan_cache_load(&loaded, PATH);
+        svr_file_delete(PATH);
+
+        if (!test_compare_scan_caches(&cache, &loaded) || loaded.changed)
+        {
+            test_log("svr_scan_cache_load: the loaded cache is not the same as the saved cache\n");
+            ret = false;
+        }
+    }
+
+    s32 rva;
+
+    if (!svr_scan_cache_find(&loaded, "CLIENT.DLL", 0x0123456789ABCDEFULL, "8B 0D ?? ?? ?? ?? 85 C9", &rva) || rva != 0x1234)
+    {
+        test_log("svr_scan_cache_find: a loaded result is not found\n");
+        ret = false;
+    }
+
+    svr_scan_cache_free(&loaded);
+    svr_scan_cache_free(&cache);
+
+    test_log("svr_scan_cache round trip: %s\n", ret ? "the results are the same" : "failed");
+
+    return ret;
+}
+
+// Text that is not in the format must not be loaded at all, since a wrong offset would crash the game.
+bool test_scan_cache_parse()
+{
+    struct ParseCase
+    {
+        const char* text;
+        s32 num_entries; // -1 if the parse must fail.
+    };
+
+    const ParseCase CASES[] =
+    {
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B 0D ?? 85\n", 1 },
+        ParseCase { "SVR_SCAN_CACHE 1\r\n\r\nclient.dll 0123456789abcdef -1 8B 0D  \r\n\r\nengine.dll 1 0 ??\r\n", 2 }, // Empty lines and spaces at the end.
+        ParseCase { "SVR_SCAN_CACHE 1\n", 0 },
+        ParseCase { "", -1 },
+        ParseCase { "SVR_SCAN_CACHE 0\nclient.dll 0123456789abcdef 4660 8B\n", -1 }, // Other version.
+        ParseCase { "SVR_SCAN_CACHE 2\nclient.dll 0123456789abcdef 4660 8B\n", -1 },
+        ParseCase { "SVR_SCAN_CACHE\nclient.dll 0123456789abcdef 4660 8B\n", -1 },
+        ParseCase { "client.dll 0123456789abcdef 4660 8B\n", -1 }, // No header.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660\n", -1 }, // No pattern.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 \n", -1 },
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll xyz 4660 8B\n", -1 }, // Not a hash.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef x 8B\n", -1 }, // Not an offset.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef -2 8B\n", -1 }, // Offsets below -1.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8b 0d\n", -1 }, // Lower case.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B0D\n", -1 }, // No space between bytes.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B  0D\n", -1 }, // Two spaces.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B 0\n", -1 }, // Half a byte.
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B ?\n", -1 },
+        ParseCase { "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 4660 8B 0D\ngarbage\n", -1 }, // A bad line after a good one.
+    };
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+
+    // A pattern with one byte too many.
+    char* long_pattern = (char*)svr_alloc(128 + (SVR_SCAN_MAX_BYTES + 1) * 3);
+    s32 pos = sprintf(long_pattern, "SVR_SCAN_CACHE 1\nclient.dll 0123456789abcdef 0");
+
+    for (s32 i = 0; i < SVR_SCAN_MAX_BYTES + 1; i++)
+    {
+        pos += sprintf(long_pattern + pos, " 8B");
+    }
+
+    sprintf(long_pattern + pos, "\n");
+
+    for (s32 i = 0; i < SVR_ARRAY_SIZE(CASES) + 1; i++)
+    {
+        const char* text = i < SVR_ARRAY_SIZE(CASES) ? CASES[i].text : long_pattern;
+        s32 num_entries = i < SVR_ARRAY_SIZE(CASES) ? CASES[i].num_entries : -1;
+
+        SvrScanCache cache = {};
+        bool parsed = svr_scan_cache_parse(&cache, text);
+
+        if (parsed != (num_entries != -1) || cache.entries.size != svr_max(num_entries, 0))
+        {
+            test_log("svr_scan_cache_parse: case %d gives %s with %d entries instead of %s with %d entries\n",
+                     i, parsed ? "true" : "false", cache.entries.size, num_entries != -1 ? "true" : "false", svr_max(num_entries, 0));
+
+            num_failed++;
+        }
+
+        num_checked++;
+
+        svr_scan_cache_free(&cache);
+    }
+
+    svr_free(long_pattern);
+
+    test_log("svr_scan_cache_parse: %d of %d texts are accepted or rejected as they should be\n", num_checked - num_failed, num_checked);
+
+    return num_failed == 0;
+}
+
+// The results of a module are removed when the module has other contents, and only then.
+bool test_scan_cache_set_module()
+{
+    bool ret = true;
+
+    SvrScanCache cache = {};
+    svr_scan_cache_add(&cache, "client.dll", 1, "8B 0D", 10);
+    svr_scan_cache_add(&cache, "client.dll", 1, "85 C9", 20);
+    svr_scan_cache_add(&cache, "engine.dll", 2, "8B 0D", 30);
+    cache.changed = false;
+
+    s32 rva;
+
+    // Same contents, module names are not case sensitive.
+    svr_scan_cache_set_module(&cache, "CLIENT.DLL", 1);
+
+    if (cache.entries.size != 3 || cache.changed)
+    {
+        test_log("svr_scan_cache_set_module: results were removed for a module with the same contents\n");
+        ret = false;
+    }
+
+    // Looking up with another hash must not give the old result, even without set_module.
+    if (svr_scan_cache_find(&cache, "client.dll", 5, "8B 0D", &rva))
+    {
+        test_log("svr_scan_cache_find: a result was found for other contents\n");
+        ret = false;
+    }
+
+    svr_scan_cache_set_module(&cache, "Client.dll", 5);
+
+    if (cache.entries.size != 1 || !cache.changed)
+    {
+        test_log("svr_scan_cache_set_module: %d results are left instead of 1 for a module with other contents\n", cache.entries.size);
+        ret = false;
+    }
+
+    if (!svr_scan_cache_find(&cache, "engine.dll", 2, "8B 0D", &rva) || rva != 30)
+    {
+        test_log("svr_scan_cache_set_module: the results of another module were removed\n");
+        ret = false;
+    }
+
+    if (svr_scan_cache_find(&cache, "client.dll", 1, "8B 0D", &rva) || svr_scan_cache_find(&cache, "client.dll", 5, "85 C9", &rva))
+    {
+        test_log("svr_scan_cache_set_module: the old results of the module are still found\n");
+        ret = false;
+    }
+
+    svr_scan_cache_remove(&cache, "ENGINE.DLL", "8B 0D");
+
+    if (cache.entries.size != 0)
+    {
+        test_log("svr_scan_cache_remove: the result was not removed\n");
+        ret = false;
+    }
+
+    svr_scan_cache_free(&cache);
+
+    test_log("svr_scan_cache_set_module: %s\n", ret ? "only the results of changed modules are removed" : "failed");
+
+    return ret;
+}
+
+bool test_scan_cache()
+{
+    bool ret = true;
+    ret &= test_scan_cache_hash();
+    ret &= test_scan_cache_round_trip();
+    ret &= test_scan_cache_parse();
+    ret &= test_scan_cache_set_module();
+    return ret;
+}
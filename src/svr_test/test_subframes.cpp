@@ -0,0 +1,137 @@
+#include "test_priv.h"
+#include "svr_subframes.h"
+#include <math.h>
+
+// Weight of subframe idx worked out from how much of its time the shutter is open, for comparing the scheduler with.
+double test_get_subframe_weight(s32 mult, float exposure, s32 idx)
+{
+    if (exposure <= 0.0f)
+    {
+        return idx == mult ? 1.0 : 0.0;
+    }
+
+    double start = (idx - 1) / (double)mult;
+    double end = idx / (double)mult;
+    double open = 1.0 - (double)exposure;
+
+    return svr_max(end - svr_max(start, open), 0.0) / (double)exposure;
+}
+
+// The scheduler that svr_game uses for motion blur must give every subframe the weight of its open shutter time, with and without
+// skipping the subframes that have no weight. Checked for every mult from 2 to 240 and exposures from 0 to 1, for a few movie frames in a row.
+bool test_subframes_weights()
+{
+    const s32 MOVIE_FRAMES = 3;
+    const double MAX_ERROR = 1e-6;
+
+    s32 num_checked = 0;
+    s32 num_failed = 0;
+    s64 num_rendered = 0; // With skipping.
+    s64 num_skipped = 0;
+
+    for (s32 mult = 2; mult <= 240; mult++)
+    {
+        for (s32 i = 0; i <= 100; i++)
+        {
+            float exposure = i / 100.0f;
+
+            for (s32 j = 0; j < 2; j++)
+            {
+                SvrSubframes subs;
+                svr_subframes_init(&subs, mult, exposure);
+                subs.skip_closed = j == 1;
+
+                const char* error = NULL;
+                s32 pos = 0;
+
+                for (s32 k = 0; k < MOVIE_FRAMES && !error; k++)
+                {
+                    float prev_weight_end = 0.0f;
+                    double weight_sum = 0.0;
+                    bool ended = false;
+
+                    for (pos = 0; pos < mult && !error; )
+                    {
+                        s32 steps = svr_subframes_get_next_steps(&subs);
+
+                        if (steps < 1 || pos + steps > mult || (!subs.skip_closed && steps != 1))
+                        {
+                            error = "wrong number of steps";
+                            break;
+                        }
+
+                        for (s32 l = pos + 1; l < pos + steps; l++)
+                        {
+                            if (test_get_subframe_weight(mult, exposure, l) > 0.0)
+                            {
+                                error = "a subframe with weight is skipped";
+                            }
+                        }
+
+                        if (error)
+                        {
+                            break;
+                        }
+
+                        if (subs.skip_closed)
+                        {
+                            num_skipped += steps - 1;
+                            num_rendered++;
+                        }
+
+                        pos += steps;
+
+                        SvrSubframe sub = svr_subframes_advance(&subs);
+                        double weight = test_get_subframe_weight(mult, exposure, pos);
+                        weight_sum += weight;
+
+                        if (fabs(sub.weight - weight) > MAX_ERROR)
+                        {
+                            error = "wrong weight";
+                        }
+
+                        else if (sub.weight_start != prev_weight_end || fabs(sub.weight_end - weight_sum) > MAX_ERROR)
+                        {
+                            error = "wrong weight sum";
+                        }
+
+                        else if (sub.ends_frame != (pos == mult))
+                        {
+                            error = "movie frame ends at the wrong subframe";
+                        }
+
+                        prev_weight_end = sub.weight_end;
+                        ended = sub.ends_frame;
+                    }
+
+                    if (!error && (!ended || prev_weight_end != 1.0f))
+                    {
+                        error = "movie frame does not end with a weight sum of 1";
+                    }
+                }
+
+                if (error)
+                {
+                    test_log("svr_subframes: mult %d exposure %.2f %s skipping, %s at subframe %d\n",
+                             mult, exposure, subs.skip_closed ? "with" : "without", error, pos);
+
+                    num_failed++;
+                }
+
+                num_checked++;
+            }
+        }
+    }
+
+    test_log("svr_subframes: %d of %d setups give the weights of the exposure, skipping leaves out %.1f%% of the subframes\n",
+             num_checked - num_failed, num_checked, (100.0 * num_skipped) / (num_rendered + num_skipped));
+
+    return num_failed == 0;
+}
+
+bool test_subframes()
+{
+    bool ret = true;
+    ret &= test_subframes_weights();
+    return ret;
+}